@@ -0,0 +1,138 @@
+/**
+ * @file
+ * Batch conversion of points between LLH, ECEF and a local ENU frame.
+ *
+ * Points are stored as the columns of 3xN matrices, e.g. an
+ * `Eigen::Matrix3Xd` or a block of one. Each conversion works on the whole
+ * matrix with Eigen array expressions, using the WGS84 ellipsoid as in
+ * world_frame_conversions.hpp, and can be split over several threads.
+ *
+ * The output of a conversion must not overlap its input.
+ */
+
+#ifndef WAVE_GEOGRAPHY_LOCAL_FRAME_HPP
+#define WAVE_GEOGRAPHY_LOCAL_FRAME_HPP
+
+#include <Eigen/Core>
+
+namespace wave {
+
+/** Converts LLH points (Latitude [deg], Longitude [deg], Height [m]) to ECEF.
+ *
+ *  @param[in] llh the input points, one per column. Height is relative to the
+ *  WGS84 ellipsoid.
+ *  @param[out] ecef the corresponding points in the geocentric ECEF frame.
+ *  Must have the same number of columns as \p llh.
+ *  @param[in] num_threads number of threads to split the points over
+ */
+void ecefPointsFromLLH(const Eigen::Ref<const Eigen::Matrix3Xd> &llh,
+                       Eigen::Ref<Eigen::Matrix3Xd> ecef,
+                       int num_threads = 1);
+
+/** Converts ECEF points to LLH (Latitude [deg], Longitude [deg], Height [m]).
+ *
+ *  @param[in] ecef the input points in the geocentric ECEF frame, one per
+ *  column.
+ *  @param[out] llh the corresponding LLH points. Must have the same number of
+ *  columns as \p ecef.
+ *  @param[in] num_threads number of threads to split the points over
+ */
+void llhPointsFromECEF(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                       Eigen::Ref<Eigen::Matrix3Xd> llh,
+                       int num_threads = 1);
+
+/** Converts ECEF points to LLH with a fixed number of Bowring iterations.
+ *
+ *  This gives the same result as llhPointsFromECEF() to within the chosen
+ *  accuracy, but works on whole blocks of points at a time instead of calling
+ *  GeographicLib for each one. Compared with GeographicLib over the globe, the
+ *  latitude error is:
+ *  - no iterations: exact on the ellipsoid, about 30 m at 10 km of height
+ *  - 1 iteration: below 1 um up to 10 km of height, 0.1 mm at 100 km and
+ *  about 1 cm at 1000 km
+ *  - 2 iterations: within rounding error at any height
+ *
+ *  The height error is within rounding error with 1 or 2 iterations.
+ *
+ *  @param[in] ecef the input points in the geocentric ECEF frame, one per
+ *  column. Must not include the centre of the Earth.
+ *  @param[out] llh the corresponding LLH points. Must have the same number of
+ *  columns as \p ecef.
+ *  @param[in] iterations number of iterations. With 0 (or fewer), only the
+ *  initial guess, exact for points on the ellipsoid, is used.
+ *  @param[in] num_threads number of threads to split the points over
+ */
+void llhPointsFromECEFBowring(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                              Eigen::Ref<Eigen::Matrix3Xd> llh,
+                              int iterations = 2,
+                              int num_threads = 1);
+
+/** A local ENU frame defined by a datum point.
+ *
+ * The datum's ECEF position and the rotation from ENU to ECEF are computed
+ * once on construction, so converting many points against the same datum
+ * costs only a rotation and translation for each point, plus the LLH
+ * conversion if needed.
+ */
+class LocalFrame {
+ public:
+    /** Constructs the frame from a datum point.
+     *
+     *  @param[in] datum the LLH datum point defining the frame. If
+     *  \p datum_is_llh is false, the datum values are taken as ECEF instead.
+     *  @param[in] datum_is_llh \b true: The given datum values are LLH
+     *  (default). <BR>
+     *  \b false: The given datum values are ECEF
+     */
+    explicit LocalFrame(const double datum[3], bool datum_is_llh = true);
+
+    /** Constructs the frame from a datum point, as above */
+    explicit LocalFrame(const Eigen::Ref<const Eigen::Vector3d> &datum,
+                        bool datum_is_llh = true);
+
+    /** The datum as (Latitude [deg], Longitude [deg], Height [m]) */
+    const Eigen::Vector3d &datumLLH() const {
+        return this->datum_llh;
+    }
+
+    /** The datum, which is the origin of the ENU frame, in ECEF */
+    const Eigen::Vector3d &datumECEF() const {
+        return this->datum_ecef;
+    }
+
+    /** Rotation taking ENU vectors to ECEF */
+    const Eigen::Matrix3d &rotationECEFFromENU() const {
+        return this->R_ecef_enu;
+    }
+
+    /** Converts ENU points in this frame to ECEF. The output must have the
+     * same number of columns as the input. */
+    void ecefFromENU(const Eigen::Ref<const Eigen::Matrix3Xd> &enu,
+                     Eigen::Ref<Eigen::Matrix3Xd> ecef,
+                     int num_threads = 1) const;
+
+    /** Converts ECEF points to ENU in this frame */
+    void enuFromECEF(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                     Eigen::Ref<Eigen::Matrix3Xd> enu,
+                     int num_threads = 1) const;
+
+    /** Converts LLH points to ENU in this frame */
+    void enuFromLLH(const Eigen::Ref<const Eigen::Matrix3Xd> &llh,
+                    Eigen::Ref<Eigen::Matrix3Xd> enu,
+                    int num_threads = 1) const;
+
+    /** Converts ENU points in this frame to LLH, with two iterations of
+     * llhPointsFromECEFBowring() */
+    void llhFromENU(const Eigen::Ref<const Eigen::Matrix3Xd> &enu,
+                    Eigen::Ref<Eigen::Matrix3Xd> llh,
+                    int num_threads = 1) const;
+
+ private:
+    Eigen::Vector3d datum_llh;
+    Eigen::Vector3d datum_ecef;
+    Eigen::Matrix3d R_ecef_enu;
+};
+
+}  // namespace wave
+
+#endif  // WAVE_GEOGRAPHY_LOCAL_FRAME_HPP
@@ -38,6 +38,8 @@
 #define WAVE_GEOGRAPHY_WORLD_FRAME_CONVERSIONS_HPP
 
 #include <cmath>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
 #include <GeographicLib/Geocentric.hpp>
 #include <GeographicLib/LocalCartesian.hpp>
 
@@ -129,5 +131,48 @@ void llhPointFromENU(const double point_enu[3],
                      double point_llh[3],
                      bool datum_is_llh = true);
 
+/** @name Eigen versions
+ * These are equivalent to the functions above, but take and return Eigen
+ * types so that callers working with Eigen need not copy to and from arrays.
+ * Inputs may be blocks of larger matrices, such as a column of a 3xN matrix,
+ * and no heap memory is allocated. The functions above wrap these ones.
+ *
+ * To convert many points with the same datum, see LocalFrame.
+ */
+/** @{ */
+
+/** Converts a point from LLH to ECEF, as ecefPointFromLLH() above */
+Eigen::Vector3d ecefPointFromLLH(const Eigen::Ref<const Eigen::Vector3d> &llh);
+
+/** Converts a point from ECEF to LLH, as llhPointFromECEF() above */
+Eigen::Vector3d llhPointFromECEF(
+  const Eigen::Ref<const Eigen::Vector3d> &ecef);
+
+/** Computes the transform from a local datum-defined ENU frame to ECEF, as
+ *  ecefFromENUTransformMatrix() above */
+Eigen::Isometry3d ecefFromENUTransform(
+  const Eigen::Ref<const Eigen::Vector3d> &datum, bool datum_is_llh = true);
+
+/** Computes the transform from ECEF to a local datum-defined ENU frame, as
+ *  enuFromECEFTransformMatrix() above */
+Eigen::Isometry3d enuFromECEFTransform(
+  const Eigen::Ref<const Eigen::Vector3d> &datum, bool datum_is_llh = true);
+
+/** Converts a point from LLH to the local ENU frame defined by the datum, as
+ *  enuPointFromLLH() above */
+Eigen::Vector3d enuPointFromLLH(
+  const Eigen::Ref<const Eigen::Vector3d> &point_llh,
+  const Eigen::Ref<const Eigen::Vector3d> &enu_datum,
+  bool datum_is_llh = true);
+
+/** Converts a point from the local ENU frame defined by the datum to LLH, as
+ *  llhPointFromENU() above */
+Eigen::Vector3d llhPointFromENU(
+  const Eigen::Ref<const Eigen::Vector3d> &point_enu,
+  const Eigen::Ref<const Eigen::Vector3d> &enu_datum,
+  bool datum_is_llh = true);
+
+/** @} */
+
 }  // namespace wave
 #endif  // WAVE_GEOGRAPHY_WORLD_FRAME_CONVERSIONS_HPP
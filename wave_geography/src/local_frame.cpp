@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <GeographicLib/Geocentric.hpp>
+
+#include "wave/geography/local_frame.hpp"
+#include "wave/geography/world_frame_conversions.hpp"
+#include "wave/utils/parallel.hpp"
+
+namespace wave {
+
+namespace {
+
+const double kDegToRad = M_PI / 180.0;
+
+// Bowring iterations used by LocalFrame, accurate to rounding error
+const int kLocalFrameIterations = 2;
+
+/** Call f(start, count) on contiguous blocks of columns covering [0, n),
+ * one block for each of up to `num_threads` threads */
+template <typename F>
+void parallelBlocks(Eigen::Index n, int num_threads, const F &f) {
+    const Eigen::Index nb_blocks =
+      std::max<Eigen::Index>(1, std::min<Eigen::Index>(num_threads, n));
+    const Eigen::Index block_size = (n + nb_blocks - 1) / nb_blocks;
+    parallelFor(static_cast<int>(nb_blocks), num_threads, [&](int b) {
+        const Eigen::Index start = b * block_size;
+        const Eigen::Index count = std::min(block_size, n - start);
+        if (count > 0) {
+            f(start, count);
+        }
+    });
+}
+
+/** Closed-form LLH to ECEF conversion of a block of points */
+void ecefFromLLHBlock(const Eigen::Ref<const Eigen::Matrix3Xd> &llh,
+                      Eigen::Ref<Eigen::Matrix3Xd> ecef) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    const double a = earth.MajorRadius();
+    const double f = earth.Flattening();
+    const double e2 = f * (2 - f);
+
+    const Eigen::ArrayXd lat = kDegToRad * llh.row(0).transpose().array();
+    const Eigen::ArrayXd lon = kDegToRad * llh.row(1).transpose().array();
+    const auto h = llh.row(2).transpose().array();
+    const Eigen::ArrayXd sin_lat = lat.sin(), cos_lat = lat.cos();
+
+    // Prime vertical radius of curvature
+    const Eigen::ArrayXd N = a / (1 - e2 * sin_lat.square()).sqrt();
+    const Eigen::ArrayXd r = (N + h) * cos_lat;
+    ecef.row(0) = (r * lon.cos()).transpose();
+    ecef.row(1) = (r * lon.sin()).transpose();
+    ecef.row(2) = ((N * (1 - e2) + h) * sin_lat).transpose();
+}
+
+/** ECEF to LLH conversion of a block of points with GeographicLib */
+void llhFromECEFBlock(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                      Eigen::Ref<Eigen::Matrix3Xd> llh) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    for (Eigen::Index i = 0; i < ecef.cols(); i++) {
+        earth.Reverse(ecef(0, i),
+                      ecef(1, i),
+                      ecef(2, i),
+                      llh(0, i),
+                      llh(1, i),
+                      llh(2, i));
+    }
+}
+
+/** ECEF to LLH conversion of a block of points with Bowring's method.
+ *
+ * The parametric latitude beta is refined with a fixed number of iterations;
+ * with none, the latitude is that of the initial guess. Latitudes are kept
+ * as sine and cosine pairs, so only the final latitude and longitude need a
+ * trigonometric function. */
+void llhFromECEFBowringBlock(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                             Eigen::Ref<Eigen::Matrix3Xd> llh,
+                             int iterations) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    const double a = earth.MajorRadius();
+    const double f = earth.Flattening();
+    const double b = a * (1 - f);
+    const double e2 = f * (2 - f);
+    const double ep2 = e2 / (1 - e2);
+
+    const auto x = ecef.row(0).transpose().array();
+    const auto y = ecef.row(1).transpose().array();
+    const auto z = ecef.row(2).transpose().array();
+    const Eigen::ArrayXd p = (x.square() + y.square()).sqrt();
+
+    // Initial guess of the parametric latitude, exact on the ellipsoid
+    Eigen::ArrayXd sin_beta = z;
+    Eigen::ArrayXd cos_beta = (1 - f) * p;
+    Eigen::ArrayXd norm = (sin_beta.square() + cos_beta.square()).sqrt();
+    sin_beta /= norm;
+    cos_beta /= norm;
+
+    // tan(lat) = tan(beta) / (1 - f)
+    Eigen::ArrayXd sin_lat = sin_beta;
+    Eigen::ArrayXd cos_lat = (1 - f) * cos_beta;
+    norm = (sin_lat.square() + cos_lat.square()).sqrt();
+    sin_lat /= norm;
+    cos_lat /= norm;
+
+    for (int i = 0; i < iterations; i++) {
+        sin_lat = z + ep2 * b * sin_beta.cube();
+        cos_lat = p - e2 * a * cos_beta.cube();
+        norm = (sin_lat.square() + cos_lat.square()).sqrt();
+        sin_lat /= norm;
+        cos_lat /= norm;
+
+        // tan(beta) = (1 - f) tan(lat)
+        sin_beta = (1 - f) * sin_lat;
+        cos_beta = cos_lat;
+        norm = (sin_beta.square() + cos_beta.square()).sqrt();
+        sin_beta /= norm;
+        cos_beta /= norm;
+    }
+
+    for (Eigen::Index i = 0; i < ecef.cols(); i++) {
+        llh(0, i) = std::atan2(sin_lat(i), cos_lat(i)) / kDegToRad;
+        llh(1, i) = std::atan2(y(i), x(i)) / kDegToRad;
+    }
+    // Distance along the normal, stable at both the equator and the poles
+    llh.row(2) = (p * cos_lat + z * sin_lat -
+                  a * (1 - e2 * sin_lat.square()).sqrt())
+                   .transpose();
+}
+
+}  // namespace
+
+void ecefPointsFromLLH(const Eigen::Ref<const Eigen::Matrix3Xd> &llh,
+                       Eigen::Ref<Eigen::Matrix3Xd> ecef,
+                       int num_threads) {
+    assert(llh.cols() == ecef.cols());
+    parallelBlocks(llh.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        ecefFromLLHBlock(llh.middleCols(s, n), ecef.middleCols(s, n));
+    });
+}
+
+void llhPointsFromECEF(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                       Eigen::Ref<Eigen::Matrix3Xd> llh,
+                       int num_threads) {
+    assert(ecef.cols() == llh.cols());
+    parallelBlocks(ecef.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        llhFromECEFBlock(ecef.middleCols(s, n), llh.middleCols(s, n));
+    });
+}
+
+void llhPointsFromECEFBowring(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                              Eigen::Ref<Eigen::Matrix3Xd> llh,
+                              int iterations,
+                              int num_threads) {
+    assert(ecef.cols() == llh.cols());
+    parallelBlocks(ecef.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        llhFromECEFBowringBlock(
+          ecef.middleCols(s, n), llh.middleCols(s, n), iterations);
+    });
+}
+
+LocalFrame::LocalFrame(const double datum[3], bool datum_is_llh)
+    : LocalFrame{Eigen::Map<const Eigen::Vector3d>{datum}, datum_is_llh} {}
+
+LocalFrame::LocalFrame(const Eigen::Ref<const Eigen::Vector3d> &datum,
+                       bool datum_is_llh) {
+    const Eigen::Isometry3d T_ecef_enu =
+      ecefFromENUTransform(datum, datum_is_llh);
+    this->datum_ecef = T_ecef_enu.translation();
+    this->R_ecef_enu = T_ecef_enu.linear();
+    this->datum_llh = datum_is_llh ? Eigen::Vector3d{datum}
+                                   : llhPointFromECEF(datum);
+}
+
+void LocalFrame::ecefFromENU(const Eigen::Ref<const Eigen::Matrix3Xd> &enu,
+                             Eigen::Ref<Eigen::Matrix3Xd> ecef,
+                             int num_threads) const {
+    assert(enu.cols() == ecef.cols());
+    parallelBlocks(enu.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        ecef.middleCols(s, n).noalias() =
+          this->R_ecef_enu * enu.middleCols(s, n);
+        ecef.middleCols(s, n).colwise() += this->datum_ecef;
+    });
+}
+
+void LocalFrame::enuFromECEF(const Eigen::Ref<const Eigen::Matrix3Xd> &ecef,
+                             Eigen::Ref<Eigen::Matrix3Xd> enu,
+                             int num_threads) const {
+    assert(ecef.cols() == enu.cols());
+    parallelBlocks(ecef.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        enu.middleCols(s, n).noalias() =
+          this->R_ecef_enu.transpose() *
+          (ecef.middleCols(s, n).colwise() - this->datum_ecef);
+    });
+}
+
+void LocalFrame::enuFromLLH(const Eigen::Ref<const Eigen::Matrix3Xd> &llh,
+                            Eigen::Ref<Eigen::Matrix3Xd> enu,
+                            int num_threads) const {
+    assert(llh.cols() == enu.cols());
+    parallelBlocks(llh.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        // Convert in place in the output, then move to the local frame
+        auto out = enu.middleCols(s, n);
+        ecefFromLLHBlock(llh.middleCols(s, n), out);
+        out = this->R_ecef_enu.transpose() *
+              (out.colwise() - this->datum_ecef);
+    });
+}
+
+void LocalFrame::llhFromENU(const Eigen::Ref<const Eigen::Matrix3Xd> &enu,
+                            Eigen::Ref<Eigen::Matrix3Xd> llh,
+                            int num_threads) const {
+    assert(enu.cols() == llh.cols());
+    parallelBlocks(enu.cols(),
+                   num_threads,
+                   [&](Eigen::Index s, Eigen::Index n) {
+        Eigen::Matrix3Xd ecef = this->R_ecef_enu * enu.middleCols(s, n);
+        ecef.colwise() += this->datum_ecef;
+        llhFromECEFBowringBlock(
+          ecef, llh.middleCols(s, n), kLocalFrameIterations);
+    });
+}
+
+}  // namespace wave
@@ -34,173 +34,143 @@
  * ############################################################################
 */
 
-#include <Eigen/Core>
 #include "wave/geography/world_frame_conversions.hpp"
 
 namespace wave {
 
-void ecefPointFromLLH(const double llh[3], double ecef[3]) {
-    double latitude = llh[0], longitude = llh[1], height = llh[2];
+namespace {
 
-    GeographicLib::Geocentric earth = GeographicLib::Geocentric::WGS84();
+/** Computes the transform from ENU to ECEF at the given LLH datum.
+ *
+ * This is the same as GeographicLib's Forward() with a rotation matrix, which
+ * returns the rotation through a std::vector. Computing both here shares the
+ * trigonometric functions and avoids the heap allocation. */
+Eigen::Isometry3d ecefFromENUAtLLH(double latitude,
+                                   double longitude,
+                                   double height) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    const double a = earth.MajorRadius();
+    const double f = earth.Flattening();
+    const double e2 = f * (2 - f);
+
+    const double lat = latitude * M_PI / 180.0;
+    const double lon = longitude * M_PI / 180.0;
+    const double sp = std::sin(lat), cp = std::cos(lat);
+    const double sl = std::sin(lon), cl = std::cos(lon);
+
+    // Prime vertical radius of curvature
+    const double N = a / std::sqrt(1 - e2 * sp * sp);
+
+    Eigen::Isometry3d T_ecef_enu;
+    T_ecef_enu.translation() << (N + height) * cp * cl,
+      (N + height) * cp * sl, (N * (1 - e2) + height) * sp;
+    T_ecef_enu.linear() << -sl, -sp * cl, cp * cl,  //
+      cl, -sp * sl, cp * sl,                        //
+      0, cp, sp;
+    T_ecef_enu.makeAffine();
+    return T_ecef_enu;
+}
 
-    double X, Y, Z;
-    earth.Forward(latitude, longitude, height, X, Y, Z);
+}  // namespace
 
-    ecef[0] = X;
-    ecef[1] = Y;
-    ecef[2] = Z;
+Eigen::Vector3d ecefPointFromLLH(const Eigen::Ref<const Eigen::Vector3d> &llh) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    Eigen::Vector3d ecef;
+    earth.Forward(llh.x(), llh.y(), llh.z(), ecef.x(), ecef.y(), ecef.z());
+    return ecef;
 }
 
-void llhPointFromECEF(const double ecef[3], double llh[3]) {
-    double X = ecef[0], Y = ecef[1], Z = ecef[2];
+Eigen::Vector3d llhPointFromECEF(
+  const Eigen::Ref<const Eigen::Vector3d> &ecef) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    Eigen::Vector3d llh;
+    earth.Reverse(ecef.x(), ecef.y(), ecef.z(), llh.x(), llh.y(), llh.z());
+    return llh;
+}
+
+Eigen::Isometry3d ecefFromENUTransform(
+  const Eigen::Ref<const Eigen::Vector3d> &datum, bool datum_is_llh) {
+    if (datum_is_llh) {
+        return ecefFromENUAtLLH(datum.x(), datum.y(), datum.z());
+    }
 
-    GeographicLib::Geocentric earth = GeographicLib::Geocentric::WGS84();
+    // Datum is already given in ECEF, so keep it exactly
+    const Eigen::Vector3d datum_llh = llhPointFromECEF(datum);
+    Eigen::Isometry3d T_ecef_enu =
+      ecefFromENUAtLLH(datum_llh.x(), datum_llh.y(), datum_llh.z());
+    T_ecef_enu.translation() = datum;
+    return T_ecef_enu;
+}
+
+Eigen::Isometry3d enuFromECEFTransform(
+  const Eigen::Ref<const Eigen::Vector3d> &datum, bool datum_is_llh) {
+    return ecefFromENUTransform(datum, datum_is_llh).inverse();
+}
+
+Eigen::Vector3d enuPointFromLLH(
+  const Eigen::Ref<const Eigen::Vector3d> &point_llh,
+  const Eigen::Ref<const Eigen::Vector3d> &enu_datum,
+  bool datum_is_llh) {
+    return enuFromECEFTransform(enu_datum, datum_is_llh) *
+           ecefPointFromLLH(point_llh);
+}
+
+Eigen::Vector3d llhPointFromENU(
+  const Eigen::Ref<const Eigen::Vector3d> &point_enu,
+  const Eigen::Ref<const Eigen::Vector3d> &enu_datum,
+  bool datum_is_llh) {
+    return llhPointFromECEF(ecefFromENUTransform(enu_datum, datum_is_llh) *
+                            point_enu);
+}
 
-    double latitude, longitude, height;
-    earth.Reverse(X, Y, Z, latitude, longitude, height);
+// The raw array functions below are wrappers of the Eigen ones
 
-    llh[0] = latitude;
-    llh[1] = longitude;
-    llh[2] = height;
+void ecefPointFromLLH(const double llh[3], double ecef[3]) {
+    Eigen::Map<Eigen::Vector3d>{ecef} =
+      ecefPointFromLLH(Eigen::Map<const Eigen::Vector3d>{llh});
+}
+
+void llhPointFromECEF(const double ecef[3], double llh[3]) {
+    Eigen::Map<Eigen::Vector3d>{llh} =
+      llhPointFromECEF(Eigen::Map<const Eigen::Vector3d>{ecef});
 }
 
 void ecefFromENUTransformMatrix(const double datum[3],
                                 double T_ecef_enu[4][4],
                                 bool datum_is_llh) {
-    // Both Forward() and Reverse() return the same rotation matrix from ENU
-    // to ECEF
-    std::vector<double> R_ecef_enu(9, 0.0);
-    GeographicLib::Geocentric earth = GeographicLib::Geocentric::WGS84();
-    double datum_X, datum_Y, datum_Z;
-
-    if (datum_is_llh) {
-        double latitude = datum[0], longitude = datum[1], height = datum[2];
-
-        earth.Forward(
-          latitude, longitude, height, datum_X, datum_Y, datum_Z, R_ecef_enu);
-    } else {
-        // Datum is already given in ECEF
-        datum_X = datum[0];
-        datum_Y = datum[1];
-        datum_Z = datum[2];
-
-        double latitude, longitude, height;
-        earth.Reverse(
-          datum_X, datum_Y, datum_Z, latitude, longitude, height, R_ecef_enu);
-    }
-
-    T_ecef_enu[0][0] = R_ecef_enu[0];
-    T_ecef_enu[0][1] = R_ecef_enu[1];
-    T_ecef_enu[0][2] = R_ecef_enu[2];
-    T_ecef_enu[0][3] = datum_X;
-    T_ecef_enu[1][0] = R_ecef_enu[3];
-    T_ecef_enu[1][1] = R_ecef_enu[4];
-    T_ecef_enu[1][2] = R_ecef_enu[5];
-    T_ecef_enu[1][3] = datum_Y;
-    T_ecef_enu[2][0] = R_ecef_enu[6];
-    T_ecef_enu[2][1] = R_ecef_enu[7];
-    T_ecef_enu[2][2] = R_ecef_enu[8];
-    T_ecef_enu[2][3] = datum_Z;
-    T_ecef_enu[3][0] = 0.0;
-    T_ecef_enu[3][1] = 0.0;
-    T_ecef_enu[3][2] = 0.0;
-    T_ecef_enu[3][3] = 1.0;
+    Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>{T_ecef_enu[0]} =
+      ecefFromENUTransform(Eigen::Map<const Eigen::Vector3d>{datum},
+                           datum_is_llh)
+        .matrix();
 }
 
 void enuFromECEFTransformMatrix(const double datum[3],
                                 double T_enu_ecef[4][4],
                                 bool datum_is_llh) {
-    // Get T_ecef_enu and then invert it
-    double T_ecef_enu[4][4];
-    ecefFromENUTransformMatrix(datum, T_ecef_enu, datum_is_llh);
-
-    // Affine inverse: [R | t]^(-1) = [ R^T | - R^T * t]
-    // TODO(msmart/benskikos) - Move these functions to somewhere where we have
-    // matrix classes and ownership since it is ours. Manual transposition is
-    // undesirable. The below should be 2 lines:
-    // R_new = R.transpose(); t_new = - R.transpose()*t;
-    T_enu_ecef[0][0] = T_ecef_enu[0][0];
-    T_enu_ecef[0][1] = T_ecef_enu[1][0];
-    T_enu_ecef[0][2] = T_ecef_enu[2][0];
-    T_enu_ecef[1][0] = T_ecef_enu[0][1];
-    T_enu_ecef[1][1] = T_ecef_enu[1][1];
-    T_enu_ecef[1][2] = T_ecef_enu[2][1];
-    T_enu_ecef[2][0] = T_ecef_enu[0][2];
-    T_enu_ecef[2][1] = T_ecef_enu[1][2];
-    T_enu_ecef[2][2] = T_ecef_enu[2][2];
-
-    // Affine inverse translation component: -R_inverse * b
-    //    with b as the 4th column of T_ecef_enu
-    T_enu_ecef[0][3] = -T_enu_ecef[0][0] * T_ecef_enu[0][3]    //
-                       - T_enu_ecef[0][1] * T_ecef_enu[1][3]   //
-                       - T_enu_ecef[0][2] * T_ecef_enu[2][3];  //
-
-    T_enu_ecef[1][3] = -T_enu_ecef[1][0] * T_ecef_enu[0][3]    //
-                       - T_enu_ecef[1][1] * T_ecef_enu[1][3]   //
-                       - T_enu_ecef[1][2] * T_ecef_enu[2][3];  //
-
-    T_enu_ecef[2][3] = -T_enu_ecef[2][0] * T_ecef_enu[0][3]    //
-                       - T_enu_ecef[2][1] * T_ecef_enu[1][3]   //
-                       - T_enu_ecef[2][2] * T_ecef_enu[2][3];  //
-
-    // Last row is the same
-    T_enu_ecef[3][0] = 0.0;
-    T_enu_ecef[3][1] = 0.0;
-    T_enu_ecef[3][2] = 0.0;
-    T_enu_ecef[3][3] = 1.0;
+    Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>{T_enu_ecef[0]} =
+      enuFromECEFTransform(Eigen::Map<const Eigen::Vector3d>{datum},
+                           datum_is_llh)
+        .matrix();
 }
 
 void enuPointFromLLH(const double point_llh[3],
                      const double enu_datum[3],
                      double point_enu[3],
                      bool datum_is_llh) {
-    double enu_datum_llh[3];
-    if (datum_is_llh) {
-        enu_datum_llh[0] = enu_datum[0];
-        enu_datum_llh[1] = enu_datum[1];
-        enu_datum_llh[2] = enu_datum[2];
-    } else {
-        // Datum is ECEF
-        llhPointFromECEF(enu_datum, enu_datum_llh);
-    }
-
-    GeographicLib::Geocentric earth = GeographicLib::Geocentric::WGS84();
-    GeographicLib::LocalCartesian localENU(
-      enu_datum_llh[0], enu_datum_llh[1], enu_datum_llh[2], earth);
-
-    localENU.Forward(point_llh[0],
-                     point_llh[1],
-                     point_llh[2],
-                     point_enu[0],
-                     point_enu[1],
-                     point_enu[2]);
+    Eigen::Map<Eigen::Vector3d>{point_enu} =
+      enuPointFromLLH(Eigen::Map<const Eigen::Vector3d>{point_llh},
+                      Eigen::Map<const Eigen::Vector3d>{enu_datum},
+                      datum_is_llh);
 }
 
 void llhPointFromENU(const double point_enu[3],
                      const double enu_datum[3],
                      double point_llh[3],
                      bool datum_is_llh) {
-    double enu_datum_llh[3];
-    if (datum_is_llh) {
-        enu_datum_llh[0] = enu_datum[0];
-        enu_datum_llh[1] = enu_datum[1];
-        enu_datum_llh[2] = enu_datum[2];
-    } else {
-        // Datum is ECEF
-        llhPointFromECEF(enu_datum, enu_datum_llh);
-    }
-
-    GeographicLib::Geocentric earth = GeographicLib::Geocentric::WGS84();
-    GeographicLib::LocalCartesian localENU(
-      enu_datum_llh[0], enu_datum_llh[1], enu_datum_llh[2], earth);
-
-    localENU.Reverse(point_enu[0],
-                     point_enu[1],
-                     point_enu[2],
-                     point_llh[0],
-                     point_llh[1],
-                     point_llh[2]);
+    Eigen::Map<Eigen::Vector3d>{point_llh} =
+      llhPointFromENU(Eigen::Map<const Eigen::Vector3d>{point_enu},
+                      Eigen::Map<const Eigen::Vector3d>{enu_datum},
+                      datum_is_llh);
 }
 
 }  // namespace wave
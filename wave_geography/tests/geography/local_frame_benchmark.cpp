@@ -0,0 +1,157 @@
+/** @file
+ * Throughput of the per-point conversions against LocalFrame batches.
+ *
+ * Points are spread over about 20 km around a fixed datum. The argument is
+ * the number of points; the batch benchmarks also take a number of threads,
+ * after the number of iterations for llhPointsFromECEFBowring().
+ * Points per second are reported as items processed, using wall time since the
+ * batches run on several threads.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "wave/geography/local_frame.hpp"
+#include "wave/geography/world_frame_conversions.hpp"
+
+namespace wave {
+
+const double kDatum[3] = {43.472, -80.540, 330.0};
+
+/** Random LLH points around the datum */
+Eigen::Matrix3Xd randomLLH(Eigen::Index n) {
+    Eigen::Matrix3Xd llh = Eigen::Matrix3Xd::Random(3, n);
+    llh.row(0) = kDatum[0] + 0.1 * llh.row(0).array();
+    llh.row(1) = kDatum[1] + 0.1 * llh.row(1).array();
+    llh.row(2) = kDatum[2] + 500 * llh.row(2).array();
+    return llh;
+}
+
+void BM_EnuPointFromLLH(benchmark::State &state) {
+    const Eigen::Matrix3Xd llh = randomLLH(state.range(0));
+    Eigen::Matrix3Xd enu{3, llh.cols()};
+    for (auto _ : state) {
+        for (Eigen::Index i = 0; i < llh.cols(); i++) {
+            enuPointFromLLH(llh.col(i).data(), kDatum, enu.col(i).data());
+        }
+        benchmark::DoNotOptimize(enu.data());
+    }
+    state.SetItemsProcessed(state.iterations() * llh.cols());
+}
+
+void BM_LocalFrameEnuFromLLH(benchmark::State &state) {
+    const LocalFrame frame{kDatum};
+    const Eigen::Matrix3Xd llh = randomLLH(state.range(0));
+    Eigen::Matrix3Xd enu{3, llh.cols()};
+    for (auto _ : state) {
+        frame.enuFromLLH(llh, enu, state.range(1));
+        benchmark::DoNotOptimize(enu.data());
+    }
+    state.SetItemsProcessed(state.iterations() * llh.cols());
+}
+
+void BM_LlhPointFromENU(benchmark::State &state) {
+    const LocalFrame frame{kDatum};
+    Eigen::Matrix3Xd enu{3, state.range(0)};
+    frame.enuFromLLH(randomLLH(state.range(0)), enu);
+    Eigen::Matrix3Xd llh{3, enu.cols()};
+    for (auto _ : state) {
+        for (Eigen::Index i = 0; i < enu.cols(); i++) {
+            llhPointFromENU(enu.col(i).data(), kDatum, llh.col(i).data());
+        }
+        benchmark::DoNotOptimize(llh.data());
+    }
+    state.SetItemsProcessed(state.iterations() * enu.cols());
+}
+
+void BM_LocalFrameLlhFromENU(benchmark::State &state) {
+    const LocalFrame frame{kDatum};
+    Eigen::Matrix3Xd enu{3, state.range(0)};
+    frame.enuFromLLH(randomLLH(state.range(0)), enu);
+    Eigen::Matrix3Xd llh{3, enu.cols()};
+    for (auto _ : state) {
+        frame.llhFromENU(enu, llh, state.range(1));
+        benchmark::DoNotOptimize(llh.data());
+    }
+    state.SetItemsProcessed(state.iterations() * enu.cols());
+}
+
+void BM_EcefPointFromLLH(benchmark::State &state) {
+    const Eigen::Matrix3Xd llh = randomLLH(state.range(0));
+    Eigen::Matrix3Xd ecef{3, llh.cols()};
+    for (auto _ : state) {
+        for (Eigen::Index i = 0; i < llh.cols(); i++) {
+            ecefPointFromLLH(llh.col(i).data(), ecef.col(i).data());
+        }
+        benchmark::DoNotOptimize(ecef.data());
+    }
+    state.SetItemsProcessed(state.iterations() * llh.cols());
+}
+
+void BM_EcefPointsFromLLH(benchmark::State &state) {
+    const Eigen::Matrix3Xd llh = randomLLH(state.range(0));
+    Eigen::Matrix3Xd ecef{3, llh.cols()};
+    for (auto _ : state) {
+        ecefPointsFromLLH(llh, ecef, state.range(1));
+        benchmark::DoNotOptimize(ecef.data());
+    }
+    state.SetItemsProcessed(state.iterations() * llh.cols());
+}
+
+/** ECEF points of a regional map tile */
+Eigen::Matrix3Xd randomECEF(Eigen::Index n) {
+    Eigen::Matrix3Xd ecef{3, n};
+    ecefPointsFromLLH(randomLLH(n), ecef);
+    return ecef;
+}
+
+void BM_LlhPointFromECEF(benchmark::State &state) {
+    const Eigen::Matrix3Xd ecef = randomECEF(state.range(0));
+    Eigen::Matrix3Xd llh{3, ecef.cols()};
+    for (auto _ : state) {
+        for (Eigen::Index i = 0; i < ecef.cols(); i++) {
+            llhPointFromECEF(ecef.col(i).data(), llh.col(i).data());
+        }
+        benchmark::DoNotOptimize(llh.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ecef.cols());
+}
+
+void BM_LlhPointsFromECEFBowring(benchmark::State &state) {
+    const Eigen::Matrix3Xd ecef = randomECEF(state.range(0));
+    Eigen::Matrix3Xd llh{3, ecef.cols()};
+    for (auto _ : state) {
+        llhPointsFromECEFBowring(ecef, llh, state.range(1), state.range(2));
+        benchmark::DoNotOptimize(llh.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ecef.cols());
+}
+
+BENCHMARK(BM_EnuPointFromLLH)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LocalFrameEnuFromLLH)
+  ->Args({100000, 1})
+  ->Args({100000, 4})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LlhPointFromENU)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LocalFrameLlhFromENU)
+  ->Args({100000, 1})
+  ->Args({100000, 4})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EcefPointFromLLH)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EcefPointsFromLLH)
+  ->Args({100000, 1})
+  ->Args({100000, 4})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LlhPointFromECEF)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LlhPointsFromECEFBowring)
+  ->Args({100000, 1, 1})
+  ->Args({100000, 2, 1})
+  ->Args({100000, 2, 4})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
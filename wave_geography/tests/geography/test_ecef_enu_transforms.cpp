@@ -268,4 +268,47 @@ TEST_F(ECEFtoENUTest, IdentityPoint) {
     checkResult(datum_llh, R_ENU_ECEF_result);
 }
 
+// The Eigen transforms compute the rotation themselves, so check it against
+// the one GeographicLib gives, and against the array versions
+TEST_F(ECEFtoENUTest, EigenTransformsMatchGeographicLib) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    for (const double lat : {-near90, -45.0, 0.0, 30.0, near90}) {
+        for (const double lon : {-near180, -90.0, 0.0, 60.0, near180}) {
+            const Eigen::Vector3d datum_llh{lat, lon, 100.0};
+            Eigen::Vector3d datum_ecef;
+            std::vector<double> R(9);
+            earth.Forward(lat,
+                          lon,
+                          100.0,
+                          datum_ecef.x(),
+                          datum_ecef.y(),
+                          datum_ecef.z(),
+                          R);
+            const Eigen::Matrix3d expected_R =
+              Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>{
+                R.data()};
+
+            for (const bool is_llh : {true, false}) {
+                const Eigen::Vector3d &datum = is_llh ? datum_llh : datum_ecef;
+                const auto T_ecef_enu = ecefFromENUTransform(datum, is_llh);
+                const auto T_enu_ecef = enuFromECEFTransform(datum, is_llh);
+                EXPECT_TRUE(T_ecef_enu.linear().isApprox(
+                  expected_R, rotation_check_threshold));
+                EXPECT_TRUE(T_ecef_enu.translation().isApprox(datum_ecef));
+                EXPECT_TRUE((T_enu_ecef * T_ecef_enu)
+                              .matrix()
+                              .isIdentity(rotation_check_threshold));
+
+                double T_array[4][4];
+                enuFromECEFTransformMatrix(datum.data(), T_array, is_llh);
+                for (int r = 0; r < 4; r++) {
+                    for (int c = 0; c < 4; c++) {
+                        EXPECT_DOUBLE_EQ(T_enu_ecef(r, c), T_array[r][c]);
+                    }
+                }
+            }
+        }
+    }
+}
+
 }  // namespace wave
@@ -371,4 +371,30 @@ TEST_F(enuAndLLHPointConversionTest, LatAt0LongUnder180Neg) {
     checkResults(datum_llh, 10000.0);
 }
 
+// The Eigen functions accept columns of a larger matrix, and match the array
+// versions
+TEST_F(enuAndLLHPointConversionTest, EigenPointsMatchArrays) {
+    Eigen::Matrix<double, 3, 2> points;
+    points.col(0) << 43.472, -80.540, 330.0;
+    points.col(1) << 43.480, -80.520, 350.0;
+    const auto datum = points.col(0);
+
+    const Eigen::Vector3d enu = enuPointFromLLH(points.col(1), datum);
+    double enu_array[3];
+    enuPointFromLLH(points.col(1).data(), datum.data(), enu_array);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_DOUBLE_EQ(enu_array[i], enu(i));
+    }
+
+    const Eigen::Vector3d llh = llhPointFromENU(enu, datum);
+    EXPECT_TRUE(llh.isApprox(points.col(1), llh_check_threshold));
+
+    // Same with the datum given in ECEF
+    const Eigen::Vector3d datum_ecef = ecefPointFromLLH(datum);
+    EXPECT_TRUE(
+      llhPointFromECEF(datum_ecef).isApprox(datum, llh_check_threshold));
+    EXPECT_TRUE(enuPointFromLLH(points.col(1), datum_ecef, false)
+                  .isApprox(enu, cartesian_check_threshold));
+}
+
 }  // namespace wave
@@ -0,0 +1,224 @@
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include "wave/geography/local_frame.hpp"
+#include "wave/geography/world_frame_conversions.hpp"
+
+namespace wave {
+
+class LocalFrameTest : public ::testing::Test {
+ protected:
+    double cartesian_check_threshold = 1e-6;
+    double llh_check_threshold = 1e-9;
+
+    // Datums spread over the globe, away from the poles
+    std::vector<Eigen::Vector3d> datums{{43.472, -80.540, 330.0},
+                                        {-33.865, 151.209, 20.0},
+                                        {64.146, -21.942, 0.0},
+                                        {0.0, 0.0, -50.0}};
+
+    /** LLH points in a grid of about 20 km around a datum */
+    Eigen::Matrix3Xd gridAround(const Eigen::Vector3d &datum) const {
+        Eigen::Matrix3Xd llh{3, 0};
+        for (int i = -5; i <= 5; i++) {
+            for (int j = -5; j <= 5; j++) {
+                for (const double dh : {-100.0, 0.0, 2000.0}) {
+                    llh.conservativeResize(Eigen::NoChange, llh.cols() + 1);
+                    llh.col(llh.cols() - 1)
+                      << datum.x() + 0.02 * i,
+                      datum.y() + 0.02 * j, datum.z() + dh;
+                }
+            }
+        }
+        return llh;
+    }
+};
+
+TEST_F(LocalFrameTest, datumFromLLHOrECEF) {
+    for (const auto &datum_llh : this->datums) {
+        const LocalFrame from_llh{datum_llh.data()};
+
+        double datum_ecef[3];
+        ecefPointFromLLH(datum_llh.data(), datum_ecef);
+        EXPECT_TRUE(from_llh.datumECEF().isApprox(
+          Eigen::Map<Eigen::Vector3d>{datum_ecef}));
+
+        const LocalFrame from_ecef{datum_ecef, false};
+        EXPECT_NEAR(
+          datum_llh.x(), from_ecef.datumLLH().x(), llh_check_threshold);
+        EXPECT_NEAR(
+          datum_llh.y(), from_ecef.datumLLH().y(), llh_check_threshold);
+        EXPECT_NEAR(
+          datum_llh.z(), from_ecef.datumLLH().z(), cartesian_check_threshold);
+        EXPECT_TRUE(from_ecef.rotationECEFFromENU().isApprox(
+          from_llh.rotationECEFFromENU(), 1e-12));
+
+        // The rotation matches the per-point transform
+        double T_ecef_enu[4][4];
+        ecefFromENUTransformMatrix(datum_llh.data(), T_ecef_enu);
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                EXPECT_NEAR(T_ecef_enu[r][c],
+                            from_llh.rotationECEFFromENU()(r, c),
+                            1e-12);
+            }
+        }
+    }
+}
+
+TEST_F(LocalFrameTest, matchesPointFunctions) {
+    for (const auto &datum : this->datums) {
+        const LocalFrame frame{datum.data()};
+        const Eigen::Matrix3Xd llh = this->gridAround(datum);
+        const auto n = llh.cols();
+
+        Eigen::Matrix3Xd ecef{3, n}, enu{3, n}, llh_from_enu{3, n},
+          llh_from_ecef{3, n}, ecef_from_enu{3, n}, enu_from_ecef{3, n};
+        ecefPointsFromLLH(llh, ecef);
+        llhPointsFromECEF(ecef, llh_from_ecef);
+        frame.enuFromLLH(llh, enu);
+        frame.llhFromENU(enu, llh_from_enu);
+        frame.ecefFromENU(enu, ecef_from_enu);
+        frame.enuFromECEF(ecef, enu_from_ecef);
+
+        for (Eigen::Index i = 0; i < n; i++) {
+            double expected_ecef[3], expected_enu[3];
+            ecefPointFromLLH(llh.col(i).data(), expected_ecef);
+            enuPointFromLLH(llh.col(i).data(), datum.data(), expected_enu);
+
+            for (int k = 0; k < 3; k++) {
+                EXPECT_NEAR(expected_ecef[k], ecef(k, i),
+                            cartesian_check_threshold);
+                EXPECT_NEAR(expected_enu[k], enu(k, i),
+                            cartesian_check_threshold);
+                EXPECT_NEAR(expected_ecef[k], ecef_from_enu(k, i),
+                            cartesian_check_threshold);
+                EXPECT_NEAR(expected_enu[k], enu_from_ecef(k, i),
+                            cartesian_check_threshold);
+            }
+            for (int k = 0; k < 2; k++) {
+                EXPECT_NEAR(llh(k, i), llh_from_ecef(k, i),
+                            llh_check_threshold);
+                EXPECT_NEAR(llh(k, i), llh_from_enu(k, i),
+                            llh_check_threshold);
+            }
+            EXPECT_NEAR(llh(2, i), llh_from_ecef(2, i),
+                        cartesian_check_threshold);
+            EXPECT_NEAR(llh(2, i), llh_from_enu(2, i),
+                        cartesian_check_threshold);
+        }
+    }
+}
+
+TEST_F(LocalFrameTest, bowringMatchesGeographicLib) {
+    // Global grid, including the poles and the antimeridian
+    Eigen::Matrix3Xd llh{3, 37 * 24};
+    for (int i = 0; i <= 36; i++) {
+        for (int j = 0; j < 24; j++) {
+            llh.col(24 * i + j) << -90.0 + 5 * i, -180.0 + 15 * j, 0.0;
+        }
+    }
+
+    // Bounds on the latitude error in metres for each number of iterations,
+    // at increasing heights
+    const double earth_radius = 6.4e6;
+    const std::vector<double> heights{-1000.0, 10e3, 100e3, 1000e3};
+    const std::vector<std::vector<double>> max_errors{
+      {1e-6, 1e-6, 1e-4, 1e-2}, {1e-6, 1e-6, 1e-6, 1e-6}};
+
+    Eigen::Matrix3Xd ecef{3, llh.cols()}, expected{3, llh.cols()},
+      actual{3, llh.cols()};
+    for (size_t k = 0; k < heights.size(); k++) {
+        llh.row(2).setConstant(heights[k]);
+        ecefPointsFromLLH(llh, ecef);
+        llhPointsFromECEF(ecef, expected);
+
+        for (int iterations = 1; iterations <= 2; iterations++) {
+            const double max_error = max_errors[iterations - 1][k];
+            llhPointsFromECEFBowring(ecef, actual, iterations, 3);
+            for (Eigen::Index i = 0; i < llh.cols(); i++) {
+                const double lat_error =
+                  (actual(0, i) - expected(0, i)) * M_PI / 180 * earth_radius;
+                EXPECT_NEAR(0, lat_error, max_error);
+                EXPECT_NEAR(expected(2, i), actual(2, i), max_error);
+
+                // Longitude is exact, but may wrap at the antimeridian
+                const double dlon = std::remainder(
+                  actual(1, i) - expected(1, i), 360.0);
+                EXPECT_NEAR(0, dlon, llh_check_threshold);
+            }
+        }
+    }
+}
+
+TEST_F(LocalFrameTest, bowringWithoutIterations) {
+    Eigen::Matrix3Xd llh{3, 37 * 24};
+    for (int i = 0; i <= 36; i++) {
+        for (int j = 0; j < 24; j++) {
+            llh.col(24 * i + j) << -90.0 + 5 * i, -180.0 + 15 * j, 0.0;
+        }
+    }
+
+    // Only the initial guess, which is exact on the ellipsoid and close to
+    // it nearby
+    const double earth_radius = 6.4e6;
+    const std::vector<double> heights{0.0, 10e3};
+    const std::vector<double> max_lat_errors{1e-6, 50.0};
+    const std::vector<double> max_height_errors{1e-6, 1e-2};
+
+    Eigen::Matrix3Xd ecef{3, llh.cols()}, expected{3, llh.cols()},
+      actual{3, llh.cols()};
+    for (size_t k = 0; k < heights.size(); k++) {
+        llh.row(2).setConstant(heights[k]);
+        ecefPointsFromLLH(llh, ecef);
+        llhPointsFromECEF(ecef, expected);
+        for (int iterations : {0, -1}) {
+            llhPointsFromECEFBowring(ecef, actual, iterations, 3);
+            ASSERT_TRUE(actual.allFinite());
+            for (Eigen::Index i = 0; i < llh.cols(); i++) {
+                const double lat_error =
+                  (actual(0, i) - expected(0, i)) * M_PI / 180 * earth_radius;
+                EXPECT_NEAR(0, lat_error, max_lat_errors[k]);
+                EXPECT_NEAR(
+                  expected(2, i), actual(2, i), max_height_errors[k]);
+            }
+        }
+    }
+}
+
+TEST_F(LocalFrameTest, threadsAndBlocks) {
+    const auto &datum = this->datums.front();
+    const LocalFrame frame{datum.data()};
+    const Eigen::Matrix3Xd llh = this->gridAround(datum);
+    const auto n = llh.cols();
+
+    Eigen::Matrix3Xd expected{3, n};
+    frame.enuFromLLH(llh, expected);
+
+    // More threads than points must also work
+    for (const int num_threads : {2, 3, 8, 1000}) {
+        Eigen::Matrix3Xd enu{3, n};
+        frame.enuFromLLH(llh, enu, num_threads);
+        EXPECT_TRUE(enu.isApprox(expected));
+
+        Eigen::Matrix3Xd round_trip{3, n};
+        frame.llhFromENU(enu, round_trip, num_threads);
+        EXPECT_TRUE(round_trip.isApprox(llh, 1e-12));
+    }
+
+    // Blocks of a larger matrix, and single points
+    Eigen::Matrix<double, 3, 10> points = llh.leftCols<10>();
+    Eigen::Matrix<double, 6, 10> stacked;
+    frame.enuFromLLH(points, stacked.topRows<3>());
+    EXPECT_TRUE(stacked.topRows<3>().isApprox(expected.leftCols<10>()));
+
+    Eigen::Vector3d single;
+    frame.enuFromLLH(llh.col(5), single);
+    EXPECT_TRUE(single.isApprox(expected.col(5)));
+
+    // No points
+    Eigen::Matrix3Xd empty{3, 0};
+    frame.enuFromLLH(empty, empty, 4);
+}
+
+}  // namespace wave
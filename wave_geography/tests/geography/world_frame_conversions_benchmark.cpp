@@ -0,0 +1,112 @@
+/** @file
+ * Per-call overhead of the single point conversions.
+ *
+ * Each benchmark converts one point or datum per iteration, as callers holding
+ * Eigen vectors do. The array functions are called the way such callers used
+ * to, copying to and from arrays, and the Eigen functions directly. Getting
+ * the rotation from GeographicLib, through a std::vector, is the baseline for
+ * the transforms.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/geography/world_frame_conversions.hpp"
+
+namespace wave {
+
+const Eigen::Vector3d kDatum{43.472, -80.540, 330.0};
+const Eigen::Vector3d kPoint{43.480, -80.520, 350.0};
+
+void BM_EcefPointFromLLHArray(benchmark::State &state) {
+    Eigen::Vector3d ecef;
+    for (auto _ : state) {
+        double llh_array[3] = {kPoint.x(), kPoint.y(), kPoint.z()};
+        double ecef_array[3];
+        ecefPointFromLLH(llh_array, ecef_array);
+        ecef << ecef_array[0], ecef_array[1], ecef_array[2];
+        benchmark::DoNotOptimize(ecef);
+    }
+}
+
+void BM_EcefPointFromLLHEigen(benchmark::State &state) {
+    Eigen::Vector3d ecef;
+    for (auto _ : state) {
+        ecef = ecefPointFromLLH(kPoint);
+        benchmark::DoNotOptimize(ecef);
+    }
+}
+
+void BM_EnuPointFromLLHArray(benchmark::State &state) {
+    Eigen::Vector3d enu;
+    for (auto _ : state) {
+        double llh_array[3] = {kPoint.x(), kPoint.y(), kPoint.z()};
+        double datum_array[3] = {kDatum.x(), kDatum.y(), kDatum.z()};
+        double enu_array[3];
+        enuPointFromLLH(llh_array, datum_array, enu_array);
+        enu << enu_array[0], enu_array[1], enu_array[2];
+        benchmark::DoNotOptimize(enu);
+    }
+}
+
+void BM_EnuPointFromLLHEigen(benchmark::State &state) {
+    Eigen::Vector3d enu;
+    for (auto _ : state) {
+        enu = enuPointFromLLH(kPoint, kDatum);
+        benchmark::DoNotOptimize(enu);
+    }
+}
+
+void BM_TransformGeographicLib(benchmark::State &state) {
+    const auto &earth = GeographicLib::Geocentric::WGS84();
+    Eigen::Affine3d T_ecef_enu = Eigen::Affine3d::Identity();
+    for (auto _ : state) {
+        std::vector<double> R(9);
+        earth.Forward(kDatum.x(),
+                      kDatum.y(),
+                      kDatum.z(),
+                      T_ecef_enu.translation().x(),
+                      T_ecef_enu.translation().y(),
+                      T_ecef_enu.translation().z(),
+                      R);
+        T_ecef_enu.linear() =
+          Eigen::Map<Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>{R.data()};
+        benchmark::DoNotOptimize(T_ecef_enu);
+    }
+}
+
+void BM_TransformMatrixArray(benchmark::State &state) {
+    Eigen::Affine3d T_ecef_enu;
+    for (auto _ : state) {
+        double datum_array[3] = {kDatum.x(), kDatum.y(), kDatum.z()};
+        double T_array[4][4];
+        ecefFromENUTransformMatrix(datum_array, T_array);
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) {
+                T_ecef_enu.matrix()(r, c) = T_array[r][c];
+            }
+        }
+        benchmark::DoNotOptimize(T_ecef_enu);
+    }
+}
+
+void BM_TransformEigen(benchmark::State &state) {
+    Eigen::Isometry3d T_ecef_enu;
+    for (auto _ : state) {
+        T_ecef_enu = ecefFromENUTransform(kDatum);
+        benchmark::DoNotOptimize(T_ecef_enu);
+    }
+}
+
+BENCHMARK(BM_EcefPointFromLLHArray);
+BENCHMARK(BM_EcefPointFromLLHEigen);
+BENCHMARK(BM_EnuPointFromLLHArray);
+BENCHMARK(BM_EnuPointFromLLHEigen);
+BENCHMARK(BM_TransformGeographicLib);
+BENCHMARK(BM_TransformMatrixArray);
+BENCHMARK(BM_TransformEigen);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
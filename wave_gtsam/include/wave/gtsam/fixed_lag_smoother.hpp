@@ -0,0 +1,181 @@
+#ifndef WAVE_FIXED_LAG_SMOOTHER_HPP
+#define WAVE_FIXED_LAG_SMOOTHER_HPP
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "wave/containers/measurement.hpp"
+
+/**
+ * Fixed-lag smoothing of any factor graph, e.g. GPSFactorWBias and
+ * DecayingBias factors with odometry between poses.
+ *
+ * Each variable is added with a timestamp. After each update, variables older
+ * than the lag before the newest one are marginalized: the factors involving
+ * them are linearized at the current estimate, the old variables are
+ * eliminated, and the marginal on the remaining variables is kept as
+ * gtsam::LinearContainerFactors. The size of the problem, and so the time
+ * taken by each update, is then bounded by the lag.
+ *
+ * Updates may also be queued and run on a worker thread. Queued updates are
+ * all added before optimizing once, so the worker keeps up with the sensors
+ * even if one optimization takes longer than the time between measurements.
+ *
+ * IncrementalEstimator also has a lag, but serves a different purpose: it
+ * builds its own IMU/GPS graph of PoseVelBias states, and relies on iSAM2
+ * to update only the part of the solution affected by new factors. This
+ * class takes factors and variables of any type from the caller, and bounds
+ * the time of each update by re-solving only the window, with a limit on the
+ * iterations and time spent, off the caller's thread if needed.
+ */
+
+namespace wave {
+
+struct FixedLagSmootherParams {
+    /// Variables with a timestamp more than this many seconds before the
+    /// newest one are marginalized
+    double lag = 5.0;
+
+    /// Maximum Levenberg-Marquardt iterations per update
+    int max_iterations = 10;
+
+    /// Iterations stop once an update has taken this many seconds. If zero or
+    /// negative, only `max_iterations` bounds the time taken.
+    double max_update_time = 0.0;
+
+    /// Iterations stop once the error decreases by less than this fraction
+    double relative_error_tol = 1e-5;
+
+    /// If true, updates from `queueUpdate()` are run on a worker thread
+    bool worker_thread = false;
+};
+
+class FixedLagSmoother {
+ public:
+    /** Time of each variable, used to decide when to marginalize it */
+    using KeyTimestampMap = std::map<gtsam::Key, TimePoint>;
+
+    explicit FixedLagSmoother(
+      const FixedLagSmootherParams &params = FixedLagSmootherParams{});
+
+    /** Stops the worker thread, dropping any queued updates */
+    ~FixedLagSmoother();
+
+    FixedLagSmoother(const FixedLagSmoother &) = delete;
+    FixedLagSmoother &operator=(const FixedLagSmoother &) = delete;
+
+    /** Add factors and variables, then optimize and marginalize
+     *
+     * @param factors new factors, which may only involve variables in
+     * `values` or still in the smoother
+     * @param values initial estimates of new variables
+     * @param timestamps the time of each new variable
+     * @returns 0 on success, -1 if a new variable is already in the smoother
+     * or has no timestamp, if a factor involves a variable that is unknown
+     * or marginalized, or if optimization fails. Nothing is added if the
+     * inputs are invalid.
+     */
+    int update(const gtsam::NonlinearFactorGraph &factors,
+               const gtsam::Values &values,
+               const KeyTimestampMap &timestamps);
+
+    /** Queue an update for the worker thread, and return immediately
+     *
+     * Without a worker thread, the update is done before returning. Invalid
+     * updates are logged and dropped.
+     */
+    void queueUpdate(const gtsam::NonlinearFactorGraph &factors,
+                     const gtsam::Values &values,
+                     const KeyTimestampMap &timestamps);
+
+    /** Wait until the worker thread has done every queued update */
+    void waitUntilIdle();
+
+    /** Current estimate of every variable not yet marginalized */
+    gtsam::Values calculateEstimate() const;
+
+    /** Current estimate of one variable
+     *
+     * @returns false if there is no such variable, e.g. if it has been
+     * marginalized
+     */
+    template <typename T>
+    bool calculateEstimate(gtsam::Key key, T &value) const {
+        std::lock_guard<std::mutex> lock{this->estimate_mutex};
+        if (!this->estimate.exists(key)) {
+            return false;
+        }
+        value = this->estimate.at<T>(key);
+        return true;
+    }
+
+    /** Number of variables not yet marginalized */
+    size_t numActiveKeys() const;
+
+    /** Number of factors in the window, including marginals */
+    size_t numFactors() const;
+
+    /** Time taken by the last update, in seconds */
+    double lastUpdateDuration() const;
+
+ private:
+    /** An update waiting for the worker thread */
+    struct QueuedUpdate {
+        gtsam::NonlinearFactorGraph factors;
+        gtsam::Values values;
+        KeyTimestampMap timestamps;
+    };
+
+    FixedLagSmootherParams params;
+
+    /// Factors, linearization point and times of the variables in the window.
+    /// Guarded by `update_mutex`.
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values theta;
+    KeyTimestampMap key_times;
+    TimePoint newest_time = TimePoint::min();
+
+    /// Copy of the estimate and statistics for readers, published at the end
+    /// of each update. Guarded by `estimate_mutex`.
+    gtsam::Values estimate;
+    size_t nb_factors = 0;
+    double last_update_duration = 0.0;
+
+    // Synchronization
+    std::mutex update_mutex;
+    mutable std::mutex estimate_mutex;
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition, idle_condition;
+    std::vector<QueuedUpdate> queue;
+    bool busy = false;
+    bool stop = false;
+    std::thread worker;
+
+    /** Check and add new factors and variables, without optimizing */
+    int add(const gtsam::NonlinearFactorGraph &factors,
+            const gtsam::Values &values,
+            const KeyTimestampMap &timestamps);
+
+    /** Optimize the window, marginalize old variables, and publish the
+     * estimate. `start` is the time the update started. */
+    int solve(const std::chrono::steady_clock::time_point &start);
+
+    /** Run Levenberg-Marquardt iterations until converged or out of time */
+    void optimize(const std::chrono::steady_clock::time_point &start);
+
+    /** Replace the variables older than the lag by their marginal */
+    void marginalize();
+
+    /** Function run by the worker thread */
+    void spin();
+};
+
+}  // namespace wave
+
+#endif  // WAVE_FIXED_LAG_SMOOTHER_HPP
@@ -11,9 +11,10 @@ namespace wave {
  * explicitly
  * estimated bias quantity so that the GPS walk can be accounted for
  * The model is
- * r = logmap(T_LOCAL_S2 * (T_LOCAL_S1 * (T_S1_S2 + bias))^-1)
+ * r = logmap(T_LOCAL_S1_meas^-1 * (bias * T_LOCAL_S1))
+ * where the bias is a pure translation applied in the local frame.
  *
- * It is assumed that T_LOCAL_S1 is a measurement, the rest are states
+ * The Jacobians are computed in closed form.
  */
 
 class GPSFactorWBias
@@ -12,9 +12,11 @@ namespace wave {
  * there is a common external reference frame.
  * It incorporates a translational bias
  * The model is
- * r = logmap(T_LOCAL_S2 * (T_LOCAL_S1 * (T_S1_S2 + bias))^-1)
+ * r = logmap((T_LOCAL_S1 * bias * T_S1_S2)^-1 * T_LOCAL_S2)
+ * where the bias is a pure translation.
  *
- * It is assumed that T_LOCAL_S1 is a measurement, the rest are states
+ * It is assumed that T_LOCAL_S1 is a measurement, the rest are states.
+ * The Jacobians are computed in closed form.
  */
 
 class HandEyeFactor
@@ -7,11 +7,12 @@ template <class T>
 gtsam::Vector PosePrior<T>::evaluateError(
   const T &m, boost::optional<gtsam::Matrix &> H) const {
     gtsam::Vector6 retval;
-    gtsam::Matrix J_between_right, J_logmap;
+    gtsam::Matrix6 J_between_right, J_logmap;
 
-    auto est_T_eye = this->prior.between(m.pose, boost::none, J_between_right);
+    auto est_T_eye = this->prior.between(
+      m.pose, boost::none, H ? &J_between_right : nullptr);
 
-    retval = gtsam::Pose3::Logmap(est_T_eye, J_logmap);
+    retval = gtsam::Pose3::Logmap(est_T_eye, H ? &J_logmap : nullptr);
 
     if (H) {
         H->resize(6, gtsam::traits<T>::dimension);
@@ -7,12 +7,13 @@ template <class T>
 gtsam::Vector TwistPrior<T>::evaluateError(
   const T &m, boost::optional<gtsam::Matrix &> H) const {
     gtsam::Vector6 retval;
-    gtsam::Matrix J_between_right, J_logmap;
+    using PriorTraits = gtsam::traits<decltype(this->prior)>;
+    gtsam::Matrix6 J_between_right, J_logmap;
 
-    auto est_T_eye = gtsam::traits<decltype(this->prior)>::Between(
-      this->prior, m.vel, boost::none, J_between_right);
+    auto est_T_eye = PriorTraits::Between(
+      this->prior, m.vel, boost::none, H ? &J_between_right : nullptr);
 
-    retval = gtsam::traits<decltype(this->prior)>::Logmap(est_T_eye, J_logmap);
+    retval = PriorTraits::Logmap(est_T_eye, H ? &J_logmap : nullptr);
 
     if (H) {
         H->resize(6, gtsam::traits<T>::dimension);
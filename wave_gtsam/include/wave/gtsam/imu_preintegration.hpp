@@ -0,0 +1,86 @@
+#ifndef WAVE_IMU_PREINTEGRATION_HPP
+#define WAVE_IMU_PREINTEGRATION_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <gtsam/navigation/CombinedImuFactor.h>
+
+#include "wave/utils/math.hpp"
+#include "wave/containers/measurement.hpp"
+#include "wave/containers/measurement_container.hpp"
+
+/**
+ * Preintegration of IMU measurements stored in a MeasurementContainer, for
+ * use with PreintegratedImuFactor.
+ *
+ * The measurements are treated as samples of a piecewise-linear signal.
+ * Each segment between samples is integrated at its midpoint value, and the
+ * signal is interpolated at the start and end times, so a measurement need
+ * not exist exactly at either. Outside the first and last samples, the signal
+ * is held constant.
+ */
+
+namespace wave {
+
+/** IMU measurement: angular velocity, then linear acceleration (specific
+ * force), both in the body frame */
+using ImuMeasurement = Measurement<Vec6, int>;
+
+struct ImuPreintegrationParams {
+    /// Only measurements with this sensor id are used
+    int sensor_id = 0;
+
+    /// IMU noise, gravity and bias random walk
+    boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params>
+      imu_params =
+        gtsam::PreintegratedCombinedMeasurements::Params::MakeSharedU(9.81);
+
+    /// Threads used by `preintegrateImuBatch()`
+    int num_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+/** Preintegrate the IMU measurements between two times
+ *
+ * The measurements are found with a single scan of the container, over the
+ * window [start, end] and the nearest measurement on either side of it.
+ *
+ * @param imu IMU measurements
+ * @param sensor_id sensor id of the measurements to use
+ * @param start, end times of the two states joined by the factor
+ * @param[in,out] pim preintegrated measurements to add to, e.g. freshly
+ * constructed with the IMU parameters and bias estimate
+ * @param[out] end_measurement if given, the measurement interpolated at `end`
+ * @returns 0 on success, -1 if `end` is not after `start` or there are no
+ * measurements of the sensor in or around the window
+ */
+int preintegrateImu(const MeasurementContainer<ImuMeasurement> &imu,
+                    int sensor_id,
+                    const TimePoint &start,
+                    const TimePoint &end,
+                    gtsam::PreintegratedCombinedMeasurements &pim,
+                    Vec6 *end_measurement = nullptr);
+
+/** Preintegrate the IMU measurements between each pair of consecutive
+ * keyframes, in parallel
+ *
+ * @param imu IMU measurements
+ * @param keyframes times of the states, in increasing order
+ * @param bias IMU bias estimate used for every interval
+ * @param params sensor id, IMU parameters and number of threads
+ * @param[out] pims the `i`th element joins keyframes `i` and `i + 1`
+ * @returns 0 on success, -1 if there are fewer than two keyframes or any
+ * interval fails as in `preintegrateImu()`
+ */
+int preintegrateImuBatch(
+  const MeasurementContainer<ImuMeasurement> &imu,
+  const std::vector<TimePoint> &keyframes,
+  const gtsam::imuBias::ConstantBias &bias,
+  const ImuPreintegrationParams &params,
+  std::vector<gtsam::PreintegratedCombinedMeasurements> &pims);
+
+}  // namespace wave
+
+#endif  // WAVE_IMU_PREINTEGRATION_HPP
@@ -0,0 +1,202 @@
+#ifndef WAVE_INCREMENTAL_ESTIMATOR_HPP
+#define WAVE_INCREMENTAL_ESTIMATOR_HPP
+
+#include <chrono>
+#include <map>
+
+#include <gtsam/geometry/Pose3.h>
+#include <gtsam/navigation/CombinedImuFactor.h>
+#include <gtsam/nonlinear/ISAM2.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "wave/utils/math.hpp"
+#include "wave/containers/measurement.hpp"
+#include "wave/containers/measurement_container.hpp"
+#include "wave/gtsam/imu_preintegration.hpp"
+#include "wave/gtsam/pose_vel_bias.hpp"
+
+/**
+ * Incremental estimation of PoseVelBias states from IMU and GPS measurements,
+ * using iSAM2 over either the whole history or a fixed lag.
+ *
+ * A state is added at each call to `update()`. Consecutive states are joined
+ * by a PreintegratedImuFactor, or by a constant-velocity MotionFactor if no
+ * IMU is used. A pose measurement (e.g. GPS) at the time of a state adds a
+ * GPSFactorWithBiasGeneral, whose translation bias is part of the state.
+ *
+ * For a fixed lag over factors built by the caller, with a bounded time per
+ * update or a worker thread, see FixedLagSmoother.
+ */
+
+namespace wave {
+
+/** Measured pose of the body in the local frame, e.g. from GPS */
+using Pose3Measurement = Measurement<gtsam::Pose3, int>;
+
+/** Interpolate poses on SE(3), for use with MeasurementContainer */
+inline gtsam::Pose3 interpolate(const Pose3Measurement &m1,
+                                const Pose3Measurement &m2,
+                                const TimePoint &t) {
+    const double w2 =
+      1.0 * (t - m1.time_point) / (m2.time_point - m1.time_point);
+    return gtsam::interpolate(m1.value, m2.value, w2);
+}
+
+struct IncrementalEstimatorParams {
+    /// States older than this many seconds before the newest are
+    /// marginalized. If zero or negative, every state is kept (plain iSAM2).
+    double lag = 0.0;
+
+    /// iSAM2 relinearization threshold and interval, which bound the work
+    /// done in each update
+    double relinearize_threshold = 0.1;
+    int relinearize_skip = 1;
+
+    /// Extra iSAM2 iterations after each update, without new factors
+    int extra_iterations = 0;
+
+    /// If true, use IMU measurements between states. Otherwise, consecutive
+    /// states are joined by a constant-velocity motion model.
+    ///
+    /// Note the two interpret the velocity of PoseVelBias differently: the
+    /// IMU factor uses its linear part as a velocity in the local frame,
+    /// while the motion model uses a body-frame twist, so they are not mixed.
+    bool use_imu = true;
+
+    /// Sensor ids of the IMU and pose measurements in their containers
+    int imu_sensor_id = 0;
+    int gps_sensor_id = 0;
+
+    /// A pose measurement is used for a state only if one is this close in
+    /// time, in seconds. It is interpolated to the time of the state.
+    double gps_max_time_offset = 0.05;
+
+    /// IMU noise, gravity and bias random walk
+    boost::shared_ptr<gtsam::PreintegratedCombinedMeasurements::Params>
+      imu_params =
+        gtsam::PreintegratedCombinedMeasurements::Params::MakeSharedU(9.81);
+
+    /// Standard deviations of the prior on the first state
+    double prior_rotation_sigma = 1e-3;
+    double prior_position_sigma = 1e-3;
+    double prior_velocity_sigma = 0.1;
+    double prior_imu_bias_sigma = 0.1;
+
+    /// Standard deviations of pose measurements
+    double gps_rotation_sigma = 0.05;
+    double gps_position_sigma = 0.5;
+    /// Standard deviation of the zero-mean prior on each state's GPS bias
+    double gps_bias_sigma = 1.0;
+
+    /// Standard deviation of the angular velocity of each state about the
+    /// gyroscope measurement, when using the IMU
+    double angular_velocity_sigma = 0.1;
+
+    /// Standard deviations of the constant-velocity motion model, per second
+    double motion_pose_sigma = 0.1;
+    double motion_velocity_sigma = 1.0;
+    double motion_bias_sigma = 0.1;
+
+    /// If true, keep every factor and initial estimate added, so the same
+    /// problem can be solved in batch (see `getHistory()`)
+    bool keep_history = false;
+};
+
+class IncrementalEstimator {
+ public:
+    using ImuContainer = MeasurementContainer<ImuMeasurement>;
+    using PoseContainer = MeasurementContainer<Pose3Measurement>;
+
+    explicit IncrementalEstimator(
+      const IncrementalEstimatorParams &params = IncrementalEstimatorParams{});
+
+    /** Add the first state, with a prior on it
+     *
+     * @param t time of the state
+     * @param state initial pose, velocity and GPS bias
+     * @param imu_bias initial IMU bias, if using the IMU
+     * @returns 0 on success, -1 if already initialized
+     */
+    int initialize(const TimePoint &t,
+                   const PoseVelBias &state,
+                   const gtsam::imuBias::ConstantBias &imu_bias =
+                     gtsam::imuBias::ConstantBias{});
+
+    /** Add a state at time `t`, and update the estimate
+     *
+     * The IMU measurements since the previous state are preintegrated, and a
+     * pose measurement near `t` is used if there is one. If a lag is set,
+     * states that fall out of it are marginalized.
+     *
+     * @returns 0 on success, -1 if not initialized, if `t` is not after the
+     * previous state, or if using the IMU and there are no IMU measurements
+     * since the previous state, i.e. in (previous time, `t`]
+     */
+    int update(const TimePoint &t,
+               const ImuContainer &imu,
+               const PoseContainer &gps);
+
+    /** Number of states added so far */
+    size_t numStates() const;
+
+    /** Number of states still being estimated, i.e. not marginalized */
+    size_t numActiveStates() const;
+
+    /** Get the estimate of the `index`th state and its IMU bias
+     *
+     * Marginalized states keep their last estimate.
+     *
+     * @returns false if there is no such state
+     */
+    bool getState(size_t index,
+                  PoseVelBias &state,
+                  gtsam::imuBias::ConstantBias *imu_bias = nullptr) const;
+
+    /** Time taken by the last call to `update()`, in seconds */
+    double lastUpdateDuration() const;
+
+    /** Every factor and initial estimate added so far, if
+     * `keep_history` is set. The keys of the `i`th state are `stateKey(i)`
+     * and `imuBiasKey(i)`. */
+    const gtsam::NonlinearFactorGraph &getHistoryGraph() const;
+    const gtsam::Values &getHistoryValues() const;
+
+    static gtsam::Key stateKey(size_t index);
+    static gtsam::Key imuBiasKey(size_t index);
+
+ private:
+    IncrementalEstimatorParams params;
+    gtsam::ISAM2 isam;
+
+    /// Time of each active state, by index
+    std::map<size_t, TimePoint> active_states;
+    size_t nb_states = 0;
+    TimePoint last_time;
+
+    /// Estimates of marginalized states
+    std::map<size_t, PoseVelBias> marginalized_states;
+    std::map<size_t, gtsam::imuBias::ConstantBias> marginalized_imu_biases;
+
+    double last_update_duration = 0.0;
+
+    gtsam::NonlinearFactorGraph history_graph;
+    gtsam::Values history_values;
+
+    /** Add a GPS factor for state `index` if there is a measurement near `t`
+     */
+    void addGpsFactor(size_t index,
+                      const TimePoint &t,
+                      const PoseContainer &gps,
+                      gtsam::NonlinearFactorGraph &factors) const;
+
+    /** Run iSAM2 on the new factors and values, then marginalize states
+     * older than the lag */
+    void updateIsam(const gtsam::NonlinearFactorGraph &factors,
+                    const gtsam::Values &values,
+                    const TimePoint &t);
+};
+
+}  // namespace wave
+
+#endif  // WAVE_INCREMENTAL_ESTIMATOR_HPP
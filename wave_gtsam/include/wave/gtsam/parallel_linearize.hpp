@@ -0,0 +1,71 @@
+#ifndef WAVE_PARALLEL_LINEARIZE_HPP
+#define WAVE_PARALLEL_LINEARIZE_HPP
+
+#include <algorithm>
+#include <thread>
+
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/VectorValues.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+/**
+ * Linearization of large factor graphs over several threads.
+ *
+ * The factors are split into contiguous chunks, and each thread linearizes
+ * whole chunks into its own slots of the result. Factors are only read, through
+ * the const `linearize()` of each factor, as are the values, so this is safe
+ * for any factor whose `evaluateError()` has no side effects, including all
+ * wave_gtsam factors and the GTSAM projection factors.
+ */
+
+namespace wave {
+
+struct ParallelLinearizeParams {
+    /// Threads used to linearize
+    int num_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    /// Number of factors linearized together by one thread. Smaller chunks
+    /// balance the load between threads when factors differ in cost.
+    size_t chunk_size = 1024;
+};
+
+/** Time spent in each part of a Gauss-Newton step, in seconds */
+struct LinearizationTimes {
+    double linearize = 0.0;
+
+    /// Ordering, elimination and back-substitution
+    double eliminate = 0.0;
+};
+
+/** Linearize every factor of a graph
+ *
+ * @returns the same graph as `graph.linearize(values)`, with the factors in
+ * the same order and a null factor for each null nonlinear factor. If any
+ * factor throws, the first exception (in factor order) is rethrown once all
+ * threads have finished.
+ */
+gtsam::GaussianFactorGraph::shared_ptr linearizeParallel(
+  const gtsam::NonlinearFactorGraph &graph,
+  const gtsam::Values &values,
+  const ParallelLinearizeParams &params = ParallelLinearizeParams{});
+
+/** Solve for one Gauss-Newton step, timing linearization and elimination
+ *
+ * The graph is linearized with `linearizeParallel()`, then eliminated with a
+ * COLAMD ordering.
+ *
+ * @param[out] delta the step, to be retracted onto `values`
+ * @param[out] times time taken by each part
+ * @returns 0 on success, -1 if the linear system is indeterminant
+ */
+int solveGaussNewtonStep(const gtsam::NonlinearFactorGraph &graph,
+                         const gtsam::Values &values,
+                         const ParallelLinearizeParams &params,
+                         gtsam::VectorValues &delta,
+                         LinearizationTimes &times);
+
+}  // namespace wave
+
+#endif  // WAVE_PARALLEL_LINEARIZE_HPP
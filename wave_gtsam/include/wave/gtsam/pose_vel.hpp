@@ -107,16 +107,14 @@ struct traits<wave::PoseVel> {
 
     static TangentVector Logmap(const wave::PoseVel &m,
                                 ChartJacobian Hm = boost::none) {
-        Eigen::MatrixXd J1, J2;
+        Matrix6 J1, J2;
         TangentVector retval;
+        retval.block<6, 1>(0, 0).noalias() =
+          traits<Pose3>::Logmap(m.pose, Hm ? &J1 : nullptr);
+        retval.block<6, 1>(6, 0).noalias() =
+          traits<VelType>::Logmap(m.vel, Hm ? &J2 : nullptr);
         if (Hm) {
             Hm->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-        }
-        retval.block<6, 1>(0, 0).noalias() = traits<Pose3>::Logmap(m.pose, J1);
-        retval.block<6, 1>(6, 0).noalias() = traits<VelType>::Logmap(m.vel, J2);
-        if (Hm) {
             Hm->block<6, 6>(0, 0).noalias() = J1;
             Hm->block<6, 6>(6, 6).noalias() = J2;
         }
@@ -125,16 +123,14 @@ struct traits<wave::PoseVel> {
 
     static wave::PoseVel Expmap(const TangentVector &v,
                                 ChartJacobian Hv = boost::none) {
+        Matrix6 J1, J2;
         wave::PoseVel retval;
-        Eigen::MatrixXd J1, J2;
+        retval.pose =
+          traits<Pose3>::Expmap(v.block<6, 1>(0, 0), Hv ? &J1 : nullptr);
+        retval.vel =
+          traits<VelType>::Expmap(v.block<6, 1>(6, 0), Hv ? &J2 : nullptr);
         if (Hv) {
             Hv->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-        }
-        retval.pose = traits<Pose3>::Expmap(v.block<6, 1>(0, 0), J1);
-        retval.vel = traits<VelType>::Expmap(v.block<6, 1>(6, 0), J2);
-        if (Hv) {
             Hv->block<6, 6>(0, 0).noalias() = J1;
             Hv->block<6, 6>(6, 6).noalias() = J2;
         }
@@ -145,25 +141,25 @@ struct traits<wave::PoseVel> {
                                  const wave::PoseVel &m2,
                                  ChartJacobian H1 = boost::none,
                                  ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4;
         wave::PoseVel retval;
-        Eigen::MatrixXd J1, J2, J3, J4;
+        retval.pose =
+          traits<Pose3>::Compose(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Compose(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-        }
-        retval.pose = traits<Pose3>::Compose(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Compose(m1.vel, m2.vel, J3, J4);
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
         }
@@ -174,25 +170,25 @@ struct traits<wave::PoseVel> {
                                  const wave::PoseVel &m2,
                                  ChartJacobian H1 = boost::none,
                                  ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4;
         wave::PoseVel retval;
-        Eigen::MatrixXd J1, J2, J3, J4;
+        retval.pose =
+          traits<Pose3>::Between(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Between(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-        }
-        retval.pose = traits<Pose3>::Between(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Between(m1.vel, m2.vel, J3, J4);
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
         }
@@ -201,16 +197,12 @@ struct traits<wave::PoseVel> {
 
     static wave::PoseVel Inverse(const wave::PoseVel &m,
                                  ChartJacobian H = boost::none) {
+        Matrix6 J1, J2;
         wave::PoseVel retval;
-        Eigen::MatrixXd J1, J2;
+        retval.pose = traits<Pose3>::Inverse(m.pose, H ? &J1 : nullptr);
+        retval.vel = traits<VelType>::Inverse(m.vel, H ? &J2 : nullptr);
         if (H) {
             H->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-        }
-        retval.pose = traits<Pose3>::Inverse(m.pose, J1);
-        retval.vel = traits<VelType>::Inverse(m.vel, J2);
-        if (H) {
             H->block<6, 6>(0, 0).noalias() = J1;
             H->block<6, 6>(6, 6).noalias() = J2;
         }
@@ -106,12 +106,12 @@ struct traits<wave::PoseVelAccBias> {
     static wave::PoseVelAccBias Retract(const wave::PoseVelAccBias &origin,
                                         const TangentVector &v) {
         wave::PoseVelAccBias retval;
-        retval.pose = traits<Pose3>::Retract(origin.pose, v.block<6, 1>(0, 0).);
-        retval.vel = traits<VelType>::Retract(origin.vel, v.block<6, 1>(6, 0).);
+        retval.pose = traits<Pose3>::Retract(origin.pose, v.block<6, 1>(0, 0));
+        retval.vel = traits<VelType>::Retract(origin.vel, v.block<6, 1>(6, 0));
         retval.acc =
-          traits<AccType>::Retract(origin.acc, v.block<6, 1>(12, 0).);
+          traits<AccType>::Retract(origin.acc, v.block<6, 1>(12, 0));
         retval.bias =
-          traits<BiasType>::Retract(origin.bias, v.block<3, 1>(18, 0).);
+          traits<BiasType>::Retract(origin.bias, v.block<3, 1>(18, 0));
         return retval;
     }
 
@@ -129,23 +129,19 @@ struct traits<wave::PoseVelAccBias> {
 
     static TangentVector Logmap(const wave::PoseVelAccBias &m,
                                 ChartJacobian Hm = boost::none) {
-        Eigen::MatrixXd J1, J2, J3, J4;
-
+        Matrix6 J1, J2, J3;
+        Matrix3 J4;
         TangentVector retval;
-        if (Hm) {
-            Hm->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(6, 6);
-            J4.resize(3, 3);
-        }
-        retval.block<6, 1>(0, 0).noalias() = traits<Pose3>::Logmap(m.pose, J1);
-        retval.block<6, 1>(6, 0).noalias() = traits<VelType>::Logmap(m.vel, J2);
+        retval.block<6, 1>(0, 0).noalias() =
+          traits<Pose3>::Logmap(m.pose, Hm ? &J1 : nullptr);
+        retval.block<6, 1>(6, 0).noalias() =
+          traits<VelType>::Logmap(m.vel, Hm ? &J2 : nullptr);
         retval.block<6, 1>(12, 0).noalias() =
-          traits<VelType>::Logmap(m.acc, J3);
+          traits<AccType>::Logmap(m.acc, Hm ? &J3 : nullptr);
         retval.block<3, 1>(18, 0).noalias() =
-          traits<BiasType>::Logmap(m.bias, J4);
+          traits<BiasType>::Logmap(m.bias, Hm ? &J4 : nullptr);
         if (Hm) {
+            Hm->setZero();
             Hm->block<6, 6>(0, 0).noalias() = J1;
             Hm->block<6, 6>(6, 6).noalias() = J2;
             Hm->block<6, 6>(12, 12).noalias() = J3;
@@ -156,20 +152,19 @@ struct traits<wave::PoseVelAccBias> {
 
     static wave::PoseVelAccBias Expmap(const TangentVector &v,
                                        ChartJacobian Hv = boost::none) {
+        Matrix6 J1, J2, J3;
+        Matrix3 J4;
         wave::PoseVelAccBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4;
+        retval.pose =
+          traits<Pose3>::Expmap(v.block<6, 1>(0, 0), Hv ? &J1 : nullptr);
+        retval.vel =
+          traits<VelType>::Expmap(v.block<6, 1>(6, 0), Hv ? &J2 : nullptr);
+        retval.acc =
+          traits<AccType>::Expmap(v.block<6, 1>(12, 0), Hv ? &J3 : nullptr);
+        retval.bias =
+          traits<BiasType>::Expmap(v.block<3, 1>(18, 0), Hv ? &J4 : nullptr);
         if (Hv) {
             Hv->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(6, 6);
-            J4.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Expmap(v.block<6, 1>(0, 0), J1);
-        retval.vel = traits<VelType>::Logmap(v.block<6, 1>(6, 0), J2);
-        retval.acc = traits<AccType>::Logmap(v.block<6, 1>(12, 0), J3);
-        retval.bias = traits<BiasType>::Logmap(v.block<3, 1>(18, 0), J4);
-        if (Hv) {
             Hv->block<6, 6>(0, 0).noalias() = J1;
             Hv->block<6, 6>(6, 6).noalias() = J2;
             Hv->block<6, 6>(12, 12).noalias() = J3;
@@ -182,33 +177,38 @@ struct traits<wave::PoseVelAccBias> {
                                         const wave::PoseVelAccBias &m2,
                                         ChartJacobian H1 = boost::none,
                                         ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4, J5, J6;
+        Matrix3 J7, J8;
         wave::PoseVelAccBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4, J5, J6, J7, J8;
+        retval.pose =
+          traits<Pose3>::Compose(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Compose(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
+        retval.acc =
+          traits<AccType>::Compose(m1.acc,
+                                   m2.acc,
+                                   H1 ? &J5 : nullptr,
+                                   H2 ? &J6 : nullptr);
+        retval.bias =
+          traits<BiasType>::Compose(m1.bias,
+                                    m2.bias,
+                                    H1 ? &J7 : nullptr,
+                                    H2 ? &J8 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-            J5.resize(6, 6);
-            J7.resize(3, 3);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-            J6.resize(6, 6);
-            J8.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Compose(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Compose(m1.vel, m2.vel, J3, J4);
-        retval.acc = traits<AccType>::Compose(m1.vel, m2.vel, J5, J6);
-        retval.bias = traits<BiasType>::Compose(m1.bias, m2.bias, J7, J8);
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
-            H1->block<6, 6>(12, 12).noalias() = J3;
-            H1->block<3, 3>(18, 18).noalias() = J5;
+            H1->block<6, 6>(12, 12).noalias() = J5;
+            H1->block<3, 3>(18, 18).noalias() = J7;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
             H2->block<6, 6>(12, 12).noalias() = J6;
@@ -221,33 +221,38 @@ struct traits<wave::PoseVelAccBias> {
                                         const wave::PoseVelAccBias &m2,
                                         ChartJacobian H1 = boost::none,
                                         ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4, J5, J6;
+        Matrix3 J7, J8;
         wave::PoseVelAccBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4, J5, J6, J7, J8;
+        retval.pose =
+          traits<Pose3>::Between(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Between(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
+        retval.acc =
+          traits<AccType>::Between(m1.acc,
+                                   m2.acc,
+                                   H1 ? &J5 : nullptr,
+                                   H2 ? &J6 : nullptr);
+        retval.bias =
+          traits<BiasType>::Between(m1.bias,
+                                    m2.bias,
+                                    H1 ? &J7 : nullptr,
+                                    H2 ? &J8 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-            J5.resize(6, 6);
-            J7.resize(3, 3);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-            J6.resize(6, 6);
-            J8.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Between(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Between(m1.vel, m2.vel, J3, J4);
-        retval.acc = traits<AccType>::Between(m1.acc, m2.acc, J5, J6);
-        retval.bias = traits<BiasType>::Between(m1.bias, m2.bias, J7, J8);
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
             H1->block<6, 6>(12, 12).noalias() = J5;
             H1->block<3, 3>(18, 18).noalias() = J7;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
             H2->block<6, 6>(12, 12).noalias() = J6;
@@ -258,20 +263,15 @@ struct traits<wave::PoseVelAccBias> {
 
     static wave::PoseVelAccBias Inverse(const wave::PoseVelAccBias &m,
                                         ChartJacobian H = boost::none) {
+        Matrix6 J1, J2, J3;
+        Matrix3 J4;
         wave::PoseVelAccBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4;
+        retval.pose = traits<Pose3>::Inverse(m.pose, H ? &J1 : nullptr);
+        retval.vel = traits<VelType>::Inverse(m.vel, H ? &J2 : nullptr);
+        retval.acc = traits<AccType>::Inverse(m.acc, H ? &J3 : nullptr);
+        retval.bias = traits<BiasType>::Inverse(m.bias, H ? &J4 : nullptr);
         if (H) {
             H->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(6, 6);
-            J4.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Inverse(m.pose, J1);
-        retval.vel = traits<VelType>::Inverse(m.vel, J2);
-        retval.acc = traits<AccType>::Inverse(m.acc, J3);
-        retval.bias = traits<BiasType>::Inverse(m.bias, J4);
-        if (H) {
             H->block<6, 6>(0, 0).noalias() = J1;
             H->block<6, 6>(6, 6).noalias() = J2;
             H->block<6, 6>(12, 12).noalias() = J3;
@@ -284,12 +284,14 @@ struct traits<wave::PoseVelAccBias> {
 
 namespace wave {
 
-PoseVelAccBias operator*(const PoseVelAccBias &m1, const PoseVelAccBias &m2) {
+inline PoseVelAccBias operator*(const PoseVelAccBias &m1,
+                                const PoseVelAccBias &m2) {
     wave::PoseVelAccBias retval;
     retval.pose = m1.pose * m2.pose;
     retval.vel = m1.vel + m2.vel;
     retval.acc = m1.acc + m2.acc;
     retval.bias = m1.bias + m2.bias;
+    return retval;
 }
 }
 
@@ -119,21 +119,17 @@ struct traits<wave::PoseVelBias> {
 
     static TangentVector Logmap(const wave::PoseVelBias &m,
                                 ChartJacobian Hm = boost::none) {
-        Eigen::MatrixXd J1, J2, J3;
-
+        Matrix6 J1, J2;
+        Matrix3 J3;
         TangentVector retval;
-        if (Hm) {
-            Hm->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(3, 3);
-        }
-        retval.block<6, 1>(0, 0).noalias() = traits<Pose3>::Logmap(m.pose, J1);
-        retval.block<6, 1>(6, 0).noalias() = traits<VelType>::Logmap(m.vel, J2);
+        retval.block<6, 1>(0, 0).noalias() =
+          traits<Pose3>::Logmap(m.pose, Hm ? &J1 : nullptr);
+        retval.block<6, 1>(6, 0).noalias() =
+          traits<VelType>::Logmap(m.vel, Hm ? &J2 : nullptr);
         retval.block<3, 1>(12, 0).noalias() =
-          traits<BiasType>::Logmap(m.bias, J3);
-
+          traits<BiasType>::Logmap(m.bias, Hm ? &J3 : nullptr);
         if (Hm) {
+            Hm->setZero();
             Hm->block<6, 6>(0, 0).noalias() = J1;
             Hm->block<6, 6>(6, 6).noalias() = J2;
             Hm->block<3, 3>(12, 12).noalias() = J3;
@@ -143,19 +139,17 @@ struct traits<wave::PoseVelBias> {
 
     static wave::PoseVelBias Expmap(const TangentVector &v,
                                     ChartJacobian Hv = boost::none) {
+        Matrix6 J1, J2;
+        Matrix3 J3;
         wave::PoseVelBias retval;
-        Eigen::MatrixXd J1, J2, J3;
+        retval.pose =
+          traits<Pose3>::Expmap(v.block<6, 1>(0, 0), Hv ? &J1 : nullptr);
+        retval.vel =
+          traits<VelType>::Expmap(v.block<6, 1>(6, 0), Hv ? &J2 : nullptr);
+        retval.bias =
+          traits<BiasType>::Expmap(v.block<3, 1>(12, 0), Hv ? &J3 : nullptr);
         if (Hv) {
             Hv->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Expmap(v.block<6, 1>(0, 0), J1);
-        retval.vel = traits<VelType>::Expmap(v.block<6, 1>(6, 0), J2);
-        retval.bias = traits<BiasType>::Expmap(v.block<3, 1>(12, 0), J3);
-
-        if (Hv) {
             Hv->block<6, 6>(0, 0).noalias() = J1;
             Hv->block<6, 6>(6, 6).noalias() = J2;
             Hv->block<3, 3>(12, 12).noalias() = J3;
@@ -167,30 +161,32 @@ struct traits<wave::PoseVelBias> {
                                      const wave::PoseVelBias &m2,
                                      ChartJacobian H1 = boost::none,
                                      ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4;
+        Matrix3 J5, J6;
         wave::PoseVelBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4, J5, J6;
+        retval.pose =
+          traits<Pose3>::Compose(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Compose(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
+        retval.bias =
+          traits<BiasType>::Compose(m1.bias,
+                                    m2.bias,
+                                    H1 ? &J5 : nullptr,
+                                    H2 ? &J6 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-            J5.resize(3, 3);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-            J6.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Compose(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Compose(m1.vel, m2.vel, J3, J4);
-        retval.bias = traits<BiasType>::Compose(m1.bias, m2.bias, J5, J6);
-
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
             H1->block<3, 3>(12, 12).noalias() = J5;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
             H2->block<3, 3>(12, 12).noalias() = J6;
@@ -202,30 +198,32 @@ struct traits<wave::PoseVelBias> {
                                      const wave::PoseVelBias &m2,
                                      ChartJacobian H1 = boost::none,
                                      ChartJacobian H2 = boost::none) {
+        Matrix6 J1, J2, J3, J4;
+        Matrix3 J5, J6;
         wave::PoseVelBias retval;
-        Eigen::MatrixXd J1, J2, J3, J4, J5, J6;
+        retval.pose =
+          traits<Pose3>::Between(m1.pose,
+                                 m2.pose,
+                                 H1 ? &J1 : nullptr,
+                                 H2 ? &J2 : nullptr);
+        retval.vel =
+          traits<VelType>::Between(m1.vel,
+                                   m2.vel,
+                                   H1 ? &J3 : nullptr,
+                                   H2 ? &J4 : nullptr);
+        retval.bias =
+          traits<BiasType>::Between(m1.bias,
+                                    m2.bias,
+                                    H1 ? &J5 : nullptr,
+                                    H2 ? &J6 : nullptr);
         if (H1) {
             H1->setZero();
-            J1.resize(6, 6);
-            J3.resize(6, 6);
-            J5.resize(3, 3);
-        }
-        if (H2) {
-            H2->setZero();
-            J2.resize(6, 6);
-            J4.resize(6, 6);
-            J6.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Between(m1.pose, m2.pose, J1, J2);
-        retval.vel = traits<VelType>::Between(m1.vel, m2.vel, J3, J4);
-        retval.bias = traits<BiasType>::Between(m1.bias, m2.bias, J5, J6);
-
-        if (H1) {
             H1->block<6, 6>(0, 0).noalias() = J1;
             H1->block<6, 6>(6, 6).noalias() = J3;
             H1->block<3, 3>(12, 12).noalias() = J5;
         }
         if (H2) {
+            H2->setZero();
             H2->block<6, 6>(0, 0).noalias() = J2;
             H2->block<6, 6>(6, 6).noalias() = J4;
             H2->block<3, 3>(12, 12).noalias() = J6;
@@ -235,19 +233,14 @@ struct traits<wave::PoseVelBias> {
 
     static wave::PoseVelBias Inverse(const wave::PoseVelBias &m,
                                      ChartJacobian H = boost::none) {
+        Matrix6 J1, J2;
+        Matrix3 J3;
         wave::PoseVelBias retval;
-        Eigen::MatrixXd J1, J2, J3;
+        retval.pose = traits<Pose3>::Inverse(m.pose, H ? &J1 : nullptr);
+        retval.vel = traits<VelType>::Inverse(m.vel, H ? &J2 : nullptr);
+        retval.bias = traits<BiasType>::Inverse(m.bias, H ? &J3 : nullptr);
         if (H) {
             H->setZero();
-            J1.resize(6, 6);
-            J2.resize(6, 6);
-            J3.resize(3, 3);
-        }
-        retval.pose = traits<Pose3>::Inverse(m.pose, J1);
-        retval.vel = traits<VelType>::Inverse(m.vel, J2);
-        retval.bias = traits<BiasType>::Inverse(m.bias, J3);
-
-        if (H) {
             H->block<6, 6>(0, 0).noalias() = J1;
             H->block<6, 6>(6, 6).noalias() = J2;
             H->block<3, 3>(12, 12).noalias() = J3;
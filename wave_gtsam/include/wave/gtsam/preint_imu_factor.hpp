@@ -7,13 +7,25 @@
 #include "wave/gtsam/pose_vel.hpp"
 #include <gtsam/navigation/CombinedImuFactor.h>
 #include <gtsam/navigation/NavState.h>
+#include <boost/make_shared.hpp>
 
 namespace wave {
 
+/** Noise model with the covariance of preintegrated measurements
+ *
+ * The square-root information matrix is computed directly from a single
+ * Cholesky factorization of the covariance, without inverting it.
+ */
+gtsam::SharedNoiseModel makeImuNoiseModel(
+  const gtsam::PreintegratedCombinedMeasurements &pim);
+
 /**
  * 4-ary factor connecting two combined pose/vel/bias states and two 6d IMU bias
  * estimates. Provides the effect of gtsam::CombinedImuFactor (a 6-ary factor).
  *
+ * The preintegrated measurements are held through a pointer to const, so
+ * copies of the factor share them.
+ *
  * @tparam StateType either PoseVel or PoseVelBias
  */
 template <typename StateType>
@@ -22,25 +34,44 @@ class PreintegratedImuFactor
                                     StateType,
                                     gtsam::imuBias::ConstantBias,
                                     gtsam::imuBias::ConstantBias> {
+ public:
+    using PimPtr =
+      boost::shared_ptr<const gtsam::PreintegratedCombinedMeasurements>;
+
  private:
-    gtsam::PreintegratedCombinedMeasurements pim;
+    PimPtr pim;
     using Base = gtsam::NoiseModelFactor4<StateType,
                                           StateType,
                                           gtsam::imuBias::ConstantBias,
                                           gtsam::imuBias::ConstantBias>;
 
  public:
+    /** Construct from preintegrated measurements, which are copied once */
     PreintegratedImuFactor(gtsam::Key S1,
                            gtsam::Key S2,
                            gtsam::Key B1,
                            gtsam::Key B2,
                            const gtsam::PreintegratedCombinedMeasurements &pim)
-        : Base{gtsam::noiseModel::Gaussian::Covariance(pim.preintMeasCov()),
-               S1,
-               S2,
-               B1,
-               B2},
-          pim{pim} {}
+        : PreintegratedImuFactor{
+            S1,
+            S2,
+            B1,
+            B2,
+            boost::make_shared<const gtsam::PreintegratedCombinedMeasurements>(
+              pim)} {}
+
+    /** Construct from shared preintegrated measurements, without copying */
+    PreintegratedImuFactor(gtsam::Key S1,
+                           gtsam::Key S2,
+                           gtsam::Key B1,
+                           gtsam::Key B2,
+                           const PimPtr &shared_pim)
+        : Base{makeImuNoiseModel(*shared_pim), S1, S2, B1, B2},
+          pim{shared_pim} {}
+
+    const gtsam::PreintegratedCombinedMeasurements &preintegrated() const {
+        return *this->pim;
+    }
 
     gtsam::Vector evaluateError(
       const StateType &state_i,
@@ -52,6 +83,10 @@ class PreintegratedImuFactor
       boost::optional<gtsam::Matrix &> H3 = boost::none,
       boost::optional<gtsam::Matrix &> H4 = boost::none) const;
 };
+
+// evaluateError is instantiated in preint_imu_factor.cpp
+extern template class PreintegratedImuFactor<PoseVel>;
+extern template class PreintegratedImuFactor<PoseVelBias>;
 }  // namespace wave
 
 #endif  // WAVE_PREINT_IMU_FACTOR_HPP
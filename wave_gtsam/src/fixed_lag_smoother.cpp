@@ -0,0 +1,262 @@
+#include <algorithm>
+
+#include <gtsam/linear/GaussianBayesTree.h>
+#include <gtsam/linear/GaussianFactorGraph.h>
+#include <gtsam/linear/linearExceptions.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/nonlinear/LinearContainerFactor.h>
+
+#include "wave/gtsam/fixed_lag_smoother.hpp"
+#include "wave/utils/log.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Seconds since `start` */
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+      .count();
+}
+
+}  // namespace
+
+FixedLagSmoother::FixedLagSmoother(const FixedLagSmootherParams &params)
+    : params{params} {
+    if (params.worker_thread) {
+        this->worker = std::thread{&FixedLagSmoother::spin, this};
+    }
+}
+
+FixedLagSmoother::~FixedLagSmoother() {
+    {
+        std::lock_guard<std::mutex> lock{this->queue_mutex};
+        this->stop = true;
+    }
+    this->queue_condition.notify_all();
+    if (this->worker.joinable()) {
+        this->worker.join();
+    }
+}
+
+int FixedLagSmoother::update(const gtsam::NonlinearFactorGraph &factors,
+                             const gtsam::Values &values,
+                             const KeyTimestampMap &timestamps) {
+    const auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock{this->update_mutex};
+    if (this->add(factors, values, timestamps) != 0) {
+        return -1;
+    }
+    return this->solve(start);
+}
+
+void FixedLagSmoother::queueUpdate(const gtsam::NonlinearFactorGraph &factors,
+                                   const gtsam::Values &values,
+                                   const KeyTimestampMap &timestamps) {
+    if (!this->worker.joinable()) {
+        this->update(factors, values, timestamps);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{this->queue_mutex};
+        this->queue.push_back(QueuedUpdate{factors, values, timestamps});
+    }
+    this->queue_condition.notify_one();
+}
+
+void FixedLagSmoother::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock{this->queue_mutex};
+    while (!this->queue.empty() || this->busy) {
+        this->idle_condition.wait(lock);
+    }
+}
+
+gtsam::Values FixedLagSmoother::calculateEstimate() const {
+    std::lock_guard<std::mutex> lock{this->estimate_mutex};
+    return this->estimate;
+}
+
+size_t FixedLagSmoother::numActiveKeys() const {
+    std::lock_guard<std::mutex> lock{this->estimate_mutex};
+    return this->estimate.size();
+}
+
+size_t FixedLagSmoother::numFactors() const {
+    std::lock_guard<std::mutex> lock{this->estimate_mutex};
+    return this->nb_factors;
+}
+
+double FixedLagSmoother::lastUpdateDuration() const {
+    std::lock_guard<std::mutex> lock{this->estimate_mutex};
+    return this->last_update_duration;
+}
+
+int FixedLagSmoother::add(const gtsam::NonlinearFactorGraph &factors,
+                          const gtsam::Values &values,
+                          const KeyTimestampMap &timestamps) {
+    // Check everything before changing anything
+    for (const auto key : values.keys()) {
+        if (this->theta.exists(key)) {
+            LOG_ERROR("Variable is already in the smoother");
+            return -1;
+        }
+        if (timestamps.count(key) == 0) {
+            LOG_ERROR("New variable has no timestamp");
+            return -1;
+        }
+    }
+    for (const auto &factor : factors) {
+        if (!factor) {
+            continue;
+        }
+        for (const auto key : factor->keys()) {
+            if (!this->theta.exists(key) && !values.exists(key)) {
+                LOG_ERROR("Factor involves an unknown or marginalized "
+                          "variable");
+                return -1;
+            }
+        }
+    }
+
+    for (const auto key : values.keys()) {
+        const auto &time = timestamps.at(key);
+        this->key_times.emplace(key, time);
+        if (time > this->newest_time) {
+            this->newest_time = time;
+        }
+    }
+    this->theta.insert(values);
+    for (const auto &factor : factors) {
+        if (factor) {
+            this->graph.push_back(factor);
+        }
+    }
+    return 0;
+}
+
+int FixedLagSmoother::solve(
+  const std::chrono::steady_clock::time_point &start) {
+    int result = 0;
+    try {
+        this->optimize(start);
+        this->marginalize();
+    } catch (const gtsam::IndeterminantLinearSystemException &) {
+        LOG_ERROR("Optimization failed, the problem may be underconstrained");
+        result = -1;
+    }
+
+    std::lock_guard<std::mutex> lock{this->estimate_mutex};
+    this->estimate = this->theta;
+    this->nb_factors = this->graph.size();
+    this->last_update_duration = secondsSince(start);
+    return result;
+}
+
+void FixedLagSmoother::optimize(
+  const std::chrono::steady_clock::time_point &start) {
+    if (this->graph.empty()) {
+        return;
+    }
+
+    gtsam::LevenbergMarquardtOptimizer optimizer{this->graph, this->theta};
+    for (int i = 0; i < this->params.max_iterations; i++) {
+        const double error = optimizer.error();
+        optimizer.iterate();
+
+        const bool converged =
+          error - optimizer.error() <= this->params.relative_error_tol * error;
+        const bool out_of_time =
+          this->params.max_update_time > 0 &&
+          secondsSince(start) >= this->params.max_update_time;
+        if (converged || out_of_time) {
+            break;
+        }
+    }
+    this->theta = optimizer.values();
+}
+
+void FixedLagSmoother::marginalize() {
+    const auto lag = std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{this->params.lag});
+    gtsam::KeySet old_keys;
+    for (const auto &key_time : this->key_times) {
+        if (key_time.second < this->newest_time - lag) {
+            old_keys.insert(key_time.first);
+        }
+    }
+    if (old_keys.empty()) {
+        return;
+    }
+
+    // Split off the factors involving old variables
+    gtsam::NonlinearFactorGraph kept, removed;
+    for (const auto &factor : this->graph) {
+        const auto &keys = factor->keys();
+        const bool old = std::any_of(
+          keys.begin(), keys.end(), [&old_keys](gtsam::Key key) {
+              return old_keys.count(key) > 0;
+          });
+        (old ? removed : kept).push_back(factor);
+    }
+
+    // Eliminate the old variables, leaving their marginal on the others
+    if (!removed.empty()) {
+        const auto linear = removed.linearize(this->theta);
+        const auto involved = linear->keys();
+        gtsam::Ordering ordering;
+        for (const auto key : old_keys) {
+            if (involved.count(key) > 0) {
+                ordering.push_back(key);
+            }
+        }
+        const auto eliminated = linear->eliminatePartialMultifrontal(ordering);
+        for (const auto &marginal : *eliminated.second) {
+            if (marginal && !marginal->empty()) {
+                kept.push_back(boost::make_shared<gtsam::LinearContainerFactor>(
+                  marginal, this->theta));
+            }
+        }
+    }
+
+    for (const auto key : old_keys) {
+        this->theta.erase(key);
+        this->key_times.erase(key);
+    }
+    this->graph = kept;
+}
+
+void FixedLagSmoother::spin() {
+    while (true) {
+        std::vector<QueuedUpdate> updates;
+        {
+            std::unique_lock<std::mutex> lock{this->queue_mutex};
+            while (!this->stop && this->queue.empty()) {
+                this->queue_condition.wait(lock);
+            }
+            if (this->stop) {
+                return;
+            }
+            updates.swap(this->queue);
+            this->busy = true;
+        }
+
+        // Add everything queued, then optimize once
+        const auto start = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock{this->update_mutex};
+            for (const auto &update : updates) {
+                this->add(update.factors, update.values, update.timestamps);
+            }
+            this->solve(start);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{this->queue_mutex};
+            this->busy = false;
+        }
+        this->idle_condition.notify_all();
+    }
+}
+
+}  // namespace wave
@@ -13,35 +13,28 @@ gtsam::Vector GPSFactorWBias::evaluateError(
   const gtsam::Point3 &B_Z,
   boost::optional<gtsam::Matrix &> J_T_LOCAL_S1,
   boost::optional<gtsam::Matrix &> J_B_Z) const {
-    gtsam::Matrix J_compose_left, J_compose_right;
-    gtsam::Matrix J_between_right;
-    gtsam::Matrix J_logmap, J_bias;
+    // E = meas^-1 * (bias * T), with the bias lifted to a pure translation
+    const gtsam::Pose3 Lifted_Bias{gtsam::Rot3{}, B_Z};
+    const auto est_T_eye =
+      this->T_LOCAL_S1.between(Lifted_Bias.compose(T_LOCAL_S1));
 
-    gtsam::Rot3 IdenRot;
-    gtsam::Pose3 Lifted_Bias(IdenRot, B_Z);
-
-    gtsam::Pose3 bias_T_LOCAL_S1 =
-      Lifted_Bias.compose(T_LOCAL_S1, J_compose_left, J_compose_right);
-    auto est_T_eye =
-      this->T_LOCAL_S1.between(bias_T_LOCAL_S1, boost::none, J_between_right);
-    auto retval = gtsam::Pose3::Logmap(est_T_eye, J_logmap);
+    if (!J_T_LOCAL_S1 && !J_B_Z) {
+        return gtsam::Pose3::Logmap(est_T_eye);
+    }
 
+    // A right perturbation of T perturbs E by the same amount, so its
+    // Jacobian is that of Logmap. A change d in the bias is a left
+    // perturbation of T by the translation d, which is the right
+    // perturbation [0; R^T d], with R the rotation of T.
+    gtsam::Matrix6 J_logmap;
+    const gtsam::Vector6 retval = gtsam::Pose3::Logmap(est_T_eye, J_logmap);
     if (J_T_LOCAL_S1) {
-        J_T_LOCAL_S1->resize(T_LOCAL_S1.dimension, T_LOCAL_S1.dimension);
-
-        *J_T_LOCAL_S1 = J_logmap * J_between_right * J_compose_right;
+        *J_T_LOCAL_S1 = J_logmap;
     }
     if (J_B_Z) {
-        J_B_Z->resize(6, 3);
-        J_bias.resize(6, 3);
-        J_bias.setZero();
-        J_bias(3, 0) = 1;
-        J_bias(4, 1) = 1;
-        J_bias(5, 2) = 1;
-
-        *J_B_Z = J_logmap * J_between_right * J_compose_left * J_bias;
+        *J_B_Z = J_logmap.rightCols<3>() *
+                 T_LOCAL_S1.rotation().matrix().transpose();
     }
-
     return retval;
 }
-}
\ No newline at end of file
+}
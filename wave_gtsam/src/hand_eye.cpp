@@ -17,46 +17,38 @@ gtsam::Vector HandEyeFactor::evaluateError(
   boost::optional<gtsam::Matrix &> J_T_LOCAL_S2,
   boost::optional<gtsam::Matrix &> J_T_S1_S2,
   boost::optional<gtsam::Matrix &> J_B_Z) const {
-    gtsam::Matrix J_compose_right;
-    gtsam::Matrix J_compose_left2, J_compose_right2;
-    gtsam::Matrix J_between_left, J_between_right;
-    gtsam::Matrix J_logmap, J_bias;
-
-    gtsam::Rot3 IdenRot;
-    gtsam::Pose3 Lifted_Bias(IdenRot, B_Z);
-
-    gtsam::Pose3 bias_T_S1_S2 =
-      Lifted_Bias.compose(T_S1_S2, J_compose_left2, J_compose_right2);
-
-    auto meas_T_LOCAL_S2 =
-      this->T_LOCAL_S1.compose(bias_T_S1_S2, boost::none, J_compose_right);
-    auto est_T_eye =
-      meas_T_LOCAL_S2.between(T_LOCAL_S2, J_between_left, J_between_right);
-    auto retval = gtsam::Pose3::Logmap(est_T_eye, J_logmap);
-
-    if (J_T_LOCAL_S2) {
-        J_T_LOCAL_S2->resize(T_LOCAL_S2.dimension, T_LOCAL_S2.dimension);
-
-        *J_T_LOCAL_S2 = J_logmap * J_between_right;
+    // E = (meas * bias * T_S1_S2)^-1 * T_LOCAL_S2, with the bias lifted to a
+    // pure translation
+    const gtsam::Pose3 Lifted_Bias{gtsam::Rot3{}, B_Z};
+    const auto meas_T_LOCAL_S2 =
+      this->T_LOCAL_S1.compose(Lifted_Bias.compose(T_S1_S2));
+    const auto est_T_eye = meas_T_LOCAL_S2.between(T_LOCAL_S2);
+
+    if (!J_T_LOCAL_S2 && !J_T_S1_S2 && !J_B_Z) {
+        return gtsam::Pose3::Logmap(est_T_eye);
     }
-    if (J_T_S1_S2) {
-        J_T_S1_S2->resize(T_S1_S2.dimension, T_S1_S2.dimension);
 
-        *J_T_S1_S2 =
-          J_logmap * J_between_left * J_compose_right * J_compose_right2;
+    // A right perturbation x of T_LOCAL_S2 perturbs E by x. A right
+    // perturbation x of T_S1_S2 gives Exp(-x) * E = E * Exp(-Ad(E^-1) x).
+    // A change d in the bias is a left perturbation of T_S1_S2 by the
+    // translation d, which is the right perturbation [0; R^T d], with R the
+    // rotation of T_S1_S2.
+    gtsam::Matrix6 J_logmap;
+    const gtsam::Vector6 retval = gtsam::Pose3::Logmap(est_T_eye, J_logmap);
+    if (J_T_LOCAL_S2) {
+        *J_T_LOCAL_S2 = J_logmap;
     }
-    if (J_B_Z) {
-        J_B_Z->resize(6, 3);
-        J_bias.resize(6, 3);
-        J_bias.setZero();
-        J_bias(3, 0) = 1;
-        J_bias(4, 1) = 1;
-        J_bias(5, 2) = 1;
-
-        *J_B_Z = J_logmap * J_between_left * J_compose_right * J_compose_left2 *
-                 J_bias;
+    if (J_T_S1_S2 || J_B_Z) {
+        const gtsam::Matrix6 J_S1_S2 =
+          -J_logmap * est_T_eye.inverse().AdjointMap();
+        if (J_T_S1_S2) {
+            *J_T_S1_S2 = J_S1_S2;
+        }
+        if (J_B_Z) {
+            *J_B_Z = J_S1_S2.rightCols<3>() *
+                     T_S1_S2.rotation().matrix().transpose();
+        }
     }
-
     return retval;
 }
 }
@@ -0,0 +1,135 @@
+#include "wave/gtsam/imu_preintegration.hpp"
+#include "wave/utils/log.hpp"
+#include "wave/utils/parallel.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Seconds between two time points */
+double secondsBetween(const TimePoint &start, const TimePoint &end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/** Integrate the segment of the signal between two consecutive samples,
+ * clipped to [start, end], at its midpoint value */
+void integrateSegment(const ImuMeasurement &m1,
+                      const ImuMeasurement &m2,
+                      const TimePoint &start,
+                      const TimePoint &end,
+                      gtsam::PreintegratedCombinedMeasurements &pim) {
+    const auto a = std::max(m1.time_point, start);
+    const auto b = std::min(m2.time_point, end);
+    if (b <= a) {
+        return;
+    }
+    const Vec6 mid = 0.5 * (interpolate(m1, m2, a) + interpolate(m1, m2, b));
+    pim.integrateMeasurement(
+      mid.tail<3>(), mid.head<3>(), secondsBetween(a, b));
+}
+
+}  // namespace
+
+int preintegrateImu(const MeasurementContainer<ImuMeasurement> &imu,
+                    int sensor_id,
+                    const TimePoint &start,
+                    const TimePoint &end,
+                    gtsam::PreintegratedCombinedMeasurements &pim,
+                    Vec6 *end_measurement) {
+    if (end <= start) {
+        LOG_ERROR("End of preintegration must be after its start");
+        return -1;
+    }
+
+    const auto from_sensor = [sensor_id](const ImuMeasurement &m) {
+        return m.sensor_id == sensor_id;
+    };
+    const auto window = imu.getTimeWindow(start, end);
+    const auto first = std::find_if(window.first, window.second, from_sensor);
+
+    // Nearest measurements on either side of the window
+    const ImuMeasurement *before = nullptr;
+    const ImuMeasurement *after = nullptr;
+    for (auto it = window.first; it != imu.begin();) {
+        --it;
+        if (from_sensor(*it)) {
+            before = &*it;
+            break;
+        }
+    }
+    for (auto it = window.second; it != imu.end(); ++it) {
+        if (from_sensor(*it)) {
+            after = &*it;
+            break;
+        }
+    }
+
+    // Without a measurement on one side, hold the nearest one up to the
+    // boundary
+    ImuMeasurement held_start{start, sensor_id, Vec6::Zero()};
+    ImuMeasurement held_end{end, sensor_id, Vec6::Zero()};
+    if (before == nullptr) {
+        const auto *nearest = first != window.second ? &*first : after;
+        if (nearest == nullptr) {
+            LOG_ERROR("No IMU measurements to preintegrate");
+            return -1;
+        }
+        held_start.value = nearest->value;
+        before = &held_start;
+    }
+
+    const ImuMeasurement *last = before;
+    for (auto it = first; it != window.second; ++it) {
+        if (!from_sensor(*it)) {
+            continue;
+        }
+        integrateSegment(*last, *it, start, end, pim);
+        last = &*it;
+    }
+
+    if (after == nullptr) {
+        held_end.value = last->value;
+        after = &held_end;
+    }
+    integrateSegment(*last, *after, start, end, pim);
+
+    if (end_measurement != nullptr) {
+        *end_measurement =
+          after == &held_end ? last->value : interpolate(*last, *after, end);
+    }
+    return 0;
+}
+
+int preintegrateImuBatch(
+  const MeasurementContainer<ImuMeasurement> &imu,
+  const std::vector<TimePoint> &keyframes,
+  const gtsam::imuBias::ConstantBias &bias,
+  const ImuPreintegrationParams &params,
+  std::vector<gtsam::PreintegratedCombinedMeasurements> &pims) {
+    if (keyframes.size() < 2) {
+        LOG_ERROR("At least two keyframes are needed");
+        return -1;
+    }
+
+    const auto nb_intervals = static_cast<int>(keyframes.size() - 1);
+    pims.assign(nb_intervals,
+                gtsam::PreintegratedCombinedMeasurements{params.imu_params,
+                                                         bias});
+    std::vector<int> results(nb_intervals);
+    parallelFor(nb_intervals, params.num_threads, [&](int i) {
+        results[i] = preintegrateImu(imu,
+                                     params.sensor_id,
+                                     keyframes[i],
+                                     keyframes[i + 1],
+                                     pims[i]);
+    });
+
+    for (const auto result : results) {
+        if (result != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace wave
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "wave/gtsam/incremental_estimator.hpp"
+#include "wave/gtsam/preint_imu_factor.hpp"
+#include "wave/gtsam/motion_factor.hpp"
+#include "wave/gtsam/gps_factor_with_bias_general.hpp"
+#include "wave/gtsam/pose_prior.hpp"
+#include "wave/gtsam/twist_prior.hpp"
+#include "wave/gtsam/bias_prior.hpp"
+#include "wave/utils/log.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Seconds between two time points */
+double secondsBetween(const TimePoint &start, const TimePoint &end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/** Whether `imu` has a measurement of `sensor_id` in (start, end] */
+bool hasImuSince(const MeasurementContainer<ImuMeasurement> &imu,
+                 int sensor_id,
+                 const TimePoint &start,
+                 const TimePoint &end) {
+    const auto window = imu.getTimeWindow(start, end);
+    return std::any_of(
+      window.first, window.second, [&](const ImuMeasurement &m) {
+          return m.sensor_id == sensor_id && m.time_point > start;
+      });
+}
+
+/** Mark the frontal keys of every clique below `clique` whose separator
+ * contains `key`. These must be re-eliminated for `key` to become a leaf;
+ * this follows gtsam's IncrementalFixedLagSmoother. */
+void markAffectedKeys(gtsam::Key key,
+                      const gtsam::ISAM2Clique::shared_ptr &clique,
+                      std::set<gtsam::Key> &keys) {
+    const auto &conditional = clique->conditional();
+    if (std::find(conditional->beginParents(),
+                  conditional->endParents(),
+                  key) == conditional->endParents()) {
+        return;
+    }
+    for (const auto frontal : conditional->frontals()) {
+        keys.insert(frontal);
+    }
+    for (const auto &child : clique->children) {
+        markAffectedKeys(key, child, keys);
+    }
+}
+
+gtsam::ISAM2Params isamParams(const IncrementalEstimatorParams &params) {
+    gtsam::ISAM2Params isam_params;
+    isam_params.relinearizeThreshold = params.relinearize_threshold;
+    isam_params.relinearizeSkip = params.relinearize_skip;
+    return isam_params;
+}
+
+}  // namespace
+
+IncrementalEstimator::IncrementalEstimator(
+  const IncrementalEstimatorParams &params)
+    : params{params}, isam{isamParams(params)} {}
+
+gtsam::Key IncrementalEstimator::stateKey(size_t index) {
+    return gtsam::Symbol{'x', index};
+}
+
+gtsam::Key IncrementalEstimator::imuBiasKey(size_t index) {
+    return gtsam::Symbol{'b', index};
+}
+
+int IncrementalEstimator::initialize(
+  const TimePoint &t,
+  const PoseVelBias &state,
+  const gtsam::imuBias::ConstantBias &imu_bias) {
+    if (this->nb_states > 0) {
+        LOG_ERROR("Estimator is already initialized");
+        return -1;
+    }
+
+    gtsam::NonlinearFactorGraph factors;
+    gtsam::Values values;
+    const auto key = stateKey(0);
+    values.insert(key, state);
+
+    gtsam::Vector6 pose_sigmas;
+    pose_sigmas << Vec3::Constant(this->params.prior_rotation_sigma),
+      Vec3::Constant(this->params.prior_position_sigma);
+    factors.emplace_shared<PosePrior<PoseVelBias>>(
+      key, state.pose, gtsam::noiseModel::Diagonal::Sigmas(pose_sigmas));
+    factors.emplace_shared<TwistPrior<PoseVelBias>>(
+      key,
+      state.vel,
+      gtsam::noiseModel::Isotropic::Sigma(6,
+                                          this->params.prior_velocity_sigma));
+    factors.emplace_shared<BiasPrior<PoseVelBias>>(
+      key,
+      state.bias,
+      gtsam::noiseModel::Isotropic::Sigma(3, this->params.gps_bias_sigma));
+
+    if (this->params.use_imu) {
+        values.insert(imuBiasKey(0), imu_bias);
+        factors.emplace_shared<
+          gtsam::PriorFactor<gtsam::imuBias::ConstantBias>>(
+          imuBiasKey(0),
+          imu_bias,
+          gtsam::noiseModel::Isotropic::Sigma(
+            6, this->params.prior_imu_bias_sigma));
+    }
+
+    this->nb_states = 1;
+    this->last_time = t;
+    this->active_states.emplace(0, t);
+    this->updateIsam(factors, values, t);
+    return 0;
+}
+
+void IncrementalEstimator::addGpsFactor(
+  size_t index,
+  const TimePoint &t,
+  const PoseContainer &gps,
+  gtsam::NonlinearFactorGraph &factors) const {
+    const auto max_offset = std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{this->params.gps_max_time_offset});
+    const auto window = gps.getTimeWindow(t - max_offset, t + max_offset);
+    const auto near = std::find_if(
+      window.first, window.second, [this](const Pose3Measurement &m) {
+          return m.sensor_id == this->params.gps_sensor_id;
+      });
+    if (near == window.second) {
+        return;
+    }
+
+    // Interpolate to the time of the state if possible, otherwise use the
+    // nearby measurement as is
+    gtsam::Pose3 T_local_s1 = near->value;
+    try {
+        T_local_s1 = gps.get(t, this->params.gps_sensor_id);
+    } catch (const std::out_of_range &) {
+    }
+
+    gtsam::Vector6 sigmas;
+    sigmas << Vec3::Constant(this->params.gps_rotation_sigma),
+      Vec3::Constant(this->params.gps_position_sigma);
+    factors.emplace_shared<GPSFactorWithBiasGeneral<PoseVelBias>>(
+      stateKey(index),
+      T_local_s1,
+      gtsam::noiseModel::Diagonal::Sigmas(sigmas));
+}
+
+int IncrementalEstimator::update(const TimePoint &t,
+                                 const ImuContainer &imu,
+                                 const PoseContainer &gps) {
+    if (this->nb_states == 0) {
+        LOG_ERROR("Estimator is not initialized");
+        return -1;
+    }
+    if (t <= this->last_time) {
+        LOG_ERROR("New state must be after the previous one");
+        return -1;
+    }
+
+    const auto prev = this->nb_states - 1;
+    const auto index = this->nb_states;
+    const auto key = stateKey(index);
+    const double dt = secondsBetween(this->last_time, t);
+
+    PoseVelBias prev_state;
+    gtsam::imuBias::ConstantBias prev_bias;
+    this->getState(prev, prev_state, &prev_bias);
+
+    gtsam::NonlinearFactorGraph factors;
+    gtsam::Values values;
+    PoseVelBias state = prev_state;
+    if (this->params.use_imu) {
+        // preintegrateImu() would hold an older measurement over the whole
+        // interval, however stale
+        if (!hasImuSince(imu, this->params.imu_sensor_id, this->last_time, t)) {
+            LOG_ERROR("No IMU measurements since the previous state");
+            return -1;
+        }
+
+        gtsam::PreintegratedCombinedMeasurements pim{this->params.imu_params,
+                                                     prev_bias};
+        Vec6 last_imu;
+        if (preintegrateImu(imu,
+                            this->params.imu_sensor_id,
+                            this->last_time,
+                            t,
+                            pim,
+                            &last_imu) != 0) {
+            return -1;
+        }
+        const Vec3 omega = prev_bias.correctGyroscope(last_imu.head<3>());
+
+        // Predict the new state from the previous estimate
+        const gtsam::Vector3 prev_velocity = prev_state.vel.tail<3>();
+        const gtsam::NavState prev_nav{prev_state.pose, prev_velocity};
+        const auto nav = pim.predict(prev_nav, prev_bias);
+        state.pose = nav.pose();
+        state.vel << omega, nav.velocity();
+
+        factors.emplace_shared<PreintegratedImuFactor<PoseVelBias>>(
+          stateKey(prev), key, imuBiasKey(prev), imuBiasKey(index), pim);
+
+        // The IMU factor does not constrain angular velocity
+        gtsam::Vector6 precisions;
+        precisions << Vec3::Constant(
+          1.0 / (this->params.angular_velocity_sigma *
+                 this->params.angular_velocity_sigma)),
+          Vec3::Zero();
+        factors.emplace_shared<TwistPrior<PoseVelBias>>(
+          key, state.vel, gtsam::noiseModel::Diagonal::Precisions(precisions));
+
+        values.insert(imuBiasKey(index), prev_bias);
+    } else {
+        state.pose = prev_state.pose.retract(dt * prev_state.vel);
+
+        Eigen::Matrix<double, 15, 1> sigmas;
+        sigmas << Vec6::Constant(this->params.motion_pose_sigma),
+          Vec6::Constant(this->params.motion_velocity_sigma),
+          Vec3::Constant(this->params.motion_bias_sigma);
+        factors.emplace_shared<MotionFactor<PoseVelBias, PoseVelBias>>(
+          stateKey(prev),
+          key,
+          dt,
+          gtsam::noiseModel::Diagonal::Sigmas(std::sqrt(dt) * sigmas));
+    }
+    values.insert(key, state);
+
+    // Keep the GPS bias near zero; the IMU factor does not constrain it
+    factors.emplace_shared<BiasPrior<PoseVelBias>>(
+      key,
+      Vec3::Zero(),
+      gtsam::noiseModel::Isotropic::Sigma(3, this->params.gps_bias_sigma));
+    this->addGpsFactor(index, t, gps, factors);
+
+    this->nb_states++;
+    this->last_time = t;
+    this->active_states.emplace(index, t);
+    this->updateIsam(factors, values, t);
+    return 0;
+}
+
+void IncrementalEstimator::updateIsam(
+  const gtsam::NonlinearFactorGraph &factors,
+  const gtsam::Values &values,
+  const TimePoint &t) {
+    const auto start = std::chrono::steady_clock::now();
+
+    if (this->params.keep_history) {
+        this->history_graph.push_back(factors);
+        this->history_values.insert(values);
+    }
+
+    // Find existing states that fall out of the lag
+    std::vector<size_t> old_states;
+    gtsam::FastList<gtsam::Key> old_keys;
+    if (this->params.lag > 0) {
+        for (const auto &active : this->active_states) {
+            if (secondsBetween(active.second, t) <= this->params.lag) {
+                break;
+            }
+            old_states.push_back(active.first);
+            old_keys.push_back(stateKey(active.first));
+            if (this->params.use_imu) {
+                old_keys.push_back(imuBiasKey(active.first));
+            }
+        }
+    }
+
+    if (old_keys.empty()) {
+        this->isam.update(factors, values);
+    } else {
+        // Eliminate the old keys first, so they are leaves of the Bayes tree
+        gtsam::FastMap<gtsam::Key, int> constrained_keys;
+        for (const auto key : this->isam.getLinearizationPoint().keys()) {
+            constrained_keys[key] = 1;
+        }
+        for (const auto key : values.keys()) {
+            constrained_keys[key] = 1;
+        }
+        std::set<gtsam::Key> affected_keys;
+        for (const auto key : old_keys) {
+            constrained_keys[key] = 0;
+            for (const auto &child : this->isam[key]->children) {
+                markAffectedKeys(key, child, affected_keys);
+            }
+        }
+        const gtsam::FastList<gtsam::Key> extra_keys{affected_keys.begin(),
+                                                     affected_keys.end()};
+
+        this->isam.update(factors,
+                          values,
+                          {},
+                          constrained_keys,
+                          boost::none,
+                          extra_keys);
+    }
+
+    for (int i = 0; i < this->params.extra_iterations; i++) {
+        this->isam.update();
+    }
+
+    if (!old_keys.empty()) {
+        // Keep the last estimate of the states being marginalized
+        for (const auto index : old_states) {
+            this->marginalized_states[index] =
+              this->isam.calculateEstimate<PoseVelBias>(stateKey(index));
+            if (this->params.use_imu) {
+                this->marginalized_imu_biases[index] =
+                  this->isam.calculateEstimate<gtsam::imuBias::ConstantBias>(
+                    imuBiasKey(index));
+            }
+            this->active_states.erase(index);
+        }
+        this->isam.marginalizeLeaves(old_keys);
+    }
+
+    this->last_update_duration =
+      secondsBetween(start, std::chrono::steady_clock::now());
+}
+
+size_t IncrementalEstimator::numStates() const {
+    return this->nb_states;
+}
+
+size_t IncrementalEstimator::numActiveStates() const {
+    return this->active_states.size();
+}
+
+bool IncrementalEstimator::getState(
+  size_t index,
+  PoseVelBias &state,
+  gtsam::imuBias::ConstantBias *imu_bias) const {
+    if (index >= this->nb_states) {
+        return false;
+    }
+
+    const auto marginalized = this->marginalized_states.find(index);
+    if (marginalized != this->marginalized_states.end()) {
+        state = marginalized->second;
+        if (imu_bias && this->params.use_imu) {
+            *imu_bias = this->marginalized_imu_biases.at(index);
+        }
+        return true;
+    }
+
+    state = this->isam.calculateEstimate<PoseVelBias>(stateKey(index));
+    if (imu_bias && this->params.use_imu) {
+        *imu_bias = this->isam.calculateEstimate<gtsam::imuBias::ConstantBias>(
+          imuBiasKey(index));
+    }
+    return true;
+}
+
+double IncrementalEstimator::lastUpdateDuration() const {
+    return this->last_update_duration;
+}
+
+const gtsam::NonlinearFactorGraph &IncrementalEstimator::getHistoryGraph()
+  const {
+    return this->history_graph;
+}
+
+const gtsam::Values &IncrementalEstimator::getHistoryValues() const {
+    return this->history_values;
+}
+
+}  // namespace wave
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <exception>
+#include <vector>
+
+#include <gtsam/inference/Ordering.h>
+#include <gtsam/linear/GaussianBayesTree.h>
+#include <gtsam/linear/linearExceptions.h>
+
+#include "wave/gtsam/parallel_linearize.hpp"
+#include "wave/utils/log.hpp"
+#include "wave/utils/parallel.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Seconds since `start` */
+double secondsSince(const std::chrono::steady_clock::time_point &start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+      .count();
+}
+
+}  // namespace
+
+gtsam::GaussianFactorGraph::shared_ptr linearizeParallel(
+  const gtsam::NonlinearFactorGraph &graph,
+  const gtsam::Values &values,
+  const ParallelLinearizeParams &params) {
+    const size_t n = graph.size();
+    const size_t chunk_size = std::max<size_t>(1, params.chunk_size);
+    const int nb_chunks = static_cast<int>((n + chunk_size - 1) / chunk_size);
+
+    // Each chunk writes only its own slots, and records its first exception
+    std::vector<gtsam::GaussianFactor::shared_ptr> linear(n);
+    std::vector<std::exception_ptr> errors(nb_chunks);
+    parallelFor(nb_chunks, params.num_threads, [&](int c) {
+        const size_t end = std::min(n, (c + 1) * chunk_size);
+        try {
+            for (size_t i = c * chunk_size; i < end; i++) {
+                if (graph[i]) {
+                    linear[i] = graph[i]->linearize(values);
+                }
+            }
+        } catch (...) {
+            errors[c] = std::current_exception();
+        }
+    });
+    for (const auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    auto result = boost::make_shared<gtsam::GaussianFactorGraph>();
+    result->reserve(n);
+    for (auto &factor : linear) {
+        result->push_back(factor);
+    }
+    return result;
+}
+
+int solveGaussNewtonStep(const gtsam::NonlinearFactorGraph &graph,
+                         const gtsam::Values &values,
+                         const ParallelLinearizeParams &params,
+                         gtsam::VectorValues &delta,
+                         LinearizationTimes &times) {
+    auto start = std::chrono::steady_clock::now();
+    const auto linear = linearizeParallel(graph, values, params);
+    times.linearize = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    try {
+        const auto ordering = gtsam::Ordering::Colamd(*linear);
+        delta = linear->eliminateMultifrontal(ordering)->optimize();
+    } catch (const gtsam::IndeterminantLinearSystemException &) {
+        LOG_ERROR("Linear system is indeterminant");
+        times.eliminate = secondsSince(start);
+        return -1;
+    }
+    times.eliminate = secondsSince(start);
+    return 0;
+}
+
+}  // namespace wave
@@ -2,131 +2,41 @@
 
 namespace wave {
 
-// Implementation of evaluateError for PoseVelBias states
-// This function is adapted from GTSAM's IMU factor code
-template <>
-gtsam::Vector PreintegratedImuFactor<PoseVelBias>::evaluateError(
-  const PoseVelBias &state_i,
-  const PoseVelBias &state_j,
-  const gtsam::imuBias::ConstantBias &bias_i,
-  const gtsam::imuBias::ConstantBias &bias_j,
-  boost::optional<gtsam::Matrix &> H1,
-  boost::optional<gtsam::Matrix &> H2,
-  boost::optional<gtsam::Matrix &> H3,
-  boost::optional<gtsam::Matrix &> H4) const {
-    // Split up the PoseVelBias combined states into pose and vel.
-    // (ignore gps bias)
-    // Then use code adapted from gtsam::CombinedImuFactor.
-    const auto &pose_i = state_i.pose;
-    const auto &pose_j = state_j.pose;
-
-    // Note we use only linear velocity here
-    const auto &vel_i = state_i.vel.tail<3>();
-    const auto &vel_j = state_j.vel.tail<3>();
-
-    // Calculate error wrt bias evolution model (random walk)
-    gtsam::Matrix6 Hbias_i, Hbias_j;
-    gtsam::Vector6 fbias =
-      gtsam::traits<gtsam::imuBias::ConstantBias>::Between(
-        bias_j, bias_i, H4 ? &Hbias_j : 0, H3 ? &Hbias_i : 0)
-        .vector();
-
-    gtsam::Matrix96 D_r_pose_i, D_r_pose_j, D_r_bias_i;
-    gtsam::Matrix93 D_r_vel_i, D_r_vel_j;
-
-    // Calculate error wrt preintegrated measurements
-    gtsam::Vector9 r_Rpv =
-      this->pim.computeErrorAndJacobians(pose_i,
-                                         vel_i,
-                                         pose_j,
-                                         vel_j,
-                                         bias_i,
-                                         H1 ? &D_r_pose_i : 0,
-                                         H2 ? &D_r_vel_i : 0,
-                                         H1 ? &D_r_pose_j : 0,
-                                         H2 ? &D_r_vel_j : 0,
-                                         H1 ? &D_r_bias_i : 0);
-
-    if (H1) {
-        H1->resize(15, 15);
-
-        // Jacobian wrt pose (Pi)
-        H1->block<9, 6>(0, PoseVelBias::pose_offset).noalias() = D_r_pose_i;
-        // adding: [dBiasAcc/dPi ; dBiasOmega/dPi]
-        H1->block<6, 6>(9, PoseVelBias::pose_offset).setZero();
-
-        // Jacobian wrt linear velocity
-        H1->block<9, 3>(0, PoseVelBias::vel_offset + 3).noalias() = D_r_vel_i;
-        // Jacobian of bias wrt linear velocity is zero
-        H1->block<6, 3>(9, PoseVelBias::vel_offset + 3).setZero();
-        // Jacobian of all wrt angular velocity is zero
-        H1->block<15, 3>(0, PoseVelBias::vel_offset).setZero();
-
-        // Jacobian of all wrt gps bias is zero
-        H1->block<15, 3>(0, PoseVelBias::bias_offset).setZero();
-    }
-
-    if (H2) {
-        H2->resize(15, 15);
-
-        // Jacobian wrt pose (Pj)
-        H2->block<9, 6>(0, PoseVelBias::pose_offset).noalias() = D_r_pose_j;
-        // adding: [dBiasAcc/dPj ; dBiasOmega/dPj]
-        H2->block<6, 6>(9, PoseVelBias::pose_offset).setZero();
-
-        // Jacobian wrt linear velocity
-        H2->block<9, 3>(0, PoseVelBias::vel_offset + 3).noalias() = D_r_vel_j;
-        // Jacobian of bias wrt linear velocity is zero
-        H2->block<6, 3>(9, PoseVelBias::vel_offset + 3).setZero();
-        // Jacobian of all wrt angular velocity is zero
-        H2->block<15, 3>(0, PoseVelBias::vel_offset).setZero();
-
-        // Jacobian of all wrt gps bias is zero
-        H2->block<15, 3>(0, PoseVelBias::bias_offset).setZero();
-    }
-
-    if (H3) {
-        H3->resize(15, 6);
-        // Jacobian wrt imu bias
-        H3->block<9, 6>(0, 0) = D_r_bias_i;
-        // adding: [dBiasAcc/dBias_i ; dBiasOmega/dBias_i]
-        H3->block<6, 6>(9, 0) = Hbias_i;
-    }
-
-    if (H4) {
-        H4->resize(15, 6);
-        // Jacobian wrt imu bias_j is zero
-        H4->block<9, 6>(0, 0).setZero();
-        // adding: [dBiasAcc/dBias_i ; dBiasOmega/dBias_i]
-        H4->block<6, 6>(9, 0) = Hbias_j;
-    }
-
-    // Return overall error
-    gtsam::Vector r(15);
-    r << r_Rpv, fbias;  // vector of size 15
-    return r;
+gtsam::SharedNoiseModel makeImuNoiseModel(
+  const gtsam::PreintegratedCombinedMeasurements &pim) {
+    using Matrix15 = Eigen::Matrix<double, 15, 15>;
+
+    // The noise model needs an upper-triangular R with R^T R = cov^-1. With
+    // the ordering of the covariance reversed, the inverse of its lower
+    // Cholesky factor is such an R, also reversed.
+    const Matrix15 reversed = pim.preintMeasCov().reverse();
+    const Eigen::LLT<Matrix15> llt{reversed};
+    const Matrix15 L_inv = llt.matrixL().solve(Matrix15::Identity());
+    return gtsam::noiseModel::Gaussian::SqrtInformation(L_inv.reverse(),
+                                                        false);
 }
 
-// Implementation of evaluateError for PoseVel states
+// Implementation of evaluateError for PoseVel and PoseVelBias states
 // This function is adapted from GTSAM's IMU factor code
-template <>
-gtsam::Vector PreintegratedImuFactor<PoseVel>::evaluateError(
-  const PoseVel &state_i,
-  const PoseVel &state_j,
+template <typename StateType>
+gtsam::Vector PreintegratedImuFactor<StateType>::evaluateError(
+  const StateType &state_i,
+  const StateType &state_j,
   const gtsam::imuBias::ConstantBias &bias_i,
   const gtsam::imuBias::ConstantBias &bias_j,
   boost::optional<gtsam::Matrix &> H1,
   boost::optional<gtsam::Matrix &> H2,
   boost::optional<gtsam::Matrix &> H3,
   boost::optional<gtsam::Matrix &> H4) const {
-    // Split up the PoseVel combined states into pose and vel.
+    // Split up the combined states into pose and vel.
+    // (ignore gps bias)
     // Then use code adapted from gtsam::CombinedImuFactor.
     const auto &pose_i = state_i.pose;
     const auto &pose_j = state_j.pose;
 
     // Note we use only linear velocity here
-    const auto &vel_i = state_i.vel.tail<3>();
-    const auto &vel_j = state_j.vel.tail<3>();
+    const auto &vel_i = state_i.vel.template tail<3>();
+    const auto &vel_j = state_j.vel.template tail<3>();
 
     // Calculate error wrt bias evolution model (random walk)
     gtsam::Matrix6 Hbias_i, Hbias_j;
@@ -140,63 +50,47 @@ gtsam::Vector PreintegratedImuFactor<PoseVel>::evaluateError(
 
     // Calculate error wrt preintegrated measurements
     gtsam::Vector9 r_Rpv =
-      this->pim.computeErrorAndJacobians(pose_i,
-                                         vel_i,
-                                         pose_j,
-                                         vel_j,
-                                         bias_i,
-                                         H1 ? &D_r_pose_i : 0,
-                                         H2 ? &D_r_vel_i : 0,
-                                         H1 ? &D_r_pose_j : 0,
-                                         H2 ? &D_r_vel_j : 0,
-                                         H1 ? &D_r_bias_i : 0);
-
+      this->pim->computeErrorAndJacobians(pose_i,
+                                          vel_i,
+                                          pose_j,
+                                          vel_j,
+                                          bias_i,
+                                          H1 ? &D_r_pose_i : 0,
+                                          H1 ? &D_r_vel_i : 0,
+                                          H2 ? &D_r_pose_j : 0,
+                                          H2 ? &D_r_vel_j : 0,
+                                          H3 ? &D_r_bias_i : 0);
+
+    // Only the pose and linear velocity blocks of the state Jacobians are
+    // non-zero: the bias evolution does not depend on the states, nothing
+    // depends on angular velocity, and nothing depends on the GPS bias.
+    const int dim = gtsam::traits<StateType>::dimension;
     if (H1) {
-        H1->resize(15, 12);
-
-        // Jacobian wrt pose (Pi)
-        H1->block<9, 6>(0, PoseVel::pose_offset).noalias() = D_r_pose_i;
-        // adding: [dBiasAcc/dPi ; dBiasOmega/dPi]
-        H1->block<6, 6>(9, PoseVel::pose_offset).setZero();
-
-        // Jacobian wrt linear velocity
-        H1->block<9, 3>(0, PoseVel::vel_offset + 3).noalias() = D_r_vel_i;
-        // Jacobian of bias wrt linear velocity is zero
-        H1->block<6, 3>(9, PoseVel::vel_offset + 3).setZero();
-        // Jacobian of all wrt angular velocity is zero
-        H1->block<15, 3>(0, PoseVel::vel_offset).setZero();
+        H1->setZero(15, dim);
+        H1->block<9, 6>(0, StateType::pose_offset).noalias() = D_r_pose_i;
+        H1->block<9, 3>(0, StateType::vel_offset + 3).noalias() = D_r_vel_i;
     }
 
     if (H2) {
-        H2->resize(15, 12);
-
-        // Jacobian wrt pose (Pj)
-        H2->block<9, 6>(0, PoseVel::pose_offset).noalias() = D_r_pose_j;
-        // adding: [dBiasAcc/dPj ; dBiasOmega/dPj]
-        H2->block<6, 6>(9, PoseVel::pose_offset).setZero();
-
-        // Jacobian wrt linear velocity
-        H2->block<9, 3>(0, PoseVel::vel_offset + 3).noalias() = D_r_vel_j;
-        // Jacobian of bias wrt linear velocity is zero
-        H2->block<6, 3>(9, PoseVel::vel_offset + 3).setZero();
-        // Jacobian of all wrt angular velocity is zero
-        H2->block<15, 3>(0, PoseVel::vel_offset).setZero();
+        H2->setZero(15, dim);
+        H2->block<9, 6>(0, StateType::pose_offset).noalias() = D_r_pose_j;
+        H2->block<9, 3>(0, StateType::vel_offset + 3).noalias() = D_r_vel_j;
     }
 
     if (H3) {
         H3->resize(15, 6);
         // Jacobian wrt imu bias
-        H3->block<9, 6>(0, 0) = D_r_bias_i;
+        H3->topRows<9>().noalias() = D_r_bias_i;
         // adding: [dBiasAcc/dBias_i ; dBiasOmega/dBias_i]
-        H3->block<6, 6>(9, 0) = Hbias_i;
+        H3->bottomRows<6>().noalias() = Hbias_i;
     }
 
     if (H4) {
         H4->resize(15, 6);
         // Jacobian wrt imu bias_j is zero
-        H4->block<9, 6>(0, 0).setZero();
-        // adding: [dBiasAcc/dBias_i ; dBiasOmega/dBias_i]
-        H4->block<6, 6>(9, 0) = Hbias_j;
+        H4->topRows<9>().setZero();
+        // adding: [dBiasAcc/dBias_j ; dBiasOmega/dBias_j]
+        H4->bottomRows<6>().noalias() = Hbias_j;
     }
 
     // Return overall error
@@ -205,4 +99,7 @@ gtsam::Vector PreintegratedImuFactor<PoseVel>::evaluateError(
     return r;
 }
 
+template class PreintegratedImuFactor<PoseVel>;
+template class PreintegratedImuFactor<PoseVelBias>;
+
 }  // namespace wave
@@ -0,0 +1,199 @@
+/** @file
+ * Linearization throughput of the wave_gtsam factors and state traits.
+ *
+ * Each benchmark linearizes a single factor at a fixed, non-trivial
+ * linearization point, which is the work done for each factor at every
+ * iteration of an optimizer.
+ *
+ * The IMU factor graph benchmarks construct and linearize a chain of 10k
+ * PreintegratedImuFactors, as in a long log.
+ */
+
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/nonlinear/Values.h>
+
+#include "wave/gtsam/pose_vel_bias.hpp"
+#include "wave/gtsam/pose_prior.hpp"
+#include "wave/gtsam/twist_prior.hpp"
+#include "wave/gtsam/bias_prior.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+#include "wave/gtsam/gps_factor_with_bias_general.hpp"
+#include "wave/gtsam/hand_eye.hpp"
+#include "wave/gtsam/motion_factor.hpp"
+#include "wave/gtsam/preint_imu_factor.hpp"
+
+namespace wave {
+
+// Keys of the values used by the factors
+const gtsam::Key S1 = 1, S2 = 2, B1 = 3, B2 = 4, P1 = 5, P2 = 6, Z = 7;
+
+PoseVelBias makeState(int seed) {
+    std::srand(seed);
+    PoseVelBias state;
+    state.pose = gtsam::Pose3::Expmap(gtsam::Vector6::Random());
+    state.vel.setRandom();
+    state.bias.setRandom();
+    return state;
+}
+
+const gtsam::Values &linearizationPoint() {
+    static const gtsam::Values values = [] {
+        gtsam::Values v;
+        v.insert(S1, makeState(1));
+        v.insert(S2, makeState(2));
+        v.insert(B1, gtsam::imuBias::ConstantBias{});
+        v.insert(B2, gtsam::imuBias::ConstantBias{});
+        v.insert(P1, makeState(3).pose);
+        v.insert(P2, makeState(4).pose);
+        v.insert(Z, gtsam::Point3{0.1, -0.2, 0.3});
+        return v;
+    }();
+    return values;
+}
+
+gtsam::SharedNoiseModel isotropic(size_t dim) {
+    return gtsam::noiseModel::Isotropic::Sigma(dim, 0.1);
+}
+
+/** Time linearizing `factor` at the linearization point */
+void benchmarkLinearize(benchmark::State &state,
+                        const gtsam::NonlinearFactor &factor) {
+    const auto &values = linearizationPoint();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(factor.linearize(values));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_PosePrior(benchmark::State &state) {
+    const PosePrior<PoseVelBias> factor{S1, makeState(5).pose, isotropic(6)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_TwistPrior(benchmark::State &state) {
+    const TwistPrior<PoseVelBias> factor{S1, makeState(5).vel, isotropic(6)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_BiasPrior(benchmark::State &state) {
+    const BiasPrior<PoseVelBias> factor{S1, makeState(5).bias, isotropic(3)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_GPSFactorWithBiasGeneral(benchmark::State &state) {
+    const GPSFactorWithBiasGeneral<PoseVelBias> factor{
+      S1, makeState(5).pose, isotropic(6)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_GPSFactorWBias(benchmark::State &state) {
+    const GPSFactorWBias factor{P1, Z, makeState(5).pose, isotropic(6)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_HandEyeFactor(benchmark::State &state) {
+    const HandEyeFactor factor{P1, P2, Z, makeState(5).pose, isotropic(6)};
+    benchmarkLinearize(state, factor);
+}
+
+void BM_MotionFactor(benchmark::State &state) {
+    const MotionFactor<PoseVelBias, PoseVelBias> factor{
+      S1, S2, 0.1, isotropic(15)};
+    benchmarkLinearize(state, factor);
+}
+
+gtsam::PreintegratedCombinedMeasurements makePim() {
+    gtsam::PreintegratedCombinedMeasurements pim{
+      gtsam::PreintegratedCombinedMeasurements::Params::MakeSharedU(9.81),
+      gtsam::imuBias::ConstantBias{}};
+    for (int i = 0; i < 10; i++) {
+        pim.integrateMeasurement(
+          gtsam::Vector3{0.1, 0.0, 9.81}, gtsam::Vector3{0.0, 0.0, 0.2}, 0.01);
+    }
+    return pim;
+}
+
+void BM_PreintegratedImuFactor(benchmark::State &state) {
+    const PreintegratedImuFactor<PoseVelBias> factor{
+      S1, S2, B1, B2, makePim()};
+    benchmarkLinearize(state, factor);
+}
+
+const int kNbImuFactors = 10000;
+
+/** Add a chain of IMU factors to `graph`, using the state keys 2i and bias
+ * keys 2i + 1 */
+void addImuFactors(gtsam::NonlinearFactorGraph &graph) {
+    const auto pim =
+      boost::make_shared<const gtsam::PreintegratedCombinedMeasurements>(
+        makePim());
+    for (int i = 0; i < kNbImuFactors; i++) {
+        graph.emplace_shared<PreintegratedImuFactor<PoseVelBias>>(
+          2 * i, 2 * i + 2, 2 * i + 1, 2 * i + 3, pim);
+    }
+}
+
+void BM_ImuFactorGraphConstruction(benchmark::State &state) {
+    for (auto _ : state) {
+        gtsam::NonlinearFactorGraph graph;
+        addImuFactors(graph);
+        benchmark::DoNotOptimize(graph);
+    }
+    state.SetItemsProcessed(state.iterations() * kNbImuFactors);
+}
+
+void BM_ImuFactorGraphLinearize(benchmark::State &state) {
+    gtsam::NonlinearFactorGraph graph;
+    addImuFactors(graph);
+    gtsam::Values values;
+    for (int i = 0; i <= kNbImuFactors; i++) {
+        values.insert(2 * i, makeState(i));
+        values.insert(2 * i + 1, gtsam::imuBias::ConstantBias{});
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(graph.linearize(values));
+    }
+    state.SetItemsProcessed(state.iterations() * kNbImuFactors);
+}
+
+/** Time the Lie group operations of the state traits, with Jacobians */
+void BM_TraitsBetween(benchmark::State &state) {
+    using Traits = gtsam::traits<PoseVelBias>;
+    const auto m1 = makeState(1), m2 = makeState(2);
+    Eigen::Matrix<double, Traits::dimension, Traits::dimension> H1, H2;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Traits::Between(m1, m2, H1, H2));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_TraitsLogmapExpmap(benchmark::State &state) {
+    using Traits = gtsam::traits<PoseVelBias>;
+    const auto m = makeState(1);
+    Eigen::Matrix<double, Traits::dimension, Traits::dimension> H1, H2;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Traits::Expmap(Traits::Logmap(m, H1), H2));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_PosePrior);
+BENCHMARK(BM_TwistPrior);
+BENCHMARK(BM_BiasPrior);
+BENCHMARK(BM_GPSFactorWithBiasGeneral);
+BENCHMARK(BM_GPSFactorWBias);
+BENCHMARK(BM_HandEyeFactor);
+BENCHMARK(BM_MotionFactor);
+BENCHMARK(BM_PreintegratedImuFactor);
+BENCHMARK(BM_ImuFactorGraphConstruction)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ImuFactorGraphLinearize)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TraitsBetween);
+BENCHMARK(BM_TraitsLogmapExpmap);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
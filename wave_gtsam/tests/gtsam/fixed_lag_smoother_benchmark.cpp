@@ -0,0 +1,263 @@
+/** @file
+ * Update latency of FixedLagSmoother over a synthetic drive of several hours.
+ *
+ * Poses are added at 10 Hz, each with a GPS pose measurement, a GPS bias
+ * decaying towards zero, and odometry from the previous pose. Odometry is a
+ * BetweenFactor on the Pose3 variables used by GPSFactorWBias. The arguments
+ * are the length of the drive in hours and the lag in seconds; the mean,
+ * 99th percentile and maximum update times are reported, which should not
+ * grow with the length of the drive.
+ *
+ * BM_FixedLagSmootherLatency replays a shorter drive at a fixed rate, either
+ * calling `update()` or `queueUpdate()` with a worker thread. It reports how
+ * long each call blocks the caller, and the latency from each call until the
+ * estimate of the new pose is available.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "wave/gtsam/decaying_bias.hpp"
+#include "wave/gtsam/fixed_lag_smoother.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+
+namespace wave {
+
+const double kPoseRate = 10.0;
+const double kSpeed = 10.0;
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+/** Generates the measurements of the drive one pose at a time, so the whole
+ * drive is never held in memory */
+class SyntheticDrive {
+ public:
+    /** Factors, initial estimates and timestamps for the next pose */
+    void next(gtsam::NonlinearFactorGraph &factors,
+              gtsam::Values &values,
+              FixedLagSmoother::KeyTimestampMap &timestamps) {
+        factors = gtsam::NonlinearFactorGraph{};
+        values.clear();
+        timestamps.clear();
+
+        const auto i = this->index;
+        const double t = i / kPoseRate;
+        const gtsam::Key pose_key = gtsam::Symbol{'x', i};
+        const gtsam::Key bias_key = gtsam::Symbol{'z', i};
+
+        gtsam::Vector6 odometry_sigmas, gps_sigmas;
+        odometry_sigmas << 0.001, 0.001, 0.005, 0.02, 0.02, 0.02;
+        gps_sigmas << 0.02, 0.02, 0.02, 0.5, 0.5, 1.0;
+
+        if (i == 0) {
+            factors.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+              pose_key,
+              this->pose,
+              gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+            factors.emplace_shared<gtsam::PriorFactor<gtsam::Point3>>(
+              bias_key,
+              gtsam::Point3{0, 0, 0},
+              gtsam::noiseModel::Isotropic::Sigma(3, 1.0));
+        } else {
+            // Turn slowly, with an occasional tighter curve
+            const double yaw_rate = 0.02 + 0.1 * std::sin(0.01 * t);
+            const gtsam::Pose3 delta{
+              gtsam::Rot3::Yaw(yaw_rate / kPoseRate),
+              gtsam::Point3{kSpeed / kPoseRate, 0, 0}};
+            this->pose = this->pose.compose(delta);
+            this->estimate = this->estimate.compose(
+              delta.retract(this->noise(0.5, odometry_sigmas)));
+
+            factors.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+              gtsam::Symbol{'x', i - 1},
+              pose_key,
+              delta.retract(this->noise(1.0, odometry_sigmas)),
+              gtsam::noiseModel::Diagonal::Sigmas(odometry_sigmas));
+            factors.emplace_shared<DecayingBias>(
+              gtsam::Symbol{'z', i - 1},
+              bias_key,
+              1.0 / kPoseRate,
+              100.0,
+              gtsam::noiseModel::Isotropic::Sigma(3, 0.01));
+        }
+        factors.emplace_shared<GPSFactorWBias>(
+          pose_key,
+          bias_key,
+          this->pose.retract(this->noise(1.0, gps_sigmas)),
+          gtsam::noiseModel::Diagonal::Sigmas(gps_sigmas));
+
+        values.insert(pose_key, this->estimate);
+        values.insert(bias_key, gtsam::Point3{0, 0, 0});
+        timestamps.emplace(pose_key, at(t));
+        timestamps.emplace(bias_key, at(t));
+        this->index++;
+    }
+
+ private:
+    size_t index = 0;
+    gtsam::Pose3 pose, estimate;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> normal{0.0, 1.0};
+
+    gtsam::Vector6 noise(double scale, const gtsam::Vector6 &sigmas) {
+        gtsam::Vector6 v;
+        for (int j = 0; j < 6; j++) {
+            v(j) = scale * sigmas(j) * this->normal(this->generator);
+        }
+        return v;
+    }
+};
+
+void BM_FixedLagSmoother(benchmark::State &state) {
+    const size_t nb_poses = state.range(0) * 3600 * kPoseRate;
+    FixedLagSmootherParams params;
+    params.lag = static_cast<double>(state.range(1));
+
+    std::vector<double> durations;
+    size_t max_keys = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        durations.clear();
+        durations.reserve(nb_poses);
+        FixedLagSmoother smoother{params};
+        SyntheticDrive drive;
+        gtsam::NonlinearFactorGraph factors;
+        gtsam::Values values;
+        FixedLagSmoother::KeyTimestampMap timestamps;
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < nb_poses; i++) {
+            drive.next(factors, values, timestamps);
+            smoother.update(factors, values, timestamps);
+            durations.push_back(smoother.lastUpdateDuration());
+            max_keys = std::max(max_keys, smoother.numActiveKeys());
+        }
+    }
+
+    std::sort(durations.begin(), durations.end());
+    double total = 0.0;
+    for (const auto d : durations) {
+        total += d;
+    }
+    state.counters["poses"] = nb_poses;
+    state.counters["max_active_keys"] = max_keys;
+    state.counters["mean_update_ms"] = 1e3 * total / durations.size();
+    state.counters["p99_update_ms"] =
+      1e3 * durations[durations.size() * 99 / 100];
+    state.counters["max_update_ms"] = 1e3 * durations.back();
+}
+
+BENCHMARK(BM_FixedLagSmoother)
+  ->Args({1, 1})
+  ->Args({1, 5})
+  ->Args({3, 5})
+  ->Args({3, 10})
+  ->Unit(benchmark::kMillisecond)
+  ->Iterations(1);
+
+/** Mean, 99th percentile and maximum of `durations` in ms, as counters */
+void setDurationCounters(benchmark::State &state,
+                         const std::string &name,
+                         std::vector<double> &durations) {
+    std::sort(durations.begin(), durations.end());
+    double total = 0.0;
+    for (const auto d : durations) {
+        total += d;
+    }
+    state.counters["mean_" + name + "_ms"] = 1e3 * total / durations.size();
+    state.counters["p99_" + name + "_ms"] =
+      1e3 * durations[durations.size() * 99 / 100];
+    state.counters["max_" + name + "_ms"] = 1e3 * durations.back();
+}
+
+/** The arguments are 1 to queue updates for a worker thread (0 to call
+ * update()), and how many times faster than real time the drive is replayed */
+void BM_FixedLagSmootherLatency(benchmark::State &state) {
+    using Clock = std::chrono::steady_clock;
+    const size_t nb_poses = 2 * 60 * kPoseRate;
+    const bool queued = state.range(0) != 0;
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>{1.0 / (kPoseRate * state.range(1))});
+    FixedLagSmootherParams params;
+    params.worker_thread = queued;
+
+    std::vector<double> call_durations, latencies;
+    for (auto _ : state) {
+        call_durations.clear();
+        latencies.clear();
+        FixedLagSmoother smoother{params};
+        SyntheticDrive drive;
+        gtsam::NonlinearFactorGraph factors;
+        gtsam::Values values;
+        FixedLagSmoother::KeyTimestampMap timestamps;
+
+        // Times each pose was given to the smoother; poses before `done`
+        // have an estimate
+        std::vector<Clock::time_point> sent(nb_poses);
+        size_t done = 0;
+        const auto poll = [&]() {
+            gtsam::Pose3 pose;
+            while (done < sent.size() && sent[done] != Clock::time_point{} &&
+                   smoother.calculateEstimate(gtsam::Symbol{'x', done},
+                                              pose)) {
+                latencies.push_back(
+                  std::chrono::duration<double>(Clock::now() - sent[done])
+                    .count());
+                done++;
+            }
+        };
+
+        auto next_time = Clock::now();
+        for (size_t i = 0; i < nb_poses; i++) {
+            drive.next(factors, values, timestamps);
+            sent[i] = Clock::now();
+            if (queued) {
+                smoother.queueUpdate(factors, values, timestamps);
+            } else {
+                smoother.update(factors, values, timestamps);
+            }
+            call_durations.push_back(
+              std::chrono::duration<double>(Clock::now() - sent[i]).count());
+
+            // Wait for the next measurement, watching for new estimates
+            next_time += period;
+            do {
+                poll();
+                std::this_thread::sleep_for(std::chrono::microseconds{50});
+            } while (Clock::now() < next_time);
+        }
+        while (done < nb_poses) {
+            poll();
+            std::this_thread::yield();
+        }
+    }
+
+    state.counters["poses"] = nb_poses;
+    setDurationCounters(state, "call", call_durations);
+    setDurationCounters(state, "latency", latencies);
+}
+
+BENCHMARK(BM_FixedLagSmootherLatency)
+  ->Args({0, 10})
+  ->Args({1, 10})
+  ->Args({0, 50})
+  ->Args({1, 50})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime()
+  ->Iterations(1);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
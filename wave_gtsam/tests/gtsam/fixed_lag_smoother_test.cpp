@@ -0,0 +1,220 @@
+#include <random>
+
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+
+#include "wave/wave_test.hpp"
+#include "wave/gtsam/decaying_bias.hpp"
+#include "wave/gtsam/fixed_lag_smoother.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+
+namespace wave {
+
+namespace {
+
+// Drive around a circle, with GPS and odometry at every pose
+const double kStepTime = 0.1;
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+gtsam::Key poseKey(int i) {
+    return gtsam::Symbol{'x', static_cast<size_t>(i)};
+}
+
+gtsam::Key biasKey(int i) {
+    return gtsam::Symbol{'z', static_cast<size_t>(i)};
+}
+
+gtsam::Pose3 truePose(int i) {
+    const double yaw = 0.05 * i;
+    return gtsam::Pose3{
+      gtsam::Rot3::Yaw(yaw),
+      gtsam::Point3{10 * std::sin(yaw), 10 * (1 - std::cos(yaw)), 0}};
+}
+
+/** New factors and variables for the `i`th pose */
+struct Step {
+    gtsam::NonlinearFactorGraph factors;
+    gtsam::Values values;
+    FixedLagSmoother::KeyTimestampMap timestamps;
+};
+
+/** Measurements of each pose with noise of standard deviation `noise` times
+ * that of the noise models */
+class Drive {
+ public:
+    explicit Drive(double noise) : noise{noise} {}
+
+    Step step(int i) {
+        Step s;
+        const auto time = at(i * kStepTime);
+        s.timestamps.emplace(poseKey(i), time);
+        s.timestamps.emplace(biasKey(i), time);
+        s.values.insert(poseKey(i), truePose(i).retract(this->offset(0.1)));
+        s.values.insert(biasKey(i), gtsam::Point3{0, 0, 0});
+
+        gtsam::Vector6 gps_sigmas;
+        gps_sigmas << Vec3::Constant(0.05), Vec3::Constant(0.5);
+        s.factors.emplace_shared<GPSFactorWBias>(
+          poseKey(i),
+          biasKey(i),
+          truePose(i).retract(this->offset(1.0).cwiseProduct(gps_sigmas)),
+          gtsam::noiseModel::Diagonal::Sigmas(gps_sigmas));
+
+        if (i == 0) {
+            s.factors.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+              poseKey(0),
+              truePose(0),
+              gtsam::noiseModel::Isotropic::Sigma(6, 1e-3));
+            s.factors.emplace_shared<gtsam::PriorFactor<gtsam::Point3>>(
+              biasKey(0),
+              gtsam::Point3{0, 0, 0},
+              gtsam::noiseModel::Isotropic::Sigma(3, 1.0));
+        } else {
+            gtsam::Vector6 odometry_sigmas;
+            odometry_sigmas << Vec3::Constant(0.01), Vec3::Constant(0.05);
+            const auto odometry = truePose(i - 1).between(truePose(i));
+            s.factors.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+              poseKey(i - 1),
+              poseKey(i),
+              odometry.retract(
+                this->offset(1.0).cwiseProduct(odometry_sigmas)),
+              gtsam::noiseModel::Diagonal::Sigmas(odometry_sigmas));
+            s.factors.emplace_shared<DecayingBias>(
+              biasKey(i - 1),
+              biasKey(i),
+              kStepTime,
+              100.0,
+              gtsam::noiseModel::Isotropic::Sigma(3, 0.01));
+        }
+        return s;
+    }
+
+ private:
+    double noise;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> normal{0.0, 1.0};
+
+    gtsam::Vector6 offset(double sigma) {
+        gtsam::Vector6 v;
+        for (int j = 0; j < 6; j++) {
+            v(j) = this->noise * sigma * this->normal(this->generator);
+        }
+        return v;
+    }
+};
+
+double positionError(const gtsam::Pose3 &estimate, int i) {
+    return (estimate.translation() - truePose(i).translation()).norm();
+}
+
+}  // namespace
+
+TEST(FixedLagSmoother, matchesBatch) {
+    const int nb_poses = 100;
+    FixedLagSmootherParams params;
+    params.lag = 2.0;
+    FixedLagSmoother smoother{params};
+
+    Drive drive{1.0};
+    gtsam::NonlinearFactorGraph all_factors;
+    gtsam::Values all_values;
+    for (int i = 0; i < nb_poses; i++) {
+        const auto step = drive.step(i);
+        ASSERT_EQ(0,
+                  smoother.update(step.factors, step.values, step.timestamps));
+        EXPECT_GT(smoother.lastUpdateDuration(), 0.0);
+        all_factors.push_back(step.factors);
+        all_values.insert(step.values);
+    }
+
+    // The newest pose is the same as in a batch solution, up to the error
+    // of linearizing the marginals
+    gtsam::Pose3 estimate;
+    ASSERT_TRUE(smoother.calculateEstimate(poseKey(nb_poses - 1), estimate));
+    gtsam::LevenbergMarquardtOptimizer optimizer{all_factors, all_values};
+    const auto batch = optimizer.optimize().at<gtsam::Pose3>(
+      poseKey(nb_poses - 1));
+    EXPECT_LT((estimate.translation() - batch.translation()).norm(), 0.01);
+    EXPECT_LT(positionError(estimate, nb_poses - 1), 0.5);
+
+    // Old poses have been marginalized
+    EXPECT_FALSE(smoother.calculateEstimate(poseKey(0), estimate));
+}
+
+TEST(FixedLagSmoother, boundsWindow) {
+    FixedLagSmootherParams params;
+    params.lag = 1.0;
+    FixedLagSmoother smoother{params};
+
+    // Each pose adds two variables and at most four factors
+    const size_t window = params.lag / kStepTime + 2;
+    Drive drive{1.0};
+    for (int i = 0; i < 100; i++) {
+        const auto step = drive.step(i);
+        ASSERT_EQ(0,
+                  smoother.update(step.factors, step.values, step.timestamps));
+        EXPECT_LE(smoother.numActiveKeys(), 2 * window);
+        EXPECT_LE(smoother.numFactors(), 4 * window);
+    }
+}
+
+TEST(FixedLagSmoother, workerThread) {
+    const int nb_poses = 100;
+    FixedLagSmootherParams params;
+    params.lag = 2.0;
+    params.worker_thread = true;
+    FixedLagSmoother smoother{params};
+
+    Drive drive{0.0};
+    for (int i = 0; i < nb_poses; i++) {
+        const auto step = drive.step(i);
+        smoother.queueUpdate(step.factors, step.values, step.timestamps);
+    }
+    smoother.waitUntilIdle();
+
+    gtsam::Pose3 estimate;
+    ASSERT_TRUE(smoother.calculateEstimate(poseKey(nb_poses - 1), estimate));
+    EXPECT_LT(positionError(estimate, nb_poses - 1), 1e-3);
+}
+
+TEST(FixedLagSmoother, invalidInputs) {
+    FixedLagSmootherParams params;
+    params.lag = 1.0;
+    FixedLagSmoother smoother{params};
+    Drive drive{0.0};
+
+    // No timestamp
+    auto step = drive.step(0);
+    auto no_time = step;
+    no_time.timestamps.erase(biasKey(0));
+    EXPECT_EQ(
+      -1, smoother.update(no_time.factors, no_time.values, no_time.timestamps));
+    EXPECT_EQ(0u, smoother.numActiveKeys());
+
+    // Already added
+    ASSERT_EQ(0, smoother.update(step.factors, step.values, step.timestamps));
+    EXPECT_EQ(-1, smoother.update(step.factors, step.values, step.timestamps));
+
+    // Unknown variable
+    step = drive.step(2);
+    EXPECT_EQ(-1, smoother.update(step.factors, step.values, step.timestamps));
+
+    // Marginalized variable
+    for (int i = 1; i < 20; i++) {
+        step = drive.step(i);
+        ASSERT_EQ(0,
+                  smoother.update(step.factors, step.values, step.timestamps));
+    }
+    gtsam::NonlinearFactorGraph old;
+    old.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+      poseKey(0), truePose(0), gtsam::noiseModel::Isotropic::Sigma(6, 1.0));
+    EXPECT_EQ(-1, smoother.update(old, gtsam::Values{}, {}));
+}
+
+}  // namespace wave
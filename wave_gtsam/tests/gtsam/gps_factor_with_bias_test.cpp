@@ -101,4 +101,43 @@ TEST(gps_with_bias, jacobians) {
     EXPECT_NEAR((J_B_Z - J_BZnum).norm(), 0, 1e-8);
 }
 
+// Test the closed-form jacobians away from the solution, with a bias
+TEST(gps_with_bias, jacobians_nonzero_error) {
+    gtsam::Vector6 v1, v2;
+    v1 << 0.3, -0.2, 1.1, 32.0, 2.0, 3.0;
+    v2 << -0.4, 0.1, 0.9, 30.0, 4.0, 1.0;
+    const auto T_meas = gtsam::Pose3::Expmap(v1);
+    const auto T_loc_1 = gtsam::Pose3::Expmap(v2);
+    const gtsam::Point3 B_Z{0.5, -1.0, 2.0};
+
+    auto model = gtsam::noiseModel::Isotropic::Sigma(6, 1.0);
+    GPSFactorWBias factor(3, 4, T_meas, model);
+
+    gtsam::Matrix J_loc1, J_B_Z;
+    auto err = factor.evaluateError(T_loc_1, B_Z, J_loc1, J_B_Z);
+    EXPECT_GT(err.norm(), 1.0);
+    EXPECT_PRED2(VectorsNear, err, factor.evaluateError(T_loc_1, B_Z));
+
+    auto fun = boost::bind(&GPSFactorWBias::evaluateError,
+                           boost::ref(factor),
+                           _1,
+                           _2,
+                           boost::none,
+                           boost::none);
+    gtsam::Matrix J_loc1num =
+      gtsam::numericalDerivative21<gtsam::Vector, gtsam::Pose3, gtsam::Point3>(
+        fun, T_loc_1, B_Z, 1e-6);
+    gtsam::Matrix J_BZnum =
+      gtsam::numericalDerivative22<gtsam::Vector, gtsam::Pose3, gtsam::Point3>(
+        fun, T_loc_1, B_Z, 1e-6);
+
+    EXPECT_PRED3(MatricesNearPrec, J_loc1, J_loc1num, 1e-6);
+    EXPECT_PRED3(MatricesNearPrec, J_B_Z, J_BZnum, 1e-6);
+
+    // The bias Jacobian is the same when computed alone
+    gtsam::Matrix J_alone;
+    factor.evaluateError(T_loc_1, B_Z, boost::none, J_alone);
+    EXPECT_PRED2(MatricesNear, J_B_Z, J_alone);
+}
+
 }  // namespace wave
@@ -134,4 +134,62 @@ TEST(hand_eye, jacobians) {
     EXPECT_NEAR((J_B_Z - J_BZnum).norm(), 0, 1e-8);
 }
 
+// Test the closed-form jacobians away from the solution, with a bias
+TEST(hand_eye, jacobians_nonzero_error) {
+    gtsam::Vector6 v1, v2, v3;
+    v1 << 0.3, -0.2, 1.1, 32.0, 2.0, 3.0;
+    v2 << -0.1, 0.4, 0.2, 0.2, 0.3, -0.1;
+    v3 << 0.5, 0.1, -0.7, 30.0, 4.0, 1.0;
+    const auto T_loc_1 = gtsam::Pose3::Expmap(v1);
+    const auto T_s1s2 = gtsam::Pose3::Expmap(v2);
+    const auto T_loc_2 = gtsam::Pose3::Expmap(v3);
+    const gtsam::Point3 B_Z{0.5, -1.0, 2.0};
+
+    auto model = gtsam::noiseModel::Isotropic::Sigma(6, 1.0);
+    HandEyeFactor factor(3, 2, 4, T_loc_1, model);
+
+    gtsam::Matrix J_loc2, J_s1s2, J_B_Z;
+    auto err =
+      factor.evaluateError(T_loc_2, T_s1s2, B_Z, J_loc2, J_s1s2, J_B_Z);
+    EXPECT_GT(err.norm(), 1.0);
+    EXPECT_PRED2(
+      VectorsNear, err, factor.evaluateError(T_loc_2, T_s1s2, B_Z));
+
+    auto fun = boost::bind(&HandEyeFactor::evaluateError,
+                           boost::ref(factor),
+                           _1,
+                           _2,
+                           _3,
+                           boost::none,
+                           boost::none,
+                           boost::none);
+    gtsam::Matrix J_loc2num = gtsam::numericalDerivative31<gtsam::Vector,
+                                                           gtsam::Pose3,
+                                                           gtsam::Pose3,
+                                                           gtsam::Point3>(
+      fun, T_loc_2, T_s1s2, B_Z, 1e-6);
+    gtsam::Matrix J_s1s2num = gtsam::numericalDerivative32<gtsam::Vector,
+                                                           gtsam::Pose3,
+                                                           gtsam::Pose3,
+                                                           gtsam::Point3>(
+      fun, T_loc_2, T_s1s2, B_Z, 1e-6);
+    gtsam::Matrix J_BZnum = gtsam::numericalDerivative33<gtsam::Vector,
+                                                         gtsam::Pose3,
+                                                         gtsam::Pose3,
+                                                         gtsam::Point3>(
+      fun, T_loc_2, T_s1s2, B_Z, 1e-6);
+
+    EXPECT_PRED3(MatricesNearPrec, J_loc2, J_loc2num, 1e-6);
+    EXPECT_PRED3(MatricesNearPrec, J_s1s2, J_s1s2num, 1e-6);
+    EXPECT_PRED3(MatricesNearPrec, J_B_Z, J_BZnum, 1e-6);
+
+    // Each Jacobian is the same when computed alone
+    gtsam::Matrix J_alone;
+    factor.evaluateError(
+      T_loc_2, T_s1s2, B_Z, boost::none, boost::none, J_alone);
+    EXPECT_PRED2(MatricesNear, J_B_Z, J_alone);
+    factor.evaluateError(T_loc_2, T_s1s2, B_Z, boost::none, J_alone);
+    EXPECT_PRED2(MatricesNear, J_s1s2, J_alone);
+}
+
 }  // namespace wave
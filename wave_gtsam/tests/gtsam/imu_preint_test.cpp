@@ -182,5 +182,58 @@ TEST(WaveImuFactor, WaveErrorAndJacobians) {
     double diffDelta = 1e-7;
     EXPECT_TRUE(gtsam::internal::testFactorJacobians(
       "ImuFactor", factor, values, diffDelta, 1e-3));
+
+    // Each Jacobian is the same when computed alone
+    Matrix H1, H2, H3, H4;
+    factor.evaluateError(s1, s2, bias, bias2, H1, H2, H3, H4);
+    Matrix H1_only, H2_only, H3_only;
+    factor.evaluateError(s1, s2, bias, bias2, H1_only);
+    factor.evaluateError(s1, s2, bias, bias2, boost::none, H2_only);
+    factor.evaluateError(
+      s1, s2, bias, bias2, boost::none, boost::none, H3_only);
+    EXPECT_TRUE(assert_equal(H1, H1_only));
+    EXPECT_TRUE(assert_equal(H2, H2_only));
+    EXPECT_TRUE(assert_equal(H3, H3_only));
+}
+
+TEST(WaveImuFactor, noiseModel) {
+    using namespace common;
+    PreintegratedCombinedMeasurements combined_pim(common::Params(),
+                                                   kZeroBiasHat);
+    combined_pim.integrateMeasurement(measuredAcc, measuredOmega, deltaT);
+
+    const auto model = boost::dynamic_pointer_cast<noiseModel::Gaussian>(
+      makeImuNoiseModel(combined_pim));
+    ASSERT_TRUE(model);
+
+    // R is upper triangular, and gives the inverse of the covariance
+    const Matrix R = model->R();
+    EXPECT_TRUE(
+      R.triangularView<Eigen::StrictlyLower>().toDenseMatrix().isZero());
+    const Matrix expected = combined_pim.preintMeasCov().inverse();
+    EXPECT_LE((expected - model->information()).norm(),
+              1e-9 * expected.norm());
+}
+
+TEST(WaveImuFactor, sharedMeasurements) {
+    using namespace common;
+    PreintegratedCombinedMeasurements combined_pim(common::Params(),
+                                                   kZeroBiasHat);
+    combined_pim.integrateMeasurement(measuredAcc, measuredOmega, deltaT);
+    const auto shared =
+      boost::make_shared<const PreintegratedCombinedMeasurements>(
+        combined_pim);
+
+    // Factors, and copies of them, use the measurements without copying
+    const PreintegratedImuFactor<wave::PoseVelBias> factor{
+      S(1), S(2), B(1), B(2), shared};
+    const auto copy = factor;
+    EXPECT_EQ(shared.get(), &factor.preintegrated());
+    EXPECT_EQ(shared.get(), &copy.preintegrated());
+
+    // They are the same as a factor made from a copy
+    const PreintegratedImuFactor<wave::PoseVelBias> copied{
+      S(1), S(2), B(1), B(2), combined_pim};
+    EXPECT_TRUE(factor.equals(copied));
 }
 }  // namespace wave
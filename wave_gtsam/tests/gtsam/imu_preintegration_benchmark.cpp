@@ -0,0 +1,103 @@
+/** @file
+ * Throughput of IMU preintegration from a MeasurementContainer, in samples
+ * per second, for a 1 kHz IMU over logs of several minutes.
+ *
+ * Keyframes are 0.1 s apart. The serial benchmark preintegrates each interval
+ * in turn, as an incremental estimator would; the batch benchmark does all of
+ * them at once with the number of threads given by the second argument.
+ */
+
+#include <cmath>
+#include <map>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/gtsam/imu_preintegration.hpp"
+
+namespace wave {
+
+const double kImuRate = 1000.0;
+const double kKeyframeRate = 10.0;
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+/** A log of IMU samples and keyframe times */
+struct ImuLog {
+    MeasurementContainer<ImuMeasurement> imu;
+    std::vector<TimePoint> keyframes;
+};
+
+/** Make a log of `minutes` minutes of driving in a slowly varying circle */
+ImuLog makeLog(int minutes) {
+    ImuLog log;
+    const double duration = 60.0 * minutes;
+    for (int i = 0; i <= duration * kImuRate; i++) {
+        const double t = i / kImuRate;
+        Vec6 value;
+        value << 0.01 * std::sin(t), 0.01 * std::cos(t), 0.2,
+          0.1 * std::sin(0.5 * t), 2.0, 9.81;
+        log.imu.emplace(at(t), 0, value);
+    }
+    for (int i = 0; i <= duration * kKeyframeRate; i++) {
+        log.keyframes.push_back(at(i / kKeyframeRate));
+    }
+    return log;
+}
+
+/** Logs are shared between benchmarks with the same length */
+const ImuLog &getLog(int minutes) {
+    static std::map<int, ImuLog> logs;
+    auto it = logs.find(minutes);
+    if (it == logs.end()) {
+        it = logs.emplace(minutes, makeLog(minutes)).first;
+    }
+    return it->second;
+}
+
+void BM_PreintegrateSerial(benchmark::State &state) {
+    const auto &log = getLog(state.range(0));
+    const ImuPreintegrationParams params;
+    for (auto _ : state) {
+        for (size_t i = 0; i + 1 < log.keyframes.size(); i++) {
+            gtsam::PreintegratedCombinedMeasurements pim{params.imu_params};
+            preintegrateImu(log.imu,
+                            params.sensor_id,
+                            log.keyframes[i],
+                            log.keyframes[i + 1],
+                            pim);
+            benchmark::DoNotOptimize(pim);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * log.imu.size());
+}
+
+void BM_PreintegrateBatch(benchmark::State &state) {
+    const auto &log = getLog(state.range(0));
+    ImuPreintegrationParams params;
+    params.num_threads = state.range(1);
+    std::vector<gtsam::PreintegratedCombinedMeasurements> pims;
+    for (auto _ : state) {
+        preintegrateImuBatch(log.imu, log.keyframes, {}, params, pims);
+        benchmark::DoNotOptimize(pims);
+    }
+    state.SetItemsProcessed(state.iterations() * log.imu.size());
+}
+
+BENCHMARK(BM_PreintegrateSerial)
+  ->Arg(1)
+  ->Arg(10)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PreintegrateBatch)
+  ->Args({1, 1})
+  ->Args({1, 4})
+  ->Args({10, 1})
+  ->Args({10, 4})
+  ->Args({10, 8})
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
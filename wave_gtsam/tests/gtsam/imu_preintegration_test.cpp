@@ -0,0 +1,116 @@
+#include "wave/wave_test.hpp"
+#include "wave/gtsam/imu_preintegration.hpp"
+
+namespace wave {
+
+namespace {
+
+const double kImuRate = 100.0;
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+/** IMU samples for `duration` seconds, with yaw rate `t * yaw_accel` and
+ * constant specific force `force` */
+MeasurementContainer<ImuMeasurement> makeImu(double duration,
+                                             double yaw_accel,
+                                             const Vec3 &force) {
+    MeasurementContainer<ImuMeasurement> imu;
+    for (int i = 0; i <= duration * kImuRate; i++) {
+        const double t = i / kImuRate;
+        Vec6 value;
+        value << 0, 0, yaw_accel * t, force;
+        imu.emplace(at(t), 0, value);
+
+        // Another sensor between the samples, which must be ignored
+        imu.emplace(at(t + 0.3 / kImuRate), 1, Vec6::Constant(100.0));
+    }
+    return imu;
+}
+
+gtsam::PreintegratedCombinedMeasurements makePim() {
+    return gtsam::PreintegratedCombinedMeasurements{
+      gtsam::PreintegratedCombinedMeasurements::Params::MakeSharedU(9.81)};
+}
+
+}  // namespace
+
+TEST(preintegrateImu, interpolatesBoundaries) {
+    // With a linear yaw rate, the integrated yaw is exact even though the
+    // window does not start or end on a sample
+    const auto imu = makeImu(1.0, 1.0, Vec3::Zero());
+    const double start = 0.105, end = 0.495;
+
+    auto pim = makePim();
+    Vec6 end_measurement;
+    ASSERT_EQ(
+      0, preintegrateImu(imu, 0, at(start), at(end), pim, &end_measurement));
+    EXPECT_NEAR(end - start, pim.deltaTij(), 1e-9);
+    EXPECT_NEAR((end * end - start * start) / 2, pim.deltaRij().ypr()(0), 1e-9);
+    EXPECT_NEAR(end, end_measurement(2), 1e-9);
+}
+
+TEST(preintegrateImu, constantForce) {
+    const Vec3 force{1.0, -2.0, 0.5};
+    const auto imu = makeImu(1.0, 0.0, force);
+
+    auto pim = makePim();
+    ASSERT_EQ(0, preintegrateImu(imu, 0, at(0.2), at(0.7), pim));
+    EXPECT_PRED3(VectorsNearPrec, Vec3{0.5 * force}, pim.deltaVij(), 1e-9);
+    EXPECT_PRED3(VectorsNearPrec, Vec3{0.125 * force}, pim.deltaPij(), 1e-9);
+}
+
+TEST(preintegrateImu, holdsOutsideSamples) {
+    const auto imu = makeImu(1.0, 1.0, Vec3::Zero());
+
+    // The last sample, with yaw rate 1, is held past the end of the data
+    auto pim = makePim();
+    Vec6 end_measurement;
+    ASSERT_EQ(
+      0, preintegrateImu(imu, 0, at(0.9), at(1.5), pim, &end_measurement));
+    EXPECT_NEAR(0.6, pim.deltaTij(), 1e-9);
+    EXPECT_NEAR((1.0 - 0.81) / 2 + 0.5, pim.deltaRij().ypr()(0), 1e-9);
+    EXPECT_NEAR(1.0, end_measurement(2), 1e-9);
+}
+
+TEST(preintegrateImu, invalidInputs) {
+    const auto imu = makeImu(1.0, 1.0, Vec3::Zero());
+    auto pim = makePim();
+
+    EXPECT_EQ(-1, preintegrateImu(imu, 0, at(0.5), at(0.5), pim));
+    EXPECT_EQ(-1, preintegrateImu(imu, 0, at(0.5), at(0.2), pim));
+    EXPECT_EQ(-1, preintegrateImu(imu, 2, at(0.2), at(0.5), pim));
+    EXPECT_EQ(
+      -1,
+      preintegrateImu(
+        MeasurementContainer<ImuMeasurement>{}, 0, at(0.2), at(0.5), pim));
+    EXPECT_EQ(0.0, pim.deltaTij());
+}
+
+TEST(preintegrateImuBatch, matchesSerial) {
+    const auto imu = makeImu(10.0, 0.1, Vec3{0.1, 0.2, 9.81});
+    std::vector<TimePoint> keyframes;
+    for (int i = 0; i <= 37; i++) {
+        keyframes.push_back(at(0.25 * i + 0.013));
+    }
+
+    ImuPreintegrationParams params;
+    params.num_threads = 4;
+    std::vector<gtsam::PreintegratedCombinedMeasurements> pims;
+    ASSERT_EQ(0, preintegrateImuBatch(imu, keyframes, {}, params, pims));
+    ASSERT_EQ(keyframes.size() - 1, pims.size());
+
+    for (size_t i = 0; i < pims.size(); i++) {
+        auto pim = makePim();
+        ASSERT_EQ(0,
+                  preintegrateImu(imu, 0, keyframes[i], keyframes[i + 1], pim));
+        EXPECT_TRUE(pim.equals(pims[i], 1e-12));
+    }
+
+    EXPECT_EQ(
+      -1, preintegrateImuBatch(imu, {keyframes.front()}, {}, params, pims));
+}
+
+}  // namespace wave
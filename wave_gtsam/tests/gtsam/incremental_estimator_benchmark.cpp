@@ -0,0 +1,198 @@
+/** @file
+ * Incremental estimation benchmark on the KITTI example data.
+ *
+ * The ground truth of the drive is used to synthesize IMU measurements, and
+ * noisy GPS poses at every state. Each update of IncrementalEstimator is
+ * timed, with and without a fixed lag, and compared to solving the same
+ * factors once with Levenberg-Marquardt.
+ */
+
+#include <algorithm>
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+
+#include "wave/vision/dataset/VoDataset.hpp"
+#include "wave/gtsam/incremental_estimator.hpp"
+
+namespace wave {
+
+const auto DATASET_DIR = "tests/data/vo_data_drive_0036";
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+/** Measurements synthesized from the ground truth of a dataset */
+struct KittiMeasurements {
+    std::vector<TimePoint> times;
+    std::vector<gtsam::Pose3> poses;
+    IncrementalEstimator::ImuContainer imu;
+    IncrementalEstimator::PoseContainer gps;
+};
+
+KittiMeasurements makeMeasurements() {
+    const auto dataset = VoDataset::loadFromDirectory(DATASET_DIR);
+    KittiMeasurements m;
+    for (const auto &state : dataset.states) {
+        m.times.push_back(at(state.time));
+        m.poses.emplace_back(gtsam::Rot3{state.robot_q_GB},
+                             gtsam::Point3{state.robot_G_p_GB});
+    }
+
+    // Body-frame angular velocity and specific force, by finite differences
+    const gtsam::Vector3 gravity{0, 0, -9.81};
+    const auto n = dataset.states.size();
+    for (size_t i = 1; i + 1 < n; i++) {
+        const double dt = dataset.states[i + 1].time - dataset.states[i].time;
+        const double dt_prev =
+          dataset.states[i].time - dataset.states[i - 1].time;
+        const auto &R = m.poses[i].rotation();
+        const gtsam::Vector3 omega =
+          gtsam::Rot3::Logmap(R.between(m.poses[i + 1].rotation())) / dt;
+        const gtsam::Vector3 v_next =
+          (m.poses[i + 1].translation() - m.poses[i].translation()) / dt;
+        const gtsam::Vector3 v_prev =
+          (m.poses[i].translation() - m.poses[i - 1].translation()) / dt_prev;
+        const gtsam::Vector3 accel = 2 * (v_next - v_prev) / (dt + dt_prev);
+
+        Vec6 value;
+        value << omega, R.unrotate(accel - gravity);
+        m.imu.emplace(m.times[i], 0, value);
+        if (i == 1) {
+            m.imu.emplace(m.times[0], 0, value);
+        }
+    }
+
+    // GPS with 0.5 m and about 1 degree of noise
+    std::mt19937 generator{42};
+    std::normal_distribution<double> noise{0.0, 1.0};
+    for (size_t i = 0; i < n; i++) {
+        gtsam::Vector6 offset;
+        offset << 0.02 * noise(generator), 0.02 * noise(generator),
+          0.02 * noise(generator), 0.5 * noise(generator),
+          0.5 * noise(generator), 0.5 * noise(generator);
+        m.gps.emplace(m.times[i], 0, m.poses[i].expmap(offset));
+    }
+    return m;
+}
+
+const KittiMeasurements &measurements() {
+    static const KittiMeasurements m = makeMeasurements();
+    return m;
+}
+
+/** Initial state from the ground truth, with the velocity in the local frame
+ */
+PoseVelBias initialState(const KittiMeasurements &m) {
+    PoseVelBias state;
+    state.pose = m.poses[0];
+    const double dt =
+      std::chrono::duration<double>(m.times[1] - m.times[0]).count();
+    state.vel.tail<3>() =
+      (m.poses[1].translation() - m.poses[0].translation()) / dt;
+    return state;
+}
+
+/** Add every state of the drive to an estimator, timing each update */
+void runEstimator(const KittiMeasurements &m,
+                  IncrementalEstimator &estimator,
+                  std::vector<double> &durations) {
+    estimator.initialize(m.times[0], initialState(m));
+    // The last state has no IMU measurement after it
+    for (size_t i = 1; i + 1 < m.times.size(); i++) {
+        estimator.update(m.times[i], m.imu, m.gps);
+        durations.push_back(estimator.lastUpdateDuration());
+    }
+}
+
+/** Mean position error of the estimated states against the ground truth */
+double meanPositionError(const KittiMeasurements &m,
+                         const IncrementalEstimator &estimator) {
+    double error = 0.0;
+    PoseVelBias state;
+    for (size_t i = 0; i < estimator.numStates(); i++) {
+        estimator.getState(i, state);
+        error +=
+          (state.pose.translation() - m.poses[i].translation()).norm();
+    }
+    return error / estimator.numStates();
+}
+
+/** Time incremental estimation of the whole drive, with the lag in seconds
+ * given by the benchmark argument (0 for plain iSAM2) */
+void BM_IncrementalEstimator(benchmark::State &state) {
+    const auto &m = measurements();
+    IncrementalEstimatorParams params;
+    params.lag = static_cast<double>(state.range(0));
+
+    std::vector<double> durations;
+    double error = 0.0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        durations.clear();
+        IncrementalEstimator estimator{params};
+        state.ResumeTiming();
+
+        runEstimator(m, estimator, durations);
+
+        state.PauseTiming();
+        error = meanPositionError(m, estimator);
+        state.ResumeTiming();
+    }
+
+    std::sort(durations.begin(), durations.end());
+    double total = 0.0;
+    for (const auto d : durations) {
+        total += d;
+    }
+    state.counters["states"] = m.times.size();
+    state.counters["mean_update_ms"] = 1e3 * total / durations.size();
+    state.counters["p99_update_ms"] =
+      1e3 * durations[durations.size() * 99 / 100];
+    state.counters["max_update_ms"] = 1e3 * durations.back();
+    state.counters["position_error"] = error;
+}
+
+/** Time one Levenberg-Marquardt solve of the same factors, from the same
+ * initial estimates */
+void BM_BatchLM(benchmark::State &state) {
+    const auto &m = measurements();
+    IncrementalEstimatorParams params;
+    params.keep_history = true;
+    IncrementalEstimator estimator{params};
+    std::vector<double> durations;
+    runEstimator(m, estimator, durations);
+
+    const auto &graph = estimator.getHistoryGraph();
+    const auto &values = estimator.getHistoryValues();
+    gtsam::Values result;
+    for (auto _ : state) {
+        gtsam::LevenbergMarquardtOptimizer optimizer{graph, values};
+        result = optimizer.optimize();
+    }
+
+    double error = 0.0;
+    for (size_t i = 0; i < estimator.numStates(); i++) {
+        const auto estimate =
+          result.at<PoseVelBias>(IncrementalEstimator::stateKey(i));
+        error +=
+          (estimate.pose.translation() - m.poses[i].translation()).norm();
+    }
+    state.counters["states"] = m.times.size();
+    state.counters["position_error"] = error / estimator.numStates();
+}
+
+BENCHMARK(BM_IncrementalEstimator)
+  ->Arg(0)
+  ->Arg(1)
+  ->Arg(5)
+  ->Unit(benchmark::kMillisecond)
+  ->Iterations(1);
+BENCHMARK(BM_BatchLM)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
@@ -0,0 +1,190 @@
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+
+#include "wave/wave_test.hpp"
+#include "wave/gtsam/incremental_estimator.hpp"
+
+namespace wave {
+
+namespace {
+
+// Drive around a circle at constant speed, facing forwards, on a level plane
+const double kRadius = 10.0;
+const double kYawRate = 0.2;
+const double kImuRate = 100.0;
+const double kStateRate = 10.0;
+
+TimePoint at(double seconds) {
+    return TimePoint{std::chrono::duration_cast<TimePoint::duration>(
+      std::chrono::duration<double>{seconds})};
+}
+
+gtsam::Pose3 truePose(double t) {
+    const double yaw = kYawRate * t;
+    return gtsam::Pose3{
+      gtsam::Rot3::Yaw(yaw),
+      gtsam::Point3{kRadius * std::sin(yaw), kRadius * (1 - std::cos(yaw)), 0}};
+}
+
+/** True state, with the velocity in the local frame, as used with the IMU */
+PoseVelBias trueState(double t) {
+    PoseVelBias state;
+    state.pose = truePose(t);
+    const double yaw = kYawRate * t;
+    state.vel << 0, 0, kYawRate,
+      kRadius * kYawRate * Vec3{std::cos(yaw), std::sin(yaw), 0};
+    return state;
+}
+
+/** IMU measurements of the circle: constant in the body frame */
+IncrementalEstimator::ImuContainer makeImu(double duration) {
+    IncrementalEstimator::ImuContainer imu;
+    Vec6 value;
+    value << 0, 0, kYawRate, 0, kRadius * kYawRate * kYawRate, 9.81;
+    for (int i = 0; i <= duration * kImuRate; i++) {
+        imu.emplace(at(i / kImuRate), 0, value);
+    }
+    return imu;
+}
+
+/** Exact pose measurements at every state */
+IncrementalEstimator::PoseContainer makeGps(double duration) {
+    IncrementalEstimator::PoseContainer gps;
+    for (int i = 0; i <= duration * kStateRate; i++) {
+        gps.emplace(at(i / kStateRate), 0, truePose(i / kStateRate));
+    }
+    return gps;
+}
+
+double positionError(const PoseVelBias &state, double t) {
+    return (state.pose.translation() - truePose(t).translation()).norm();
+}
+
+}  // namespace
+
+TEST(IncrementalEstimator, invalidInputs) {
+    IncrementalEstimator estimator;
+    const auto imu = makeImu(1.0);
+    const auto gps = makeGps(1.0);
+    PoseVelBias state;
+
+    EXPECT_EQ(-1, estimator.update(at(0.1), imu, gps));
+    EXPECT_FALSE(estimator.getState(0, state));
+
+    ASSERT_EQ(0, estimator.initialize(at(0.0), trueState(0.0)));
+    EXPECT_EQ(-1, estimator.initialize(at(0.0), trueState(0.0)));
+    EXPECT_EQ(-1, estimator.update(at(0.0), imu, gps));
+
+    // No IMU measurements
+    const IncrementalEstimator::ImuContainer no_imu;
+    EXPECT_EQ(-1, estimator.update(at(0.1), no_imu, gps));
+
+    // Only measurements up to the previous state, or from another sensor
+    IncrementalEstimator::ImuContainer stale_imu;
+    stale_imu.emplace(at(0.0), 0, imu.begin()->value);
+    stale_imu.emplace(at(0.05), 1, imu.begin()->value);
+    EXPECT_EQ(-1, estimator.update(at(0.1), stale_imu, gps));
+    EXPECT_EQ(1u, estimator.numStates());
+
+    // A single new measurement is enough
+    stale_imu.emplace(at(0.05), 0, imu.begin()->value);
+    EXPECT_EQ(0, estimator.update(at(0.1), stale_imu, gps));
+    EXPECT_EQ(2u, estimator.numStates());
+    EXPECT_TRUE(estimator.getState(0, state));
+}
+
+TEST(IncrementalEstimator, imuAndGps) {
+    const double duration = 5.0;
+    const auto imu = makeImu(duration);
+    const auto gps = makeGps(duration);
+
+    IncrementalEstimatorParams params;
+    params.keep_history = true;
+    IncrementalEstimator estimator{params};
+
+    // Start from a wrong velocity
+    auto initial = trueState(0.0);
+    initial.vel.tail<3>() += Vec3{0.2, -0.2, 0.0};
+    ASSERT_EQ(0, estimator.initialize(at(0.0), initial));
+
+    const int nb_states = static_cast<int>(duration * kStateRate);
+    for (int i = 1; i <= nb_states; i++) {
+        ASSERT_EQ(0, estimator.update(at(i / kStateRate), imu, gps));
+        EXPECT_GT(estimator.lastUpdateDuration(), 0.0);
+    }
+    EXPECT_EQ(nb_states + 1u, estimator.numStates());
+    EXPECT_EQ(nb_states + 1u, estimator.numActiveStates());
+
+    PoseVelBias state;
+    gtsam::imuBias::ConstantBias imu_bias;
+    ASSERT_TRUE(estimator.getState(nb_states, state, &imu_bias));
+    EXPECT_LT(positionError(state, duration), 0.05);
+    EXPECT_LT(
+      (state.vel.tail<3>() - trueState(duration).vel.tail<3>()).norm(), 0.05);
+    EXPECT_LT(imu_bias.vector().norm(), 0.05);
+
+    // The same problem solved in batch gives the same answer
+    const auto &graph = estimator.getHistoryGraph();
+    const auto &values = estimator.getHistoryValues();
+    EXPECT_EQ(nb_states + 1u, values.size() / 2);
+    gtsam::LevenbergMarquardtOptimizer optimizer{graph, values};
+    const auto result = optimizer.optimize();
+    const auto batch =
+      result.at<PoseVelBias>(IncrementalEstimator::stateKey(nb_states));
+    EXPECT_LT((batch.pose.translation() - state.pose.translation()).norm(),
+              0.01);
+}
+
+TEST(IncrementalEstimator, fixedLag) {
+    const double duration = 5.0;
+    const auto imu = makeImu(duration);
+    const auto gps = makeGps(duration);
+
+    IncrementalEstimatorParams params;
+    params.lag = 1.0;
+    IncrementalEstimator estimator{params};
+    ASSERT_EQ(0, estimator.initialize(at(0.0), trueState(0.0)));
+
+    const int nb_states = static_cast<int>(duration * kStateRate);
+    for (int i = 1; i <= nb_states; i++) {
+        ASSERT_EQ(0, estimator.update(at(i / kStateRate), imu, gps));
+        EXPECT_LE(estimator.numActiveStates(), params.lag * kStateRate + 1);
+    }
+    EXPECT_EQ(nb_states + 1u, estimator.numStates());
+
+    // Marginalized states keep their last estimate
+    PoseVelBias state;
+    ASSERT_TRUE(estimator.getState(0, state));
+    EXPECT_LT(positionError(state, 0.0), 0.05);
+    ASSERT_TRUE(estimator.getState(nb_states, state));
+    EXPECT_LT(positionError(state, duration), 0.05);
+}
+
+TEST(IncrementalEstimator, constantVelocity) {
+    // Without the IMU, the velocity is a body-frame twist
+    const double duration = 5.0;
+    const auto gps = makeGps(duration);
+
+    IncrementalEstimatorParams params;
+    params.use_imu = false;
+    IncrementalEstimator estimator{params};
+
+    PoseVelBias initial;
+    initial.pose = truePose(0.0);
+    initial.vel << 0, 0, kYawRate, kRadius * kYawRate, 0, 0;
+    ASSERT_EQ(0, estimator.initialize(at(0.0), initial));
+
+    const int nb_states = static_cast<int>(duration * kStateRate);
+    for (int i = 1; i <= nb_states; i++) {
+        ASSERT_EQ(0,
+                  estimator.update(at(i / kStateRate),
+                                   IncrementalEstimator::ImuContainer{},
+                                   gps));
+    }
+
+    PoseVelBias state;
+    ASSERT_TRUE(estimator.getState(nb_states, state));
+    EXPECT_LT(positionError(state, duration), 0.05);
+    EXPECT_NEAR(kYawRate, state.vel(2), 0.01);
+}
+
+}  // namespace wave
@@ -0,0 +1,144 @@
+/** @file
+ * Parallel linearization benchmark on the KITTI example data.
+ *
+ * The projection factors of the offline KITTI example, with GPS on every pose,
+ * are repeated with disjoint keys to make graphs of hundreds of thousands of
+ * factors. The arguments are the number of repetitions and of threads.
+ * Linearization alone is timed, then a whole Gauss-Newton step, reporting the
+ * time spent linearizing and eliminating separately.
+ */
+
+#include <map>
+
+#include <benchmark/benchmark.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/slam/ProjectionFactor.h>
+
+#include "wave/vision/dataset/VoDataset.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+#include "wave/gtsam/parallel_linearize.hpp"
+#include "gtsam_helpers.hpp"
+
+namespace wave {
+
+const auto DATASET_DIR = "tests/data/vo_data_drive_0036";
+
+// Offset between the keys of each repetition
+const size_t kRepetitionKeys = 1000000;
+
+/** The KITTI example graph, repeated with disjoint keys */
+struct ScaledGraph {
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values values;
+};
+
+ScaledGraph makeGraph(int repetitions) {
+    const auto dataset = VoDataset::loadFromDirectory(DATASET_DIR);
+    const auto K = boost::make_shared<gtsam::Cal3_S2>(dataset.camera_K(0, 0),
+                                                      dataset.camera_K(1, 1),
+                                                      0.,
+                                                      dataset.camera_K(0, 2),
+                                                      dataset.camera_K(1, 2));
+    const auto pixel_noise = gtsam::noiseModel::Isotropic::Sigma(2, 1.0);
+    const auto gps_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.5);
+    const auto bias_noise = gtsam::noiseModel::Isotropic::Sigma(3, 1.0);
+
+    ScaledGraph s;
+    for (int r = 0; r < repetitions; r++) {
+        const size_t offset = r * kRepetitionKeys;
+        const gtsam::Key bias = gtsam::Symbol{'z', offset};
+        s.values.insert(bias, gtsam::Point3{0, 0, 0});
+        s.graph.emplace_shared<gtsam::PriorFactor<gtsam::Point3>>(
+          bias, gtsam::Point3{0, 0, 0}, bias_noise);
+
+        for (size_t i = 0; i < dataset.states.size(); i++) {
+            const auto &state = dataset.states[i];
+            const auto pose = gtsamPoseFromState(state);
+            const gtsam::Key x = gtsam::Symbol{'x', offset + i};
+            s.values.insert(x, pose);
+            s.graph.emplace_shared<GPSFactorWBias>(x, bias, pose, gps_noise);
+
+            for (const auto &observation : state.features_observed) {
+                const gtsam::Key l =
+                  gtsam::Symbol{'l', offset + observation.first};
+                const auto measurement = gtsam::Point2{observation.second};
+                s.graph.emplace_shared<gtsam::GenericProjectionFactor<
+                  gtsam::Pose3,
+                  gtsam::Point3,
+                  gtsam::Cal3_S2>>(measurement, pixel_noise, x, l, K);
+                if (!s.values.exists(l)) {
+                    const auto camera = gtsam::SimpleCamera{pose, *K};
+                    s.values.insert(l, camera.backproject(measurement, 3.0));
+                }
+            }
+        }
+    }
+    return s;
+}
+
+/** Graphs are shared between benchmarks with the same size */
+const ScaledGraph &getGraph(int repetitions) {
+    static std::map<int, ScaledGraph> graphs;
+    auto it = graphs.find(repetitions);
+    if (it == graphs.end()) {
+        it = graphs.emplace(repetitions, makeGraph(repetitions)).first;
+    }
+    return it->second;
+}
+
+void BM_LinearizeSerial(benchmark::State &state) {
+    const auto &s = getGraph(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s.graph.linearize(s.values));
+    }
+    state.SetItemsProcessed(state.iterations() * s.graph.size());
+}
+
+void BM_LinearizeParallel(benchmark::State &state) {
+    const auto &s = getGraph(state.range(0));
+    ParallelLinearizeParams params;
+    params.num_threads = state.range(1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(linearizeParallel(s.graph, s.values, params));
+    }
+    state.SetItemsProcessed(state.iterations() * s.graph.size());
+}
+
+void BM_GaussNewtonStep(benchmark::State &state) {
+    const auto &s = getGraph(state.range(0));
+    ParallelLinearizeParams params;
+    params.num_threads = state.range(1);
+    gtsam::VectorValues delta;
+    LinearizationTimes times, total;
+    for (auto _ : state) {
+        solveGaussNewtonStep(s.graph, s.values, params, delta, times);
+        total.linearize += times.linearize;
+        total.eliminate += times.eliminate;
+    }
+    state.counters["factors"] = s.graph.size();
+    state.counters["linearize_ms"] =
+      1e3 * total.linearize / state.iterations();
+    state.counters["eliminate_ms"] =
+      1e3 * total.eliminate / state.iterations();
+}
+
+BENCHMARK(BM_LinearizeSerial)
+  ->Arg(1)
+  ->Arg(20)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LinearizeParallel)
+  ->Args({1, 1})
+  ->Args({20, 1})
+  ->Args({20, 2})
+  ->Args({20, 4})
+  ->Args({20, 8})
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GaussNewtonStep)
+  ->Args({20, 1})
+  ->Args({20, 8})
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
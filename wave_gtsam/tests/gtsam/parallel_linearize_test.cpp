@@ -0,0 +1,148 @@
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/slam/ProjectionFactor.h>
+
+#include "wave/wave_test.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+#include "wave/gtsam/hand_eye.hpp"
+#include "wave/gtsam/parallel_linearize.hpp"
+
+namespace wave {
+
+namespace {
+
+using ProjectionFactor =
+  gtsam::GenericProjectionFactor<gtsam::Pose3, gtsam::Point3, gtsam::Cal3_S2>;
+
+/** A chain of poses seeing landmarks, with GPS and a hand-eye calibration */
+class ParallelLinearizeTest : public ::testing::Test {
+ protected:
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values values;
+
+    void SetUp() override {
+        const auto K =
+          boost::make_shared<gtsam::Cal3_S2>(500, 500, 0, 320, 240);
+        const auto pixel_noise = gtsam::noiseModel::Isotropic::Sigma(2, 1.0);
+        const auto pose_noise = gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+        const auto bias_noise = gtsam::noiseModel::Isotropic::Sigma(3, 1.0);
+        const gtsam::Key calibration = gtsam::Symbol{'c', 0};
+        const gtsam::Key bias = gtsam::Symbol{'z', 0};
+
+        const int nb_poses = 50, nb_landmarks = 40;
+        for (int j = 0; j < nb_landmarks; j++) {
+            this->values.insert(gtsam::Symbol{'l', static_cast<size_t>(j)},
+                                gtsam::Point3{0.5 * j - 10, 0.1 * j, 20});
+        }
+        this->values.insert(calibration, gtsam::Pose3{});
+        this->values.insert(bias, gtsam::Point3{0.1, 0.2, 0.3});
+        this->graph.emplace_shared<gtsam::PriorFactor<gtsam::Point3>>(
+          bias, gtsam::Point3{0, 0, 0}, bias_noise);
+
+        for (int i = 0; i < nb_poses; i++) {
+            const gtsam::Key x = gtsam::Symbol{'x', static_cast<size_t>(i)};
+            const gtsam::Pose3 pose{gtsam::Rot3::Yaw(0.01 * i),
+                                    gtsam::Point3{0.2 * i, 0, 0}};
+            this->values.insert(x, pose);
+
+            this->graph.emplace_shared<GPSFactorWBias>(
+              x, bias, pose, pose_noise);
+            this->graph.emplace_shared<HandEyeFactor>(
+              x, calibration, bias, pose, pose_noise);
+            if (i > 0) {
+                this->graph.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+                  gtsam::Symbol{'x', static_cast<size_t>(i - 1)},
+                  x,
+                  gtsam::Pose3{gtsam::Rot3::Yaw(0.01),
+                               gtsam::Point3{0.2, 0, 0}},
+                  pose_noise);
+            } else {
+                // Null factors are kept, as by NonlinearFactorGraph
+                this->graph.push_back(gtsam::NonlinearFactor::shared_ptr{});
+            }
+            for (int j = i % 4; j < nb_landmarks; j += 4) {
+                this->graph.emplace_shared<ProjectionFactor>(
+                  gtsam::Point2{300 + j, 200 + i},
+                  pixel_noise,
+                  x,
+                  gtsam::Symbol{'l', static_cast<size_t>(j)},
+                  K);
+            }
+        }
+    }
+};
+
+}  // namespace
+
+TEST_F(ParallelLinearizeTest, matchesSerial) {
+    const auto expected = this->graph.linearize(this->values);
+
+    // Include chunks which do not divide the graph evenly, and more threads
+    // than chunks
+    for (const auto num_threads : {1, 2, 3, 8}) {
+        for (const size_t chunk_size : {1, 7, 100, 100000}) {
+            ParallelLinearizeParams params;
+            params.num_threads = num_threads;
+            params.chunk_size = chunk_size;
+            const auto result =
+              linearizeParallel(this->graph, this->values, params);
+
+            ASSERT_EQ(expected->size(), result->size());
+            for (size_t i = 0; i < expected->size(); i++) {
+                const auto &e = expected->at(i);
+                const auto &r = result->at(i);
+                ASSERT_EQ(static_cast<bool>(e), static_cast<bool>(r)) << i;
+                if (e) {
+                    EXPECT_TRUE(e->equals(*r, 0.0)) << i;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(ParallelLinearizeTest, emptyGraph) {
+    const auto result = linearizeParallel(gtsam::NonlinearFactorGraph{},
+                                          gtsam::Values{});
+    EXPECT_TRUE(result->empty());
+}
+
+TEST_F(ParallelLinearizeTest, missingValueThrows) {
+    this->values.erase(gtsam::Symbol{'l', 3});
+    ParallelLinearizeParams params;
+    params.num_threads = 4;
+    params.chunk_size = 10;
+    EXPECT_THROW(linearizeParallel(this->graph, this->values, params),
+                 gtsam::ValuesKeyDoesNotExist);
+}
+
+TEST_F(ParallelLinearizeTest, gaussNewtonStep) {
+    gtsam::VectorValues delta;
+    LinearizationTimes times;
+    ASSERT_EQ(0,
+              solveGaussNewtonStep(this->graph,
+                                   this->values,
+                                   ParallelLinearizeParams{},
+                                   delta,
+                                   times));
+    const auto expected = this->graph.linearize(this->values)->optimize();
+    EXPECT_TRUE(expected.equals(delta, 1e-9));
+    EXPECT_GT(times.linearize, 0.0);
+    EXPECT_GT(times.eliminate, 0.0);
+
+    // Two poses with only odometry between them are undetermined
+    gtsam::NonlinearFactorGraph odometry;
+    odometry.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+      gtsam::Symbol{'x', 0},
+      gtsam::Symbol{'x', 1},
+      gtsam::Pose3{},
+      gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+    EXPECT_EQ(-1,
+              solveGaussNewtonStep(odometry,
+                                   this->values,
+                                   ParallelLinearizeParams{},
+                                   delta,
+                                   times));
+}
+
+}  // namespace wave
@@ -0,0 +1,436 @@
+/** @file
+ * Scaling of the wave_gtsam factors on synthetic graphs of any size.
+ *
+ * A vehicle drives around a circle. Its inertial states (PoseVelBias) are
+ * joined by PreintegratedImuFactors, or by MotionFactors if the IMU rate is
+ * zero, with GPSFactorWithBiasGeneral at each GPS fix. A camera on the vehicle
+ * has its own Pose3 chain with odometry, projection factors to landmarks, and
+ * BetweenFactor loop closures to earlier frames; at each GPS fix it also has a
+ * GPSFactorWBias and a HandEyeFactor to the estimated camera mount. The two
+ * chains use different variable types, so they are only tied together
+ * through the shared GPS measurements.
+ *
+ * The arguments of each benchmark are, in order: the number of states, the
+ * IMU rate in Hz, the number of states between GPS fixes (0 for none), the
+ * landmarks observed per frame, and the loop closures per 100 states. Build
+ * time and memory, linearization time and a Levenberg-Marquardt solve are
+ * measured.
+ *
+ * For results which can be compared across versions, run with
+ * `--benchmark_out=<file> --benchmark_out_format=json` (or csv); the counters
+ * are included with the timings.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include <gtsam/geometry/SimpleCamera.h>
+#include <gtsam/inference/Symbol.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/slam/ProjectionFactor.h>
+
+#include "wave/gtsam/pose_vel_bias.hpp"
+#include "wave/gtsam/pose_prior.hpp"
+#include "wave/gtsam/twist_prior.hpp"
+#include "wave/gtsam/gps_factor_with_bias.hpp"
+#include "wave/gtsam/gps_factor_with_bias_general.hpp"
+#include "wave/gtsam/hand_eye.hpp"
+#include "wave/gtsam/motion_factor.hpp"
+#include "wave/gtsam/preint_imu_factor.hpp"
+#include "wave/wave_benchmark.hpp"
+
+namespace wave {
+
+/** Structure of a synthetic graph */
+struct SyntheticGraphParams {
+    int nb_states;
+
+    /// IMU samples per second, preintegrated between states. If zero, states
+    /// are joined by MotionFactors instead.
+    double imu_rate;
+
+    /// A GPS fix every this many states, or none if zero
+    int gps_interval;
+
+    /// Landmarks observed by each camera frame. Each landmark is seen by up
+    /// to `kTrackLength` consecutive frames.
+    int landmarks_per_frame;
+
+    /// Loop closures per 100 states
+    double loop_closure_density;
+
+    explicit SyntheticGraphParams(const benchmark::State &state)
+        : nb_states{static_cast<int>(state.range(0))},
+          imu_rate{static_cast<double>(state.range(1))},
+          gps_interval{static_cast<int>(state.range(2))},
+          landmarks_per_frame{static_cast<int>(state.range(3))},
+          loop_closure_density{static_cast<double>(state.range(4))} {}
+};
+
+const double kStateRate = 10.0;
+const double kSpeed = 10.0;
+const double kYawRate = 0.1;
+const int kTrackLength = 5;
+
+using ProjectionFactor =
+  gtsam::GenericProjectionFactor<gtsam::Pose3, gtsam::Point3, gtsam::Cal3_S2>;
+
+gtsam::Key stateKey(int i) {
+    return gtsam::Symbol{'x', static_cast<size_t>(i)};
+}
+gtsam::Key imuBiasKey(int i) {
+    return gtsam::Symbol{'b', static_cast<size_t>(i)};
+}
+gtsam::Key cameraKey(int i) {
+    return gtsam::Symbol{'c', static_cast<size_t>(i)};
+}
+gtsam::Key landmarkKey(int j) {
+    return gtsam::Symbol{'l', static_cast<size_t>(j)};
+}
+const gtsam::Key kMountKey = gtsam::Symbol{'m', 0};
+const gtsam::Key kGpsBiasKey = gtsam::Symbol{'z', 0};
+
+/** A synthetic graph with initial estimates near the truth */
+struct SyntheticGraph {
+    gtsam::NonlinearFactorGraph graph;
+    gtsam::Values values;
+};
+
+class SyntheticGraphGenerator {
+ public:
+    explicit SyntheticGraphGenerator(const SyntheticGraphParams &params)
+        : params(params) {}
+
+    SyntheticGraph generate() {
+        SyntheticGraph s;
+        this->addPriors(s);
+        for (int i = 0; i < this->params.nb_states; i++) {
+            this->addState(s, i);
+        }
+        return s;
+    }
+
+ private:
+    SyntheticGraphParams params;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> normal{0.0, 1.0};
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+
+    const gtsam::Pose3 T_body_camera{
+      gtsam::Rot3::Ypr(-M_PI_2, 0, -M_PI_2), gtsam::Point3{1.0, 0, 1.5}};
+    const boost::shared_ptr<gtsam::Cal3_S2> K =
+      boost::make_shared<gtsam::Cal3_S2>(500, 500, 0, 320, 240);
+
+    const gtsam::SharedNoiseModel pose_noise =
+      gtsam::noiseModel::Isotropic::Sigma(6, 0.1);
+    const gtsam::SharedNoiseModel gps_noise =
+      gtsam::noiseModel::Isotropic::Sigma(6, 0.5);
+    const gtsam::SharedNoiseModel pixel_noise =
+      gtsam::noiseModel::Isotropic::Sigma(2, 1.0);
+
+    double time(int i) const {
+        return i / kStateRate;
+    }
+
+    /** True pose of the vehicle body */
+    gtsam::Pose3 bodyPose(int i) const {
+        const double yaw = kYawRate * this->time(i);
+        const double radius = kSpeed / kYawRate;
+        return gtsam::Pose3{gtsam::Rot3::Yaw(yaw),
+                            gtsam::Point3{radius * std::sin(yaw),
+                                          radius * (1 - std::cos(yaw)),
+                                          0}};
+    }
+
+    gtsam::Pose3 cameraPose(int i) const {
+        return this->bodyPose(i).compose(this->T_body_camera);
+    }
+
+    /** True position of landmark `j`, between 10 and 30 m ahead of the frame
+     * which first sees it */
+    gtsam::Point3 landmark(int j, int new_per_frame) const {
+        const int frame = j / new_per_frame;
+        std::mt19937 landmark_generator{static_cast<unsigned>(j)};
+        std::uniform_real_distribution<double> u{-1.0, 1.0};
+        const gtsam::Point3 p_camera{10 * u(landmark_generator),
+                                     3 * u(landmark_generator),
+                                     20 + 10 * u(landmark_generator)};
+        return this->cameraPose(frame).transform_from(p_camera);
+    }
+
+    gtsam::Vector6 noise(double sigma) {
+        gtsam::Vector6 v;
+        for (int k = 0; k < 6; k++) {
+            v(k) = sigma * this->normal(this->generator);
+        }
+        return v;
+    }
+
+    bool isGpsState(int i) const {
+        return this->params.gps_interval > 0 &&
+               i % this->params.gps_interval == 0;
+    }
+
+    bool useImu() const {
+        return this->params.imu_rate > 0;
+    }
+
+    void addPriors(SyntheticGraph &s) {
+        PoseVelBias x0;
+        x0.pose = this->bodyPose(0);
+        x0.vel = this->trueVelocity(0);
+        s.graph.emplace_shared<PosePrior<PoseVelBias>>(
+          stateKey(0), x0.pose, this->pose_noise);
+        s.graph.emplace_shared<TwistPrior<PoseVelBias>>(
+          stateKey(0), x0.vel, this->pose_noise);
+        s.graph.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+          cameraKey(0), this->cameraPose(0), this->pose_noise);
+
+        s.values.insert(kMountKey,
+                        this->T_body_camera.retract(this->noise(0.01)));
+        s.values.insert(kGpsBiasKey, gtsam::Point3{0, 0, 0});
+        s.graph.emplace_shared<gtsam::PriorFactor<gtsam::Pose3>>(
+          kMountKey, this->T_body_camera, this->pose_noise);
+        s.graph.emplace_shared<gtsam::PriorFactor<gtsam::Point3>>(
+          kGpsBiasKey,
+          gtsam::Point3{0, 0, 0},
+          gtsam::noiseModel::Isotropic::Sigma(3, 1.0));
+
+        if (this->useImu()) {
+            s.graph.emplace_shared<
+              gtsam::PriorFactor<gtsam::imuBias::ConstantBias>>(
+              imuBiasKey(0),
+              gtsam::imuBias::ConstantBias{},
+              gtsam::noiseModel::Isotropic::Sigma(6, 0.1));
+        }
+    }
+
+    /** Velocity of the inertial states: in the world frame for the IMU
+     * factors, or in the body frame for MotionFactor */
+    VelType trueVelocity() const {
+        VelType vel;
+        vel << 0, 0, kYawRate, kSpeed, 0, 0;
+        return vel;
+    }
+
+    VelType trueVelocity(int i) const {
+        auto vel = this->trueVelocity();
+        if (this->useImu()) {
+            vel.tail<3>() = this->bodyPose(i).rotation().matrix() *
+                            gtsam::Vector3{kSpeed, 0, 0};
+        }
+        return vel;
+    }
+
+    /** IMU samples between states i - 1 and i, with a little noise */
+    gtsam::PreintegratedCombinedMeasurements preintegrate() {
+        gtsam::PreintegratedCombinedMeasurements pim{
+          gtsam::PreintegratedCombinedMeasurements::Params::MakeSharedU(9.81),
+          gtsam::imuBias::ConstantBias{}};
+        const int nb_samples =
+          std::max(1, static_cast<int>(this->params.imu_rate / kStateRate));
+        const double dt = 1.0 / (kStateRate * nb_samples);
+        for (int k = 0; k < nb_samples; k++) {
+            const auto n = this->noise(0.01);
+            pim.integrateMeasurement(
+              gtsam::Vector3{0, kSpeed * kYawRate, 9.81} + n.tail<3>(),
+              gtsam::Vector3{0, 0, kYawRate} + 0.1 * n.head<3>(),
+              dt);
+        }
+        return pim;
+    }
+
+    void addState(SyntheticGraph &s, int i) {
+        const auto body = this->bodyPose(i);
+        const auto camera = this->cameraPose(i);
+
+        PoseVelBias x;
+        x.pose = body.retract(this->noise(0.05));
+        x.vel = this->trueVelocity(i);
+        s.values.insert(stateKey(i), x);
+        s.values.insert(cameraKey(i), camera.retract(this->noise(0.05)));
+
+        // Motion of the vehicle and camera
+        if (i > 0) {
+            if (this->useImu()) {
+                s.graph.emplace_shared<PreintegratedImuFactor<PoseVelBias>>(
+                  stateKey(i - 1),
+                  stateKey(i),
+                  imuBiasKey(i - 1),
+                  imuBiasKey(i),
+                  this->preintegrate());
+            } else {
+                s.graph.emplace_shared<MotionFactor<PoseVelBias, PoseVelBias>>(
+                  stateKey(i - 1),
+                  stateKey(i),
+                  1.0 / kStateRate,
+                  gtsam::noiseModel::Isotropic::Sigma(15, 0.1));
+            }
+            const auto odometry = this->cameraPose(i - 1).between(camera);
+            s.graph.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+              cameraKey(i - 1),
+              cameraKey(i),
+              odometry.retract(this->noise(0.01)),
+              this->pose_noise);
+        }
+        if (this->useImu()) {
+            s.values.insert(imuBiasKey(i), gtsam::imuBias::ConstantBias{});
+        }
+
+        if (this->isGpsState(i)) {
+            const auto gps = body.retract(this->noise(0.1));
+            s.graph.emplace_shared<GPSFactorWithBiasGeneral<PoseVelBias>>(
+              stateKey(i), gps, this->gps_noise);
+            s.graph.emplace_shared<GPSFactorWBias>(
+              cameraKey(i),
+              kGpsBiasKey,
+              gps.compose(this->T_body_camera),
+              this->gps_noise);
+            s.graph.emplace_shared<HandEyeFactor>(
+              cameraKey(i), kMountKey, kGpsBiasKey, gps, this->gps_noise);
+        }
+
+        this->addObservations(s, i, camera);
+
+        // Loop closures to frames at least 10 s earlier
+        const int min_gap = static_cast<int>(10 * kStateRate);
+        if (i > min_gap && this->uniform(this->generator) <
+                             this->params.loop_closure_density / 100) {
+            std::uniform_int_distribution<int> earlier{0, i - min_gap};
+            const int j = earlier(this->generator);
+            const auto closure = this->cameraPose(j).between(camera);
+            s.graph.emplace_shared<gtsam::BetweenFactor<gtsam::Pose3>>(
+              cameraKey(j),
+              cameraKey(i),
+              closure.retract(this->noise(0.01)),
+              this->pose_noise);
+        }
+    }
+
+    /** Projections of the landmarks seen by frame i, adding any new ones */
+    void addObservations(SyntheticGraph &s,
+                         int i,
+                         const gtsam::Pose3 &camera_pose) {
+        const int per_frame = this->params.landmarks_per_frame;
+        if (per_frame <= 0) {
+            return;
+        }
+
+        // Each frame adds `per_frame / kTrackLength` landmarks, and sees those
+        // added by the last `kTrackLength` frames
+        const int new_per_frame = std::max(1, per_frame / kTrackLength);
+        const gtsam::SimpleCamera camera{camera_pose, *this->K};
+        const int first = std::max(0, i - kTrackLength + 1) * new_per_frame;
+        const int end = (i + 1) * new_per_frame;
+        for (int j = first; j < end; j++) {
+            const auto point = this->landmark(j, new_per_frame);
+            gtsam::Point2 measurement;
+            try {
+                measurement = camera.project(point);
+            } catch (const gtsam::CheiralityException &) {
+                continue;
+            }
+            measurement =
+              measurement + gtsam::Point2{this->normal(this->generator),
+                                          this->normal(this->generator)};
+
+            if (!s.values.exists(landmarkKey(j))) {
+                const gtsam::Point3 offset{this->noise(0.3).head<3>()};
+                s.values.insert(landmarkKey(j), point + offset);
+            }
+            s.graph.emplace_shared<ProjectionFactor>(
+              measurement, this->pixel_noise, cameraKey(i), landmarkKey(j), K);
+        }
+    }
+};
+
+void setSizeCounters(benchmark::State &state, const SyntheticGraph &s) {
+    state.counters["factors"] = s.graph.size();
+    state.counters["variables"] = s.values.size();
+}
+
+/** Time generating the graph, and measure the memory it uses */
+void BM_SyntheticBuild(benchmark::State &state) {
+    const SyntheticGraphParams params{state};
+    long memory = 0;
+    size_t nb_factors = 0, nb_variables = 0;
+    for (auto _ : state) {
+        const auto before = residentMemory();
+        std::unique_ptr<SyntheticGraph> s{new SyntheticGraph{
+          SyntheticGraphGenerator{params}.generate()}};
+        state.PauseTiming();
+        memory = std::max(memory, residentMemory() - before);
+        nb_factors = s->graph.size();
+        nb_variables = s->values.size();
+        s.reset();
+        state.ResumeTiming();
+    }
+    state.counters["factors"] = nb_factors;
+    state.counters["variables"] = nb_variables;
+    state.counters["memory_MB"] = memory / 1e6;
+}
+
+void BM_SyntheticLinearize(benchmark::State &state) {
+    const auto s =
+      SyntheticGraphGenerator{SyntheticGraphParams{state}}.generate();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s.graph.linearize(s.values));
+    }
+    state.SetItemsProcessed(state.iterations() * s.graph.size());
+    setSizeCounters(state, s);
+}
+
+void BM_SyntheticOptimize(benchmark::State &state) {
+    const auto s =
+      SyntheticGraphGenerator{SyntheticGraphParams{state}}.generate();
+    gtsam::LevenbergMarquardtParams lm_params;
+    lm_params.setMaxIterations(20);
+    size_t iterations = 0;
+    double final_error = 0.0;
+    for (auto _ : state) {
+        gtsam::LevenbergMarquardtOptimizer optimizer{
+          s.graph, s.values, lm_params};
+        optimizer.optimize();
+        iterations = optimizer.iterations();
+        final_error = optimizer.error();
+    }
+    setSizeCounters(state, s);
+    state.counters["lm_iterations"] = iterations;
+    state.counters["initial_error"] = s.graph.error(s.values);
+    state.counters["final_error"] = final_error;
+}
+
+/** Arguments: states, IMU rate, GPS interval, landmarks per frame and loop
+ * closures per 100 states */
+void syntheticArgs(benchmark::internal::Benchmark *b) {
+    // Inertial and GPS only, with the IMU or the motion model
+    b->Args({1000, 100, 1, 0, 0});
+    b->Args({1000, 0, 1, 0, 0});
+    b->Args({10000, 100, 1, 0, 0});
+    b->Args({10000, 400, 1, 0, 0});
+
+    // Visual-inertial with sparse GPS and loop closures
+    b->Args({1000, 100, 10, 50, 0});
+    b->Args({1000, 100, 10, 200, 0});
+    b->Args({1000, 100, 10, 50, 5});
+    b->Args({10000, 100, 10, 50, 5});
+}
+
+BENCHMARK(BM_SyntheticBuild)
+  ->Apply(syntheticArgs)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyntheticLinearize)
+  ->Apply(syntheticArgs)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyntheticOptimize)
+  ->Apply(syntheticArgs)
+  ->Unit(benchmark::kMillisecond)
+  ->Iterations(1);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
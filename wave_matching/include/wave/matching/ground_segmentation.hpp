@@ -22,6 +22,7 @@
 #include <pcl/registration/transforms.h>
 #include <wave/matching/ground_segmentation_params.hpp>
 #include <wave/utils/math.hpp>
+#include <wave/utils/profile.hpp>
 
 namespace wave {
 /** @addtogroup matching
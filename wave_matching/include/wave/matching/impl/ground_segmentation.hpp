@@ -227,7 +227,7 @@ void GroundSegmentation<PointT>::sectorINSAC(int sector_index) {
 
         if (Vf_s.rows() == 0) {
             keep_going = false;
-            LOG_INFO("WARNING BREAKING LOOP: VF_s does not exist");
+            LOG_WARN_THROTTLE(1.0, "Breaking loop: Vf_s does not exist");
             continue;
         }
 
@@ -352,12 +352,14 @@ void GroundSegmentation<PointT>::sectorINSAC(int sector_index) {
             cur_cell.obs_mean = obs_sum / num_obs;
         }
     } else {
-        LOG_INFO("WARNING:Insufficient Model for angular slice");
+        LOG_WARN_THROTTLE(1.0, "Insufficient model for angular slice");
     }
 }
 
 template <typename PointT>
 void GroundSegmentation<PointT>::applyFilter(PointCloud &output) {
+    WAVE_PROFILE_SCOPE("GroundSegmentation::applyFilter");
+
     // Do the work and fill the indices vectors
     this->genPolarBinGrid();
     for (int i = 0; i < this->params.num_bins_a; i++) {
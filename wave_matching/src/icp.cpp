@@ -1,4 +1,5 @@
 #include "wave/utils/config.hpp"
+#include "wave/utils/profile.hpp"
 #include "wave/matching/icp.hpp"
 
 namespace wave {
@@ -73,6 +74,7 @@ void ICPMatcher::setTarget(const PCLPointCloudPtr &target) {
 }
 
 bool ICPMatcher::match() {
+    WAVE_PROFILE_SCOPE("ICPMatcher::match");
     if (this->params.res > 0) {
         if (this->params.multiscale_steps > 0) {
             Affine3 running_transform = Affine3::Identity();
@@ -133,6 +135,7 @@ bool ICPMatcher::match() {
 }
 
 void ICPMatcher::estimateInfo() {
+    WAVE_PROFILE_SCOPE("ICPMatcher::estimateInfo");
     switch (this->params.covar_estimator) {
         case ICPMatcherParams::covar_method::LUM: this->estimateLUM();
         case ICPMatcherParams::covar_method::CENSI: this->estimateCensi();
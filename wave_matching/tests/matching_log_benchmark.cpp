@@ -0,0 +1,93 @@
+/** @file
+ * Ground segmentation and ICP matching throughput with each log mode.
+ *
+ * The first argument selects synchronous (0) or asynchronous (1) logging.
+ * Log output goes to /dev/null, line buffered like a terminal, so the
+ * difference is the time the pipeline spends blocked on writing messages.
+ */
+
+#include <pcl/io/pcd_io.h>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/matching/ground_segmentation.hpp"
+#include "wave/matching/icp.hpp"
+#include "wave/utils/log.hpp"
+
+namespace wave {
+
+const auto TEST_SCAN = "tests/data/testscan.pcd";
+const auto GROUND_CONFIG = "tests/config/ground_segmentation.yaml";
+const auto ICP_CONFIG = "tests/config/icp.yaml";
+
+FILE *devNull() {
+    static FILE *file = []() {
+        FILE *file = fopen("/dev/null", "w");
+        setvbuf(file, nullptr, _IOLBF, BUFSIZ);
+        return file;
+    }();
+    return file;
+}
+
+PCLPointCloudPtr testScan() {
+    static PCLPointCloudPtr scan = []() {
+        auto cloud = boost::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
+        pcl::io::loadPCDFile(TEST_SCAN, *cloud);
+        return cloud;
+    }();
+    return scan;
+}
+
+void BM_GroundSegmentation(benchmark::State &state) {
+    setLogAsynchronous(state.range(0));
+    GroundSegmentationParams params{GROUND_CONFIG};
+    GroundSegmentation<pcl::PointXYZ> ground_segmentation{params};
+    ground_segmentation.setInputCloud(testScan());
+    ground_segmentation.setKeepGround(true);
+    auto output = boost::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
+
+    for (auto _ : state) {
+        ground_segmentation.filter(*output);
+    }
+    flushLog();
+    setLogAsynchronous(true);
+    state.SetItemsProcessed(state.iterations() * testScan()->size());
+}
+
+void BM_ICPMatch(benchmark::State &state) {
+    setLogAsynchronous(state.range(0));
+    Affine3 perturb = Affine3::Identity();
+    perturb.translation() << 0.2, 0.1, 0;
+    auto target = boost::make_shared<pcl::PointCloud<pcl::PointXYZ>>();
+    pcl::transformPointCloud(*testScan(), *target, perturb);
+
+    ICPMatcher matcher{ICPMatcherParams{ICP_CONFIG}};
+    for (auto _ : state) {
+        matcher.setup(testScan(), target);
+        matcher.match();
+    }
+    flushLog();
+    setLogAsynchronous(true);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_GroundSegmentation)
+  ->Arg(0)
+  ->Arg(1)
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ICPMatch)
+  ->Arg(0)
+  ->Arg(1)
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+int main(int argc, char **argv) {
+    wave::setLogOutput(wave::devNull(), wave::devNull());
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    wave::flushLog();
+    return 0;
+}
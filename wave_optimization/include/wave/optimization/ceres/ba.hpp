@@ -1,13 +1,19 @@
 #ifndef WAVE_OPTIMIZATION_CERES_BA_HPP
 #define WAVE_OPTIMIZATION_CERES_BA_HPP
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <thread>
 #include <typeinfo>
+#include <unordered_map>
 
 #include <ceres/ceres.h>
 
 #include "wave/utils/utils.hpp"
 #include "wave/vision/utils.hpp"
 #include "wave/vision/dataset/VoDataset.hpp"
+#include "wave/optimization/ceres/covariance.hpp"
 
 namespace wave {
 
@@ -92,21 +98,357 @@ struct BAResidual {
     }
 };
 
+/** Bundle Adjustment Residual with analytic Jacobians
+ *
+ * Computes the same reprojection error as `BAResidual`, for the same parameter
+ * blocks, but with hand-derived Jacobians and fixed-size math. This avoids
+ * the cost of evaluating the projection with `ceres::Jet`s over all 10
+ * parameters, which dominates the time spent in the solver.
+ *
+ * The Jacobian with respect to the quaternion is taken in its 4-dimensional
+ * ambient space (x, y, z, w), so it is meant to be used together with
+ * `ceres::EigenQuaternionParameterization`, as is `BAResidual`.
+ */
+class BAAnalyticResidual : public ceres::SizedCostFunction<2, 4, 3, 3> {
+ public:
+    double fx;
+    double fy;
+    double cx;
+    double cy;
+
+    double x;
+    double y;
+
+    BAAnalyticResidual()
+        : fx(0.0), fy(0.0), cx(0.0), cy(0.0), x(0.0), y(0.0) {}
+
+    BAAnalyticResidual(const Mat3 &K, const Vec2 &x)
+        : fx(K(0, 0)),
+          fy(K(1, 1)),
+          cx(K(0, 2)),
+          cy(K(1, 2)),
+          x(x(0)),
+          y(x(1)) {}
+
+    virtual ~BAAnalyticResidual() {}
+
+    /**
+     * Calculate Bundle Adjustment Residual and, if requested, its Jacobians
+     *
+     * @param parameters camera quaternion q_GC (x, y, z, w), camera position
+     * G_p_GC and landmark position G_p_GF, in that order
+     * @param residuals Calculated residual (2 values)
+     * @param jacobians Row-major Jacobians of the residual with respect to
+     * each parameter block (2x4, 2x3, 2x3). Any of them may be NULL.
+     */
+    virtual bool Evaluate(double const *const *parameters,
+                          double *residuals,
+                          double **jacobians) const;
+};
+
+/** Bundle Adjustment Residual with the camera intrinsics as a parameter block
+ *
+ * Computes the same reprojection error as `BAAnalyticResidual`, but reads the
+ * intrinsics from a fourth parameter block (fx, fy, cx, cy) instead of
+ * storing a copy. All observations made by one physical camera can then share
+ * a single intrinsics block, which may be held constant or optimized.
+ */
+class BAIntrinsicsResidual : public ceres::SizedCostFunction<2, 4, 3, 3, 4> {
+ public:
+    double x;
+    double y;
+
+    BAIntrinsicsResidual() : x(0.0), y(0.0) {}
+
+    explicit BAIntrinsicsResidual(const Vec2 &x) : x(x(0)), y(x(1)) {}
+
+    virtual ~BAIntrinsicsResidual() {}
+
+    /**
+     * Calculate Bundle Adjustment Residual and, if requested, its Jacobians
+     *
+     * @param parameters camera quaternion q_GC (x, y, z, w), camera position
+     * G_p_GC, landmark position G_p_GF and intrinsics (fx, fy, cx, cy), in
+     * that order
+     * @param residuals Calculated residual (2 values)
+     * @param jacobians Row-major Jacobians of the residual with respect to
+     * each parameter block (2x4, 2x3, 2x3, 2x4). Any of them may be NULL.
+     */
+    virtual bool Evaluate(double const *const *parameters,
+                          double *residuals,
+                          double **jacobians) const;
+};
+
+/** Robust loss functions which can be applied to every BA residual */
+enum class BALossType : int { None = 0, Huber = 1, Cauchy = 2 };
+
+/** Create the loss function of the given type and scale
+ *
+ * @returns a new loss function owned by the caller, or NULL (no loss) for
+ * `BALossType::None`
+ */
+ceres::LossFunction *makeLossFunction(BALossType type, double scale);
+
+/** Parameters of BundleAdjustment, mostly passed on to the Ceres solver.
+ *
+ * They can be set in the yaml config file; see `config/ba.yaml`.
+ */
+struct BAParams {
+    BAParams() {}
+
+    /** Constructor using parameters extracted from a configuration file.
+     *
+     * @param config_path the path to the location of the configuration file.
+     * @throws std::runtime_error if the file cannot be loaded
+     */
+    explicit BAParams(const std::string &config_path);
+
+    /// Linear solver used to compute each step. All of them eliminate the
+    /// landmarks first using the Schur complement. DENSE_SCHUR suits small
+    /// problems, SPARSE_SCHUR medium ones, and ITERATIVE_SCHUR large ones.
+    enum solver_type : int {
+        DENSE_SCHUR = 0,
+        SPARSE_SCHUR = 1,
+        ITERATIVE_SCHUR = 2
+    } linear_solver = solver_type::SPARSE_SCHUR;
+
+    /// Preconditioner for ITERATIVE_SCHUR. Ignored by the other solvers.
+    enum preconditioner_type : int {
+        JACOBI = 0,
+        SCHUR_JACOBI = 1,
+        CLUSTER_JACOBI = 2,
+        CLUSTER_TRIDIAGONAL = 3
+    } preconditioner = preconditioner_type::SCHUR_JACOBI;
+
+    /// Number of threads used to evaluate residuals and Jacobians, and by the
+    /// linear solver. Defaults to the number of hardware threads.
+    int num_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    /// Maximum number of solver iterations
+    int max_num_iterations = 200;
+    /// Stop when the relative decrease in cost is less than this
+    double function_tolerance = 1e-6;
+    /// Stop when the maximum norm of the gradient is less than this
+    double gradient_tolerance = 1e-10;
+    /// Stop when the relative change in parameters is less than this
+    double parameter_tolerance = 1e-10;
+    /// Use inner iterations, which alternately optimize poses and landmarks
+    bool use_inner_iterations = true;
+
+    /// Robust loss applied to every reprojection residual. BundleAdjustment
+    /// applies the loss set when `solve()` is called.
+    BALossType loss_type = BALossType::None;
+    /// Scale of the robust loss, in pixels
+    double loss_scale = 1.0;
+
+    /// Print the progress of every iteration to stdout
+    bool minimizer_progress_to_stdout = false;
+    /// Print the full Ceres report to stdout after each solve
+    bool print_full_report = false;
+};
+
+/** Set the Ceres solver options corresponding to `params` */
+void setSolverOptions(const BAParams &params, ceres::Solver::Options &options);
+
 class BundleAdjustment {
+ private:
+    // These objects are shared by every camera and residual block. The problem
+    // does not take ownership of them, so they are declared before it (and
+    // destroyed after it).
+    std::unique_ptr<ceres::LocalParameterization> quat_param;
+
+    /** Wraps the loss set in `params`, so that it can be replaced when
+     * solving without rebuilding the residual blocks */
+    std::unique_ptr<ceres::LossFunctionWrapper> loss_function;
+
+    /** Intrinsics (fx, fy, cx, cy) of each physical camera, indexed by camera
+     * id. A deque is used so that pointers to elements stay valid. */
+    std::deque<Vec4, Eigen::aligned_allocator<Vec4>> intrinsics;
+
+    /** Whether each intrinsics block is optimized */
+    std::vector<bool> intrinsics_optimized;
+
+    /** Landmark positions set with `setLandmarks()`, one per column, so that
+     * landmark parameter blocks are contiguous in memory */
+    Eigen::Matrix<double, 3, Eigen::Dynamic> landmark_data;
+
+    /** Column of `landmark_data` holding each landmark */
+    std::unordered_map<LandmarkId, int> landmark_index;
+
+    /** Elimination order for the Schur solvers: landmarks (group 0) first,
+     * then camera poses and intrinsics (group 1) */
+    std::shared_ptr<ceres::ParameterBlockOrdering> ordering;
+
+    /** Reprojection residual of each feature of each pose, keyed by the
+     * pose's quaternion block, in the order the features were added. The
+     * residuals are owned by the problem. */
+    std::unordered_map<const double *, std::vector<BAIntrinsicsResidual *>>
+      pose_residuals;
+
+    /** Add one reprojection residual block */
+    BAIntrinsicsResidual *addResidual(int camera_id,
+                                      const Vec2 &feature,
+                                      double *cam_t,
+                                      double *cam_q,
+                                      double *landmark);
+
+    /** Add the pose blocks of a camera, and set their parameterization and
+     * elimination group */
+    void addPose(double *cam_t, double *cam_q);
+
  public:
     ceres::Problem problem;
     ceres::Solver::Options options;
     ceres::Solver::Summary summary;
 
-    BundleAdjustment() {}
+    BAParams params;
+
+    explicit BundleAdjustment(const BAParams &params = BAParams{});
+
+    /** Add a physical camera, whose intrinsics are shared by all of its
+     * observations
+     *
+     * @param K camera intrinsic matrix
+     * @param optimize if true, the intrinsics are optimized with the poses and
+     * landmarks. Otherwise they are held constant.
+     * @returns the camera id to pass to `addCamera`
+     */
+    int addIntrinsics(const Mat3 &K, bool optimize = false);
 
+    /** Get the current intrinsic matrix of a physical camera */
+    Mat3 getIntrinsics(int camera_id) const;
+
+    /** Add the observations of one camera pose
+     *
+     * @param camera_id id of the physical camera, from `addIntrinsics`
+     * @param features matrix of image features, one (u, v) per row
+     * @param landmark_ids id of the landmark observed by each feature
+     * @param cam_t camera position parameter block
+     * @param cam_q camera quaternion parameter block (x, y, z, w)
+     * @param landmarks landmark parameter blocks
+     * @returns 0 on success, -1 if `camera_id` is invalid
+     */
+    int addCamera(int camera_id,
+                  const MatX &features,
+                  const std::vector<LandmarkId> &landmark_ids,
+                  double *cam_t,
+                  double *cam_q,
+                  LandmarkMap &landmarks);
+
+    /** Set the initial landmark estimates, to be stored in this object
+     *
+     * The landmarks are stored contiguously, in order of id, and their blocks
+     * are added to the problem. Use them with the `addCamera` and `addCameras`
+     * overloads which take no `LandmarkMap`.
+     *
+     * @returns 0 on success, -1 if landmarks have already been set
+     */
+    int setLandmarks(const LandmarkMap &landmarks);
+
+    /** Get the current estimate of a landmark stored in this object
+     *
+     * @returns false if `id` was not given to `setLandmarks`
+     */
+    bool getLandmark(LandmarkId id, Vec3 &G_p_GF) const;
+
+    /** Copy the current estimates of all landmarks stored in this object */
+    void getLandmarks(LandmarkMap &landmarks) const;
+
+    /** Add the observations of one camera pose, of landmarks stored in this
+     * object
+     *
+     * @see addCameras()
+     */
+    int addCamera(int camera_id,
+                  const MatX &features,
+                  const std::vector<LandmarkId> &landmark_ids,
+                  double *cam_t,
+                  double *cam_q);
+
+    /** Add the observations of many camera poses, of landmarks stored in this
+     * object
+     *
+     * Residual blocks are added grouped by landmark, not by camera, so that
+     * the landmark (eliminated) blocks are visited in order during evaluation.
+     *
+     * @param camera_ids id of the physical camera of each pose
+     * @param features image features of each pose, one (u, v) per row
+     * @param landmark_ids id of the landmark observed by each feature
+     * @param cam_t camera position parameter block of each pose
+     * @param cam_q camera quaternion parameter block (x, y, z, w) of each pose
+     * @returns 0 on success, -1 if a camera or landmark id is invalid, in
+     * which case nothing is added
+     */
+    int addCameras(const std::vector<int> &camera_ids,
+                   const std::vector<MatX> &features,
+                   const std::vector<std::vector<LandmarkId>> &landmark_ids,
+                   const std::vector<double *> &cam_t,
+                   const std::vector<double *> &cam_q);
+
+    /** Add the observations of one camera pose, with constant intrinsics `K`
+     *
+     * Observations made with identical `K` share one intrinsics block.
+     */
     int addCamera(const Mat3 &K,
                   const MatX &features,
                   const std::vector<LandmarkId> &landmark_ids,
                   double *cam_t,
                   double *cam_q,
                   LandmarkMap &landmarks);
+
+    /** Replace the measured image features of a camera pose, keeping the
+     * residual blocks and structure of the problem
+     *
+     * This allows the same problem to be solved repeatedly, e.g. for a window
+     * of cameras whose features are tracked again, without rebuilding it.
+     * The estimates are not changed; reset them through the parameter blocks
+     * and `setLandmark()` if needed.
+     *
+     * @param cam_q camera quaternion parameter block of the pose
+     * @param features new image features, one (u, v) per row, in the order
+     * they were first added
+     * @returns 0 on success, -1 if the pose is unknown or the number of
+     * features differs
+     */
+    int updateFeatures(const double *cam_q, const MatX &features);
+
+    /** Set the estimate of a landmark stored in this object
+     *
+     * @returns 0 on success, -1 if `id` was not given to `setLandmarks`
+     */
+    int setLandmark(LandmarkId id, const Vec3 &G_p_GF);
+
+    /** Solve the problem with the settings in `params`
+     *
+     * All settings, including the robust loss, are read from `params` at each
+     * call, so they can be changed between solves.
+     *
+     * If every parameter block was added through this class, landmarks are
+     * eliminated first by the Schur solvers. Otherwise Ceres chooses the
+     * elimination order.
+     *
+     * The problem is kept after solving, so it can be solved again after
+     * `updateFeatures()`.
+     *
+     * @returns 0 if the solution is usable, -1 otherwise
+     */
     int solve();
+
+    /** Compute the marginal covariances of camera poses after `solve()`
+     *
+     * With the SCHUR algorithm, every landmark added through this class is
+     * eliminated first.
+     *
+     * @see computePoseCovariances(ceres::Problem&, const std::vector<double*>&,
+     * const std::vector<double*>&, const std::vector<double*>&,
+     * PoseCovarianceVector&, const CovarianceParams&)
+     */
+    int computePoseCovariances(
+      const std::vector<double *> &cam_q,
+      const std::vector<double *> &cam_t,
+      PoseCovarianceVector &poses,
+      const CovarianceParams &params = CovarianceParams{});
 };
 
 }  // namespace wave
@@ -0,0 +1,98 @@
+/** @file
+ * @ingroup optimization
+ *
+ * Reading and writing bundle adjustment problems in the text format of the
+ * "Bundle Adjustment in the Large" (BAL) dataset, by Agarwal et al.
+ */
+
+#ifndef WAVE_OPTIMIZATION_CERES_BAL_PROBLEM_HPP
+#define WAVE_OPTIMIZATION_CERES_BAL_PROBLEM_HPP
+
+#include <string>
+#include <vector>
+
+#include "wave/utils/utils.hpp"
+#include "wave/optimization/ceres/ba.hpp"
+
+namespace wave {
+/** @addtogroup optimization
+ *  @{ */
+
+/** BAL camera parameters: angle-axis rotation (3), translation (3), focal
+ * length, and radial distortion coefficients k1 and k2 */
+using BALCamera = Eigen::Matrix<double, 9, 1>;
+
+/** The parameter blocks and measurements of a bundle adjustment problem, in
+ * the conventions of `BundleAdjustment`
+ *
+ * The camera parameter blocks are stored here, so this object must outlive
+ * any problem it is added to. Landmarks are copied into the problem.
+ */
+struct BAInputs {
+    /** Intrinsic matrix of each camera */
+    std::vector<Mat3> K;
+    std::vector<Quaternion, Eigen::aligned_allocator<Quaternion>> q_GC;
+    std::vector<Vec3> G_p_GC;
+    LandmarkMap landmarks;
+
+    /** Image features of each camera, one (u, v) per row */
+    std::vector<MatX> features;
+
+    /** Id of the landmark observed by each feature of each camera */
+    std::vector<std::vector<LandmarkId>> landmark_ids;
+
+    /** Add every camera to `ba`, each with its own constant intrinsics
+     *
+     * The landmarks are stored in `ba`; get their estimates with
+     * `BundleAdjustment::getLandmarks()`.
+     */
+    void addTo(BundleAdjustment &ba);
+};
+
+/** A problem in the BAL format
+ *
+ * In BAL, a world point X is projected as follows:
+ *
+ *     P = R * X + t       (R is from the angle-axis rotation)
+ *     p = -P / P.z        (the camera looks along its negative z axis)
+ *     p' = f * (1 + k1 * |p|^2 + k2 * |p|^4) * p
+ *
+ * and the measurement is p', relative to the image centre, with y up.
+ */
+struct BALProblem {
+    struct Observation {
+        int camera_index;
+        int point_index;
+        Vec2 measurement;
+    };
+
+    std::vector<Observation, Eigen::aligned_allocator<Observation>>
+      observations;
+    std::vector<BALCamera> cameras;
+    std::vector<Vec3> points;
+
+    /** Convert to the camera and pinhole conventions of `BundleAdjustment`
+     *
+     * `BundleAdjustment` has no distortion model, so the measurements are
+     * undistorted using each camera's k1 and k2, which are then fixed. The
+     * focal lengths are likewise held constant.
+     */
+    BAInputs toBAInputs() const;
+
+    /** Reads a problem from a BAL text file
+     *
+     * @throws std::runtime_error on failure
+     */
+    static BALProblem loadFromFile(const std::string &input_path);
+
+    /** Writes the problem to a BAL text file
+     *
+     * @throws std::runtime_error on failure
+     */
+    void outputToFile(const std::string &output_path) const;
+};
+
+/** @} group optimization */
+}  // namespace wave
+
+#endif  // WAVE_OPTIMIZATION_CERES_BAL_PROBLEM_HPP
@@ -0,0 +1,97 @@
+/** @file
+ * @ingroup optimization
+ *
+ * Recovery of marginal covariances from a solved Ceres problem, such as those
+ * of `BundleAdjustment` and `PoseGraph`.
+ */
+
+#ifndef WAVE_OPTIMIZATION_CERES_COVARIANCE_HPP
+#define WAVE_OPTIMIZATION_CERES_COVARIANCE_HPP
+
+#include <thread>
+#include <vector>
+
+#include <ceres/ceres.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/utils/pose_cov_comp.hpp"
+
+namespace wave {
+/** @addtogroup optimization
+ *  @{ */
+
+struct CovarianceParams {
+    /// How the covariances are computed.
+    ///
+    /// SCHUR eliminates the landmark blocks with the Schur complement, then
+    /// factors the reduced camera system densely. Only pose covariances can
+    /// be recovered this way, but it is much faster for bundle adjustment.
+    ///
+    /// SPARSE_QR and SUITE_SPARSE_QR use `ceres::Covariance`, which factors
+    /// the full Jacobian. SUITE_SPARSE_QR requires Ceres built with
+    /// SuiteSparse.
+    enum algorithm_type : int {
+        SCHUR = 0,
+        SPARSE_QR = 1,
+        SUITE_SPARSE_QR = 2
+    } algorithm = algorithm_type::SCHUR;
+
+    /// Number of threads used to evaluate the Jacobian and recover the
+    /// covariances. Defaults to the number of hardware threads.
+    int num_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+};
+
+/** Poses with covariance, in the convention of `PoseWithCovariance` */
+using PoseCovarianceVector =
+  std::vector<PoseWithCovariance, Eigen::aligned_allocator<PoseWithCovariance>>;
+
+/** Compute the marginal covariances of camera poses in a solved problem
+ *
+ * Each pose is made of a quaternion block (x, y, z, w) using
+ * `ceres::EigenQuaternionParameterization`, and a position block, as in
+ * `BundleAdjustment` and `PoseGraph`. The result for each pose holds its
+ * estimate, and its covariance in the convention of `composePose()`: position
+ * first, then the Euler angles of `pose_comp::quatToYPR()`.
+ *
+ * Blocks held constant have zero covariance. The problem must have no other
+ * gauge freedom; for example, hold one pose constant.
+ *
+ * @param problem the solved problem
+ * @param cam_q quaternion block of each pose
+ * @param cam_t position block of each pose
+ * @param landmarks blocks eliminated by the SCHUR algorithm. They must have
+ * size 3, and no residual may depend on more than one of them. Ignored by
+ * the other algorithms.
+ * @param poses the poses with their covariances, in the order given
+ * @param params algorithm and number of threads
+ * @returns 0 on success, -1 if a block is not in the problem or the
+ * covariance is rank deficient
+ */
+int computePoseCovariances(ceres::Problem &problem,
+                           const std::vector<double *> &cam_q,
+                           const std::vector<double *> &cam_t,
+                           const std::vector<double *> &landmarks,
+                           PoseCovarianceVector &poses,
+                           const CovarianceParams &params = CovarianceParams{});
+
+/** Compute the marginal covariances of any parameter blocks in a solved
+ * problem, using `ceres::Covariance`
+ *
+ * Each covariance is in the tangent space of its block, e.g. 3x3 for both
+ * landmarks and quaternions.
+ *
+ * @param params algorithm (SPARSE_QR or SUITE_SPARSE_QR; SCHUR falls back to
+ * SPARSE_QR) and number of threads
+ * @returns 0 on success, -1 if the covariance could not be computed
+ */
+int computeBlockCovariances(
+  ceres::Problem &problem,
+  const std::vector<double *> &blocks,
+  std::vector<MatX> &covariances,
+  const CovarianceParams &params = CovarianceParams{});
+
+/** @} group optimization */
+}  // namespace wave
+
+#endif  // WAVE_OPTIMIZATION_CERES_COVARIANCE_HPP
@@ -0,0 +1,27 @@
+#ifndef WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_IMPL_HPP
+#define WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_IMPL_HPP
+
+namespace wave {
+
+template <typename T>
+int SlidingWindowBA::addKeyframe(
+  const LandmarkMeasurementContainer<T> &measurements,
+  const typename LandmarkMeasurementContainer<T>::TimeType &t,
+  const typename LandmarkMeasurementContainer<T>::SensorIdType &sensor,
+  const Quaternion &q_GC,
+  const Vec3 &G_p_GC,
+  const LandmarkMap &initial_landmarks) {
+    std::vector<LandmarkObservation> observations;
+    const auto window = measurements.getTimeWindow(t, t);
+    for (auto it = window.first; it != window.second; ++it) {
+        if (it->sensor_id == sensor) {
+            observations.emplace_back(it->landmark_id, it->value);
+        }
+    }
+
+    return this->addKeyframe(q_GC, G_p_GC, observations, initial_landmarks);
+}
+
+}  // namespace wave
+
+#endif  // WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_IMPL_HPP
@@ -0,0 +1,258 @@
+/** @file
+ * @ingroup optimization
+ *
+ * SE(3) pose-graph optimization, for example of the relative transforms
+ * estimated by scan matchers between pairs of scans.
+ */
+
+#ifndef WAVE_OPTIMIZATION_CERES_POSE_GRAPH_HPP
+#define WAVE_OPTIMIZATION_CERES_POSE_GRAPH_HPP
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ceres/ceres.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/optimization/ceres/ba.hpp"
+#include "wave/optimization/ceres/covariance.hpp"
+
+namespace wave {
+/** @addtogroup optimization
+ *  @{ */
+
+/** Residual of a relative pose measurement between poses i and j
+ *
+ * The measurement `T_ij` maps points from frame j to frame i. The residual is
+ * `sqrt_info * [dp; dq]`, where `dp` is the error in the translation of T_ij
+ * and `dq` is twice the vector part of the rotation error quaternion, i.e.
+ * approximately the rotation vector. Translation comes first, as in the
+ * information matrix of a `Matcher` result.
+ */
+struct PoseGraphResidual {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Vec3 i_p_ij;
+    Quaternion q_ij;
+    Mat6 sqrt_info;
+
+    PoseGraphResidual(const Affine3 &T_ij, const Mat6 &sqrt_info)
+        : i_p_ij{T_ij.translation()},
+          q_ij{T_ij.rotation()},
+          sqrt_info{sqrt_info} {}
+
+    /** Calculate the residual
+     *
+     * @param q_Gi, G_p_Gi orientation (x, y, z, w) and position of pose i
+     * @param q_Gj, G_p_Gj orientation (x, y, z, w) and position of pose j
+     * @param residual Calculated residual (6 values)
+     */
+    template <typename T>
+    bool operator()(const T *const q_Gi,
+                    const T *const G_p_Gi,
+                    const T *const q_Gj,
+                    const T *const G_p_Gj,
+                    T *residual) const {
+        Eigen::Map<const Eigen::Quaternion<T>> q_i{q_Gi};
+        Eigen::Map<const Eigen::Matrix<T, 3, 1>> p_i{G_p_Gi};
+        Eigen::Map<const Eigen::Quaternion<T>> q_j{q_Gj};
+        Eigen::Map<const Eigen::Matrix<T, 3, 1>> p_j{G_p_Gj};
+
+        // Relative pose predicted by the estimates
+        const Eigen::Quaternion<T> q_i_inv = q_i.conjugate();
+        const Eigen::Quaternion<T> q_ij_est = q_i_inv * q_j;
+        const Eigen::Matrix<T, 3, 1> p_ij_est = q_i_inv * (p_j - p_i);
+
+        const Eigen::Quaternion<T> dq =
+          this->q_ij.template cast<T>().conjugate() * q_ij_est;
+
+        Eigen::Map<Eigen::Matrix<T, 6, 1>> r{residual};
+        r.template head<3>() = p_ij_est - this->i_p_ij.template cast<T>();
+        r.template tail<3>() = T(2.0) * dq.vec();
+        r.applyOnTheLeft(this->sqrt_info.template cast<T>());
+
+        return true;
+    }
+};
+
+struct PoseGraphParams {
+    /// Robust loss applied to loop closure edges only. Odometry edges are
+    /// trusted and use no loss.
+    BALossType loop_closure_loss = BALossType::Cauchy;
+    /// Scale of the loop closure loss, in units of the whitened residual
+    double loss_scale = 1.0;
+
+    /// Hold the first pose added constant, to fix the gauge freedom
+    bool fix_first_pose = true;
+
+    /// Number of threads used to evaluate residuals and Jacobians, and by the
+    /// sparse Cholesky solver. Defaults to the number of hardware threads.
+    int num_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    /// Maximum number of solver iterations
+    int max_num_iterations = 100;
+    /// Stop when the relative decrease in cost is less than this
+    double function_tolerance = 1e-6;
+    /// Stop when the maximum norm of the gradient is less than this
+    double gradient_tolerance = 1e-10;
+    /// Stop when the relative change in parameters is less than this
+    double parameter_tolerance = 1e-8;
+
+    /// Print the progress of every iteration to stdout
+    bool minimizer_progress_to_stdout = false;
+    /// Print the full Ceres report to stdout after each solve
+    bool print_full_report = false;
+};
+
+/** Pose-graph optimizer over SE(3) poses
+ *
+ * Edges are relative transforms with a 6x6 information matrix, ordered
+ * (x, y, z, rotx, roty, rotz), as returned by `Matcher::getResult()` and
+ * `Matcher::getInfo()`.
+ *
+ * The problem is kept between solves, and every solve starts from the current
+ * estimates. To re-solve incrementally, add the new poses and edges and call
+ * `solve()` again; only a few iterations are then needed.
+ */
+class PoseGraph {
+ public:
+    explicit PoseGraph(const PoseGraphParams &params = PoseGraphParams{});
+
+    /** Add a pose with its initial estimate
+     *
+     * @returns 0 on success, -1 if a pose with this id already exists
+     */
+    int addPose(int id, const Affine3 &T_G);
+
+    /** Add a relative pose measurement between two existing poses
+     *
+     * @param id_i, id_j ids of the poses
+     * @param T_ij measured transform from frame j to frame i
+     * @param info information matrix of the measurement, translation first.
+     * It must be positive definite.
+     * @param loop_closure if true, the robust loop closure loss is applied
+     * @returns 0 on success, -1 if a pose does not exist or `info` is not
+     * positive definite
+     */
+    int addEdge(int id_i,
+                int id_j,
+                const Affine3 &T_ij,
+                const Mat6 &info,
+                bool loop_closure = false);
+
+    /** Hold a pose constant, or let it vary again
+     *
+     * @returns 0 on success, -1 if the pose does not exist
+     */
+    int setPoseConstant(int id, bool constant = true);
+
+    /** Solve the problem, starting from the current estimates
+     *
+     * @returns 0 if the solution is usable, -1 otherwise
+     */
+    int solve();
+
+    /** Get the current estimate of a pose
+     *
+     * @returns false if the pose does not exist
+     */
+    bool getPose(int id, Affine3 &T_G) const;
+
+    int numPoses() const;
+    int numEdges() const;
+
+    /** Compute the marginal covariances of poses after `solve()`
+     *
+     * Only the SPARSE_QR and SUITE_SPARSE_QR algorithms make sense for a pose
+     * graph, which has no landmarks; SCHUR factors the whole system densely.
+     *
+     * @returns 0 on success, -1 if a pose does not exist or the covariance is
+     * rank deficient
+     */
+    int computeCovariances(const std::vector<int> &ids,
+                           PoseCovarianceVector &poses,
+                           const CovarianceParams &params = CovarianceParams{});
+
+    /** Summary of the last solve */
+    const ceres::Solver::Summary &getSummary() const;
+
+ private:
+    struct Pose {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        Quaternion q_G;
+        Vec3 G_p;
+    };
+
+    PoseGraphParams params;
+
+    // Shared by every residual block; declared before (destroyed after) the
+    // problem, which does not own them
+    std::unique_ptr<ceres::LocalParameterization> quat_param;
+    std::unique_ptr<ceres::LossFunction> loop_closure_loss;
+
+    /** Map nodes are never moved, so pointers to the parameter blocks of each
+     * pose stay valid as poses are added */
+    std::map<int,
+             Pose,
+             std::less<int>,
+             Eigen::aligned_allocator<std::pair<const int, Pose>>>
+      poses;
+
+    int nb_edges = 0;
+
+    ceres::Problem problem;
+    ceres::Solver::Options options;
+    ceres::Solver::Summary summary;
+};
+
+/** A pose graph in the g2o text format
+ *
+ * Only `VERTEX_SE3:QUAT` and `EDGE_SE3:QUAT` lines are read; others, such as
+ * `FIX`, are ignored. In g2o, the information matrix of an edge is stored as
+ * its upper triangle, translation first, as in `PoseGraph`.
+ */
+struct G2OProblem {
+    struct Vertex {
+        int id;
+        Affine3 T_G;
+    };
+
+    struct Edge {
+        int id_i;
+        int id_j;
+        Affine3 T_ij;
+        Mat6 info;
+    };
+
+    std::vector<Vertex, Eigen::aligned_allocator<Vertex>> vertices;
+    std::vector<Edge, Eigen::aligned_allocator<Edge>> edges;
+
+    /** Add every vertex and edge to `graph`. Edges between poses whose ids are
+     * not consecutive are treated as loop closures.
+     *
+     * @returns 0 on success, -1 if a vertex or edge could not be added
+     */
+    int addTo(PoseGraph &graph) const;
+
+    /** Reads a pose graph from a g2o text file
+     *
+     * @throws std::runtime_error on failure
+     */
+    static G2OProblem loadFromFile(const std::string &input_path);
+
+    /** Writes the pose graph to a g2o text file
+     *
+     * @throws std::runtime_error on failure
+     */
+    void outputToFile(const std::string &output_path) const;
+};
+
+/** @} group optimization */
+}  // namespace wave
+
+#endif  // WAVE_OPTIMIZATION_CERES_POSE_GRAPH_HPP
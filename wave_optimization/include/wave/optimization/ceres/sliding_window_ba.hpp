@@ -0,0 +1,221 @@
+/** @file
+ * @ingroup optimization
+ *
+ * Sliding-window bundle adjustment, for bounded-latency visual odometry.
+ *
+ * Only the last N keyframes, and the landmarks they observe, are kept as
+ * variables. When a keyframe leaves the window it is not simply dropped: the
+ * information its observations carried is marginalized into a linear prior on
+ * the remaining variables, using the Schur complement. The same
+ * `ceres::Problem` is kept between windows, with residual and parameter
+ * blocks removed and added incrementally.
+ */
+
+#ifndef WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_HPP
+#define WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_HPP
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <ceres/ceres.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/containers/landmark_measurement.hpp"
+#include "wave/containers/landmark_measurement_container.hpp"
+#include "wave/optimization/ceres/ba.hpp"
+
+namespace wave {
+/** @addtogroup optimization
+ *  @{ */
+
+/** Linear prior left by marginalizing variables out of a sliding window
+ *
+ * The residual is `r0 + J * delta`, where `delta` stacks the difference of
+ * each parameter block from its value at the linearization point, in the
+ * block's 3-dimensional tangent space:
+ * - blocks of size 3 (positions) use `x - x0`
+ * - blocks of size 4 (quaternions x, y, z, w) use the vector part of
+ *   `q * q0^-1`, matching `ceres::EigenQuaternionParameterization`
+ */
+class MarginalizationPrior : public ceres::CostFunction {
+ public:
+    /** Constructor
+     *
+     * @param J Jacobian with respect to the stacked tangent-space deltas
+     * @param r0 residual at the linearization point
+     * @param block_sizes size of each parameter block (3 or 4)
+     * @param x0 stacked values of each parameter block at the linearization
+     * point
+     */
+    MarginalizationPrior(const MatX &J,
+                         const VecX &r0,
+                         const std::vector<int> &block_sizes,
+                         const VecX &x0);
+
+    virtual ~MarginalizationPrior() {}
+
+    virtual bool Evaluate(double const *const *parameters,
+                          double *residuals,
+                          double **jacobians) const;
+
+ private:
+    MatX J;
+    VecX r0;
+    VecX x0;
+};
+
+struct SlidingWindowBAParams {
+    /// Number of keyframes kept as variables
+    int window_size = 10;
+
+    /// Hold the first keyframe constant, to fix the gauge freedom. Once it is
+    /// marginalized, the prior takes this role.
+    bool fix_first_keyframe = true;
+
+    /// Settings for each window solve, and the robust loss
+    BAParams solver;
+};
+
+/** Sliding-window bundle adjustment on the residuals of BundleAdjustment
+ *
+ * Observations are `BAIntrinsicsResidual`s sharing one constant intrinsics
+ * block, with the same quaternion parameterization and loss as
+ * BundleAdjustment.
+ *
+ * Usage: for each new keyframe, call `addKeyframe()` then `solve()`. If the
+ * window is full, `addKeyframe()` first marginalizes the oldest keyframe at
+ * its current (solved) estimate. Landmarks whose observations all leave the
+ * window are marginalized with it.
+ */
+class SlidingWindowBA {
+ public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /** Constructor
+     *
+     * @param K camera intrinsic matrix, shared by all keyframes
+     * @param params window and solver settings
+     */
+    explicit SlidingWindowBA(
+      const Mat3 &K,
+      const SlidingWindowBAParams &params = SlidingWindowBAParams{});
+
+    /** Add a keyframe to the window
+     *
+     * @param q_GC initial estimate of the camera orientation
+     * @param G_p_GC initial estimate of the camera position
+     * @param observations the landmarks observed by this keyframe
+     * @param initial_landmarks initial estimates of the landmarks. Only used
+     * for landmarks not already in the window; observations of landmarks that
+     * are in neither are ignored.
+     * @returns the id of the new keyframe
+     */
+    int addKeyframe(const Quaternion &q_GC,
+                    const Vec3 &G_p_GC,
+                    const std::vector<LandmarkObservation> &observations,
+                    const LandmarkMap &initial_landmarks);
+
+    /** Add a keyframe made of all measurements from `sensor` at time `t`
+     *
+     * @see addKeyframe(const Quaternion&, const Vec3&, const
+     * std::vector<LandmarkObservation>&, const LandmarkMap&)
+     */
+    template <typename T>
+    int addKeyframe(
+      const LandmarkMeasurementContainer<T> &measurements,
+      const typename LandmarkMeasurementContainer<T>::TimeType &t,
+      const typename LandmarkMeasurementContainer<T>::SensorIdType &sensor,
+      const Quaternion &q_GC,
+      const Vec3 &G_p_GC,
+      const LandmarkMap &initial_landmarks);
+
+    /** Solve the current window
+     *
+     * @returns 0 if the solution is usable, -1 otherwise
+     */
+    int solve();
+
+    /** Get the estimate of a keyframe in the window
+     *
+     * @returns false if the keyframe is not (or no longer) in the window
+     */
+    bool getPose(int keyframe_id, Quaternion &q_GC, Vec3 &G_p_GC) const;
+
+    /** Get the estimate of a landmark in the window
+     *
+     * @returns false if the landmark is not (or no longer) in the window
+     */
+    bool getLandmark(LandmarkId id, Vec3 &G_p_GF) const;
+
+    /** Number of keyframes currently in the window */
+    int numKeyframes() const;
+
+    /** Number of landmarks currently in the window */
+    int numLandmarks() const;
+
+    /** Whether the window holds a prior from marginalized keyframes */
+    bool hasPrior() const;
+
+    /** Summary of the last solve */
+    const ceres::Solver::Summary &getSummary() const;
+
+ private:
+    /** A landmark observation, as a residual block in the problem */
+    struct Observation {
+        LandmarkId landmark_id;
+        ceres::ResidualBlockId residual_id;
+        const BAIntrinsicsResidual *cost;  ///< owned by the problem
+    };
+
+    struct Keyframe {
+        int id;
+        Quaternion q_GC;
+        Vec3 G_p_GC;
+        bool constant;
+        std::vector<Observation> observations;
+    };
+
+    struct Landmark {
+        Vec3 G_p_GF;
+        int nb_observations;  ///< observations by keyframes in the window
+    };
+
+    /** Remove the oldest keyframe from the window, replacing the previous
+     * prior with one which also holds the information of its observations */
+    void marginalizeOldest();
+
+    SlidingWindowBAParams params;
+
+    /** Constant intrinsics block (fx, fy, cx, cy) shared by all keyframes */
+    Vec4 intrinsics;
+
+    // Shared by every residual block; declared before (destroyed after) the
+    // problem, which does not own them
+    std::unique_ptr<ceres::LocalParameterization> quat_param;
+    std::unique_ptr<ceres::LossFunction> loss_function;
+
+    /** Keyframes in the window, oldest first. A deque keeps pointers to the
+     * parameter blocks of remaining keyframes valid when one is removed. */
+    std::deque<Keyframe, Eigen::aligned_allocator<Keyframe>> keyframes;
+    std::map<LandmarkId, Landmark> landmarks;
+
+    /** The current prior; all three are empty if there is none */
+    ceres::ResidualBlockId prior_id = nullptr;
+    const MarginalizationPrior *prior_cost = nullptr;
+    std::vector<double *> prior_blocks;
+
+    int next_keyframe_id = 0;
+
+    ceres::Problem problem;
+    ceres::Solver::Options options;
+    ceres::Solver::Summary summary;
+};
+
+/** @} group optimization */
+}  // namespace wave
+
+#include "impl/sliding_window_ba_impl.hpp"
+
+#endif  // WAVE_OPTIMIZATION_CERES_SLIDING_WINDOW_BA_HPP
@@ -1,62 +1,564 @@
+#include <numeric>
+
 #include "wave/optimization/ceres/ba.hpp"
+#include "wave/utils/profile.hpp"
 
 namespace wave {
 
-int BundleAdjustment::addCamera(const Mat3 &K,
+namespace {
+
+/** Evaluate the pinhole reprojection error of measurement (x, y).
+ *
+ * `parameters` and `jacobians` hold the camera quaternion, camera position
+ * and landmark position blocks, in that order; only the first three entries
+ * of `jacobians` are used. If `J_intrinsics` is not NULL, the row-major 2x4
+ * Jacobian with respect to (fx, fy, cx, cy) is written to it.
+ */
+bool evaluateReprojection(const double *intrinsics,
+                          double x,
+                          double y,
+                          double const *const *parameters,
+                          double *residuals,
+                          double **jacobians,
+                          double *J_intrinsics) {
+    const double fx = intrinsics[0];
+    const double fy = intrinsics[1];
+    const double cx = intrinsics[2];
+    const double cy = intrinsics[3];
+
+    // Like in BAResidual, the quaternion is assumed (not forced) to have unit
+    // norm; the Jacobian below is that of Eigen's toRotationMatrix() formula
+    const double qx = parameters[0][0];
+    const double qy = parameters[0][1];
+    const double qz = parameters[0][2];
+    const double qw = parameters[0][3];
+    Eigen::Map<const Quaternion> q_GC{parameters[0]};
+    Eigen::Map<const Vec3> G_p_GC{parameters[1]};
+    Eigen::Map<const Vec3> G_p_GF{parameters[2]};
+
+    // Transform the landmark into the camera frame
+    const Mat3 R_CG = q_GC.toRotationMatrix().transpose();
+    const Vec3 d = G_p_GF - G_p_GC;
+    const Vec3 C_p_CF = R_CG * d;
+
+    // Project onto the image plane
+    const double inv_z = 1.0 / C_p_CF(2);
+    const double u = C_p_CF(0) * inv_z;
+    const double v = C_p_CF(1) * inv_z;
+
+    residuals[0] = x - (fx * u + cx);
+    residuals[1] = y - (fy * v + cy);
+
+    if (J_intrinsics != NULL) {
+        Eigen::Map<Eigen::Matrix<double, 2, 4, Eigen::RowMajor>> J{
+          J_intrinsics};
+        J << -u, 0.0, -1.0, 0.0,  //
+          0.0, -v, 0.0, -1.0;
+    }
+
+    if (jacobians == NULL) {
+        return true;
+    }
+
+    // Jacobian of the residual with respect to the point in the camera frame
+    Eigen::Matrix<double, 2, 3> J_point;
+    J_point << -fx * inv_z, 0.0, fx * u * inv_z,  //
+      0.0, -fy * inv_z, fy * v * inv_z;
+
+    if (jacobians[0] != NULL) {
+        // Derivative of R_GC^T * d with respect to (qx, qy, qz, qw)
+        Eigen::Matrix<double, 3, 4> J_q;
+        J_q(0, 0) = qy * d(1) + qz * d(2);
+        J_q(0, 1) = -2 * qy * d(0) + qx * d(1) - qw * d(2);
+        J_q(0, 2) = -2 * qz * d(0) + qw * d(1) + qx * d(2);
+        J_q(0, 3) = qz * d(1) - qy * d(2);
+
+        J_q(1, 0) = qy * d(0) - 2 * qx * d(1) + qw * d(2);
+        J_q(1, 1) = qx * d(0) + qz * d(2);
+        J_q(1, 2) = -qw * d(0) - 2 * qz * d(1) + qy * d(2);
+        J_q(1, 3) = -qz * d(0) + qx * d(2);
+
+        J_q(2, 0) = qz * d(0) - qw * d(1) - 2 * qx * d(2);
+        J_q(2, 1) = qw * d(0) + qz * d(1) - 2 * qy * d(2);
+        J_q(2, 2) = qx * d(0) + qy * d(1);
+        J_q(2, 3) = qy * d(0) - qx * d(1);
+
+        Eigen::Map<Eigen::Matrix<double, 2, 4, Eigen::RowMajor>> J{
+          jacobians[0]};
+        J.noalias() = 2.0 * J_point * J_q;
+    }
+
+    if (jacobians[1] == NULL && jacobians[2] == NULL) {
+        return true;
+    }
+
+    // The landmark and camera position only enter through d = G_p_GF - G_p_GC
+    const Eigen::Matrix<double, 2, 3> J_d = J_point * R_CG;
+
+    if (jacobians[1] != NULL) {
+        Eigen::Map<Eigen::Matrix<double, 2, 3, Eigen::RowMajor>> J{
+          jacobians[1]};
+        J = -J_d;
+    }
+
+    if (jacobians[2] != NULL) {
+        Eigen::Map<Eigen::Matrix<double, 2, 3, Eigen::RowMajor>> J{
+          jacobians[2]};
+        J = J_d;
+    }
+
+    return true;
+}
+
+/** Problem options for a problem which does not own its local
+ * parameterizations and loss functions, as they are shared. */
+ceres::Problem::Options sharedObjectProblemOptions() {
+    ceres::Problem::Options problem_options;
+    problem_options.local_parameterization_ownership =
+      ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    return problem_options;
+}
+
+}  // namespace
+
+bool BAAnalyticResidual::Evaluate(double const *const *parameters,
+                                  double *residuals,
+                                  double **jacobians) const {
+    const double intrinsics[4] = {this->fx, this->fy, this->cx, this->cy};
+    return evaluateReprojection(
+      intrinsics, this->x, this->y, parameters, residuals, jacobians, NULL);
+}
+
+bool BAIntrinsicsResidual::Evaluate(double const *const *parameters,
+                                    double *residuals,
+                                    double **jacobians) const {
+    return evaluateReprojection(parameters[3],
+                                this->x,
+                                this->y,
+                                parameters,
+                                residuals,
+                                jacobians,
+                                jacobians == NULL ? NULL : jacobians[3]);
+}
+
+BAParams::BAParams(const std::string &config_path) {
+    ConfigParser parser;
+    int linear_solver_temp;
+    int preconditioner_temp;
+    int loss_type_temp;
+    parser.addParam("linear_solver", &linear_solver_temp);
+    parser.addParam("preconditioner", &preconditioner_temp);
+    parser.addParam("num_threads", &(this->num_threads));
+    parser.addParam("max_num_iterations", &(this->max_num_iterations));
+    parser.addParam("function_tolerance", &(this->function_tolerance));
+    parser.addParam("gradient_tolerance", &(this->gradient_tolerance));
+    parser.addParam("parameter_tolerance", &(this->parameter_tolerance));
+    parser.addParam("use_inner_iterations", &(this->use_inner_iterations));
+    parser.addParam("loss_type", &loss_type_temp);
+    parser.addParam("loss_scale", &(this->loss_scale));
+    parser.addParam("minimizer_progress_to_stdout",
+                    &(this->minimizer_progress_to_stdout));
+    parser.addParam("print_full_report", &(this->print_full_report));
+
+    if (parser.load(config_path) != ConfigStatus::OK) {
+        throw std::runtime_error{"Failed to Load BAParams Config"};
+    }
+
+    if ((linear_solver_temp >= BAParams::solver_type::DENSE_SCHUR) &&
+        (linear_solver_temp <= BAParams::solver_type::ITERATIVE_SCHUR)) {
+        this->linear_solver =
+          static_cast<BAParams::solver_type>(linear_solver_temp);
+    } else {
+        LOG_ERROR("Invalid linear solver, using SPARSE_SCHUR");
+        this->linear_solver = BAParams::solver_type::SPARSE_SCHUR;
+    }
+
+    if ((preconditioner_temp >= BAParams::preconditioner_type::JACOBI) &&
+        (preconditioner_temp <=
+         BAParams::preconditioner_type::CLUSTER_TRIDIAGONAL)) {
+        this->preconditioner =
+          static_cast<BAParams::preconditioner_type>(preconditioner_temp);
+    } else {
+        LOG_ERROR("Invalid preconditioner, using SCHUR_JACOBI");
+        this->preconditioner = BAParams::preconditioner_type::SCHUR_JACOBI;
+    }
+
+    if ((loss_type_temp >= static_cast<int>(BALossType::None)) &&
+        (loss_type_temp <= static_cast<int>(BALossType::Cauchy))) {
+        this->loss_type = static_cast<BALossType>(loss_type_temp);
+    } else {
+        LOG_ERROR("Invalid loss type, using no loss function");
+        this->loss_type = BALossType::None;
+    }
+
+    // A non-positive number of threads means "use all hardware threads"
+    if (this->num_threads <= 0) {
+        this->num_threads = BAParams{}.num_threads;
+    }
+}
+
+ceres::LossFunction *makeLossFunction(BALossType type, double scale) {
+    switch (type) {
+        case BALossType::Huber: return new ceres::HuberLoss{scale};
+        case BALossType::Cauchy: return new ceres::CauchyLoss{scale};
+        case BALossType::None:
+        default: return NULL;
+    }
+}
+
+BundleAdjustment::BundleAdjustment(const BAParams &params)
+    : quat_param{new ceres::EigenQuaternionParameterization{}},
+      loss_function{new ceres::LossFunctionWrapper{
+        makeLossFunction(params.loss_type, params.loss_scale),
+        ceres::TAKE_OWNERSHIP}},
+      ordering{new ceres::ParameterBlockOrdering{}},
+      problem{sharedObjectProblemOptions()},
+      params{params} {}
+
+int BundleAdjustment::addIntrinsics(const Mat3 &K, bool optimize) {
+    this->intrinsics.emplace_back(K(0, 0), K(1, 1), K(0, 2), K(1, 2));
+    this->intrinsics_optimized.push_back(optimize);
+
+    double *block = this->intrinsics.back().data();
+    this->problem.AddParameterBlock(block, 4);
+    if (!optimize) {
+        this->problem.SetParameterBlockConstant(block);
+    }
+    this->ordering->AddElementToGroup(block, 1);
+
+    return static_cast<int>(this->intrinsics.size()) - 1;
+}
+
+Mat3 BundleAdjustment::getIntrinsics(int camera_id) const {
+    const Vec4 &k = this->intrinsics.at(camera_id);
+    Mat3 K;
+    K << k(0), 0.0, k(2),  //
+      0.0, k(1), k(3),     //
+      0.0, 0.0, 1.0;
+    return K;
+}
+
+BAIntrinsicsResidual *BundleAdjustment::addResidual(int camera_id,
+                                                    const Vec2 &feature,
+                                                    double *cam_t,
+                                                    double *cam_q,
+                                                    double *landmark) {
+    // parameters: quaternion (4), camera center (3), 3d point in world (3),
+    // intrinsics (4)
+    auto residual = new BAIntrinsicsResidual{feature};
+    this->problem.AddResidualBlock(residual,
+                                   this->loss_function.get(),
+                                   cam_q,
+                                   cam_t,
+                                   landmark,
+                                   this->intrinsics[camera_id].data());
+    return residual;
+}
+
+void BundleAdjustment::addPose(double *cam_t, double *cam_q) {
+    // add quaternion local parameterization, shared by all cameras
+    this->problem.AddParameterBlock(cam_q, 4, this->quat_param.get());
+    this->problem.AddParameterBlock(cam_t, 3);
+    this->ordering->AddElementToGroup(cam_q, 1);
+    this->ordering->AddElementToGroup(cam_t, 1);
+}
+
+int BundleAdjustment::addCamera(int camera_id,
                                 const MatX &features,
                                 const std::vector<LandmarkId> &landmark_ids,
                                 double *cam_t,
                                 double *cam_q,
                                 LandmarkMap &landmarks) {
+    if (camera_id < 0 ||
+        camera_id >= static_cast<int>(this->intrinsics.size())) {
+        LOG_ERROR("Invalid camera id %d", camera_id);
+        return -1;
+    }
+
+    this->addPose(cam_t, cam_q);
+
     // create a residual block for each image feature
+    auto &residuals = this->pose_residuals[cam_q];
     for (int i = 0; i < features.rows(); i++) {
-        // build residual
-        Vec2 feature{features(i, 0), features(i, 1)};
-        auto residual = new BAResidual(K, feature);
-
-        // build cost function
-        auto cost_func = new ceres::AutoDiffCostFunction<
-          BAResidual,  // Residual type
-          2,           // size of residual
-          4,           // size of 1st parameter - quaternion
-          3,           // size of 2nd parameter - camera center (x, y, z)
-          3            // size of 3rd parameter - 3d point in world (x, y, z)
-          >(residual);
-
-        // add residual block to problem
-        this->problem.AddResidualBlock(
-          cost_func,                              // cost function
-          NULL,                                   // loss function
-          cam_q,                                  // camera quaternion
-          cam_t,                                  // camera translation
-          landmarks.at(landmark_ids[i]).data());  // landmark
-    }
-
-    // add quaternion local parameterization
-    ceres::LocalParameterization *quat_param;
-    quat_param = new ceres::EigenQuaternionParameterization();
-    this->problem.SetParameterization(cam_q, quat_param);
+        double *landmark = landmarks.at(landmark_ids[i]).data();
+        residuals.push_back(
+          this->addResidual(camera_id,
+                            Vec2{features(i, 0), features(i, 1)},
+                            cam_t,
+                            cam_q,
+                            landmark));
+        this->ordering->AddElementToGroup(landmark, 0);
+    }
 
     return 0;
 }
 
+int BundleAdjustment::setLandmarks(const LandmarkMap &landmarks) {
+    if (!this->landmark_index.empty()) {
+        LOG_ERROR("Landmarks have already been set");
+        return -1;
+    }
+
+    this->landmark_data.resize(3, landmarks.size());
+    this->landmark_index.reserve(landmarks.size());
+    int col = 0;
+    for (const auto &landmark : landmarks) {
+        this->landmark_data.col(col) = landmark.second;
+        this->landmark_index.emplace(landmark.first, col);
+
+        double *block = this->landmark_data.col(col).data();
+        this->problem.AddParameterBlock(block, 3);
+        this->ordering->AddElementToGroup(block, 0);
+        col++;
+    }
+
+    return 0;
+}
+
+bool BundleAdjustment::getLandmark(LandmarkId id, Vec3 &G_p_GF) const {
+    const auto index = this->landmark_index.find(id);
+    if (index == this->landmark_index.end()) {
+        return false;
+    }
+
+    G_p_GF = this->landmark_data.col(index->second);
+    return true;
+}
+
+void BundleAdjustment::getLandmarks(LandmarkMap &landmarks) const {
+    for (const auto &index : this->landmark_index) {
+        landmarks[index.first] = this->landmark_data.col(index.second);
+    }
+}
+
+int BundleAdjustment::addCamera(int camera_id,
+                                const MatX &features,
+                                const std::vector<LandmarkId> &landmark_ids,
+                                double *cam_t,
+                                double *cam_q) {
+    return this->addCameras(
+      {camera_id}, {features}, {landmark_ids}, {cam_t}, {cam_q});
+}
+
+int BundleAdjustment::addCameras(
+  const std::vector<int> &camera_ids,
+  const std::vector<MatX> &features,
+  const std::vector<std::vector<LandmarkId>> &landmark_ids,
+  const std::vector<double *> &cam_t,
+  const std::vector<double *> &cam_q) {
+    const auto nb_poses = camera_ids.size();
+    if (features.size() != nb_poses || landmark_ids.size() != nb_poses ||
+        cam_t.size() != nb_poses || cam_q.size() != nb_poses) {
+        LOG_ERROR("Inconsistent number of camera poses");
+        return -1;
+    }
+
+    // Check all ids before adding anything, and count the observations of
+    // each landmark
+    const auto nb_landmarks = this->landmark_data.cols();
+    std::vector<int> offsets(nb_landmarks + 1, 0);
+    std::vector<std::vector<int>> columns(nb_poses);
+    for (size_t k = 0; k < nb_poses; k++) {
+        if (camera_ids[k] < 0 ||
+            camera_ids[k] >= static_cast<int>(this->intrinsics.size())) {
+            LOG_ERROR("Invalid camera id %d", camera_ids[k]);
+            return -1;
+        }
+        if (features[k].rows() !=
+            static_cast<int>(landmark_ids[k].size())) {
+            LOG_ERROR("Inconsistent number of features and landmark ids");
+            return -1;
+        }
+
+        columns[k].reserve(landmark_ids[k].size());
+        for (const auto &id : landmark_ids[k]) {
+            const auto index = this->landmark_index.find(id);
+            if (index == this->landmark_index.end()) {
+                LOG_ERROR("Landmark %zu has not been set", id);
+                return -1;
+            }
+            columns[k].push_back(index->second);
+            offsets[index->second + 1]++;
+        }
+    }
+
+    // Each pose's residuals are recorded in feature order, after any it
+    // already has. Make room for all of them before taking pointers.
+    std::vector<size_t> first_residual(nb_poses);
+    for (size_t k = 0; k < nb_poses; k++) {
+        this->addPose(cam_t[k], cam_q[k]);
+
+        auto &pose_residuals = this->pose_residuals[cam_q[k]];
+        first_residual[k] = pose_residuals.size();
+        pose_residuals.resize(pose_residuals.size() + columns[k].size());
+    }
+    std::vector<BAIntrinsicsResidual **> residuals(nb_poses);
+    for (size_t k = 0; k < nb_poses; k++) {
+        residuals[k] =
+          this->pose_residuals[cam_q[k]].data() + first_residual[k];
+    }
+
+    // Counting sort of the observations (pose, feature) by landmark
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<std::pair<int, int>> by_landmark(offsets.back());
+    for (size_t k = 0; k < nb_poses; k++) {
+        for (size_t i = 0; i < columns[k].size(); i++) {
+            by_landmark[offsets[columns[k][i]]++] =
+              std::make_pair(static_cast<int>(k), static_cast<int>(i));
+        }
+    }
+
+    for (const auto &observation : by_landmark) {
+        const int k = observation.first;
+        const int i = observation.second;
+        residuals[k][i] =
+          this->addResidual(camera_ids[k],
+                            Vec2{features[k](i, 0), features[k](i, 1)},
+                            cam_t[k],
+                            cam_q[k],
+                            this->landmark_data.col(columns[k][i]).data());
+    }
+
+    return 0;
+}
+
+int BundleAdjustment::updateFeatures(const double *cam_q,
+                                     const MatX &features) {
+    const auto residuals = this->pose_residuals.find(cam_q);
+    if (residuals == this->pose_residuals.end()) {
+        LOG_ERROR("Unknown camera pose");
+        return -1;
+    }
+    if (features.rows() != static_cast<int>(residuals->second.size())) {
+        LOG_ERROR("Expected %zu features, got %d",
+                  residuals->second.size(),
+                  static_cast<int>(features.rows()));
+        return -1;
+    }
+
+    for (int i = 0; i < features.rows(); i++) {
+        residuals->second[i]->x = features(i, 0);
+        residuals->second[i]->y = features(i, 1);
+    }
+    return 0;
+}
+
+int BundleAdjustment::setLandmark(LandmarkId id, const Vec3 &G_p_GF) {
+    const auto index = this->landmark_index.find(id);
+    if (index == this->landmark_index.end()) {
+        LOG_ERROR("Landmark %zu has not been set", id);
+        return -1;
+    }
+
+    this->landmark_data.col(index->second) = G_p_GF;
+    return 0;
+}
+
+int BundleAdjustment::addCamera(const Mat3 &K,
+                                const MatX &features,
+                                const std::vector<LandmarkId> &landmark_ids,
+                                double *cam_t,
+                                double *cam_q,
+                                LandmarkMap &landmarks) {
+    // Reuse the constant intrinsics block with the same K, if there is one
+    const Vec4 k{K(0, 0), K(1, 1), K(0, 2), K(1, 2)};
+    int camera_id = -1;
+    for (size_t i = 0; i < this->intrinsics.size(); i++) {
+        if (!this->intrinsics_optimized[i] && this->intrinsics[i] == k) {
+            camera_id = static_cast<int>(i);
+            break;
+        }
+    }
+    if (camera_id < 0) {
+        camera_id = this->addIntrinsics(K, false);
+    }
+
+    return this->addCamera(
+      camera_id, features, landmark_ids, cam_t, cam_q, landmarks);
+}
+
+void setSolverOptions(const BAParams &params,
+                      ceres::Solver::Options &options) {
+    switch (params.linear_solver) {
+        case BAParams::solver_type::DENSE_SCHUR:
+            options.linear_solver_type = ceres::DENSE_SCHUR;
+            break;
+        case BAParams::solver_type::ITERATIVE_SCHUR:
+            options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+            break;
+        case BAParams::solver_type::SPARSE_SCHUR:
+        default: options.linear_solver_type = ceres::SPARSE_SCHUR; break;
+    }
+    switch (params.preconditioner) {
+        case BAParams::preconditioner_type::JACOBI:
+            options.preconditioner_type = ceres::JACOBI;
+            break;
+        case BAParams::preconditioner_type::CLUSTER_JACOBI:
+            options.preconditioner_type = ceres::CLUSTER_JACOBI;
+            break;
+        case BAParams::preconditioner_type::CLUSTER_TRIDIAGONAL:
+            options.preconditioner_type = ceres::CLUSTER_TRIDIAGONAL;
+            break;
+        case BAParams::preconditioner_type::SCHUR_JACOBI:
+        default: options.preconditioner_type = ceres::SCHUR_JACOBI; break;
+    }
+    options.max_num_iterations = params.max_num_iterations;
+    options.use_nonmonotonic_steps = false;
+    options.use_inner_iterations = params.use_inner_iterations;
+    options.function_tolerance = params.function_tolerance;
+    options.gradient_tolerance = params.gradient_tolerance;
+    options.parameter_tolerance = params.parameter_tolerance;
+    options.num_threads = params.num_threads;
+    options.num_linear_solver_threads = params.num_threads;
+    options.minimizer_progress_to_stdout = params.minimizer_progress_to_stdout;
+    if (!params.minimizer_progress_to_stdout) {
+        options.logging_type = ceres::SILENT;
+    }
+}
+
 int BundleAdjustment::solve() {
-    // set options
-    this->options.max_num_iterations = 200;
-    this->options.use_nonmonotonic_steps = false;
-    this->options.use_inner_iterations = true;
-    this->options.preconditioner_type = ceres::SCHUR_JACOBI;
-    this->options.linear_solver_type = ceres::SPARSE_SCHUR;
-    this->options.parameter_tolerance = 1e-10;
-    this->options.num_threads = 8;
-    this->options.num_linear_solver_threads = 8;
-    this->options.minimizer_progress_to_stdout = true;
+    WAVE_PROFILE_SCOPE("BundleAdjustment::solve");
+
+    // set options, and the loss which may have changed since construction
+    setSolverOptions(this->params, this->options);
+    this->loss_function->Reset(
+      makeLossFunction(this->params.loss_type, this->params.loss_scale),
+      ceres::TAKE_OWNERSHIP);
+
+    // Ceres removes constant blocks from the ordering it is given, so give it
+    // a copy. The ordering is only complete if every block was added here.
+    if (this->ordering->NumElements() == this->problem.NumParameterBlocks()) {
+        this->options.linear_solver_ordering.reset(
+          new ceres::ParameterBlockOrdering{*this->ordering});
+    } else {
+        this->options.linear_solver_ordering.reset();
+    }
 
     // solve
     ceres::Solve(this->options, &this->problem, &this->summary);
-    std::cout << summary.FullReport() << "\n";
+    if (this->params.print_full_report) {
+        LOG_INFO("%s", this->summary.FullReport().c_str());
+    }
 
-    return 0;
+    return this->summary.IsSolutionUsable() ? 0 : -1;
+}
+
+int BundleAdjustment::computePoseCovariances(
+  const std::vector<double *> &cam_q,
+  const std::vector<double *> &cam_t,
+  PoseCovarianceVector &poses,
+  const CovarianceParams &params) {
+    // Landmarks are in group 0 of the elimination order
+    std::vector<double *> landmarks;
+    const auto &groups = this->ordering->group_to_elements();
+    const auto group = groups.find(0);
+    if (group != groups.end()) {
+        landmarks.assign(group->second.begin(), group->second.end());
+    }
+
+    return wave::computePoseCovariances(
+      this->problem, cam_q, cam_t, landmarks, poses, params);
 }
 
 }  // namespace wave
@@ -0,0 +1,181 @@
+#include <fstream>
+#include <iomanip>
+
+#include "wave/optimization/ceres/bal_problem.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Rotation from the BAL camera frame, which looks along -z with y up, to the
+ * BundleAdjustment camera frame, which looks along +z with y down */
+const Mat3 R_CB = Vec3{1.0, -1.0, -1.0}.asDiagonal();
+
+/** Rotation matrix from a BAL angle-axis vector */
+Mat3 rotationFromAngleAxis(const Vec3 &angle_axis) {
+    const double angle = angle_axis.norm();
+    if (angle < 1e-12) {
+        return Mat3::Identity();
+    }
+    return Eigen::AngleAxisd{angle, angle_axis / angle}.toRotationMatrix();
+}
+
+/** Remove BAL radial distortion from a measurement, returning the normalized
+ * image point p such that p' = f * (1 + k1 * |p|^2 + k2 * |p|^4) * p */
+Vec2 undistort(const Vec2 &measurement, const BALCamera &camera) {
+    const double f = camera(6);
+    const double k1 = camera(7);
+    const double k2 = camera(8);
+
+    // Fixed-point iteration; BAL distortion is small, so this converges fast
+    const Vec2 p_distorted = measurement / f;
+    Vec2 p = p_distorted;
+    for (int i = 0; i < 10; i++) {
+        const double r2 = p.squaredNorm();
+        p = p_distorted / (1.0 + k1 * r2 + k2 * r2 * r2);
+    }
+    return p;
+}
+
+}  // namespace
+
+void BAInputs::addTo(BundleAdjustment &ba) {
+    std::vector<int> camera_ids;
+    std::vector<double *> cam_t;
+    std::vector<double *> cam_q;
+    for (size_t i = 0; i < this->K.size(); i++) {
+        camera_ids.push_back(ba.addIntrinsics(this->K[i]));
+        cam_t.push_back(this->G_p_GC[i].data());
+        cam_q.push_back(this->q_GC[i].coeffs().data());
+    }
+
+    ba.setLandmarks(this->landmarks);
+    ba.addCameras(camera_ids, this->features, this->landmark_ids, cam_t, cam_q);
+}
+
+BAInputs BALProblem::toBAInputs() const {
+    BAInputs inputs;
+    const auto nb_cameras = this->cameras.size();
+    inputs.K.reserve(nb_cameras);
+    inputs.q_GC.reserve(nb_cameras);
+    inputs.G_p_GC.reserve(nb_cameras);
+    inputs.features.resize(nb_cameras);
+    inputs.landmark_ids.resize(nb_cameras);
+
+    for (const auto &camera : this->cameras) {
+        const Mat3 R_BG = rotationFromAngleAxis(camera.head<3>());
+        const Vec3 B_p_BG = camera.segment<3>(3);
+
+        Mat3 K = Mat3::Identity();
+        K(0, 0) = camera(6);
+        K(1, 1) = camera(6);
+        inputs.K.push_back(K);
+        inputs.q_GC.emplace_back((R_CB * R_BG).transpose());
+        inputs.G_p_GC.emplace_back(-R_BG.transpose() * B_p_BG);
+    }
+
+    for (size_t i = 0; i < this->points.size(); i++) {
+        inputs.landmarks.emplace(i, this->points[i]);
+    }
+
+    // Group observations by camera
+    std::vector<int> nb_features(nb_cameras, 0);
+    for (const auto &observation : this->observations) {
+        nb_features[observation.camera_index]++;
+    }
+    for (size_t i = 0; i < nb_cameras; i++) {
+        inputs.features[i].resize(nb_features[i], 2);
+        inputs.landmark_ids[i].reserve(nb_features[i]);
+        nb_features[i] = 0;
+    }
+    for (const auto &observation : this->observations) {
+        const int c = observation.camera_index;
+        const auto &camera = this->cameras[c];
+        const Vec2 p = undistort(observation.measurement, camera);
+
+        // Flip y to match the BundleAdjustment camera frame
+        const int row = nb_features[c]++;
+        inputs.features[c](row, 0) = camera(6) * p(0);
+        inputs.features[c](row, 1) = -camera(6) * p(1);
+        inputs.landmark_ids[c].push_back(observation.point_index);
+    }
+
+    return inputs;
+}
+
+BALProblem BALProblem::loadFromFile(const std::string &input_path) {
+    std::ifstream input_file{input_path};
+    if (!input_file) {
+        throw std::runtime_error("Could not open " + input_path);
+    }
+
+    int nb_cameras, nb_points, nb_observations;
+    if (!(input_file >> nb_cameras >> nb_points >> nb_observations) ||
+        nb_cameras < 0 || nb_points < 0 || nb_observations < 0) {
+        throw std::runtime_error("Invalid BAL header in " + input_path);
+    }
+
+    BALProblem problem;
+    problem.observations.resize(nb_observations);
+    for (auto &observation : problem.observations) {
+        input_file >> observation.camera_index >> observation.point_index >>
+          observation.measurement(0) >> observation.measurement(1);
+        if (observation.camera_index < 0 ||
+            observation.camera_index >= nb_cameras ||
+            observation.point_index < 0 ||
+            observation.point_index >= nb_points) {
+            throw std::runtime_error("Invalid BAL observation in " +
+                                     input_path);
+        }
+    }
+
+    problem.cameras.resize(nb_cameras);
+    for (auto &camera : problem.cameras) {
+        camera = matrixFromStream<9, 1>(input_file);
+    }
+
+    problem.points.resize(nb_points);
+    for (auto &point : problem.points) {
+        point = matrixFromStream<3, 1>(input_file);
+    }
+
+    if (!input_file) {
+        throw std::runtime_error("Unexpected end of file in " + input_path);
+    }
+
+    return problem;
+}
+
+void BALProblem::outputToFile(const std::string &output_path) const {
+    std::ofstream output_file{output_path};
+    if (!output_file) {
+        throw std::runtime_error("Could not open " + output_path);
+    }
+
+    output_file << this->cameras.size() << " " << this->points.size() << " "
+                << this->observations.size() << "\n";
+
+    output_file << std::setprecision(16);
+    for (const auto &observation : this->observations) {
+        output_file << observation.camera_index << " "
+                    << observation.point_index << " "
+                    << observation.measurement(0) << " "
+                    << observation.measurement(1) << "\n";
+    }
+
+    // BAL files hold one parameter per line
+    for (const auto &camera : this->cameras) {
+        for (int i = 0; i < camera.size(); i++) {
+            output_file << camera(i) << "\n";
+        }
+    }
+    for (const auto &point : this->points) {
+        output_file << point(0) << "\n" << point(1) << "\n" << point(2) << "\n";
+    }
+
+    if (!output_file) {
+        throw std::runtime_error("Could not write " + output_path);
+    }
+}
+
+}  // namespace wave
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Eigen/Sparse>
+
+#include "wave/optimization/ceres/covariance.hpp"
+#include "wave/utils/parallel.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Reduced systems with a reciprocal condition number below this are treated
+ * as rank deficient, as in `ceres::Covariance` */
+const double kMinReciprocalConditionNumber = 1e-14;
+
+/** Eigenvalues below this fraction of the largest are treated as zero when
+ * inverting landmark blocks */
+const double kLandmarkEps = 1e-10;
+
+/** Covariance of a pose in its tangent space: position, then the 3-vector of
+ * `ceres::EigenQuaternionParameterization` */
+using TangentCovariance = Mat6;
+using TangentCovarianceVector =
+  std::vector<TangentCovariance, Eigen::aligned_allocator<TangentCovariance>>;
+
+/** Options for `ceres::Covariance`; SCHUR falls back to SPARSE_QR */
+ceres::Covariance::Options covarianceOptions(const CovarianceParams &params) {
+    ceres::Covariance::Options options;
+    options.algorithm_type =
+      params.algorithm == CovarianceParams::algorithm_type::SUITE_SPARSE_QR
+        ? ceres::SUITE_SPARSE_QR
+        : ceres::SPARSE_QR;
+    options.min_reciprocal_condition_number = kMinReciprocalConditionNumber;
+    options.num_threads = params.num_threads;
+    return options;
+}
+
+/** Pseudo-inverse of a symmetric positive semi-definite 3x3 matrix */
+Mat3 pseudoInverse(const Mat3 &H) {
+    const Eigen::SelfAdjointEigenSolver<Mat3> eigen{H};
+    const Vec3 &values = eigen.eigenvalues();
+    const double eps = kLandmarkEps * values.maxCoeff();
+
+    Vec3 inv_values = Vec3::Zero();
+    for (int i = 0; i < 3; i++) {
+        if (values(i) > eps) {
+            inv_values(i) = 1.0 / values(i);
+        }
+    }
+    return eigen.eigenvectors() * inv_values.asDiagonal() *
+           eigen.eigenvectors().transpose();
+}
+
+/** Convert a tangent-space covariance to a `PoseWithCovariance`
+ *
+ * The Jacobian of the quaternion (w, x, y, z) with respect to the tangent
+ * vector of `ceres::EigenQuaternionParameterization` is chained with that of
+ * the p7 to p6 conversion used by `composePose()`.
+ */
+PoseWithCovariance toPoseWithCovariance(const double *cam_q,
+                                        const double *cam_t,
+                                        const TangentCovariance &cov) {
+    const Eigen::Map<const Quaternion> q{cam_q};
+    const Eigen::Map<const Vec3> p{cam_t};
+
+    Vector7 p7;
+    p7 << p, q.w(), q.x(), q.y(), q.z();
+
+    Eigen::Matrix<double, 7, 6> J_p7 = Eigen::Matrix<double, 7, 6>::Zero();
+    J_p7.topLeftCorner<3, 3>().setIdentity();
+    J_p7.block<1, 3>(3, 3) = -q.vec().transpose();
+    J_p7.block<3, 3>(4, 3) << q.w(), q.z(), -q.y(),  //
+      -q.z(), q.w(), q.x(),                           //
+      q.y(), -q.x(), q.w();
+
+    const Eigen::Matrix<double, 6, 6> J =
+      jacobian_p7_to_p6_wrt_p(p7) * J_p7;
+
+    PoseWithCovariance pose;
+    pose.position = p;
+    pose.rotation_matrix = q.normalized().toRotationMatrix();
+    pose.covariance = J * cov * J.transpose();
+    return pose;
+}
+
+/** Recover the tangent-space covariance of each pose by eliminating the
+ * landmarks
+ *
+ * @param crs Jacobian of the problem. Its first `nb_kept` columns are those
+ * of the blocks kept in the reduced system, and the rest are those of the
+ * landmarks, 3 each.
+ * @param pose_columns first column of each pose's position and quaternion
+ * blocks
+ */
+int schurCovariances(const ceres::CRSMatrix &crs,
+                     int nb_kept,
+                     const std::vector<std::pair<int, int>> &pose_columns,
+                     int num_threads,
+                     TangentCovarianceVector &covariances) {
+    using SparseMat = Eigen::SparseMatrix<double>;
+    const int nb_landmark_cols = crs.num_cols - nb_kept;
+
+    // Ceres's matrix is row-major; column blocks are needed here
+    const Eigen::Map<const Eigen::SparseMatrix<double, Eigen::RowMajor>>
+      J_rows{crs.num_rows,
+             crs.num_cols,
+             static_cast<int>(crs.values.size()),
+             crs.rows.data(),
+             crs.cols.data(),
+             crs.values.data()};
+    const SparseMat J = J_rows;
+    const SparseMat J_c = J.leftCols(nb_kept);
+    const SparseMat J_l = J.rightCols(nb_landmark_cols);
+
+    // H_ll is block diagonal, since no residual involves two landmarks
+    const SparseMat H_ll = J_l.transpose() * J_l;
+    const int nb_landmarks = nb_landmark_cols / 3;
+    std::vector<Mat3> H_ll_inv(nb_landmarks);
+    parallelFor(nb_landmarks, num_threads, [&](int k) {
+        const Mat3 H = H_ll.block(3 * k, 3 * k, 3, 3);
+        H_ll_inv[k] = pseudoInverse(H);
+    });
+
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(9 * nb_landmarks);
+    for (int k = 0; k < nb_landmarks; k++) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                triplets.emplace_back(3 * k + i, 3 * k + j, H_ll_inv[k](i, j));
+            }
+        }
+    }
+    SparseMat H_ll_inv_mat{nb_landmark_cols, nb_landmark_cols};
+    H_ll_inv_mat.setFromTriplets(triplets.begin(), triplets.end());
+
+    // Reduced camera system S = H_cc - H_cl * H_ll^-1 * H_lc
+    const SparseMat H_cl = J_c.transpose() * J_l;
+    const SparseMat W = H_cl * H_ll_inv_mat;
+    MatX S = MatX(J_c.transpose() * J_c);
+    S -= MatX(W * H_cl.transpose());
+
+    // Constant blocks have zero columns in the Jacobian; leave them out
+    std::vector<int> active_index(nb_kept, -1);
+    std::vector<int> active;
+    for (int i = 0; i < nb_kept; i++) {
+        if (S(i, i) > 0.0) {
+            active_index[i] = static_cast<int>(active.size());
+            active.push_back(i);
+        }
+    }
+    const auto nb_active = static_cast<int>(active.size());
+    MatX S_active{nb_active, nb_active};
+    for (int j = 0; j < nb_active; j++) {
+        for (int i = 0; i < nb_active; i++) {
+            S_active(i, j) = S(active[i], active[j]);
+        }
+    }
+
+    const Eigen::LLT<MatX> llt{S_active};
+    if (llt.info() != Eigen::Success ||
+        llt.rcond() < kMinReciprocalConditionNumber) {
+        LOG_ERROR("Covariance is rank deficient; is a pose held constant?");
+        return -1;
+    }
+
+    // Solve for the columns of S^-1 belonging to each pose, in parallel
+    const auto nb_poses = static_cast<int>(pose_columns.size());
+    covariances.assign(nb_poses, TangentCovariance::Zero());
+    parallelFor(nb_poses, num_threads, [&](int k) {
+        // Rows of the tangent covariance, and of S_active, of each variable
+        std::vector<std::pair<int, int>> rows;
+        const int first_columns[2] = {pose_columns[k].first,
+                                      pose_columns[k].second};
+        for (int b = 0; b < 2; b++) {
+            for (int i = 0; i < 3; i++) {
+                const int index = active_index[first_columns[b] + i];
+                if (index >= 0) {
+                    rows.emplace_back(3 * b + i, index);
+                }
+            }
+        }
+
+        const auto n = static_cast<int>(rows.size());
+        MatX E = MatX::Zero(nb_active, n);
+        for (int i = 0; i < n; i++) {
+            E(rows[i].second, i) = 1.0;
+        }
+        const MatX X = llt.solve(E);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                covariances[k](rows[i].first, rows[j].first) =
+                  X(rows[i].second, j);
+            }
+        }
+    });
+
+    return 0;
+}
+
+}  // namespace
+
+int computePoseCovariances(ceres::Problem &problem,
+                           const std::vector<double *> &cam_q,
+                           const std::vector<double *> &cam_t,
+                           const std::vector<double *> &landmarks,
+                           PoseCovarianceVector &poses,
+                           const CovarianceParams &params) {
+    if (cam_q.size() != cam_t.size()) {
+        LOG_ERROR("Inconsistent number of camera poses");
+        return -1;
+    }
+    for (size_t k = 0; k < cam_q.size(); k++) {
+        if (!problem.HasParameterBlock(cam_q[k]) ||
+            !problem.HasParameterBlock(cam_t[k])) {
+            LOG_ERROR("Camera pose %zu is not in the problem", k);
+            return -1;
+        }
+    }
+
+    TangentCovarianceVector covariances;
+    if (params.algorithm == CovarianceParams::algorithm_type::SCHUR) {
+        // Order the Jacobian columns as kept blocks, then landmarks
+        std::unordered_set<const double *> landmark_set;
+        std::vector<double *> landmark_blocks;
+        for (const auto landmark : landmarks) {
+            if (!problem.HasParameterBlock(landmark) ||
+                problem.ParameterBlockLocalSize(landmark) != 3) {
+                LOG_ERROR("Invalid landmark block");
+                return -1;
+            }
+            if (landmark_set.insert(landmark).second) {
+                landmark_blocks.push_back(landmark);
+            }
+        }
+
+        std::vector<double *> all_blocks;
+        problem.GetParameterBlocks(&all_blocks);
+        ceres::Problem::EvaluateOptions evaluate_options;
+        std::unordered_map<const double *, int> columns;
+        int nb_kept = 0;
+        for (const auto block : all_blocks) {
+            if (landmark_set.count(block) == 0) {
+                evaluate_options.parameter_blocks.push_back(block);
+                columns.emplace(block, nb_kept);
+                nb_kept += problem.ParameterBlockLocalSize(block);
+            }
+        }
+        evaluate_options.parameter_blocks.insert(
+          evaluate_options.parameter_blocks.end(),
+          landmark_blocks.begin(),
+          landmark_blocks.end());
+        evaluate_options.num_threads = params.num_threads;
+
+        ceres::CRSMatrix jacobian;
+        problem.Evaluate(evaluate_options, NULL, NULL, NULL, &jacobian);
+
+        std::vector<std::pair<int, int>> pose_columns;
+        for (size_t k = 0; k < cam_q.size(); k++) {
+            pose_columns.emplace_back(columns.at(cam_t[k]),
+                                      columns.at(cam_q[k]));
+        }
+        if (schurCovariances(jacobian,
+                             nb_kept,
+                             pose_columns,
+                             params.num_threads,
+                             covariances) != 0) {
+            return -1;
+        }
+    } else {
+        ceres::Covariance covariance{covarianceOptions(params)};
+
+        std::vector<std::pair<const double *, const double *>> pairs;
+        for (size_t k = 0; k < cam_q.size(); k++) {
+            pairs.emplace_back(cam_t[k], cam_t[k]);
+            pairs.emplace_back(cam_t[k], cam_q[k]);
+            pairs.emplace_back(cam_q[k], cam_q[k]);
+        }
+        if (!covariance.Compute(pairs, &problem)) {
+            LOG_ERROR("Covariance is rank deficient; is a pose held constant?");
+            return -1;
+        }
+
+        // Ceres writes covariance blocks in row-major order
+        using Block = Eigen::Matrix<double, 3, 3, Eigen::RowMajor>;
+        for (size_t k = 0; k < cam_q.size(); k++) {
+            Block tt, tq, qq;
+            covariance.GetCovarianceBlockInTangentSpace(
+              cam_t[k], cam_t[k], tt.data());
+            covariance.GetCovarianceBlockInTangentSpace(
+              cam_t[k], cam_q[k], tq.data());
+            covariance.GetCovarianceBlockInTangentSpace(
+              cam_q[k], cam_q[k], qq.data());
+
+            TangentCovariance cov;
+            cov << tt, tq, tq.transpose(), qq;
+            covariances.push_back(cov);
+        }
+    }
+
+    poses.clear();
+    poses.reserve(cam_q.size());
+    for (size_t k = 0; k < cam_q.size(); k++) {
+        poses.push_back(
+          toPoseWithCovariance(cam_q[k], cam_t[k], covariances[k]));
+    }
+    return 0;
+}
+
+int computeBlockCovariances(ceres::Problem &problem,
+                            const std::vector<double *> &blocks,
+                            std::vector<MatX> &covariances,
+                            const CovarianceParams &params) {
+    ceres::Covariance covariance{covarianceOptions(params)};
+
+    std::vector<std::pair<const double *, const double *>> pairs;
+    for (const auto block : blocks) {
+        if (!problem.HasParameterBlock(block)) {
+            LOG_ERROR("Block is not in the problem");
+            return -1;
+        }
+        pairs.emplace_back(block, block);
+    }
+    if (!covariance.Compute(pairs, &problem)) {
+        LOG_ERROR("Covariance could not be computed");
+        return -1;
+    }
+
+    covariances.clear();
+    for (const auto block : blocks) {
+        const int size = problem.ParameterBlockLocalSize(block);
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+          cov{size, size};
+        covariance.GetCovarianceBlockInTangentSpace(block, block, cov.data());
+        covariances.emplace_back(cov);
+    }
+    return 0;
+}
+
+}  // namespace wave
@@ -0,0 +1,282 @@
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "wave/optimization/ceres/pose_graph.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Problem options for the pose graph: shared parameterization and loss */
+ceres::Problem::Options poseGraphProblemOptions() {
+    ceres::Problem::Options problem_options;
+    problem_options.local_parameterization_ownership =
+      ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    return problem_options;
+}
+
+/** Read a g2o pose: x y z qx qy qz qw */
+Affine3 readG2OPose(std::istream &input) {
+    Vec3 p;
+    Quaternion q;
+    input >> p(0) >> p(1) >> p(2) >> q.x() >> q.y() >> q.z() >> q.w();
+
+    Affine3 T = Affine3::Identity();
+    T.linear() = q.normalized().toRotationMatrix();
+    T.translation() = p;
+    return T;
+}
+
+void writeG2OPose(std::ostream &output, const Affine3 &T) {
+    const Vec3 p = T.translation();
+    const Quaternion q{T.rotation()};
+    output << p(0) << " " << p(1) << " " << p(2) << " " << q.x() << " "
+           << q.y() << " " << q.z() << " " << q.w();
+}
+
+}  // namespace
+
+PoseGraph::PoseGraph(const PoseGraphParams &params)
+    : params{params},
+      quat_param{new ceres::EigenQuaternionParameterization{}},
+      loop_closure_loss{
+        makeLossFunction(params.loop_closure_loss, params.loss_scale)},
+      problem{poseGraphProblemOptions()} {}
+
+int PoseGraph::addPose(int id, const Affine3 &T_G) {
+    if (this->poses.count(id) != 0) {
+        LOG_ERROR("Pose %d already exists", id);
+        return -1;
+    }
+
+    auto &pose = this->poses[id];
+    pose.q_G = Quaternion{T_G.rotation()};
+    pose.G_p = T_G.translation();
+
+    this->problem.AddParameterBlock(
+      pose.q_G.coeffs().data(), 4, this->quat_param.get());
+    this->problem.AddParameterBlock(pose.G_p.data(), 3);
+
+    if (this->params.fix_first_pose && this->poses.size() == 1) {
+        this->problem.SetParameterBlockConstant(pose.q_G.coeffs().data());
+        this->problem.SetParameterBlockConstant(pose.G_p.data());
+    }
+
+    return 0;
+}
+
+int PoseGraph::addEdge(int id_i,
+                       int id_j,
+                       const Affine3 &T_ij,
+                       const Mat6 &info,
+                       bool loop_closure) {
+    auto pose_i = this->poses.find(id_i);
+    auto pose_j = this->poses.find(id_j);
+    if (pose_i == this->poses.end() || pose_j == this->poses.end()) {
+        LOG_ERROR("Edge %d-%d refers to a pose which does not exist",
+                  id_i,
+                  id_j);
+        return -1;
+    }
+
+    // info = L * L^T, so the whitened residual is L^T * e
+    const Eigen::LLT<Mat6> llt{info};
+    if (llt.info() != Eigen::Success) {
+        LOG_ERROR("Information of edge %d-%d is not positive definite",
+                  id_i,
+                  id_j);
+        return -1;
+    }
+    const Mat6 sqrt_info = llt.matrixL().transpose();
+
+    auto cost_function =
+      new ceres::AutoDiffCostFunction<PoseGraphResidual, 6, 4, 3, 4, 3>{
+        new PoseGraphResidual{T_ij, sqrt_info}};
+    this->problem.AddResidualBlock(
+      cost_function,
+      loop_closure ? this->loop_closure_loss.get() : NULL,
+      pose_i->second.q_G.coeffs().data(),
+      pose_i->second.G_p.data(),
+      pose_j->second.q_G.coeffs().data(),
+      pose_j->second.G_p.data());
+    this->nb_edges++;
+
+    return 0;
+}
+
+int PoseGraph::setPoseConstant(int id, bool constant) {
+    auto pose = this->poses.find(id);
+    if (pose == this->poses.end()) {
+        LOG_ERROR("Pose %d does not exist", id);
+        return -1;
+    }
+
+    double *q_G = pose->second.q_G.coeffs().data();
+    double *G_p = pose->second.G_p.data();
+    if (constant) {
+        this->problem.SetParameterBlockConstant(q_G);
+        this->problem.SetParameterBlockConstant(G_p);
+    } else {
+        this->problem.SetParameterBlockVariable(q_G);
+        this->problem.SetParameterBlockVariable(G_p);
+    }
+    return 0;
+}
+
+int PoseGraph::solve() {
+    // Pose graphs have no structure for the Schur solvers to exploit, but are
+    // very sparse
+    this->options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+    this->options.max_num_iterations = this->params.max_num_iterations;
+    this->options.function_tolerance = this->params.function_tolerance;
+    this->options.gradient_tolerance = this->params.gradient_tolerance;
+    this->options.parameter_tolerance = this->params.parameter_tolerance;
+    this->options.num_threads = this->params.num_threads;
+    this->options.num_linear_solver_threads = this->params.num_threads;
+    this->options.minimizer_progress_to_stdout =
+      this->params.minimizer_progress_to_stdout;
+    if (!this->params.minimizer_progress_to_stdout) {
+        this->options.logging_type = ceres::SILENT;
+    }
+
+    ceres::Solve(this->options, &this->problem, &this->summary);
+    if (this->params.print_full_report) {
+        LOG_INFO("%s", this->summary.FullReport().c_str());
+    }
+
+    return this->summary.IsSolutionUsable() ? 0 : -1;
+}
+
+bool PoseGraph::getPose(int id, Affine3 &T_G) const {
+    auto pose = this->poses.find(id);
+    if (pose == this->poses.end()) {
+        return false;
+    }
+
+    T_G.setIdentity();
+    T_G.linear() = pose->second.q_G.normalized().toRotationMatrix();
+    T_G.translation() = pose->second.G_p;
+    return true;
+}
+
+int PoseGraph::numPoses() const {
+    return static_cast<int>(this->poses.size());
+}
+
+int PoseGraph::numEdges() const {
+    return this->nb_edges;
+}
+
+int PoseGraph::computeCovariances(const std::vector<int> &ids,
+                                  PoseCovarianceVector &poses,
+                                  const CovarianceParams &params) {
+    std::vector<double *> q_G;
+    std::vector<double *> G_p;
+    for (const auto id : ids) {
+        auto pose = this->poses.find(id);
+        if (pose == this->poses.end()) {
+            LOG_ERROR("Pose %d does not exist", id);
+            return -1;
+        }
+        q_G.push_back(pose->second.q_G.coeffs().data());
+        G_p.push_back(pose->second.G_p.data());
+    }
+
+    return computePoseCovariances(this->problem, q_G, G_p, {}, poses, params);
+}
+
+const ceres::Solver::Summary &PoseGraph::getSummary() const {
+    return this->summary;
+}
+
+int G2OProblem::addTo(PoseGraph &graph) const {
+    for (const auto &vertex : this->vertices) {
+        if (graph.addPose(vertex.id, vertex.T_G) != 0) {
+            return -1;
+        }
+    }
+    for (const auto &edge : this->edges) {
+        const bool loop_closure = std::abs(edge.id_j - edge.id_i) != 1;
+        if (graph.addEdge(
+              edge.id_i, edge.id_j, edge.T_ij, edge.info, loop_closure) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+G2OProblem G2OProblem::loadFromFile(const std::string &input_path) {
+    std::ifstream input_file{input_path};
+    if (!input_file) {
+        throw std::runtime_error("Could not open " + input_path);
+    }
+
+    G2OProblem problem;
+    std::string line;
+    while (std::getline(input_file, line)) {
+        std::istringstream input{line};
+        std::string tag;
+        input >> tag;
+
+        if (tag == "VERTEX_SE3:QUAT") {
+            Vertex vertex;
+            input >> vertex.id;
+            vertex.T_G = readG2OPose(input);
+            if (!input) {
+                throw std::runtime_error("Invalid vertex in " + input_path);
+            }
+            problem.vertices.push_back(vertex);
+        } else if (tag == "EDGE_SE3:QUAT") {
+            Edge edge;
+            input >> edge.id_i >> edge.id_j;
+            edge.T_ij = readG2OPose(input);
+            for (int row = 0; row < 6; row++) {
+                for (int col = row; col < 6; col++) {
+                    input >> edge.info(row, col);
+                    edge.info(col, row) = edge.info(row, col);
+                }
+            }
+            if (!input) {
+                throw std::runtime_error("Invalid edge in " + input_path);
+            }
+            problem.edges.push_back(edge);
+        }
+    }
+
+    return problem;
+}
+
+void G2OProblem::outputToFile(const std::string &output_path) const {
+    std::ofstream output_file{output_path};
+    if (!output_file) {
+        throw std::runtime_error("Could not open " + output_path);
+    }
+
+    output_file << std::setprecision(16);
+    for (const auto &vertex : this->vertices) {
+        output_file << "VERTEX_SE3:QUAT " << vertex.id << " ";
+        writeG2OPose(output_file, vertex.T_G);
+        output_file << "\n";
+    }
+    for (const auto &edge : this->edges) {
+        output_file << "EDGE_SE3:QUAT " << edge.id_i << " " << edge.id_j
+                    << " ";
+        writeG2OPose(output_file, edge.T_ij);
+        for (int row = 0; row < 6; row++) {
+            for (int col = row; col < 6; col++) {
+                output_file << " " << edge.info(row, col);
+            }
+        }
+        output_file << "\n";
+    }
+
+    if (!output_file) {
+        throw std::runtime_error("Could not write " + output_path);
+    }
+}
+
+}  // namespace wave
@@ -0,0 +1,453 @@
+#include <cmath>
+
+#include "wave/optimization/ceres/sliding_window_ba.hpp"
+
+namespace wave {
+
+namespace {
+
+/** Eigenvalues below this fraction of the largest are treated as zero when
+ * inverting and factoring the marginalized information */
+const double kMarginalizationEps = 1e-10;
+
+/** Problem options for the sliding window: shared parameterization and loss,
+ * and fast removal since blocks are removed every time the window slides. */
+ceres::Problem::Options slidingWindowProblemOptions() {
+    ceres::Problem::Options problem_options;
+    problem_options.local_parameterization_ownership =
+      ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.enable_fast_removal = true;
+    return problem_options;
+}
+
+/** Jacobian of vec(q * q0^-1) with respect to q = (x, y, z, w), given
+ * r = q0^-1 */
+Eigen::Matrix<double, 3, 4> quaternionDeltaJacobian(const Quaternion &r) {
+    Eigen::Matrix<double, 3, 4> J;
+    J << r.w(), r.z(), -r.y(), r.x(),  //
+      -r.z(), r.w(), r.x(), r.y(),     //
+      r.y(), -r.x(), r.w(), r.z();
+    return J;
+}
+
+/** A residual block to be removed from the window, with what is needed to
+ * linearize it */
+struct RemovedResidual {
+    ceres::ResidualBlockId id;
+    const ceres::CostFunction *cost;
+    const ceres::LossFunction *loss;
+    std::vector<double *> blocks;
+};
+
+/** Position of a variable in the stacked tangent-space vector */
+struct BlockIndex {
+    int offset;
+    int size;  ///< ambient size, 3 or 4
+};
+
+}  // namespace
+
+MarginalizationPrior::MarginalizationPrior(const MatX &J,
+                                           const VecX &r0,
+                                           const std::vector<int> &block_sizes,
+                                           const VecX &x0)
+    : J{J}, r0{r0}, x0{x0} {
+    this->set_num_residuals(static_cast<int>(r0.size()));
+    *this->mutable_parameter_block_sizes() = block_sizes;
+}
+
+bool MarginalizationPrior::Evaluate(double const *const *parameters,
+                                    double *residuals,
+                                    double **jacobians) const {
+    const auto &block_sizes = this->parameter_block_sizes();
+    const int nb_residuals = this->num_residuals();
+
+    // Tangent-space delta of each block from the linearization point
+    VecX delta{3 * block_sizes.size()};
+    int x_offset = 0;
+    for (size_t i = 0; i < block_sizes.size(); i++) {
+        if (block_sizes[i] == 4) {
+            const Eigen::Map<const Quaternion> q{parameters[i]};
+            const Eigen::Map<const Quaternion> q0{this->x0.data() + x_offset};
+            const Quaternion r = q0.conjugate();
+            const Quaternion dq = q * r;
+
+            // q and -q are the same rotation; use the delta nearest zero
+            const double sign = dq.w() < 0.0 ? -1.0 : 1.0;
+            delta.segment<3>(3 * i) = sign * dq.vec();
+
+            if (jacobians != NULL && jacobians[i] != NULL) {
+                Eigen::Map<Eigen::Matrix<double,
+                                         Eigen::Dynamic,
+                                         4,
+                                         Eigen::RowMajor>>
+                  J_i{jacobians[i], nb_residuals, 4};
+                J_i.noalias() = sign * this->J.middleCols<3>(3 * i) *
+                                quaternionDeltaJacobian(r);
+            }
+        } else {
+            const Eigen::Map<const Vec3> x{parameters[i]};
+            delta.segment<3>(3 * i) = x - this->x0.segment<3>(x_offset);
+
+            if (jacobians != NULL && jacobians[i] != NULL) {
+                Eigen::Map<Eigen::Matrix<double,
+                                         Eigen::Dynamic,
+                                         3,
+                                         Eigen::RowMajor>>
+                  J_i{jacobians[i], nb_residuals, 3};
+                J_i = this->J.middleCols<3>(3 * i);
+            }
+        }
+        x_offset += block_sizes[i];
+    }
+
+    Eigen::Map<VecX> r{residuals, nb_residuals};
+    r.noalias() = this->r0 + this->J * delta;
+
+    return true;
+}
+
+SlidingWindowBA::SlidingWindowBA(const Mat3 &K,
+                                 const SlidingWindowBAParams &params)
+    : params{params},
+      intrinsics{K(0, 0), K(1, 1), K(0, 2), K(1, 2)},
+      quat_param{new ceres::EigenQuaternionParameterization{}},
+      loss_function{makeLossFunction(params.solver.loss_type,
+                                     params.solver.loss_scale)},
+      problem{slidingWindowProblemOptions()} {
+    if (this->params.window_size < 2) {
+        LOG_ERROR("Invalid window size %d, using 2", params.window_size);
+        this->params.window_size = 2;
+    }
+
+    this->problem.AddParameterBlock(this->intrinsics.data(), 4);
+    this->problem.SetParameterBlockConstant(this->intrinsics.data());
+}
+
+int SlidingWindowBA::addKeyframe(
+  const Quaternion &q_GC,
+  const Vec3 &G_p_GC,
+  const std::vector<LandmarkObservation> &observations,
+  const LandmarkMap &initial_landmarks) {
+    if (static_cast<int>(this->keyframes.size()) >= this->params.window_size) {
+        this->marginalizeOldest();
+    }
+
+    const int id = this->next_keyframe_id++;
+    const bool constant = this->params.fix_first_keyframe && id == 0;
+    this->keyframes.push_back(
+      Keyframe{id, q_GC.normalized(), G_p_GC, constant, {}});
+    auto &keyframe = this->keyframes.back();
+
+    double *cam_q = keyframe.q_GC.coeffs().data();
+    double *cam_t = keyframe.G_p_GC.data();
+    this->problem.AddParameterBlock(cam_q, 4, this->quat_param.get());
+    this->problem.AddParameterBlock(cam_t, 3);
+    if (constant) {
+        this->problem.SetParameterBlockConstant(cam_q);
+        this->problem.SetParameterBlockConstant(cam_t);
+    }
+
+    keyframe.observations.reserve(observations.size());
+    for (const auto &observation : observations) {
+        auto landmark = this->landmarks.find(observation.first);
+        if (landmark == this->landmarks.end()) {
+            const auto initial = initial_landmarks.find(observation.first);
+            if (initial == initial_landmarks.end()) {
+                continue;
+            }
+            landmark =
+              this->landmarks
+                .emplace(observation.first, Landmark{initial->second, 0})
+                .first;
+            this->problem.AddParameterBlock(landmark->second.G_p_GF.data(),
+                                            3);
+        }
+
+        auto cost = new BAIntrinsicsResidual{observation.second};
+        const auto residual_id =
+          this->problem.AddResidualBlock(cost,
+                                         this->loss_function.get(),
+                                         cam_q,
+                                         cam_t,
+                                         landmark->second.G_p_GF.data(),
+                                         this->intrinsics.data());
+        keyframe.observations.push_back(
+          Observation{observation.first, residual_id, cost});
+        landmark->second.nb_observations++;
+    }
+
+    return id;
+}
+
+void SlidingWindowBA::marginalizeOldest() {
+    auto &oldest = this->keyframes.front();
+    double *cam_q = oldest.q_GC.coeffs().data();
+    double *cam_t = oldest.G_p_GC.data();
+
+    // Collect the residuals which leave the window: the observations of the
+    // oldest keyframe, and the previous prior
+    std::vector<RemovedResidual> removed;
+    removed.reserve(oldest.observations.size() + 1);
+    std::map<LandmarkId, int> nb_removed;
+    for (const auto &observation : oldest.observations) {
+        removed.push_back(RemovedResidual{
+          observation.residual_id,
+          observation.cost,
+          this->loss_function.get(),
+          {cam_q,
+           cam_t,
+           this->landmarks.at(observation.landmark_id).G_p_GF.data(),
+           this->intrinsics.data()}});
+        nb_removed[observation.landmark_id]++;
+    }
+    if (this->prior_id != nullptr) {
+        removed.push_back(RemovedResidual{
+          this->prior_id, this->prior_cost, nullptr, this->prior_blocks});
+    }
+
+    // Order the variables: those marginalized (the oldest pose, and landmarks
+    // not observed by any other keyframe) first, then those kept
+    std::vector<double *> marginalized_blocks;
+    if (!oldest.constant) {
+        marginalized_blocks.push_back(cam_q);
+        marginalized_blocks.push_back(cam_t);
+    }
+    std::vector<LandmarkId> marginalized_landmarks;
+    for (const auto &count : nb_removed) {
+        auto &landmark = this->landmarks.at(count.first);
+        if (landmark.nb_observations == count.second) {
+            marginalized_blocks.push_back(landmark.G_p_GF.data());
+            marginalized_landmarks.push_back(count.first);
+        }
+    }
+
+    std::map<double *, BlockIndex> index;
+    int size = 0;
+    for (double *block : marginalized_blocks) {
+        const int block_size = block == cam_q ? 4 : 3;
+        index[block] = BlockIndex{size, block_size};
+        size += 3;
+    }
+    const int nb_marginalized = size;
+
+    std::vector<double *> kept_blocks;
+    for (const auto &residual : removed) {
+        for (size_t i = 0; i < residual.blocks.size(); i++) {
+            double *block = residual.blocks[i];
+            // The oldest pose is either marginalized or constant, and the
+            // intrinsics are constant
+            if (index.count(block) != 0 || block == cam_q || block == cam_t ||
+                block == this->intrinsics.data()) {
+                continue;
+            }
+            index[block] =
+              BlockIndex{size, residual.cost->parameter_block_sizes()[i]};
+            kept_blocks.push_back(block);
+            size += 3;
+        }
+    }
+    const int nb_kept = size - nb_marginalized;
+
+    // Accumulate the Gauss-Newton system of the removed residuals at the
+    // current estimate, in the tangent space of each variable
+    MatX H = MatX::Zero(size, size);
+    VecX b = VecX::Zero(size);
+    for (const auto &residual : removed) {
+        const auto &block_sizes = residual.cost->parameter_block_sizes();
+        const int nb_residuals = residual.cost->num_residuals();
+        const size_t nb_blocks = block_sizes.size();
+
+        VecX r{nb_residuals};
+        std::vector<MatX> J_ambient(nb_blocks);
+        std::vector<double *> J_ptrs(nb_blocks, nullptr);
+        for (size_t i = 0; i < nb_blocks; i++) {
+            // Ceres expects row-major Jacobians; store the transpose. Those
+            // of blocks which are not variables are not needed.
+            if (index.count(residual.blocks[i]) != 0) {
+                J_ambient[i].resize(block_sizes[i], nb_residuals);
+                J_ptrs[i] = J_ambient[i].data();
+            }
+        }
+        residual.cost->Evaluate(
+          residual.blocks.data(), r.data(), J_ptrs.data());
+
+        // Weight by the robust loss, ignoring its second-order term
+        double w = 1.0;
+        if (residual.loss != nullptr) {
+            double rho[3];
+            residual.loss->Evaluate(r.squaredNorm(), rho);
+            w = std::sqrt(rho[1]);
+        }
+
+        MatX J = MatX::Zero(nb_residuals, size);
+        for (size_t i = 0; i < nb_blocks; i++) {
+            const auto it = index.find(residual.blocks[i]);
+            if (it == index.end()) {
+                continue;
+            }
+            const int offset = it->second.offset;
+            if (block_sizes[i] == 4) {
+                Eigen::Matrix<double, 4, 3, Eigen::RowMajor> J_plus;
+                this->quat_param->ComputeJacobian(residual.blocks[i],
+                                                  J_plus.data());
+                J.middleCols<3>(offset).noalias() =
+                  w * J_ambient[i].transpose() * J_plus;
+            } else {
+                J.middleCols<3>(offset) = w * J_ambient[i].transpose();
+            }
+        }
+
+        H.noalias() += J.transpose() * J;
+        b.noalias() += J.transpose() * (w * r);
+    }
+
+    // Remove the residuals, then the marginalized variables and the constant
+    // first keyframe, which no longer has residuals
+    for (const auto &residual : removed) {
+        this->problem.RemoveResidualBlock(residual.id);
+    }
+    this->prior_id = nullptr;
+    this->prior_cost = nullptr;
+    this->prior_blocks.clear();
+
+    for (double *block : marginalized_blocks) {
+        this->problem.RemoveParameterBlock(block);
+    }
+    if (oldest.constant) {
+        this->problem.RemoveParameterBlock(cam_q);
+        this->problem.RemoveParameterBlock(cam_t);
+    }
+    for (const auto &count : nb_removed) {
+        this->landmarks.at(count.first).nb_observations -= count.second;
+    }
+    for (const auto &id : marginalized_landmarks) {
+        this->landmarks.erase(id);
+    }
+    this->keyframes.pop_front();
+
+    if (nb_kept == 0) {
+        return;
+    }
+
+    // Schur complement onto the kept variables
+    const int m = nb_marginalized;
+    MatX H_prior = H.bottomRightCorner(nb_kept, nb_kept);
+    VecX b_prior = b.tail(nb_kept);
+    if (m > 0) {
+        const Eigen::SelfAdjointEigenSolver<MatX> saes{H.topLeftCorner(m, m)};
+        const VecX &S = saes.eigenvalues();
+        const double threshold = kMarginalizationEps * S.cwiseAbs().maxCoeff();
+        const VecX S_inv =
+          (S.array() > threshold).select(S.cwiseInverse(), 0.0);
+        const MatX H_mm_inv = saes.eigenvectors() * S_inv.asDiagonal() *
+                              saes.eigenvectors().transpose();
+
+        const MatX H_km_H_mm_inv =
+          H.bottomLeftCorner(nb_kept, m) * H_mm_inv;
+        H_prior.noalias() -= H_km_H_mm_inv * H.topRightCorner(m, nb_kept);
+        b_prior.noalias() -= H_km_H_mm_inv * b.head(m);
+    }
+
+    // Factor the prior information as J^T J, with J = S^(1/2) V^T, keeping
+    // only the directions it constrains
+    const Eigen::SelfAdjointEigenSolver<MatX> saes{H_prior};
+    const VecX &S = saes.eigenvalues();
+    const double threshold = kMarginalizationEps * S.cwiseAbs().maxCoeff();
+    std::vector<int> rank_indices;
+    for (int i = 0; i < S.size(); i++) {
+        if (S(i) > threshold) {
+            rank_indices.push_back(i);
+        }
+    }
+    if (rank_indices.empty()) {
+        return;
+    }
+
+    const int rank = static_cast<int>(rank_indices.size());
+    MatX J_prior{rank, nb_kept};
+    VecX r_prior{rank};
+    for (int i = 0; i < rank; i++) {
+        const double s = S(rank_indices[i]);
+        const auto v = saes.eigenvectors().col(rank_indices[i]);
+        J_prior.row(i) = std::sqrt(s) * v.transpose();
+        r_prior(i) = v.dot(b_prior) / std::sqrt(s);
+    }
+
+    std::vector<int> block_sizes;
+    int x_size = 0;
+    for (double *block : kept_blocks) {
+        block_sizes.push_back(index.at(block).size);
+        x_size += block_sizes.back();
+    }
+    VecX x0{x_size};
+    x_size = 0;
+    for (size_t i = 0; i < kept_blocks.size(); i++) {
+        x0.segment(x_size, block_sizes[i]) =
+          Eigen::Map<const VecX>{kept_blocks[i], block_sizes[i]};
+        x_size += block_sizes[i];
+    }
+
+    auto cost = new MarginalizationPrior{J_prior, r_prior, block_sizes, x0};
+    this->prior_id = this->problem.AddResidualBlock(cost, NULL, kept_blocks);
+    this->prior_cost = cost;
+    this->prior_blocks = kept_blocks;
+}
+
+int SlidingWindowBA::solve() {
+    setSolverOptions(this->params.solver, this->options);
+
+    ceres::Solve(this->options, &this->problem, &this->summary);
+    if (this->params.solver.print_full_report) {
+        LOG_INFO("%s", this->summary.FullReport().c_str());
+    }
+
+    return this->summary.IsSolutionUsable() ? 0 : -1;
+}
+
+bool SlidingWindowBA::getPose(int keyframe_id,
+                              Quaternion &q_GC,
+                              Vec3 &G_p_GC) const {
+    if (this->keyframes.empty()) {
+        return false;
+    }
+
+    // Keyframe ids are consecutive, oldest first
+    const int i = keyframe_id - this->keyframes.front().id;
+    if (i < 0 || i >= static_cast<int>(this->keyframes.size())) {
+        return false;
+    }
+
+    q_GC = this->keyframes[i].q_GC;
+    G_p_GC = this->keyframes[i].G_p_GC;
+    return true;
+}
+
+bool SlidingWindowBA::getLandmark(LandmarkId id, Vec3 &G_p_GF) const {
+    const auto landmark = this->landmarks.find(id);
+    if (landmark == this->landmarks.end()) {
+        return false;
+    }
+
+    G_p_GF = landmark->second.G_p_GF;
+    return true;
+}
+
+int SlidingWindowBA::numKeyframes() const {
+    return static_cast<int>(this->keyframes.size());
+}
+
+int SlidingWindowBA::numLandmarks() const {
+    return static_cast<int>(this->landmarks.size());
+}
+
+bool SlidingWindowBA::hasPrior() const {
+    return this->prior_id != nullptr;
+}
+
+const ceres::Solver::Summary &SlidingWindowBA::getSummary() const {
+    return this->summary;
+}
+
+}  // namespace wave
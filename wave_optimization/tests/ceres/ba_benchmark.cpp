@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/vision/dataset/VoDataset.hpp"
+#include "wave/optimization/ceres/ba.hpp"
+#include "wave/wave_benchmark.hpp"
+
+namespace wave {
+
+/** Generates a synthetic VO dataset, with the camera used in ba_test.cpp and
+ * the given number of landmarks. More landmarks give more observations per
+ * camera. */
+VoDataset makeDataset(int nb_landmarks) {
+    Mat3 K;
+    K << 554.25, 0.0, 320.0,  //
+      0.0, 554.25, 320.0,     //
+      0.0, 0.0, 1.0;          //
+
+    VoDatasetGenerator generator;
+    generator.camera = VoTestCamera{640, 640, K, 10.0};
+    generator.nb_landmarks = nb_landmarks;
+    generator.landmark_x_bounds = Vec2{-10.0, 10.0};
+    generator.landmark_y_bounds = Vec2{-10.0, 10.0};
+    generator.landmark_z_bounds = Vec2{-1.0, 1.0};
+
+    return generator.generate();
+}
+
+/** Initial estimates for a BA problem. The parameter blocks are stored here so
+ * that pointers to them stay valid for the lifetime of the problem. */
+struct BAEstimates {
+    std::vector<Vec3> G_p_GC;
+    std::vector<Quaternion> q_GC;
+    LandmarkMap landmarks;
+};
+
+/** Builds initial estimates by perturbing the ground truth, like ba_test.cpp */
+BAEstimates perturbedEstimates(const VoDataset &dataset) {
+    BAEstimates estimates;
+    const auto q_BC = Quaternion{Eigen::AngleAxisd(-M_PI_2, Vec3::UnitZ()) *
+                                 Eigen::AngleAxisd(-M_PI_2, Vec3::UnitX())};
+    const auto offset = Quaternion{Eigen::AngleAxisd{0.1, Vec3::UnitX()}};
+
+    for (const auto &state : dataset.states) {
+        estimates.G_p_GC.emplace_back(state.robot_G_p_GB +
+                                      Vec3{0.5, 0.1, -0.5});
+        estimates.q_GC.emplace_back(state.robot_q_GB * offset * q_BC);
+    }
+
+    estimates.landmarks = dataset.landmarks;
+    for (auto &l : estimates.landmarks) {
+        l.second += Vec3{0.3, -0.3, 0.3};
+    }
+
+    return estimates;
+}
+
+/** Makes a reprojection cost function of the given residual type */
+template <typename Residual>
+ceres::CostFunction *makeCost(const Mat3 &K, const Vec2 &x);
+
+template <>
+ceres::CostFunction *makeCost<BAResidual>(const Mat3 &K, const Vec2 &x) {
+    return new ceres::AutoDiffCostFunction<BAResidual, 2, 4, 3, 3>{
+      new BAResidual{K, x}};
+}
+
+template <>
+ceres::CostFunction *makeCost<BAAnalyticResidual>(const Mat3 &K,
+                                                  const Vec2 &x) {
+    return new BAAnalyticResidual{K, x};
+}
+
+/** Adds every observation in the dataset to the problem, using the given
+ * residual type. The first camera is held constant to fix the gauge. */
+template <typename Residual>
+void buildProblem(const VoDataset &dataset,
+                  BAEstimates &estimates,
+                  ceres::Problem &problem) {
+    for (size_t i = 0; i < dataset.states.size(); i++) {
+        auto cam_q = estimates.q_GC[i].coeffs().data();
+        auto cam_t = estimates.G_p_GC[i].data();
+
+        for (const auto &obs : dataset.states[i].features_observed) {
+            problem.AddResidualBlock(
+              makeCost<Residual>(dataset.camera_K, obs.second),
+              NULL,
+              cam_q,
+              cam_t,
+              estimates.landmarks.at(obs.first).data());
+        }
+
+        problem.SetParameterization(
+          cam_q, new ceres::EigenQuaternionParameterization{});
+    }
+
+    problem.SetParameterBlockConstant(estimates.q_GC[0].coeffs().data());
+    problem.SetParameterBlockConstant(estimates.G_p_GC[0].data());
+}
+
+/** Time evaluation of the residuals and full Jacobian of the problem */
+template <typename Residual>
+void BM_BAJacobianEval(benchmark::State &state) {
+    const auto dataset = makeDataset(state.range(0));
+    auto estimates = perturbedEstimates(dataset);
+    ceres::Problem problem;
+    buildProblem<Residual>(dataset, estimates, problem);
+
+    double cost;
+    ceres::CRSMatrix jacobian;
+    for (auto _ : state) {
+        problem.Evaluate(
+          ceres::Problem::EvaluateOptions{}, &cost, NULL, NULL, &jacobian);
+        benchmark::DoNotOptimize(cost);
+    }
+
+    state.SetItemsProcessed(state.iterations() * problem.NumResidualBlocks());
+    state.counters["residual_blocks"] = problem.NumResidualBlocks();
+}
+
+/** Time a full solve of the problem, starting from the perturbed estimates */
+template <typename Residual>
+void BM_BASolve(benchmark::State &state) {
+    const auto dataset = makeDataset(state.range(0));
+
+    ceres::Solver::Options options;
+    options.max_num_iterations = 50;
+    options.linear_solver_type = ceres::SPARSE_SCHUR;
+    options.preconditioner_type = ceres::SCHUR_JACOBI;
+    options.minimizer_progress_to_stdout = false;
+
+    ceres::Solver::Summary summary;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto estimates = perturbedEstimates(dataset);
+        ceres::Problem problem;
+        buildProblem<Residual>(dataset, estimates, problem);
+        state.ResumeTiming();
+
+        ceres::Solve(options, &problem, &summary);
+    }
+
+    state.counters["residual_blocks"] = summary.num_residual_blocks;
+    state.counters["iterations"] = summary.iterations.size();
+    state.counters["jacobian_eval_s"] =
+      summary.jacobian_evaluation_time_in_seconds;
+    state.counters["final_cost"] = summary.final_cost;
+}
+
+/** Adds every observation in the dataset to a BundleAdjustment problem. The
+ * first camera is held constant to fix the gauge. */
+void buildBundleAdjustment(const VoDataset &dataset,
+                           BAEstimates &estimates,
+                           BundleAdjustment &ba) {
+    for (size_t i = 0; i < dataset.states.size(); i++) {
+        const auto &observed = dataset.states[i].features_observed;
+        MatX features(observed.size(), 2);
+        std::vector<LandmarkId> landmark_ids(observed.size());
+        for (size_t j = 0; j < observed.size(); j++) {
+            features.row(j) = observed[j].second;
+            landmark_ids[j] = observed[j].first;
+        }
+
+        ba.addCamera(dataset.camera_K,
+                     features,
+                     landmark_ids,
+                     estimates.G_p_GC[i].data(),
+                     estimates.q_GC[i].coeffs().data(),
+                     estimates.landmarks);
+    }
+
+    ba.problem.SetParameterBlockConstant(estimates.q_GC[0].coeffs().data());
+    ba.problem.SetParameterBlockConstant(estimates.G_p_GC[0].data());
+}
+
+/** Time BundleAdjustment::solve() with the linear solver and number of
+ * threads given by the benchmark arguments */
+void BM_BASolverSettings(benchmark::State &state) {
+    const auto dataset = makeDataset(state.range(0));
+
+    BAParams params;
+    params.linear_solver = static_cast<BAParams::solver_type>(state.range(1));
+    params.num_threads = state.range(2);
+    params.max_num_iterations = 50;
+
+    const char *solver_names[] = {
+      "DENSE_SCHUR", "SPARSE_SCHUR", "ITERATIVE_SCHUR"};
+    state.SetLabel(solver_names[params.linear_solver]);
+
+    ceres::Solver::Summary summary;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto estimates = perturbedEstimates(dataset);
+        std::unique_ptr<BundleAdjustment> ba{new BundleAdjustment{params}};
+        buildBundleAdjustment(dataset, estimates, *ba);
+        state.ResumeTiming();
+
+        ba->solve();
+
+        state.PauseTiming();
+        summary = ba->summary;
+        ba.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["residual_blocks"] = summary.num_residual_blocks;
+    state.counters["iterations"] = summary.iterations.size();
+    state.counters["linear_solver_s"] = summary.linear_solver_time_in_seconds;
+    state.counters["final_cost"] = summary.final_cost;
+}
+
+/** Arguments for BM_BASolverSettings: problem size, solver and threads */
+void solverSettingsArgs(benchmark::internal::Benchmark *b) {
+    const int max_threads = BAParams{}.num_threads;
+    for (int nb_landmarks : {1000, 4000, 16000}) {
+        for (int solver = BAParams::solver_type::DENSE_SCHUR;
+             solver <= BAParams::solver_type::ITERATIVE_SCHUR;
+             solver++) {
+            for (int threads : {1, 4, max_threads}) {
+                b->Args({nb_landmarks, solver, threads});
+            }
+        }
+    }
+}
+
+/** Features of each camera in the dataset, with Gaussian noise added */
+std::vector<MatX> noisyFeatures(const VoDataset &dataset, int seed) {
+    std::mt19937 generator{static_cast<unsigned>(seed)};
+    std::normal_distribution<double> noise{0.0, 0.5};
+
+    std::vector<MatX> features;
+    for (const auto &state : dataset.states) {
+        const auto &observed = state.features_observed;
+        MatX f(observed.size(), 2);
+        for (size_t j = 0; j < observed.size(); j++) {
+            f(j, 0) = observed[j].second(0) + noise(generator);
+            f(j, 1) = observed[j].second(1) + noise(generator);
+        }
+        features.push_back(f);
+    }
+    return features;
+}
+
+/** Time repeated solves of the same structure with new measurements each
+ * time, from the same initial estimates. If `reuse` is true, one
+ * BundleAdjustment is kept and only its features are updated; otherwise the
+ * problem is built from scratch every time, and the build is timed too. */
+void BM_BARepeatedSolve(benchmark::State &state, bool reuse) {
+    const auto dataset = makeDataset(state.range(0));
+    const auto initial = perturbedEstimates(dataset);
+    std::vector<std::vector<MatX>> measurements;
+    for (int seed = 0; seed < 4; seed++) {
+        measurements.push_back(noisyFeatures(dataset, seed));
+    }
+
+    BAParams params;
+    params.max_num_iterations = 20;
+
+    auto estimates = initial;
+    std::unique_ptr<BundleAdjustment> ba;
+    if (reuse) {
+        ba.reset(new BundleAdjustment{params});
+        buildBundleAdjustment(dataset, estimates, *ba);
+    }
+
+    double preprocessor_time = 0.0;
+    size_t k = 0;
+    for (auto _ : state) {
+        const auto &features = measurements[k++ % measurements.size()];
+
+        // Reset the parameter blocks in place, keeping their addresses
+        state.PauseTiming();
+        estimates.G_p_GC = initial.G_p_GC;
+        estimates.q_GC = initial.q_GC;
+        for (auto &l : estimates.landmarks) {
+            l.second = initial.landmarks.at(l.first);
+        }
+        if (!reuse) {
+            ba.reset();
+        }
+        state.ResumeTiming();
+
+        if (reuse) {
+            for (size_t i = 0; i < features.size(); i++) {
+                ba->updateFeatures(estimates.q_GC[i].coeffs().data(),
+                                   features[i]);
+            }
+        } else {
+            // Set the same noisy features as the reuse path
+            ba.reset(new BundleAdjustment{params});
+            buildBundleAdjustment(dataset, estimates, *ba);
+            for (size_t i = 0; i < features.size(); i++) {
+                ba->updateFeatures(estimates.q_GC[i].coeffs().data(),
+                                   features[i]);
+            }
+        }
+
+        ba->solve();
+        preprocessor_time += ba->summary.preprocessor_time_in_seconds;
+    }
+
+    state.counters["residual_blocks"] = ba->summary.num_residual_blocks;
+    state.counters["preprocessor_ms"] =
+      1e3 * preprocessor_time / static_cast<double>(state.iterations());
+    state.counters["final_cost"] = ba->summary.final_cost;
+}
+
+/** Time recovery of the covariances of every camera pose after a solve,
+ * with the algorithm given by the second benchmark argument */
+void BM_BACovariance(benchmark::State &state) {
+    const auto dataset = makeDataset(state.range(0));
+    auto estimates = perturbedEstimates(dataset);
+    BundleAdjustment ba;
+    buildBundleAdjustment(dataset, estimates, ba);
+    ba.solve();
+
+    CovarianceParams params;
+    params.algorithm =
+      static_cast<CovarianceParams::algorithm_type>(state.range(1));
+    const char *algorithm_names[] = {"SCHUR", "SPARSE_QR", "SUITE_SPARSE_QR"};
+    state.SetLabel(algorithm_names[params.algorithm]);
+
+    std::vector<double *> cam_q;
+    std::vector<double *> cam_t;
+    for (size_t i = 0; i < dataset.states.size(); i++) {
+        cam_q.push_back(estimates.q_GC[i].coeffs().data());
+        cam_t.push_back(estimates.G_p_GC[i].data());
+    }
+
+    PoseCovarianceVector poses;
+    for (auto _ : state) {
+        if (ba.computePoseCovariances(cam_q, cam_t, poses, params) != 0) {
+            state.SkipWithError("Covariance could not be computed");
+            break;
+        }
+    }
+
+    state.counters["poses"] = cam_q.size();
+    state.counters["residual_blocks"] = ba.problem.NumResidualBlocks();
+}
+
+/** Arguments for BM_BACovariance: problem size and algorithm */
+void covarianceArgs(benchmark::internal::Benchmark *b) {
+    for (int nb_landmarks : {1000, 4000, 16000}) {
+        b->Args({nb_landmarks, CovarianceParams::algorithm_type::SCHUR});
+        b->Args({nb_landmarks, CovarianceParams::algorithm_type::SPARSE_QR});
+    }
+}
+
+/** Observations for benchmarking problem construction. Only the structure of
+ * the problem matters here, so the measurements are random. */
+struct SyntheticObservations {
+    Mat3 K;
+    std::vector<Vec3> G_p_GC;
+    std::vector<Quaternion> q_GC;
+    LandmarkMap landmarks;
+    std::vector<MatX> features;
+    std::vector<std::vector<LandmarkId>> landmark_ids;
+};
+
+/** Makes cameras with 1000 observations each, with each landmark observed by
+ * about 10 cameras */
+SyntheticObservations makeObservations(int nb_observations) {
+    const int per_camera = 1000;
+    const int nb_cameras = nb_observations / per_camera;
+    const int nb_landmarks = nb_observations / 10;
+
+    SyntheticObservations obs;
+    obs.K << 554.25, 0.0, 320.0,  //
+      0.0, 554.25, 320.0,         //
+      0.0, 0.0, 1.0;              //
+    obs.G_p_GC.resize(nb_cameras, Vec3::Zero());
+    obs.q_GC.resize(nb_cameras, Quaternion::Identity());
+    for (int i = 0; i < nb_landmarks; i++) {
+        obs.landmarks[i] = Vec3::Random();
+    }
+    for (int c = 0; c < nb_cameras; c++) {
+        MatX features = MatX::Random(per_camera, 2);
+        obs.features.emplace_back((320.0 * (features.array() + 1.0)).matrix());
+
+        std::vector<LandmarkId> ids(per_camera);
+        for (int j = 0; j < per_camera; j++) {
+            ids[j] = (c * per_camera / 10 + j) % nb_landmarks;
+        }
+        obs.landmark_ids.push_back(ids);
+    }
+    return obs;
+}
+
+/** Builds a problem the way BundleAdjustment did before sharing intrinsics and
+ * parameterizations: each residual stores its own copy of K and each camera
+ * gets its own parameterization, owned by the problem. */
+void buildUnsharedProblem(SyntheticObservations &obs, ceres::Problem &problem) {
+    for (size_t c = 0; c < obs.features.size(); c++) {
+        auto cam_q = obs.q_GC[c].coeffs().data();
+        for (int i = 0; i < obs.features[c].rows(); i++) {
+            Vec2 feature{obs.features[c](i, 0), obs.features[c](i, 1)};
+            problem.AddResidualBlock(
+              new BAAnalyticResidual{obs.K, feature},
+              NULL,
+              cam_q,
+              obs.G_p_GC[c].data(),
+              obs.landmarks.at(obs.landmark_ids[c][i]).data());
+        }
+        problem.SetParameterization(
+          cam_q, new ceres::EigenQuaternionParameterization{});
+    }
+}
+
+/** Builds the problem with BundleAdjustment, sharing intrinsics and
+ * parameterization objects */
+void buildSharedProblem(SyntheticObservations &obs, BundleAdjustment &ba) {
+    const int camera_id = ba.addIntrinsics(obs.K);
+    for (size_t c = 0; c < obs.features.size(); c++) {
+        ba.addCamera(camera_id,
+                     obs.features[c],
+                     obs.landmark_ids[c],
+                     obs.G_p_GC[c].data(),
+                     obs.q_GC[c].coeffs().data(),
+                     obs.landmarks);
+    }
+}
+
+/** Time construction of the problem and measure the memory it uses */
+void BM_BABuildUnshared(benchmark::State &state) {
+    auto obs = makeObservations(state.range(0));
+    long memory = 0;
+
+    for (auto _ : state) {
+        const auto before = residentMemory();
+        std::unique_ptr<ceres::Problem> problem{new ceres::Problem};
+        buildUnsharedProblem(obs, *problem);
+        state.PauseTiming();
+        memory = std::max(memory, residentMemory() - before);
+        problem.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["memory_MB"] = memory / 1e6;
+}
+
+/** Time construction of the problem and measure the memory it uses */
+void BM_BABuildShared(benchmark::State &state) {
+    auto obs = makeObservations(state.range(0));
+    long memory = 0;
+
+    for (auto _ : state) {
+        const auto before = residentMemory();
+        std::unique_ptr<BundleAdjustment> ba{new BundleAdjustment};
+        buildSharedProblem(obs, *ba);
+        state.PauseTiming();
+        memory = std::max(memory, residentMemory() - before);
+        ba.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["memory_MB"] = memory / 1e6;
+}
+
+BENCHMARK_TEMPLATE(BM_BAJacobianEval, BAResidual)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BAJacobianEval, BAAnalyticResidual)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_BASolve, BAResidual)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BASolve, BAAnalyticResidual)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_BASolverSettings)
+  ->Apply(solverSettingsArgs)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_BARepeatedSolve, rebuild, false)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_BARepeatedSolve, reuse, true)
+  ->RangeMultiplier(4)
+  ->Range(1000, 16000)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_BACovariance)
+  ->Apply(covarianceArgs)
+  ->Unit(benchmark::kMillisecond);
+
+// Up to ~1M observations
+BENCHMARK(BM_BABuildUnshared)
+  ->RangeMultiplier(4)
+  ->Range(1 << 16, 1 << 20)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BABuildShared)
+  ->RangeMultiplier(4)
+  ->Range(1 << 16, 1 << 20)
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
@@ -6,6 +6,7 @@
 namespace wave {
 
 const std::string TEST_CONFIG = "tests/data/vo_test.yaml";
+const std::string BA_TEST_CONFIG = "tests/data/ba_test.yaml";
 
 static std::vector<LandmarkId> build_landmark_ids(
   const std::vector<LandmarkObservation> &features_observed) {
@@ -31,6 +32,28 @@ static MatX build_feature_matrix(
     return features;
 }
 
+TEST(BAParams, constructor) {
+    BAParams params{BA_TEST_CONFIG};
+
+    EXPECT_EQ(BAParams::solver_type::ITERATIVE_SCHUR, params.linear_solver);
+    EXPECT_EQ(BAParams::preconditioner_type::JACOBI, params.preconditioner);
+    EXPECT_EQ(4, params.num_threads);
+    EXPECT_EQ(50, params.max_num_iterations);
+    EXPECT_DOUBLE_EQ(1e-8, params.function_tolerance);
+    EXPECT_DOUBLE_EQ(1e-9, params.gradient_tolerance);
+    EXPECT_DOUBLE_EQ(1e-7, params.parameter_tolerance);
+    EXPECT_FALSE(params.use_inner_iterations);
+    EXPECT_EQ(BALossType::Cauchy, params.loss_type);
+    EXPECT_DOUBLE_EQ(2.0, params.loss_scale);
+    EXPECT_FALSE(params.minimizer_progress_to_stdout);
+    EXPECT_TRUE(params.print_full_report);
+
+    EXPECT_THROW(BAParams{"not_a_file.yaml"}, std::runtime_error);
+
+    // Default thread count comes from the hardware
+    EXPECT_GE(BAParams{}.num_threads, 1);
+}
+
 TEST(BAResidual, constructor) {
     // TEST DEFAULT CONSTRUCTOR
     BAResidual residual1;
@@ -93,15 +116,161 @@ TEST(BAResidual, testResidual) {
     EXPECT_NEAR(0.0, e[1], 0.0001);
 }
 
-TEST(BundleAdjustment, solve) {
+TEST(BAAnalyticResidual, matchesAutoDiff) {
+    Mat3 K;
+    K << 554.25, 0.0, 320.0,  //
+      0.0, 554.25, 320.0,     //
+      0.0, 0.0, 1.0;          //
+    const Vec2 x = Vec2{130, 62};
+
+    BAAnalyticResidual analytic{K, x};
+    ceres::AutoDiffCostFunction<BAResidual, 2, 4, 3, 3> autodiff{
+      new BAResidual{K, x}};
+
+    for (int trial = 0; trial < 10; trial++) {
+        // Random camera pose looking roughly at a random landmark
+        Quaternion q_GC{Eigen::AngleAxisd{0.5, Vec3::Random().normalized()}};
+        Vec3 G_p_GC = Vec3::Random();
+        Vec3 G_p_GF = G_p_GC + q_GC * (Vec3{0, 0, 10} + Vec3::Random());
+        const double *params[] = {
+          q_GC.coeffs().data(), G_p_GC.data(), G_p_GF.data()};
+
+        // Ceres expects row-major Jacobians
+        using Mat2x4 = Eigen::Matrix<double, 2, 4, Eigen::RowMajor>;
+        using Mat2x3 = Eigen::Matrix<double, 2, 3, Eigen::RowMajor>;
+
+        Vec2 e_analytic, e_autodiff;
+        Mat2x4 J_q_analytic, J_q_autodiff;
+        Mat2x3 J_t_analytic, J_t_autodiff;
+        Mat2x3 J_f_analytic, J_f_autodiff;
+        double *J_analytic[] = {
+          J_q_analytic.data(), J_t_analytic.data(), J_f_analytic.data()};
+        double *J_autodiff[] = {
+          J_q_autodiff.data(), J_t_autodiff.data(), J_f_autodiff.data()};
+
+        ASSERT_TRUE(analytic.Evaluate(params, e_analytic.data(), J_analytic));
+        ASSERT_TRUE(autodiff.Evaluate(params, e_autodiff.data(), J_autodiff));
+
+        EXPECT_PRED3(VectorsNearPrec, e_autodiff, e_analytic, 1e-9);
+        EXPECT_PRED3(MatricesNearPrec, J_q_autodiff, J_q_analytic, 1e-6);
+        EXPECT_PRED3(MatricesNearPrec, J_t_autodiff, J_t_analytic, 1e-6);
+        EXPECT_PRED3(MatricesNearPrec, J_f_autodiff, J_f_analytic, 1e-6);
+
+        // Residual only, and partial Jacobians, must also work
+        Vec2 e_only;
+        ASSERT_TRUE(analytic.Evaluate(params, e_only.data(), nullptr));
+        EXPECT_PRED3(VectorsNearPrec, e_autodiff, e_only, 1e-9);
+
+        double *J_landmark_only[] = {nullptr, nullptr, J_f_analytic.data()};
+        ASSERT_TRUE(
+          analytic.Evaluate(params, e_only.data(), J_landmark_only));
+        EXPECT_PRED3(MatricesNearPrec, J_f_autodiff, J_f_analytic, 1e-6);
+    }
+}
+
+TEST(BAIntrinsicsResidual, matchesAnalytic) {
+    Mat3 K;
+    K << 554.25, 0.0, 320.0,  //
+      0.0, 550.0, 310.0,      //
+      0.0, 0.0, 1.0;          //
+    Vec4 intrinsics{K(0, 0), K(1, 1), K(0, 2), K(1, 2)};
+    const Vec2 x = Vec2{130, 62};
+
+    BAAnalyticResidual analytic{K, x};
+    BAIntrinsicsResidual with_intrinsics{x};
+
+    Quaternion q_GC{Eigen::AngleAxisd{0.5, Vec3::Random().normalized()}};
+    Vec3 G_p_GC = Vec3::Random();
+    Vec3 G_p_GF = G_p_GC + q_GC * (Vec3{0, 0, 10} + Vec3::Random());
+    const double *params[] = {
+      q_GC.coeffs().data(), G_p_GC.data(), G_p_GF.data(), intrinsics.data()};
+
+    using Mat2x4 = Eigen::Matrix<double, 2, 4, Eigen::RowMajor>;
+    using Mat2x3 = Eigen::Matrix<double, 2, 3, Eigen::RowMajor>;
+    Vec2 e_analytic, e_intrinsics;
+    Mat2x4 J_q_analytic, J_q, J_k;
+    Mat2x3 J_t_analytic, J_t, J_f_analytic, J_f;
+    double *J_analytic[] = {
+      J_q_analytic.data(), J_t_analytic.data(), J_f_analytic.data()};
+    double *J_intrinsics[] = {J_q.data(), J_t.data(), J_f.data(), J_k.data()};
+
+    ASSERT_TRUE(analytic.Evaluate(params, e_analytic.data(), J_analytic));
+    ASSERT_TRUE(
+      with_intrinsics.Evaluate(params, e_intrinsics.data(), J_intrinsics));
+
+    // Central differences with respect to the intrinsics
+    Mat2x4 J_k_numeric;
+    const double h = 1e-6;
+    for (int i = 0; i < 4; i++) {
+        Vec2 e_plus, e_minus;
+        intrinsics(i) += h;
+        with_intrinsics.Evaluate(params, e_plus.data(), nullptr);
+        intrinsics(i) -= 2 * h;
+        with_intrinsics.Evaluate(params, e_minus.data(), nullptr);
+        intrinsics(i) += h;
+        J_k_numeric.col(i) = (e_plus - e_minus) / (2 * h);
+    }
+
+    // Same residual and pose / landmark Jacobians as BAAnalyticResidual
+    EXPECT_PRED3(VectorsNearPrec, e_analytic, e_intrinsics, 1e-12);
+    EXPECT_PRED3(MatricesNearPrec, J_q_analytic, J_q, 1e-12);
+    EXPECT_PRED3(MatricesNearPrec, J_t_analytic, J_t, 1e-12);
+    EXPECT_PRED3(MatricesNearPrec, J_f_analytic, J_f, 1e-12);
+
+    // Intrinsics Jacobian checked numerically
+    EXPECT_PRED3(MatricesNearPrec, J_k_numeric, J_k, 1e-6);
+}
+
+TEST(BundleAdjustment, sharesIntrinsics) {
+    Mat3 K1 = Mat3::Identity();
+    Mat3 K2 = 2 * Mat3::Identity();
+    K2(2, 2) = 1.0;
+
+    BAParams params;
+    params.loss_type = BALossType::Huber;
+    BundleAdjustment ba{params};
+    LandmarkMap landmarks{{0, Vec3{0, 0, 10}}, {1, Vec3{1, 1, 10}}};
+    std::vector<LandmarkId> ids{0, 1};
+    MatX features(2, 2);
+    features << 0, 0,  //
+      0.1, 0.1;
+
+    std::vector<Vec3> t(3, Vec3::Zero());
+    std::vector<Quaternion> q(3, Quaternion::Identity());
+    for (int i = 0; i < 3; i++) {
+        const Mat3 &K = (i < 2) ? K1 : K2;
+        ba.addCamera(
+          K, features, ids, t[i].data(), q[i].coeffs().data(), landmarks);
+    }
+
+    // 3 poses of 2 blocks, 2 landmarks, and one intrinsics block per K
+    EXPECT_EQ(3 * 2 + 2 + 2, ba.problem.NumParameterBlocks());
+    EXPECT_EQ(6, ba.problem.NumResidualBlocks());
+    EXPECT_PRED2(MatricesNear, K1, ba.getIntrinsics(0));
+    EXPECT_PRED2(MatricesNear, K2, ba.getIntrinsics(1));
+
+    // Explicitly added intrinsics get their own block, even if K is the same
+    auto id = ba.addIntrinsics(K1, true);
+    EXPECT_EQ(2, id);
+    EXPECT_EQ(3 * 2 + 2 + 3, ba.problem.NumParameterBlocks());
+
+    // Invalid camera ids are rejected
+    auto retval = ba.addCamera(
+      3, features, ids, t[0].data(), q[0].coeffs().data(), landmarks);
+    EXPECT_EQ(-1, retval);
+}
+
+/** Builds a BA problem from the test dataset, solves it, and checks the
+ * result is close to the ground truth
+ *
+ * If `contiguous` is true, the landmarks are stored in `ba`, and all cameras
+ * are added at once. */
+static void checkSolve(BundleAdjustment &ba, bool contiguous = false) {
     // create vo dataset
     VoDatasetGenerator generator;
     generator.configure(TEST_CONFIG);
     auto dataset = generator.generate();
 
-    // build bundle adjustment problem
-    BundleAdjustment ba;
-
     // We'll keep the parameters in a vector for now.
     // Note we have to pre-allocate the vector, so that pointers to the elements
     // don't change as we insert.
@@ -114,6 +283,13 @@ TEST(BundleAdjustment, solve) {
         l.second += Vec3{0.3, -0.3, 0.3};
     }
 
+    const int camera_id = ba.addIntrinsics(dataset.camera_K);
+    std::vector<MatX> all_features;
+    std::vector<std::vector<LandmarkId>> all_landmark_ids;
+    if (contiguous) {
+        ASSERT_EQ(0, ba.setLandmarks(params_landmarks));
+    }
+
     // Add pose parameters
     for (size_t i = 0; i < dataset.states.size(); i++) {
         // translation
@@ -144,25 +320,76 @@ TEST(BundleAdjustment, solve) {
           build_landmark_ids(dataset.states[i].features_observed);
         MatX features =
           build_feature_matrix(dataset.states[i].features_observed);
-        ba.addCamera(dataset.camera_K,
-                     features,
-                     landmark_ids,
-                     params_G_p_GC[i].data(),
-                     params_q_GC[i].coeffs().data(),
-                     params_landmarks);
+        if (contiguous) {
+            all_features.push_back(features);
+            all_landmark_ids.push_back(landmark_ids);
+        } else {
+            ba.addCamera(camera_id,
+                         features,
+                         landmark_ids,
+                         params_G_p_GC[i].data(),
+                         params_q_GC[i].coeffs().data(),
+                         params_landmarks);
+        }
 
         // Set a prior on first pose
         if (i == 0 || i == 1) {
             params_G_p_GC[i] = true_G_p_GC;
             params_q_GC[i] = initial_q_GB * q_BC;
-            ba.problem.SetParameterBlockConstant(params_G_p_GC[i].data());
-            ba.problem.SetParameterBlockConstant(
-              params_q_GC[i].coeffs().data());
         }
     }
 
+    if (contiguous) {
+        std::vector<int> camera_ids(dataset.states.size(), camera_id);
+        std::vector<double *> cam_t;
+        std::vector<double *> cam_q;
+        for (size_t i = 0; i < dataset.states.size(); i++) {
+            cam_t.push_back(params_G_p_GC[i].data());
+            cam_q.push_back(params_q_GC[i].coeffs().data());
+        }
+        ASSERT_EQ(
+          0,
+          ba.addCameras(
+            camera_ids, all_features, all_landmark_ids, cam_t, cam_q));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        ba.problem.SetParameterBlockConstant(params_G_p_GC[i].data());
+        ba.problem.SetParameterBlockConstant(params_q_GC[i].coeffs().data());
+    }
+
     // test
     ba.solve();
+    if (contiguous) {
+        ba.getLandmarks(params_landmarks);
+    }
+
+    // Landmarks are eliminated first: group 0 holds exactly the landmark
+    // blocks, and the optimized camera poses are in group 1
+    ASSERT_TRUE(ba.options.linear_solver_ordering != nullptr);
+    const auto &ordering = *ba.options.linear_solver_ordering;
+    const auto &groups = ordering.group_to_elements();
+    ASSERT_EQ(1u, groups.count(0));
+    const auto &eliminated = groups.at(0);
+    const int nb_states = static_cast<int>(dataset.states.size());
+    const int nb_landmarks =
+      ba.problem.NumParameterBlocks() - 2 * nb_states - 1;
+    EXPECT_EQ(nb_landmarks, static_cast<int>(eliminated.size()));
+    for (double *block : eliminated) {
+        // Not a camera position, all of which are in `params_G_p_GC`
+        EXPECT_EQ(3, ba.problem.ParameterBlockSize(block));
+        EXPECT_FALSE(block >= params_G_p_GC.front().data() &&
+                     block <= params_G_p_GC.back().data());
+    }
+    for (int i = 2; i < nb_states; i++) {
+        EXPECT_EQ(1, ordering.GroupId(params_q_GC[i].coeffs().data()));
+        EXPECT_EQ(1, ordering.GroupId(params_G_p_GC[i].data()));
+    }
+    if (contiguous) {
+        // One column of the landmark matrix each, in a single allocation
+        EXPECT_EQ(3 * (nb_landmarks - 1),
+                  *eliminated.rbegin() - *eliminated.begin());
+    }
 
     for (auto i = 0u; i < dataset.states.size(); i++) {
         // Note: we gave the camera pose, not the robot pose, to the optimizer
@@ -190,4 +417,147 @@ TEST(BundleAdjustment, solve) {
     }
 }
 
+TEST(BundleAdjustment, solve) {
+    BundleAdjustment ba;
+    checkSolve(ba);
+}
+
+TEST(BundleAdjustment, solveContiguousLandmarks) {
+    BundleAdjustment ba;
+    checkSolve(ba, true);
+}
+
+TEST(BundleAdjustment, setLandmarks) {
+    BundleAdjustment ba;
+    const int camera_id = ba.addIntrinsics(Mat3::Identity());
+    LandmarkMap landmarks{{3, Vec3{0, 0, 10}}, {7, Vec3{1, 1, 10}}};
+    ASSERT_EQ(0, ba.setLandmarks(landmarks));
+    EXPECT_EQ(1 + 2, ba.problem.NumParameterBlocks());
+
+    // Landmarks can only be set once
+    EXPECT_EQ(-1, ba.setLandmarks(landmarks));
+
+    Vec3 G_p_GF;
+    ASSERT_TRUE(ba.getLandmark(7, G_p_GF));
+    EXPECT_PRED2(VectorsNear, landmarks.at(7), G_p_GF);
+    EXPECT_FALSE(ba.getLandmark(5, G_p_GF));
+
+    // Observations of unknown landmarks are rejected, adding nothing
+    Vec3 t = Vec3::Zero();
+    Quaternion q = Quaternion::Identity();
+    MatX features(2, 2);
+    features << 0, 0,  //
+      0.1, 0.1;
+    auto retval = ba.addCamera(
+      camera_id, features, {3, 5}, t.data(), q.coeffs().data());
+    EXPECT_EQ(-1, retval);
+    EXPECT_EQ(0, ba.problem.NumResidualBlocks());
+
+    retval = ba.addCamera(
+      camera_id, features, {3, 7}, t.data(), q.coeffs().data());
+    EXPECT_EQ(0, retval);
+    EXPECT_EQ(2, ba.problem.NumResidualBlocks());
+    EXPECT_EQ(1 + 2 + 2, ba.problem.NumParameterBlocks());
+}
+
+TEST(BundleAdjustment, updateFeatures) {
+    BundleAdjustment ba;
+    const int camera_id = ba.addIntrinsics(Mat3::Identity());
+    LandmarkMap landmarks{{3, Vec3{0, 0, 10}}, {7, Vec3{1, 1, 10}}};
+    ASSERT_EQ(0, ba.setLandmarks(landmarks));
+
+    // The features are the exact projections of the landmarks
+    Vec3 t = Vec3::Zero();
+    Quaternion q = Quaternion::Identity();
+    MatX features(2, 2);
+    features << 0, 0,  //
+      0.1, 0.1;
+    auto retval = ba.addCamera(
+      camera_id, features, {3, 7}, t.data(), q.coeffs().data());
+    ASSERT_EQ(0, retval);
+
+    double cost;
+    ba.problem.Evaluate(
+      ceres::Problem::EvaluateOptions{}, &cost, NULL, NULL, NULL);
+    EXPECT_NEAR(0.0, cost, 1e-12);
+
+    // Move the first feature; the structure of the problem does not change
+    features(0, 0) = 0.1;
+    ASSERT_EQ(0, ba.updateFeatures(q.coeffs().data(), features));
+    EXPECT_EQ(2, ba.problem.NumResidualBlocks());
+    ba.problem.Evaluate(
+      ceres::Problem::EvaluateOptions{}, &cost, NULL, NULL, NULL);
+    EXPECT_NEAR(0.5 * 0.1 * 0.1, cost, 1e-12);
+
+    // Moving the landmark to match brings the cost back to zero
+    ASSERT_EQ(0, ba.setLandmark(3, Vec3{1, 0, 10}));
+    ba.problem.Evaluate(
+      ceres::Problem::EvaluateOptions{}, &cost, NULL, NULL, NULL);
+    EXPECT_NEAR(0.0, cost, 1e-12);
+
+    // Unknown poses and landmarks, or wrong numbers of features, are rejected
+    Quaternion other_q = Quaternion::Identity();
+    EXPECT_EQ(-1, ba.updateFeatures(other_q.coeffs().data(), features));
+    EXPECT_EQ(-1, ba.updateFeatures(q.coeffs().data(), MatX::Zero(3, 2)));
+    EXPECT_EQ(-1, ba.setLandmark(5, Vec3::Zero()));
+}
+
+TEST(BundleAdjustment, lossChangedBeforeSolve) {
+    BundleAdjustment ba;
+    const int camera_id = ba.addIntrinsics(Mat3::Identity());
+    ASSERT_EQ(0, ba.setLandmarks(LandmarkMap{{0, Vec3{0, 0, 1}}}));
+
+    // A residual of 10 pixels, with only the initial cost evaluated
+    Vec3 t = Vec3::Zero();
+    Quaternion q = Quaternion::Identity();
+    MatX features(1, 2);
+    features << 10, 0;
+    ASSERT_EQ(
+      0, ba.addCamera(camera_id, features, {0}, t.data(), q.coeffs().data()));
+    ba.params.max_num_iterations = 0;
+    ba.params.use_inner_iterations = false;
+    ASSERT_EQ(0, ba.solve());
+    EXPECT_NEAR(0.5 * 10 * 10, ba.summary.initial_cost, 1e-9);
+
+    // The loss set after construction applies to the next solve
+    ba.params.loss_type = BALossType::Huber;
+    ba.params.loss_scale = 1.0;
+    ASSERT_EQ(0, ba.solve());
+    EXPECT_NEAR(0.5 * (2 * 10 - 1), ba.summary.initial_cost, 1e-9);
+
+    ba.params.loss_type = BALossType::None;
+    ASSERT_EQ(0, ba.solve());
+    EXPECT_NEAR(0.5 * 10 * 10, ba.summary.initial_cost, 1e-9);
+}
+
+TEST(BundleAdjustment, solveHuberLoss) {
+    BAParams params;
+    params.loss_type = BALossType::Huber;
+    BundleAdjustment ba{params};
+    checkSolve(ba);
+}
+
+TEST(BundleAdjustment, solveCauchyLoss) {
+    BAParams params;
+    params.loss_type = BALossType::Cauchy;
+    BundleAdjustment ba{params};
+    checkSolve(ba);
+}
+
+TEST(BundleAdjustment, solveDenseSchur) {
+    BAParams params;
+    params.linear_solver = BAParams::solver_type::DENSE_SCHUR;
+    params.num_threads = 1;
+    BundleAdjustment ba{params};
+    checkSolve(ba);
+}
+
+TEST(BundleAdjustment, solveIterativeSchur) {
+    BAParams params;
+    params.linear_solver = BAParams::solver_type::ITERATIVE_SCHUR;
+    params.preconditioner = BAParams::preconditioner_type::SCHUR_JACOBI;
+    BundleAdjustment ba{params};
+    checkSolve(ba);
+}
+
 }  // namespace wave
@@ -0,0 +1,237 @@
+/** @file
+ * Large-scale bundle adjustment benchmark.
+ *
+ * Usage: wave_optimization_bal_benchmark [benchmark flags] [BAL files...]
+ *
+ * Each BAL file given (e.g. from the "Bundle Adjustment in the Large" dataset)
+ * is loaded, built into a BundleAdjustment problem and solved. If no files are
+ * given, synthetic problems of increasing size are used instead.
+ *
+ * Each problem is also solved with a baseline that leaves the elimination
+ * order to Ceres, with residuals added per camera and landmarks in a map.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/optimization/ceres/bal_problem.hpp"
+
+namespace wave {
+
+/** Generate a BAL problem with cameras on a ring, looking at points in a cube
+ * at its centre. Each point is observed by `nb_views` random cameras. The
+ * initial estimates are perturbed from the ground truth. */
+BALProblem makeSyntheticBAL(int nb_cameras, int nb_points, int nb_views = 8) {
+    BALProblem problem;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> noise{0.0, 1.0};
+    std::uniform_real_distribution<double> cube{-2.0, 2.0};
+    const double f = 500.0;
+
+    // Rotation from the BundleAdjustment camera frame to the BAL one
+    const Mat3 R_BC = Vec3{1.0, -1.0, -1.0}.asDiagonal();
+
+    std::vector<Mat3> R_BG;
+    std::vector<Vec3> B_p_BG;
+    for (int i = 0; i < nb_cameras; i++) {
+        const double angle = 2 * M_PI * i / nb_cameras;
+        const Vec3 G_p_GC{10 * std::cos(angle), 10 * std::sin(angle), 1.0};
+
+        // Look at the origin, with y down
+        Mat3 R_GC;
+        R_GC.col(2) = -G_p_GC.normalized();
+        R_GC.col(0) = R_GC.col(2).cross(Vec3::UnitZ()).normalized();
+        R_GC.col(1) = R_GC.col(2).cross(R_GC.col(0));
+
+        R_BG.push_back(R_BC * R_GC.transpose());
+        B_p_BG.push_back(-R_BG.back() * G_p_GC);
+    }
+
+    std::vector<int> camera_indices(nb_cameras);
+    std::iota(camera_indices.begin(), camera_indices.end(), 0);
+    for (int j = 0; j < nb_points; j++) {
+        const Vec3 X{cube(generator), cube(generator), cube(generator)};
+        problem.points.push_back(X + 0.05 * Vec3{noise(generator),
+                                                 noise(generator),
+                                                 noise(generator)});
+
+        std::shuffle(camera_indices.begin(), camera_indices.end(), generator);
+        for (int k = 0; k < std::min(nb_views, nb_cameras); k++) {
+            const int i = camera_indices[k];
+            const Vec3 P = R_BG[i] * X + B_p_BG[i];
+            const Vec2 p = -P.head<2>() / P(2);
+            problem.observations.push_back(
+              BALProblem::Observation{i, j, f * p});
+        }
+    }
+
+    // Order observations by camera, like the BAL dataset
+    std::stable_sort(problem.observations.begin(),
+                     problem.observations.end(),
+                     [](const BALProblem::Observation &a,
+                        const BALProblem::Observation &b) {
+                         return a.camera_index < b.camera_index;
+                     });
+
+    for (int i = 0; i < nb_cameras; i++) {
+        const Eigen::AngleAxisd angle_axis{R_BG[i]};
+        const Vec3 rotation_noise =
+          0.005 * Vec3{noise(generator), noise(generator), noise(generator)};
+        const Vec3 translation_noise =
+          0.05 * Vec3{noise(generator), noise(generator), noise(generator)};
+
+        BALCamera camera;
+        camera << angle_axis.angle() * angle_axis.axis() + rotation_noise,
+          B_p_BG[i] + translation_noise, f, 0.0, 0.0;
+        problem.cameras.push_back(camera);
+    }
+
+    return problem;
+}
+
+/** Solve `inputs` the way BundleAdjustment did before landmarks were stored
+ * contiguously: residuals added camera by camera, landmarks in a map, and the
+ * elimination order left to Ceres */
+ceres::Solver::Summary solveBaseline(BAInputs &inputs,
+                                     const BAParams &params,
+                                     double &build_time) {
+    const auto start = std::chrono::steady_clock::now();
+    ceres::Problem problem;
+    std::vector<Vec4, Eigen::aligned_allocator<Vec4>> intrinsics;
+    for (const auto &K : inputs.K) {
+        intrinsics.emplace_back(K(0, 0), K(1, 1), K(0, 2), K(1, 2));
+    }
+
+    for (size_t c = 0; c < inputs.K.size(); c++) {
+        double *cam_q = inputs.q_GC[c].coeffs().data();
+        for (int i = 0; i < inputs.features[c].rows(); i++) {
+            const Vec2 feature = inputs.features[c].row(i).transpose();
+            problem.AddResidualBlock(
+              new BAIntrinsicsResidual{feature},
+              NULL,
+              cam_q,
+              inputs.G_p_GC[c].data(),
+              inputs.landmarks.at(inputs.landmark_ids[c][i]).data(),
+              intrinsics[c].data());
+        }
+        problem.SetParameterization(
+          cam_q, new ceres::EigenQuaternionParameterization{});
+        problem.SetParameterBlockConstant(intrinsics[c].data());
+    }
+    build_time += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    ceres::Solver::Options options;
+    setSolverOptions(params, options);
+    ceres::Solver::Summary summary;
+    ceres::Solve(options, &problem, &summary);
+    return summary;
+}
+
+/** Build and solve a BAL problem. Reports the mean time to build the problem,
+ * the time Ceres spent evaluating Jacobians and in the linear solver, and the
+ * initial and final costs.
+ *
+ * The build time includes conversion from BAL, construction of the problem,
+ * and Ceres's preprocessing. If `baseline` is true, the problem is solved
+ * with `solveBaseline()` instead of BundleAdjustment. */
+void BM_BALSolve(benchmark::State &state,
+                 std::shared_ptr<const BALProblem> problem,
+                 bool baseline) {
+    BAParams params;
+    params.max_num_iterations = 50;
+
+    double build_time = 0.0;
+    double jacobian_time = 0.0;
+    double linear_solver_time = 0.0;
+    ceres::Solver::Summary summary;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        auto inputs = problem->toBAInputs();
+        build_time += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+        if (baseline) {
+            summary = solveBaseline(inputs, params, build_time);
+        } else {
+            start = std::chrono::steady_clock::now();
+            std::unique_ptr<BundleAdjustment> ba{new BundleAdjustment{params}};
+            inputs.addTo(*ba);
+            build_time += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+            ba->solve();
+            summary = ba->summary;
+
+            // Exclude destruction of the problem
+            state.PauseTiming();
+            ba.reset();
+            state.ResumeTiming();
+        }
+        build_time += summary.preprocessor_time_in_seconds;
+        jacobian_time += summary.jacobian_evaluation_time_in_seconds;
+        linear_solver_time += summary.linear_solver_time_in_seconds;
+    }
+
+    const auto n = static_cast<double>(state.iterations());
+    state.SetItemsProcessed(state.iterations() * problem->observations.size());
+    state.counters["cameras"] = problem->cameras.size();
+    state.counters["points"] = problem->points.size();
+    state.counters["build_ms"] = 1e3 * build_time / n;
+    state.counters["jacobian_eval_ms"] = 1e3 * jacobian_time / n;
+    state.counters["linear_solver_ms"] = 1e3 * linear_solver_time / n;
+    state.counters["iterations"] = summary.iterations.size();
+    state.counters["initial_cost"] = summary.initial_cost;
+    state.counters["final_cost"] = summary.final_cost;
+}
+
+void registerBALBenchmark(const std::string &name,
+                          std::shared_ptr<const BALProblem> problem) {
+    benchmark::RegisterBenchmark(
+      (name + "/baseline").c_str(), BM_BALSolve, problem, true)
+      ->Unit(benchmark::kMillisecond)
+      ->Iterations(1);
+    benchmark::RegisterBenchmark(name.c_str(), BM_BALSolve, problem, false)
+      ->Unit(benchmark::kMillisecond)
+      ->Iterations(1);
+}
+
+}  // namespace wave
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Arguments not consumed by benchmark::Initialize are BAL files
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            const std::string path{argv[i]};
+            std::shared_ptr<const wave::BALProblem> problem{
+              new wave::BALProblem{wave::BALProblem::loadFromFile(path)}};
+            const auto name = path.substr(path.find_last_of('/') + 1);
+            wave::registerBALBenchmark("BM_BALSolve/" + name, problem);
+        }
+    } else {
+        for (int nb_points = 1000; nb_points <= 64000; nb_points *= 4) {
+            const int nb_cameras = nb_points / 100;
+            std::shared_ptr<const wave::BALProblem> problem{
+              new wave::BALProblem{
+                wave::makeSyntheticBAL(nb_cameras, nb_points)}};
+            wave::registerBALBenchmark(
+              "BM_BALSolve/synthetic-" + std::to_string(nb_cameras) + "-" +
+                std::to_string(nb_points),
+              problem);
+        }
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+}
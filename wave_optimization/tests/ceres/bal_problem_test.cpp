@@ -0,0 +1,93 @@
+#include "wave/wave_test.hpp"
+#include "wave/optimization/ceres/bal_problem.hpp"
+
+namespace wave {
+
+const std::string BAL_TEST_FILE = "tests/data/bal/problem-3-6-18.txt";
+const std::string BAL_TEST_OUTPUT = "/tmp/bal_problem_test.txt";
+
+TEST(BALProblem, loadFromFile) {
+    const auto problem = BALProblem::loadFromFile(BAL_TEST_FILE);
+
+    ASSERT_EQ(3u, problem.cameras.size());
+    ASSERT_EQ(6u, problem.points.size());
+    ASSERT_EQ(18u, problem.observations.size());
+
+    const auto &observation = problem.observations.front();
+    EXPECT_EQ(0, observation.camera_index);
+    EXPECT_EQ(0, observation.point_index);
+    EXPECT_DOUBLE_EQ(-8.9851333888309867e+01, observation.measurement(0));
+    EXPECT_DOUBLE_EQ(6.3256314910388120e+01, observation.measurement(1));
+    EXPECT_DOUBLE_EQ(500.0, problem.cameras[0](6));
+    EXPECT_EQ(2, problem.observations.back().camera_index);
+    EXPECT_EQ(5, problem.observations.back().point_index);
+}
+
+TEST(BALProblem, loadMissingFile) {
+    EXPECT_THROW(BALProblem::loadFromFile("tests/data/bal/missing.txt"),
+                 std::runtime_error);
+}
+
+TEST(BALProblem, outputToFile) {
+    const auto problem = BALProblem::loadFromFile(BAL_TEST_FILE);
+    problem.outputToFile(BAL_TEST_OUTPUT);
+    const auto loaded = BALProblem::loadFromFile(BAL_TEST_OUTPUT);
+
+    ASSERT_EQ(problem.observations.size(), loaded.observations.size());
+    for (size_t i = 0; i < problem.observations.size(); i++) {
+        EXPECT_EQ(problem.observations[i].camera_index,
+                  loaded.observations[i].camera_index);
+        EXPECT_EQ(problem.observations[i].point_index,
+                  loaded.observations[i].point_index);
+        EXPECT_PRED2(VectorsNear,
+                     problem.observations[i].measurement,
+                     loaded.observations[i].measurement);
+    }
+    ASSERT_EQ(problem.cameras.size(), loaded.cameras.size());
+    for (size_t i = 0; i < problem.cameras.size(); i++) {
+        EXPECT_PRED2(VectorsNear, problem.cameras[i], loaded.cameras[i]);
+    }
+    ASSERT_EQ(problem.points.size(), loaded.points.size());
+    for (size_t i = 0; i < problem.points.size(); i++) {
+        EXPECT_PRED2(VectorsNear, problem.points[i], loaded.points[i]);
+    }
+}
+
+TEST(BALProblem, toBAInputs) {
+    // The test file has exact measurements, so once converted, every
+    // BundleAdjustment residual should be zero
+    const auto problem = BALProblem::loadFromFile(BAL_TEST_FILE);
+    auto inputs = problem.toBAInputs();
+
+    ASSERT_EQ(3u, inputs.K.size());
+    ASSERT_EQ(6u, inputs.landmarks.size());
+    int nb_features = 0;
+    for (size_t c = 0; c < inputs.K.size(); c++) {
+        ASSERT_EQ(inputs.features[c].rows(),
+                  static_cast<int>(inputs.landmark_ids[c].size()));
+        for (int i = 0; i < inputs.features[c].rows(); i++) {
+            const Vec2 feature = inputs.features[c].row(i).transpose();
+            const BAAnalyticResidual residual{inputs.K[c], feature};
+            const double *parameters[3] = {
+              inputs.q_GC[c].coeffs().data(),
+              inputs.G_p_GC[c].data(),
+              inputs.landmarks.at(inputs.landmark_ids[c][i]).data()};
+
+            Vec2 r;
+            ASSERT_TRUE(residual.Evaluate(parameters, r.data(), NULL));
+            EXPECT_NEAR(0.0, r.norm(), 1e-6);
+            nb_features++;
+        }
+    }
+    EXPECT_EQ(18, nb_features);
+
+    // The problem can be solved, and stays at the solution
+    BundleAdjustment ba;
+    inputs.addTo(ba);
+    ba.problem.SetParameterBlockConstant(inputs.q_GC[0].coeffs().data());
+    ba.problem.SetParameterBlockConstant(inputs.G_p_GC[0].data());
+    ASSERT_EQ(0, ba.solve());
+    EXPECT_NEAR(0.0, ba.summary.final_cost, 1e-10);
+}
+
+}  // namespace wave
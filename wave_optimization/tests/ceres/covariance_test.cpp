@@ -0,0 +1,214 @@
+#include "wave/wave_test.hpp"
+#include "wave/utils/utils.hpp"
+#include "wave/vision/dataset/VoDataset.hpp"
+#include "wave/optimization/ceres/ba.hpp"
+#include "wave/optimization/ceres/pose_graph.hpp"
+#include "wave/optimization/ceres/covariance.hpp"
+
+namespace wave {
+
+const std::string TEST_CONFIG = "tests/data/vo_test.yaml";
+const std::string G2O_TEST_FILE = "tests/data/g2o/square.g2o";
+
+/** Residual of a direct measurement `m` of a 3-vector, with standard
+ * deviation `sigma` */
+struct PriorResidual {
+    Vec3 m;
+    double sigma;
+
+    template <typename T>
+    bool operator()(const T *const x, T *residual) const {
+        for (int i = 0; i < 3; i++) {
+            residual[i] = (x[i] - T(this->m(i))) / T(this->sigma);
+        }
+        return true;
+    }
+};
+
+/** Expect `actual` to match `expected` to a relative precision `tol` */
+void expectCovarianceNear(const Mat6 &expected,
+                          const Mat6 &actual,
+                          double tol) {
+    EXPECT_LE((expected - actual).norm(), tol * expected.norm());
+}
+
+TEST(computeBlockCovariances, priors) {
+    Vec3 x{1.0, 2.0, 3.0};
+    ceres::Problem problem;
+    for (const double sigma : {0.5, 2.0}) {
+        problem.AddResidualBlock(
+          new ceres::AutoDiffCostFunction<PriorResidual, 3, 3>{
+            new PriorResidual{x, sigma}},
+          NULL,
+          x.data());
+    }
+
+    std::vector<MatX> covariances;
+    ASSERT_EQ(0, computeBlockCovariances(problem, {x.data()}, covariances));
+    ASSERT_EQ(1u, covariances.size());
+
+    const double expected = 1.0 / (1.0 / 0.25 + 1.0 / 4.0);
+    EXPECT_PRED3(MatricesNearPrec,
+                 MatX{expected * Mat3::Identity()},
+                 covariances[0],
+                 1e-9);
+
+    // Blocks must be in the problem
+    Vec3 y = Vec3::Zero();
+    EXPECT_EQ(-1, computeBlockCovariances(problem, {y.data()}, covariances));
+}
+
+TEST(computePoseCovariances, twoPoses) {
+    // Pose 1 is measured from the constant pose 0 with information 4 I, so
+    // its covariance is I / 4: the rotation residual is the angle error
+    for (const auto algorithm : {CovarianceParams::algorithm_type::SCHUR,
+                                 CovarianceParams::algorithm_type::SPARSE_QR}) {
+        PoseGraph graph;
+        Affine3 T_01 = Affine3::Identity();
+        T_01.translation() = Vec3{1.0, 0.0, 0.0};
+        ASSERT_EQ(0, graph.addPose(0, Affine3::Identity()));
+        ASSERT_EQ(0, graph.addPose(1, T_01));
+        ASSERT_EQ(0, graph.addEdge(0, 1, T_01, 4.0 * Mat6::Identity()));
+        ASSERT_EQ(0, graph.solve());
+
+        CovarianceParams params;
+        params.algorithm = algorithm;
+        PoseCovarianceVector poses;
+        ASSERT_EQ(0, graph.computeCovariances({0, 1}, poses, params));
+        ASSERT_EQ(2u, poses.size());
+
+        // The constant pose has zero covariance
+        EXPECT_LT(poses[0].covariance.norm(), 1e-12);
+        EXPECT_PRED3(MatricesNearPrec,
+                     Mat6{0.25 * Mat6::Identity()},
+                     poses[1].covariance,
+                     1e-6);
+        EXPECT_PRED3(VectorsNearPrec, Vec3::UnitX(), poses[1].position, 1e-6);
+        EXPECT_PRED3(MatricesNearPrec,
+                     Mat3::Identity(),
+                     poses[1].rotation_matrix,
+                     1e-6);
+    }
+}
+
+TEST(computePoseCovariances, invalidInputs) {
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+    PoseCovarianceVector poses;
+
+    // Unknown pose
+    PoseGraph graph;
+    ASSERT_EQ(0, problem.addTo(graph));
+    ASSERT_EQ(0, graph.solve());
+    EXPECT_EQ(-1, graph.computeCovariances({0, 4}, poses));
+
+    // Without a constant pose the covariance is rank deficient
+    for (const auto algorithm : {CovarianceParams::algorithm_type::SCHUR,
+                                 CovarianceParams::algorithm_type::SPARSE_QR}) {
+        PoseGraphParams graph_params;
+        graph_params.fix_first_pose = false;
+        PoseGraph free_graph{graph_params};
+        ASSERT_EQ(0, problem.addTo(free_graph));
+        ASSERT_EQ(0, free_graph.solve());
+
+        CovarianceParams params;
+        params.algorithm = algorithm;
+        EXPECT_EQ(-1, free_graph.computeCovariances({1, 2}, poses, params));
+    }
+}
+
+TEST(computePoseCovariances, poseGraph) {
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+    PoseGraph graph;
+    ASSERT_EQ(0, problem.addTo(graph));
+    ASSERT_EQ(0, graph.solve());
+
+    const std::vector<int> ids{0, 1, 2, 3};
+    CovarianceParams params;
+    PoseCovarianceVector schur, qr;
+    params.algorithm = CovarianceParams::algorithm_type::SCHUR;
+    ASSERT_EQ(0, graph.computeCovariances(ids, schur, params));
+    params.algorithm = CovarianceParams::algorithm_type::SPARSE_QR;
+    ASSERT_EQ(0, graph.computeCovariances(ids, qr, params));
+
+    for (size_t i = 1; i < ids.size(); i++) {
+        expectCovarianceNear(qr[i].covariance, schur[i].covariance, 1e-8);
+    }
+
+    // The opposite corner is the furthest from the constant pose
+    EXPECT_GT(qr[2].covariance.trace(), qr[1].covariance.trace());
+    EXPECT_GT(qr[2].covariance.trace(), qr[3].covariance.trace());
+}
+
+TEST(computePoseCovariances, bundleAdjustment) {
+    VoDatasetGenerator generator;
+    generator.configure(TEST_CONFIG);
+    const auto dataset = generator.generate();
+
+    // Start from the ground truth; the covariance only depends on the
+    // Jacobian at the solution
+    const Quaternion q_BC{Eigen::AngleAxisd(-M_PI_2, Vec3::UnitZ()) *
+                          Eigen::AngleAxisd(-M_PI_2, Vec3::UnitX())};
+    const auto nb_poses = dataset.states.size();
+    std::vector<Vec3> G_p_GC(nb_poses);
+    std::vector<Quaternion> q_GC(nb_poses);
+    LandmarkMap landmarks = dataset.landmarks;
+
+    BundleAdjustment ba;
+    std::vector<double *> cam_q, cam_t;
+    for (size_t i = 0; i < nb_poses; i++) {
+        const auto &observed = dataset.states[i].features_observed;
+        MatX features(observed.size(), 2);
+        std::vector<LandmarkId> landmark_ids(observed.size());
+        for (size_t j = 0; j < observed.size(); j++) {
+            features.row(j) = observed[j].second;
+            landmark_ids[j] = observed[j].first;
+        }
+
+        G_p_GC[i] = dataset.states[i].robot_G_p_GB;
+        q_GC[i] = dataset.states[i].robot_q_GB * q_BC;
+        cam_t.push_back(G_p_GC[i].data());
+        cam_q.push_back(q_GC[i].coeffs().data());
+        ba.addCamera(dataset.camera_K,
+                     features,
+                     landmark_ids,
+                     cam_t.back(),
+                     cam_q.back(),
+                     landmarks);
+    }
+
+    // Two constant poses fix the gauge, including the scale
+    for (int i = 0; i < 2; i++) {
+        ba.problem.SetParameterBlockConstant(cam_t[i]);
+        ba.problem.SetParameterBlockConstant(cam_q[i]);
+    }
+    ASSERT_EQ(0, ba.solve());
+
+    CovarianceParams params;
+    PoseCovarianceVector schur, qr;
+    params.algorithm = CovarianceParams::algorithm_type::SCHUR;
+    ASSERT_EQ(0, ba.computePoseCovariances(cam_q, cam_t, schur, params));
+    params.algorithm = CovarianceParams::algorithm_type::SPARSE_QR;
+    ASSERT_EQ(0, ba.computePoseCovariances(cam_q, cam_t, qr, params));
+    ASSERT_EQ(nb_poses, schur.size());
+    ASSERT_EQ(nb_poses, qr.size());
+
+    for (size_t i = 0; i < nb_poses; i++) {
+        if (i < 2) {
+            EXPECT_LT(schur[i].covariance.norm(), 1e-12);
+            EXPECT_LT(qr[i].covariance.norm(), 1e-12);
+        } else {
+            expectCovarianceNear(qr[i].covariance, schur[i].covariance, 1e-6);
+        }
+    }
+
+    // A single thread gives the same result
+    params.algorithm = CovarianceParams::algorithm_type::SCHUR;
+    params.num_threads = 1;
+    PoseCovarianceVector serial;
+    ASSERT_EQ(0, ba.computePoseCovariances(cam_q, cam_t, serial, params));
+    for (size_t i = 2; i < nb_poses; i++) {
+        expectCovarianceNear(schur[i].covariance, serial[i].covariance, 1e-12);
+    }
+}
+
+}  // namespace wave
@@ -0,0 +1,190 @@
+/** @file
+ * Pose-graph optimization benchmark.
+ *
+ * Usage:
+ *     wave_optimization_pose_graph_benchmark [benchmark flags] [g2o files...]
+ *
+ * Each g2o file given (e.g. sphere2500, parking-garage or torus3D from the
+ * standard pose-graph datasets) is loaded and solved, with one thread and with
+ * every hardware thread. If no files are given, synthetic graphs of increasing
+ * size are used instead.
+ *
+ * The incremental benchmarks solve the graph without its last few edges, then
+ * time only the re-solve after adding them.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/utils.hpp"
+#include "wave/optimization/ceres/pose_graph.hpp"
+
+namespace wave {
+
+/** Number of edges added before each incremental re-solve */
+const int kIncrementalEdges = 10;
+
+/** Generate a helix of `nb_laps` laps with `poses_per_lap` poses each, like
+ * the sphere dataset. Consecutive poses are joined by noisy odometry edges,
+ * and each pose by a loop closure to the one below it on the previous lap.
+ * The initial estimates are found by chaining the odometry. */
+G2OProblem makeSyntheticG2O(int nb_laps, int poses_per_lap) {
+    G2OProblem problem;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> noise{0.0, 1.0};
+
+    Mat6 info = Mat6::Identity();
+    info.topLeftCorner<3, 3>() *= 100.0;
+    info.bottomRightCorner<3, 3>() *= 1000.0;
+
+    std::vector<Affine3, Eigen::aligned_allocator<Affine3>> truth;
+    const int nb_poses = nb_laps * poses_per_lap;
+    for (int i = 0; i < nb_poses; i++) {
+        const double angle = 2 * M_PI * i / poses_per_lap;
+        Affine3 T = Affine3::Identity();
+        T.translation() =
+          Vec3{10 * std::cos(angle), 10 * std::sin(angle), 0.2 * i};
+        T.linear() =
+          Eigen::AngleAxisd{angle + M_PI / 2, Vec3::UnitZ()}.matrix();
+        truth.push_back(T);
+    }
+
+    auto addEdge = [&](int i, int j) {
+        Affine3 T_ij = truth[i].inverse() * truth[j];
+        T_ij.translation() +=
+          0.1 * Vec3{noise(generator), noise(generator), noise(generator)};
+        T_ij.rotate(Eigen::AngleAxisd{
+          0.03 * noise(generator),
+          Vec3{noise(generator), noise(generator), noise(generator)}
+            .normalized()});
+        problem.edges.push_back(G2OProblem::Edge{i, j, T_ij, info});
+    };
+
+    Affine3 T_G = truth.front();
+    problem.vertices.push_back(G2OProblem::Vertex{0, T_G});
+    for (int i = 1; i < nb_poses; i++) {
+        addEdge(i - 1, i);
+        T_G = T_G * problem.edges.back().T_ij;
+        problem.vertices.push_back(G2OProblem::Vertex{i, T_G});
+        if (i >= poses_per_lap) {
+            addEdge(i - poses_per_lap, i);
+        }
+    }
+
+    return problem;
+}
+
+/** Solve a pose graph from its initial estimates. Reports the time Ceres
+ * spent evaluating Jacobians and in the linear solver, and the initial and
+ * final costs.
+ *
+ * If `incremental` is true, the last `kIncrementalEdges` edges are first left
+ * out and the graph solved; only the re-solve after adding them is timed. */
+void BM_PoseGraphSolve(benchmark::State &state,
+                       std::shared_ptr<const G2OProblem> problem,
+                       bool incremental) {
+    PoseGraphParams params;
+    params.num_threads = static_cast<int>(state.range(0));
+
+    const auto nb_edges = static_cast<int>(problem->edges.size());
+    const int first_new_edge =
+      incremental ? std::max(0, nb_edges - kIncrementalEdges) : nb_edges;
+
+    double jacobian_time = 0.0;
+    double linear_solver_time = 0.0;
+    ceres::Solver::Summary summary;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::unique_ptr<PoseGraph> graph{new PoseGraph{params}};
+        for (const auto &vertex : problem->vertices) {
+            graph->addPose(vertex.id, vertex.T_G);
+        }
+        for (int k = 0; k < nb_edges; k++) {
+            if (k == first_new_edge) {
+                graph->solve();
+                state.ResumeTiming();
+            }
+            const auto &edge = problem->edges[k];
+            graph->addEdge(edge.id_i,
+                           edge.id_j,
+                           edge.T_ij,
+                           edge.info,
+                           std::abs(edge.id_j - edge.id_i) != 1);
+        }
+        if (first_new_edge == nb_edges) {
+            state.ResumeTiming();
+        }
+
+        graph->solve();
+        summary = graph->getSummary();
+        jacobian_time += summary.jacobian_evaluation_time_in_seconds;
+        linear_solver_time += summary.linear_solver_time_in_seconds;
+
+        // Exclude destruction of the problem
+        state.PauseTiming();
+        graph.reset();
+        state.ResumeTiming();
+    }
+
+    const auto n = static_cast<double>(state.iterations());
+    state.counters["poses"] = problem->vertices.size();
+    state.counters["edges"] = problem->edges.size();
+    state.counters["jacobian_eval_ms"] = 1e3 * jacobian_time / n;
+    state.counters["linear_solver_ms"] = 1e3 * linear_solver_time / n;
+    state.counters["iterations"] = summary.iterations.size();
+    state.counters["initial_cost"] = summary.initial_cost;
+    state.counters["final_cost"] = summary.final_cost;
+}
+
+void registerPoseGraphBenchmark(const std::string &name,
+                                std::shared_ptr<const G2OProblem> problem) {
+    const int max_threads =
+      static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    benchmark::RegisterBenchmark(
+      name.c_str(), BM_PoseGraphSolve, problem, false)
+      ->Arg(1)
+      ->Arg(max_threads)
+      ->Unit(benchmark::kMillisecond)
+      ->Iterations(1);
+    benchmark::RegisterBenchmark(
+      (name + "/incremental").c_str(), BM_PoseGraphSolve, problem, true)
+      ->Arg(1)
+      ->Arg(max_threads)
+      ->Unit(benchmark::kMillisecond)
+      ->Iterations(1);
+}
+
+}  // namespace wave
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Arguments not consumed by benchmark::Initialize are g2o files
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            const std::string path{argv[i]};
+            std::shared_ptr<const wave::G2OProblem> problem{
+              new wave::G2OProblem{wave::G2OProblem::loadFromFile(path)}};
+            const auto name = path.substr(path.find_last_of('/') + 1);
+            wave::registerPoseGraphBenchmark("BM_PoseGraphSolve/" + name,
+                                             problem);
+        }
+    } else {
+        for (int nb_laps = 10; nb_laps <= 160; nb_laps *= 4) {
+            std::shared_ptr<const wave::G2OProblem> problem{
+              new wave::G2OProblem{wave::makeSyntheticG2O(nb_laps, 50)}};
+            wave::registerPoseGraphBenchmark(
+              "BM_PoseGraphSolve/synthetic-" + std::to_string(nb_laps * 50),
+              problem);
+        }
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+}
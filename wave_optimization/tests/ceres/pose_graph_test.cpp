@@ -0,0 +1,202 @@
+#include <random>
+
+#include "wave/wave_test.hpp"
+#include "wave/optimization/ceres/pose_graph.hpp"
+
+namespace wave {
+
+const std::string G2O_TEST_FILE = "tests/data/g2o/square.g2o";
+const std::string G2O_TEST_OUTPUT = "/tmp/pose_graph_test.g2o";
+
+/** Pose i of the unit square in the test file: each side is 1 m, turning
+ * 90 degrees left at every corner */
+Affine3 squarePose(int i) {
+    const Vec3 corners[4] = {
+      {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {1.0, 1.0, 0.0}, {0.0, 1.0, 0.0}};
+    Affine3 T = Affine3::Identity();
+    T.translation() = corners[i % 4];
+    T.linear() = Eigen::AngleAxisd{i * M_PI / 2, Vec3::UnitZ()}.matrix();
+    return T;
+}
+
+/** Pose i of a circle of `nb_poses` poses with a 10 m radius */
+Affine3 circlePose(int i, int nb_poses) {
+    const double angle = 2 * M_PI * i / nb_poses;
+    Affine3 T = Affine3::Identity();
+    T.translation() = Vec3{10 * std::sin(angle), 10 - 10 * std::cos(angle), 0};
+    T.linear() = Eigen::AngleAxisd{angle, Vec3::UnitZ()}.matrix();
+    return T;
+}
+
+void expectPoseNear(const Affine3 &expected,
+                    const Affine3 &actual,
+                    double tol) {
+    EXPECT_PRED3(
+      VectorsNearPrec, expected.translation(), actual.translation(), tol);
+    EXPECT_PRED3(MatricesNearPrec, expected.linear(), actual.linear(), tol);
+}
+
+TEST(G2OProblem, loadFromFile) {
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+
+    ASSERT_EQ(4u, problem.vertices.size());
+    ASSERT_EQ(4u, problem.edges.size());
+    EXPECT_EQ(3, problem.vertices.back().id);
+    EXPECT_EQ(3, problem.edges.back().id_i);
+    EXPECT_EQ(0, problem.edges.back().id_j);
+    expectPoseNear(squarePose(1), problem.edges.front().T_ij, 1e-12);
+    EXPECT_PRED2(MatricesNear, Mat6::Identity(), problem.edges.front().info);
+}
+
+TEST(G2OProblem, loadMissingFile) {
+    EXPECT_THROW(G2OProblem::loadFromFile("tests/data/g2o/missing.g2o"),
+                 std::runtime_error);
+}
+
+TEST(G2OProblem, outputToFile) {
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+    problem.outputToFile(G2O_TEST_OUTPUT);
+    const auto loaded = G2OProblem::loadFromFile(G2O_TEST_OUTPUT);
+
+    ASSERT_EQ(problem.vertices.size(), loaded.vertices.size());
+    for (size_t i = 0; i < problem.vertices.size(); i++) {
+        EXPECT_EQ(problem.vertices[i].id, loaded.vertices[i].id);
+        expectPoseNear(problem.vertices[i].T_G, loaded.vertices[i].T_G, 1e-12);
+    }
+    ASSERT_EQ(problem.edges.size(), loaded.edges.size());
+    for (size_t i = 0; i < problem.edges.size(); i++) {
+        EXPECT_EQ(problem.edges[i].id_i, loaded.edges[i].id_i);
+        EXPECT_EQ(problem.edges[i].id_j, loaded.edges[i].id_j);
+        expectPoseNear(problem.edges[i].T_ij, loaded.edges[i].T_ij, 1e-12);
+        EXPECT_PRED2(MatricesNear, problem.edges[i].info, loaded.edges[i].info);
+    }
+}
+
+TEST(PoseGraphResidual, evaluate) {
+    const Affine3 T_i = squarePose(1);
+    const Affine3 T_j = squarePose(2);
+    const Mat6 sqrt_info = Vec6{1.0, 2.0, 3.0, 4.0, 5.0, 6.0}.asDiagonal();
+    const PoseGraphResidual residual{T_i.inverse() * T_j, sqrt_info};
+
+    Quaternion q_i{T_i.rotation()};
+    Vec3 p_i = T_i.translation();
+    Quaternion q_j{T_j.rotation()};
+    Vec3 p_j = T_j.translation();
+
+    // The residual is zero at the measurement
+    Vec6 r;
+    residual(q_i.coeffs().data(), p_i.data(), q_j.coeffs().data(), p_j.data(),
+             r.data());
+    EXPECT_PRED3(VectorsNearPrec, Vec6::Zero(), r, 1e-12);
+
+    // A small rotation of pose j about its own z axis, and a translation in
+    // frame i, show up in the right components, weighted by sqrt_info
+    q_j = q_j * Quaternion{Eigen::AngleAxisd{0.01, Vec3::UnitZ()}};
+    p_j += T_i.linear() * Vec3{0.1, 0.0, 0.0};
+    residual(q_i.coeffs().data(), p_i.data(), q_j.coeffs().data(), p_j.data(),
+             r.data());
+    Vec6 expected;
+    expected << 0.1, 0.0, 0.0, 0.0, 0.0, 0.01;
+    expected = sqrt_info * expected;
+    EXPECT_PRED3(VectorsNearPrec, expected, r, 1e-6);
+}
+
+TEST(PoseGraph, invalidInputs) {
+    PoseGraph graph;
+    EXPECT_EQ(0, graph.addPose(0, squarePose(0)));
+    EXPECT_EQ(-1, graph.addPose(0, squarePose(1)));
+    EXPECT_EQ(0, graph.addPose(1, squarePose(1)));
+
+    const Affine3 T_01 = squarePose(1);
+    EXPECT_EQ(-1, graph.addEdge(0, 2, T_01, Mat6::Identity()));
+    EXPECT_EQ(-1, graph.addEdge(0, 1, T_01, Mat6::Zero()));
+    EXPECT_EQ(-1, graph.setPoseConstant(2));
+    EXPECT_EQ(0, graph.addEdge(0, 1, T_01, Mat6::Identity()));
+    EXPECT_EQ(1, graph.numEdges());
+
+    Affine3 T;
+    EXPECT_FALSE(graph.getPose(2, T));
+}
+
+TEST(PoseGraph, solveFromFile) {
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+    PoseGraph graph;
+    ASSERT_EQ(0, problem.addTo(graph));
+    EXPECT_EQ(4, graph.numPoses());
+    EXPECT_EQ(4, graph.numEdges());
+
+    // The edges are exact, and the first pose is fixed at its true value
+    ASSERT_EQ(0, graph.solve());
+    EXPECT_NEAR(0.0, graph.getSummary().final_cost, 1e-10);
+    for (int i = 0; i < 4; i++) {
+        Affine3 T;
+        ASSERT_TRUE(graph.getPose(i, T));
+        expectPoseNear(squarePose(i), T, 1e-4);
+    }
+}
+
+TEST(PoseGraph, robustLoopClosure) {
+    // Add a wrong loop closure across the square, with and without a loss
+    const auto problem = G2OProblem::loadFromFile(G2O_TEST_FILE);
+    Affine3 T_02 = Affine3::Identity();
+    T_02.translation() = Vec3{-3.0, 4.0, 0.0};
+
+    double errors[2];
+    for (int robust = 0; robust < 2; robust++) {
+        PoseGraphParams params;
+        params.loop_closure_loss =
+          robust ? BALossType::Cauchy : BALossType::None;
+        PoseGraph graph{params};
+        ASSERT_EQ(0, problem.addTo(graph));
+        ASSERT_EQ(0, graph.addEdge(0, 2, T_02, Mat6::Identity(), true));
+        ASSERT_EQ(0, graph.solve());
+
+        Affine3 T;
+        ASSERT_TRUE(graph.getPose(2, T));
+        errors[robust] = (T.translation() - squarePose(2).translation()).norm();
+    }
+
+    EXPECT_LT(errors[1], 0.25);
+    EXPECT_LT(errors[1], errors[0]);
+}
+
+TEST(PoseGraph, incrementalLoopClosure) {
+    // Drive around a circle with noisy odometry, then close the loop
+    const int nb_poses = 50;
+    std::mt19937 generator{42};
+    std::normal_distribution<double> noise{0.0, 0.02};
+
+    Mat6 info = Mat6::Identity();
+    info.bottomRightCorner<3, 3>() *= 100.0;
+
+    PoseGraph graph;
+    Affine3 T_G = circlePose(0, nb_poses);
+    ASSERT_EQ(0, graph.addPose(0, T_G));
+    for (int i = 1; i < nb_poses; i++) {
+        Affine3 T_ij =
+          circlePose(i - 1, nb_poses).inverse() * circlePose(i, nb_poses);
+        T_ij.translation() += Vec3{noise(generator), noise(generator), 0.0};
+        T_ij.rotate(Eigen::AngleAxisd{0.1 * noise(generator), Vec3::UnitZ()});
+
+        T_G = T_G * T_ij;
+        ASSERT_EQ(0, graph.addPose(i, T_G));
+        ASSERT_EQ(0, graph.addEdge(i - 1, i, T_ij, info));
+    }
+    ASSERT_EQ(0, graph.solve());
+
+    Affine3 T_last;
+    ASSERT_TRUE(graph.getPose(nb_poses - 1, T_last));
+    const Affine3 truth = circlePose(nb_poses - 1, nb_poses);
+    const double drift = (T_last.translation() - truth.translation()).norm();
+
+    // An exact loop closure, solved from the current estimates, reduces the
+    // drift
+    const Affine3 T_loop = truth.inverse() * circlePose(0, nb_poses);
+    ASSERT_EQ(0, graph.addEdge(nb_poses - 1, 0, T_loop, 100.0 * info, true));
+    ASSERT_EQ(0, graph.solve());
+
+    ASSERT_TRUE(graph.getPose(nb_poses - 1, T_last));
+    EXPECT_LT((T_last.translation() - truth.translation()).norm(), drift);
+}
+
+}  // namespace wave
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/optimization/ceres/sliding_window_ba.hpp"
+#include "synthetic_sequence.hpp"
+
+namespace wave {
+
+/** Run sliding-window BA over a long synthetic sequence, with the window size
+ * given by the first argument. Reports the mean time to solve one window and
+ * the RMS position error of each new keyframe after its window is solved. */
+void BM_SlidingWindowBA(benchmark::State &state) {
+    const int nb_frames = 200;
+    const auto sequence = makeSyntheticSequence(nb_frames);
+    const auto initial_landmarks = perturbLandmarks(sequence.landmarks, 0.1);
+
+    SlidingWindowBAParams params;
+    params.window_size = static_cast<int>(state.range(0));
+
+    double solve_time = 0.0;
+    double squared_error = 0.0;
+    int nb_solves = 0;
+    int max_landmarks = 0;
+    for (auto _ : state) {
+        SlidingWindowBA ba{sequence.K, params};
+        for (int i = 0; i < nb_frames; i++) {
+            Quaternion q_GC = sequence.q_GC[i];
+            Vec3 G_p_GC = sequence.G_p_GC[i];
+            if (i > 0) {
+                perturbPose(q_GC, G_p_GC, 0.1);
+            }
+            const int id = ba.addKeyframe(
+              q_GC, G_p_GC, sequence.observations[i], initial_landmarks);
+
+            const auto start = std::chrono::steady_clock::now();
+            ba.solve();
+            solve_time += std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+            ba.getPose(id, q_GC, G_p_GC);
+            squared_error += (G_p_GC - sequence.G_p_GC[i]).squaredNorm();
+            nb_solves++;
+            max_landmarks = std::max(max_landmarks, ba.numLandmarks());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * nb_frames);
+    state.counters["solve_ms"] = 1e3 * solve_time / nb_solves;
+    state.counters["rms_error_m"] = std::sqrt(squared_error / nb_solves);
+    state.counters["max_landmarks"] = max_landmarks;
+}
+
+BENCHMARK(BM_SlidingWindowBA)
+  ->Arg(3)
+  ->Arg(5)
+  ->Arg(10)
+  ->Arg(20)
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
@@ -0,0 +1,162 @@
+#include "wave/wave_test.hpp"
+#include "wave/optimization/ceres/sliding_window_ba.hpp"
+#include "synthetic_sequence.hpp"
+
+namespace wave {
+
+TEST(MarginalizationPrior, jacobians) {
+    // One quaternion block and one position block
+    const MatX J = MatX::Random(6, 6);
+    const VecX r0 = VecX::Random(6);
+    const Quaternion q0 = Quaternion::UnitRandom();
+    const Vec3 p0 = Vec3::Random();
+    VecX x0{7};
+    x0 << q0.coeffs(), p0;
+    MarginalizationPrior prior{J, r0, {4, 3}, x0};
+
+    // At the linearization point, the residual is r0
+    Vec6 residuals;
+    const double *x0_blocks[2] = {x0.data(), x0.data() + 4};
+    ASSERT_TRUE(prior.Evaluate(x0_blocks, residuals.data(), NULL));
+    EXPECT_PRED3(VectorsNearPrec, r0, residuals, 1e-12);
+
+    // Elsewhere, the Jacobians match central differences
+    Quaternion q = q0 * Quaternion{Eigen::AngleAxisd{0.1, Vec3::UnitY()}};
+    Vec3 p = p0 + Vec3{0.1, -0.2, 0.3};
+    double *blocks[2] = {q.coeffs().data(), p.data()};
+    Eigen::Matrix<double, 6, 4, Eigen::RowMajor> J_q;
+    Eigen::Matrix<double, 6, 3, Eigen::RowMajor> J_p;
+    double *jacobians[2] = {J_q.data(), J_p.data()};
+    ASSERT_TRUE(prior.Evaluate(blocks, residuals.data(), jacobians));
+
+    const double h = 1e-6;
+    for (int i = 0; i < 7; i++) {
+        double *value = i < 4 ? blocks[0] + i : blocks[1] + i - 4;
+        Vec6 r_plus, r_minus;
+        const double original = *value;
+        *value = original + h;
+        prior.Evaluate(blocks, r_plus.data(), NULL);
+        *value = original - h;
+        prior.Evaluate(blocks, r_minus.data(), NULL);
+        *value = original;
+
+        const Vec6 numeric = (r_plus - r_minus) / (2 * h);
+        const Vec6 analytic = i < 4 ? Vec6{J_q.col(i)} : Vec6{J_p.col(i - 4)};
+        EXPECT_PRED3(VectorsNearPrec, numeric, analytic, 1e-6);
+    }
+}
+
+class SlidingWindowBATest : public ::testing::Test {
+ protected:
+    SlidingWindowBATest() : sequence{makeSyntheticSequence(40)} {
+        this->params.window_size = 5;
+        this->params.solver.linear_solver = BAParams::DENSE_SCHUR;
+        this->params.solver.max_num_iterations = 50;
+    }
+
+    /** Add frame i with perturbed initial estimates */
+    int addFrame(SlidingWindowBA &ba, int i) {
+        Quaternion q_GC = this->sequence.q_GC[i];
+        Vec3 G_p_GC = this->sequence.G_p_GC[i];
+        if (i > 0) {
+            perturbPose(q_GC, G_p_GC, 0.1);
+        }
+        return ba.addKeyframe(q_GC,
+                              G_p_GC,
+                              this->sequence.observations[i],
+                              this->initial_landmarks);
+    }
+
+    SyntheticSequence sequence;
+    LandmarkMap initial_landmarks =
+      perturbLandmarks(this->sequence.landmarks, 0.1);
+    SlidingWindowBAParams params;
+};
+
+TEST_F(SlidingWindowBATest, boundedWindow) {
+    SlidingWindowBA ba{this->sequence.K, this->params};
+    const auto nb_frames = static_cast<int>(this->sequence.observations.size());
+
+    int max_landmarks = 0;
+    for (int i = 0; i < nb_frames; i++) {
+        EXPECT_EQ(i, this->addFrame(ba, i));
+        EXPECT_EQ(std::min(i + 1, this->params.window_size), ba.numKeyframes());
+        EXPECT_EQ(i >= this->params.window_size, ba.hasPrior());
+        max_landmarks = std::max(max_landmarks, ba.numLandmarks());
+    }
+
+    // Old keyframes and landmarks leave the window
+    Quaternion q_GC;
+    Vec3 G_p_GC;
+    EXPECT_FALSE(ba.getPose(0, q_GC, G_p_GC));
+    EXPECT_TRUE(ba.getPose(nb_frames - 1, q_GC, G_p_GC));
+    EXPECT_FALSE(ba.getPose(nb_frames, q_GC, G_p_GC));
+    EXPECT_LT(max_landmarks, static_cast<int>(this->sequence.landmarks.size()));
+}
+
+TEST_F(SlidingWindowBATest, accuracy) {
+    SlidingWindowBA ba{this->sequence.K, this->params};
+    const auto nb_frames = static_cast<int>(this->sequence.observations.size());
+
+    for (int i = 0; i < nb_frames; i++) {
+        const int id = this->addFrame(ba, i);
+        ASSERT_EQ(0, ba.solve());
+
+        // The newest keyframe is recovered from its perturbed estimate
+        Quaternion q_GC;
+        Vec3 G_p_GC;
+        ASSERT_TRUE(ba.getPose(id, q_GC, G_p_GC));
+        EXPECT_LT((G_p_GC - this->sequence.G_p_GC[i]).norm(), 0.1);
+        EXPECT_LT(q_GC.angularDistance(this->sequence.q_GC[i]), 0.02);
+    }
+
+    // So are the landmarks still in the window
+    for (const auto &landmark : this->sequence.landmarks) {
+        Vec3 G_p_GF;
+        if (ba.getLandmark(landmark.first, G_p_GF)) {
+            EXPECT_LT((G_p_GF - landmark.second).norm(), 0.2);
+        }
+    }
+}
+
+TEST_F(SlidingWindowBATest, fromContainer) {
+    using Measurement = LandmarkMeasurement<int>;
+    const int sensor = 1;
+    const auto start = std::chrono::steady_clock::now();
+    const auto nb_frames = 10;
+
+    // Store the observations of every frame, plus a second sensor's, which
+    // must be ignored
+    LandmarkMeasurementContainer<Measurement> measurements;
+    for (int i = 0; i < nb_frames; i++) {
+        const auto t = start + std::chrono::milliseconds{100 * i};
+        for (const auto &observation : this->sequence.observations[i]) {
+            measurements.emplace(
+              t, sensor, observation.first, i, observation.second);
+            measurements.emplace(
+              t, sensor + 1, observation.first, i, Vec2{0.0, 0.0});
+        }
+    }
+
+    SlidingWindowBA from_vector{this->sequence.K, this->params};
+    SlidingWindowBA from_container{this->sequence.K, this->params};
+    for (int i = 0; i < nb_frames; i++) {
+        const auto t = start + std::chrono::milliseconds{100 * i};
+        this->addFrame(from_vector, i);
+        from_container.addKeyframe(measurements,
+                                   t,
+                                   sensor,
+                                   this->sequence.q_GC[i],
+                                   this->sequence.G_p_GC[i],
+                                   this->initial_landmarks);
+        EXPECT_EQ(from_vector.numLandmarks(), from_container.numLandmarks());
+    }
+
+    ASSERT_EQ(0, from_container.solve());
+    Quaternion q_GC;
+    Vec3 G_p_GC;
+    ASSERT_TRUE(from_container.getPose(nb_frames - 1, q_GC, G_p_GC));
+    EXPECT_LT((G_p_GC - this->sequence.G_p_GC[nb_frames - 1]).norm(), 0.1);
+}
+
+}  // namespace wave
@@ -0,0 +1,109 @@
+#ifndef WAVE_OPTIMIZATION_SYNTHETIC_SEQUENCE_HPP
+#define WAVE_OPTIMIZATION_SYNTHETIC_SEQUENCE_HPP
+
+#include <random>
+#include <vector>
+
+#include "wave/utils/utils.hpp"
+#include "wave/vision/dataset/VoTestCamera.hpp"
+
+namespace wave {
+
+/** A long synthetic camera sequence, for sliding-window estimation
+ *
+ * The camera drives forward along the x axis of the global frame, weaving
+ * slightly, through a corridor of landmarks. Unlike VoDatasetGenerator, which
+ * circles a fixed set of landmarks, each landmark is only seen for a limited
+ * number of frames.
+ */
+struct SyntheticSequence {
+    Mat3 K;
+    std::vector<Quaternion, Eigen::aligned_allocator<Quaternion>> q_GC;
+    std::vector<Vec3> G_p_GC;
+    LandmarkMap landmarks;
+
+    /** Observations made by each frame, without noise */
+    std::vector<std::vector<LandmarkObservation>> observations;
+};
+
+/** Generate a sequence of `nb_frames` frames, `step` metres apart */
+inline SyntheticSequence makeSyntheticSequence(int nb_frames,
+                                               double step = 0.5,
+                                               int landmarks_per_metre = 20) {
+    SyntheticSequence sequence;
+    sequence.K << 300.0, 0.0, 320.0,  //
+      0.0, 300.0, 240.0,              //
+      0.0, 0.0, 1.0;
+    const double image_width = 640.0;
+    const double image_height = 480.0;
+    const double max_depth = 15.0;
+
+    std::mt19937 generator{42};
+
+    // The camera's z axis looks along the robot's x axis
+    const auto q_BC = Quaternion{Eigen::AngleAxisd(-M_PI_2, Vec3::UnitZ()) *
+                                 Eigen::AngleAxisd(-M_PI_2, Vec3::UnitX())};
+    for (int i = 0; i < nb_frames; i++) {
+        const double x = step * i;
+        const double heading = 0.1 * std::cos(0.1 * x);
+        const auto q_GB =
+          Quaternion{Eigen::AngleAxisd(heading, Vec3::UnitZ())};
+        sequence.q_GC.push_back(q_GB * q_BC);
+        sequence.G_p_GC.emplace_back(x, std::sin(0.1 * x), 0.0);
+    }
+
+    // Landmarks on the walls, floor and ceiling of a corridor
+    const double length = step * nb_frames + max_depth;
+    const int nb_landmarks = static_cast<int>(landmarks_per_metre * length);
+    std::uniform_real_distribution<double> x_dist{0.0, length};
+    std::uniform_real_distribution<double> y_dist{-5.0, 5.0};
+    std::uniform_real_distribution<double> z_dist{-2.0, 3.0};
+    for (int i = 0; i < nb_landmarks; i++) {
+        sequence.landmarks[i] =
+          Vec3{x_dist(generator), y_dist(generator), z_dist(generator)};
+    }
+
+    for (int i = 0; i < nb_frames; i++) {
+        const Mat3 R_CG = sequence.q_GC[i].toRotationMatrix().transpose();
+        std::vector<LandmarkObservation> observations;
+        for (const auto &landmark : sequence.landmarks) {
+            const Vec3 C_p_CF = R_CG * (landmark.second - sequence.G_p_GC[i]);
+            if (C_p_CF(2) < 1.0 || C_p_CF(2) > max_depth) {
+                continue;
+            }
+
+            const double u = sequence.K(0, 0) * C_p_CF(0) / C_p_CF(2) +
+                             sequence.K(0, 2);
+            const double v = sequence.K(1, 1) * C_p_CF(1) / C_p_CF(2) +
+                             sequence.K(1, 2);
+            if (u < 0.0 || u > image_width || v < 0.0 || v > image_height) {
+                continue;
+            }
+            observations.emplace_back(landmark.first, Vec2{u, v});
+        }
+        sequence.observations.push_back(observations);
+    }
+
+    return sequence;
+}
+
+/** Perturb a pose estimate by a fixed offset, like the BundleAdjustment tests
+ */
+inline void perturbPose(Quaternion &q_GC, Vec3 &G_p_GC, double scale) {
+    q_GC = q_GC * Quaternion{Eigen::AngleAxisd{0.2 * scale, Vec3::UnitX()}};
+    G_p_GC += scale * Vec3{0.5, 0.1, -0.5};
+}
+
+/** Perturb landmark estimates by a fixed offset */
+inline LandmarkMap perturbLandmarks(const LandmarkMap &landmarks,
+                                    double scale) {
+    LandmarkMap perturbed = landmarks;
+    for (auto &landmark : perturbed) {
+        landmark.second += scale * Vec3{0.3, -0.3, 0.3};
+    }
+    return perturbed;
+}
+
+}  // namespace wave
+
+#endif  // WAVE_OPTIMIZATION_SYNTHETIC_SEQUENCE_HPP
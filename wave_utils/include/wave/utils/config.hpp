@@ -11,6 +11,7 @@
 #include <string>
 #include <sstream>
 #include <type_traits>
+#include <vector>
 
 #include <yaml-cpp/yaml.h>
 
@@ -37,8 +38,7 @@ enum class ConfigStatus {
 
 /** Base class representing a parameter to be parsed in the yaml file */
 struct ConfigParamBase {
-    ConfigParamBase(std::string key, bool optional)
-        : key{std::move(key)}, optional{optional} {};
+    ConfigParamBase(std::string key, bool optional);
 
 
     /** Parse the given node as T, and write the value into `destination`.
@@ -50,6 +50,10 @@ struct ConfigParamBase {
     std::string key;  //!< yaml key to parse from
     bool optional;    //!< if true, it is not an error if the key is not found
 
+    /** Elements of `key` split at each '.', so that looking up the node does
+     * not parse the key again */
+    std::vector<std::string> path;
+
  protected:
     ~ConfigParamBase() = default;  // disallow deletion through pointer to base
 };
@@ -102,6 +106,15 @@ class ConfigParam : public ConfigParamBase {
  * The code that parses the above is:
  * @include example_config_parser.cpp
  *
+ * Parsed files are cached for the whole process, keyed by path. A file is
+ * parsed again if its inode, size, modification time or status change time
+ * differ from when it was cached, so replacing or editing it is noticed. A
+ * file rewritten within the resolution of the file system timestamps may
+ * not be; call `clearCache` in that case. Many parsers loading the same
+ * file, e.g. the params of each matcher in a `MultiMatcher`, parse it only
+ * once and bind their params from the same tree. `getYamlNode` returns a
+ * copy of part of the tree, so changing it does not affect other parsers.
+ *
  * @todo integrate unit tests into examples (see
  * http://stackoverflow.com/a/16034375/431033)
  */
@@ -109,7 +122,6 @@ class ConfigParser {
  public:
     bool config_loaded;
 
-    YAML::Node root;
     std::vector<std::shared_ptr<ConfigParamBase>> params;
 
     /** Default constructor. By default it sets:
@@ -120,6 +132,12 @@ class ConfigParser {
      */
     ConfigParser(void);
 
+    ConfigParser(const ConfigParser &) = default;
+
+    /** Copy the params and the loaded file of `other`, sharing its tree
+     * without modifying the tree previously loaded */
+    ConfigParser &operator=(const ConfigParser &other);
+
     /** Use the variations of `addParam` to add parameters you would like to
      * parse from the yaml file, where `key` is the yaml key, `out` is
      * dependent on the type of parameter you want to parse to and an
@@ -133,11 +151,16 @@ class ConfigParser {
         this->params.push_back(ptr);
     }
 
-    /** Get yaml node given yaml `key`. The result is assigned to `node` if
-     * `key` matches anything in the config file, else `node` is set to `NULL`.
+    /** Get yaml node given yaml `key`. A copy of the result is assigned to
+     * `node` if `key` matches anything in the config file, else `node` is set
+     * to `NULL`.
      */
     ConfigStatus getYamlNode(const std::string &key, YAML::Node &node);
 
+    /** Get yaml node given the elements of a yaml key, as getYamlNode() */
+    ConfigStatus getYamlNode(const std::vector<std::string> &path,
+                             YAML::Node &node);
+
     /** Check whether a key is present in the yaml file */
     ConfigStatus checkKey(const std::string &key, bool optional);
 
@@ -146,6 +169,19 @@ class ConfigParser {
 
     /** Load yaml file at `config_file`. */
     ConfigStatus load(const std::string &config_file);
+
+    /** Remove all parsed files from the cache, so they are parsed again on
+     * the next `load` */
+    static void clearCache();
+
+ private:
+    /// Parsed yaml file, possibly shared with other parsers through the cache
+    YAML::Node root;
+
+    /** Get the yaml node at `path` in `root` itself, without copying it, or
+     * an undefined node if there is none. `node` must not be modified. */
+    ConfigStatus findNode(const std::vector<std::string> &path,
+                          YAML::Node &node) const;
 };
 
 /** @} group utils */
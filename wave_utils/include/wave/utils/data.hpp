@@ -24,32 +24,41 @@ namespace wave {
 
 /** @return  the number of rows in the csv file at `file_path`, or `-1` if the
  * function failed to open the csv file. */
-int csvrows(std::string file_path);
+int csvrows(const std::string &file_path);
 
 /** @return  the number of columns in the csv file at `file_path`, or `-1` if
  * the
  * function failed to open the csv file. */
-int csvcols(std::string file_path);
+int csvcols(const std::string &file_path);
 
 /** Load csv file containing a matrix.
  *
- * The parsed matrix will be loaded to `data`.
+ * The parsed matrix will be loaded to `data`. The number of columns is taken
+ * from the first line; missing or invalid values are loaded as 0.
+ *
+ * The file is memory-mapped and read once. Large files are split into chunks
+ * of whole lines, which are parsed on up to `num_threads` threads.
  *
  * @param file_path path to the csv file
  * @param header whether a header line exists in the csv file.
  * @param[out] data
+ * @param num_threads maximum number of threads to parse with
  *
  * @return `0` on success, `-1` on error
  *
  */
-int csv2mat(std::string file_path, bool header, MatX &data);
+int csv2mat(const std::string &file_path,
+            bool header,
+            MatX &data,
+            int num_threads = 1);
 
 /** Saves matrix to file.
  *
- * The `data` is saved in csv format to a file at `file_path`.
+ * The `data` is saved in csv format to a file at `file_path`, with six
+ * significant digits as `std::ostream` would format them.
  * @return `0` on success, `-1` on error
  */
-int mat2csv(std::string file_path, MatX data);
+int mat2csv(const std::string &file_path, const MatX &data);
 
 
 /** Reads a matrix from an input stream.
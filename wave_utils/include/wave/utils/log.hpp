@@ -1,33 +1,182 @@
 /** @file
  * @ingroup utils
  *
- * Functions to log errors and info to `stderr` and `stdout`.
+ * Functions to log errors, warnings and info to `stderr` and `stdout`.
  *
- * `LOG_ERROR` and `LOG_INFO` both are simple `fprintf()` that can be use to
- * write message `M` to `stderr` and `stdout`. For example:
+ * `LOG_ERROR`, `LOG_WARN`, `LOG_INFO` and `LOG_DEBUG` take a `printf()` format
+ * and arguments, and write message `M` to `stderr` (errors and warnings) or
+ * `stdout`. For example:
  * ```
  * LOG_ERROR("Failed to load configuration file [%s]", config_file.c_str());
  * LOG_INFO("Parameter was not found! Loading defaults!");
  * ```
+ *
+ * Info and debug messages are formatted by the calling thread into a
+ * lock-free ring buffer of its own, and written out by a background thread,
+ * so logging does not block on terminal I/O. Pending messages are written at
+ * exit, or on `flushLog()`. Errors and warnings are written before the
+ * `LOG_*` call returns, after any pending messages, so they are not lost if
+ * the program crashes. Messages from one thread keep their order.
+ *
+ * Levels below `WAVE_LOG_LEVEL` are compiled out, so their arguments are not
+ * even evaluated. By default `LOG_DEBUG` is disabled; define `WAVE_LOG_LEVEL`
+ * as `WAVE_LOG_LEVEL_DEBUG` before including this file to enable it.
+ *
+ * For messages in loops, e.g. once per point or per frame, the `_THROTTLE`
+ * variants log at most once per `period` seconds from each call site, noting
+ * how many messages were suppressed in between:
+ * ```
+ * LOG_WARN_THROTTLE(1.0, "Insufficient model for angular slice");
+ * ```
  */
 
 #ifndef WAVE_UTILS_LOG_HPP
 #define WAVE_UTILS_LOG_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#define WAVE_LOG_LEVEL_DEBUG 0
+#define WAVE_LOG_LEVEL_INFO 1
+#define WAVE_LOG_LEVEL_WARN 2
+#define WAVE_LOG_LEVEL_ERROR 3
+#define WAVE_LOG_LEVEL_OFF 4
+
+#ifndef WAVE_LOG_LEVEL
+#define WAVE_LOG_LEVEL WAVE_LOG_LEVEL_INFO
+#endif
+
 namespace wave {
 /** @addtogroup utils
  *  @{ */
 
+/** Stream a log message is written to */
+enum class LogStream { Out, Err };
+
+/** Formats a message and queues it to be written to `stream`, or writes it
+ * at once if `stream` is `LogStream::Err`.
+ *
+ * Use the `LOG_*` macros rather than calling this directly.
+ */
+void logMessage(LogStream stream, const char *format, ...)
+  __attribute__((format(printf, 2, 3)));
+
+/** Blocks until all messages logged so far have been written */
+void flushLog();
+
+/** Redirects log output to the given files, which must stay open.
+ *
+ * Defaults are `stdout` and `stderr`. Pending messages are flushed first.
+ */
+void setLogOutput(FILE *out, FILE *err);
+
+/** Enables or disables the background thread (enabled by default).
+ *
+ * When disabled, info and debug messages are also written before the `LOG_*`
+ * call returns, which can help when debugging crashes.
+ */
+void setLogAsynchronous(bool asynchronous);
+
+/** Limits how often a call site logs; used by the `_THROTTLE` macros */
+class LogThrottle {
+ public:
+    explicit LogThrottle(double period);
+
+    /** @return true if a message may be logged now. In that case
+     * `suppressed` is set to the number of messages suppressed since the
+     * last one. */
+    bool check(int &suppressed);
+
+ private:
+    const int64_t period_ns;
+    std::atomic<int64_t> next_ns;
+    std::atomic<int> nb_suppressed;
+};
+
 #define FILENAME \
     (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
-#define LOG_ERROR(M, ...) \
-    fprintf(              \
-      stderr, "[ERROR] [%s:%d] " M "\n", FILENAME, __LINE__, ##__VA_ARGS__)
+#define WAVE_LOG_THROTTLE(LOG, period, M, ...)                \
+    do {                                                      \
+        static ::wave::LogThrottle wave_log_throttle{period}; \
+        int wave_log_suppressed;                              \
+        if (wave_log_throttle.check(wave_log_suppressed)) {   \
+            if (wave_log_suppressed > 0) {                    \
+                LOG(M " (%d similar messages suppressed)",    \
+                    ##__VA_ARGS__,                            \
+                    wave_log_suppressed);                     \
+            } else {                                          \
+                LOG(M, ##__VA_ARGS__);                        \
+            }                                                 \
+        }                                                     \
+    } while (0)
+
+#define WAVE_LOG_DISABLED(M, ...) \
+    do {                          \
+    } while (0)
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_ERROR
+#define LOG_ERROR(M, ...)                         \
+    ::wave::logMessage(::wave::LogStream::Err,    \
+                       "[ERROR] [%s:%d] " M "\n", \
+                       FILENAME,                  \
+                       __LINE__,                  \
+                       ##__VA_ARGS__)
+#else
+#define LOG_ERROR WAVE_LOG_DISABLED
+#endif
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_WARN
+#define LOG_WARN(M, ...)                         \
+    ::wave::logMessage(::wave::LogStream::Err,   \
+                       "[WARN] [%s:%d] " M "\n", \
+                       FILENAME,                 \
+                       __LINE__,                 \
+                       ##__VA_ARGS__)
+#else
+#define LOG_WARN WAVE_LOG_DISABLED
+#endif
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_INFO
+#define LOG_INFO(M, ...) \
+    ::wave::logMessage(::wave::LogStream::Out, "[INFO] " M "\n", ##__VA_ARGS__)
+#else
+#define LOG_INFO WAVE_LOG_DISABLED
+#endif
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(M, ...)                      \
+    ::wave::logMessage(::wave::LogStream::Out, \
+                       "[DEBUG] " M "\n",      \
+                       ##__VA_ARGS__)
+#else
+#define LOG_DEBUG WAVE_LOG_DISABLED
+#endif
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_ERROR
+#define LOG_ERROR_THROTTLE(period, M, ...) \
+    WAVE_LOG_THROTTLE(LOG_ERROR, period, M, ##__VA_ARGS__)
+#else
+#define LOG_ERROR_THROTTLE WAVE_LOG_DISABLED
+#endif
+
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_WARN
+#define LOG_WARN_THROTTLE(period, M, ...) \
+    WAVE_LOG_THROTTLE(LOG_WARN, period, M, ##__VA_ARGS__)
+#else
+#define LOG_WARN_THROTTLE WAVE_LOG_DISABLED
+#endif
 
-#define LOG_INFO(M, ...) fprintf(stdout, "[INFO] " M "\n", ##__VA_ARGS__)
+#if WAVE_LOG_LEVEL <= WAVE_LOG_LEVEL_INFO
+#define LOG_INFO_THROTTLE(period, M, ...) \
+    WAVE_LOG_THROTTLE(LOG_INFO, period, M, ##__VA_ARGS__)
+#else
+#define LOG_INFO_THROTTLE WAVE_LOG_DISABLED
+#endif
 
 /** @} group utils */
 }  // namespace wave
 
-#endif  // WAVE_UTILS_LOGGING_HPP
+#endif  // WAVE_UTILS_LOG_HPP
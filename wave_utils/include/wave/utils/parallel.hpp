@@ -0,0 +1,47 @@
+/** @file
+ * @ingroup utils
+ *
+ * Spreading independent work items over threads.
+ */
+
+#ifndef WAVE_UTILS_PARALLEL_HPP
+#define WAVE_UTILS_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace wave {
+/** @addtogroup utils
+ *  @{ */
+
+/** Call `f(i)` for each `i` in [0, n), spread over up to `num_threads` threads
+ *
+ * The calling thread is one of them, so with one thread (or one item) no
+ * thread is started. Items are handed out one at a time, in increasing order,
+ * so items of uneven cost are balanced between the threads. `f` is called
+ * concurrently for different items, and must not throw.
+ */
+template <typename F>
+void parallelFor(int n, int num_threads, const F &f) {
+    std::atomic<int> next{0};
+    const auto work = [&]() {
+        for (int i = next++; i < n; i = next++) {
+            f(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::min(num_threads, n); t++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/** @} group utils */
+}  // namespace wave
+
+#endif  // WAVE_UTILS_PARALLEL_HPP
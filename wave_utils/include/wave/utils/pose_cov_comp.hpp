@@ -42,6 +42,8 @@
 #ifndef WAVE_UTILS_POSE_COV_COMP_HPP_
 #define WAVE_UTILS_POSE_COV_COMP_HPP_
 
+#include <vector>
+
 #include <Eigen/Dense>
 
 namespace wave {
@@ -72,6 +74,23 @@ struct PoseWithCovariance {
     Eigen::Quaterniond getQuaternion() const;
     Vector7 getPoseQuaternion() const;
     Eigen::Affine3d getTransformMatrix() const;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<PoseWithCovariance,
+                    Eigen::aligned_allocator<PoseWithCovariance>>
+  PoseWithCovarianceVector;
+
+/** Parameterization of `PoseWithCovariance::covariance` */
+enum class CovarianceConvention {
+    /** Covariance of [x y z yaw pitch roll], composed as in [1] */
+    YPR,
+    /** Covariance of the se(3) vector [rho phi] perturbing the pose on the
+     * left, T = exp(xi^) * T_mean. Composing only needs the adjoint of the
+     * first pose, so it is several times faster than YPR and has no
+     * singularity at pitch = +-pi/2. */
+    SE3
 };
 
 /** Calculates the pose composition of two poses and the estimated covariance.
@@ -85,6 +104,48 @@ struct PoseWithCovariance {
  */
 PoseWithCovariance composePose(PoseWithCovariance &p1, PoseWithCovariance &p);
 
+/** Calculates the pose composition of two poses and the estimated covariance,
+ *  with covariances in the given convention.
+ *
+ *  @param p1 first pose with covariance
+ *  @param p2 second pose with covariance
+ *  @param convention parameterization of both input and output covariances
+ *
+ *  @return composed pose with predicted covariance
+ */
+PoseWithCovariance composePose(const PoseWithCovariance &p1,
+                               const PoseWithCovariance &p2,
+                               CovarianceConvention convention);
+
+/** Composes a chain of poses, e.g. odometry increments, so that
+ *  `result[i]` is `poses[0]` composed with `poses[1]` up to `poses[i]`.
+ *
+ *  The result is the same as calling composePose() in a loop, but the forms
+ *  of each pose needed by the Jacobians are only computed once.
+ *
+ *  @param poses chain of poses with covariance
+ *  @param result composed poses, resized to the length of `poses`
+ *  @param convention parameterization of all covariances
+ */
+void composePoseChain(
+  const PoseWithCovarianceVector &poses,
+  PoseWithCovarianceVector &result,
+  CovarianceConvention convention = CovarianceConvention::YPR);
+
+/** Composes several independent chains with composePoseChain(), spread over
+ *  up to `num_threads` threads.
+ *
+ *  @param chains chains of poses with covariance
+ *  @param results composed poses of each chain, resized to match `chains`
+ *  @param convention parameterization of all covariances
+ *  @param num_threads maximum number of threads to use
+ */
+void composePoseChains(
+  const std::vector<PoseWithCovarianceVector> &chains,
+  std::vector<PoseWithCovarianceVector> &results,
+  CovarianceConvention convention = CovarianceConvention::YPR,
+  int num_threads = 1);
+
 /** The Jacobian of quaternion normalization function. Quaternion in the form of
  *  [qr, qx, qt, qz]
  *  Equation (1.7)
@@ -0,0 +1,104 @@
+/** @file
+ * @ingroup utils
+ *
+ * Scoped timers for profiling hot paths.
+ *
+ * `WAVE_PROFILE_SCOPE(name)` records the time from where it appears to the end
+ * of the enclosing scope as one event of the zone `name`, which must be a
+ * string literal. For example:
+ * ```
+ * bool ICPMatcher::match() {
+ *     WAVE_PROFILE_SCOPE("ICPMatcher::match");
+ *     ...
+ * }
+ * ```
+ *
+ * Each thread records its events into a buffer of its own without locking.
+ * `profileStats()` summarizes the events of each zone, and
+ * `writeProfileTrace()` saves them in the Chrome trace format, which can be
+ * opened in `chrome://tracing` or https://ui.perfetto.dev.
+ *
+ * Zones are only recorded when `WAVE_PROFILING` is defined, e.g. by the
+ * `ENABLE_PROFILING` CMake option. Otherwise `WAVE_PROFILE_SCOPE` expands to
+ * nothing.
+ */
+
+#ifndef WAVE_UTILS_PROFILE_HPP
+#define WAVE_UTILS_PROFILE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wave {
+/** @addtogroup utils
+ *  @{ */
+
+/** Summary of the events recorded for one zone, with times in seconds */
+struct ProfileStats {
+    std::string name;
+    size_t count;
+    double total;
+    double mean;
+    double p50;
+    double p99;
+    double max;
+};
+
+/** Records one event of the zone `name`, with times from `profileClock()` */
+void recordProfileEvent(const char *name, int64_t start_ns, int64_t end_ns);
+
+/** @return the time in nanoseconds from a monotonic clock */
+int64_t profileClock();
+
+/** @return statistics for each zone recorded so far, sorted by total time */
+std::vector<ProfileStats> profileStats();
+
+/** @return `profileStats()` as a table, one zone per line */
+std::string profileReport();
+
+/** Saves all events recorded so far as a Chrome trace JSON file.
+ *
+ * @return 0 on success, -1 if the file could not be written
+ */
+int writeProfileTrace(const std::string &file_path);
+
+/** Discards all events recorded so far.
+ *
+ * Must not be called while other threads may be recording events.
+ */
+void resetProfile();
+
+/** Records the lifetime of the object as one event; see WAVE_PROFILE_SCOPE */
+class ProfileScope {
+ public:
+    explicit ProfileScope(const char *name)
+        : name{name}, start_ns{profileClock()} {}
+
+    ~ProfileScope() {
+        recordProfileEvent(this->name, this->start_ns, profileClock());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+ private:
+    const char *name;
+    int64_t start_ns;
+};
+
+#define WAVE_PROFILE_CONCAT_(a, b) a##b
+#define WAVE_PROFILE_CONCAT(a, b) WAVE_PROFILE_CONCAT_(a, b)
+
+#ifdef WAVE_PROFILING
+#define WAVE_PROFILE_SCOPE(name)                                  \
+    ::wave::ProfileScope WAVE_PROFILE_CONCAT(wave_profile_scope_, \
+                                             __LINE__)("" name)
+#else
+#define WAVE_PROFILE_SCOPE(name)
+#endif
+
+/** @} group utils */
+}  // namespace wave
+
+#endif  // WAVE_UTILS_PROFILE_HPP
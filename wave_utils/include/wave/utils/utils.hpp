@@ -14,6 +14,8 @@
 #include "wave/utils/file.hpp"
 #include "wave/utils/log.hpp"
 #include "wave/utils/math.hpp"
+#include "wave/utils/parallel.hpp"
+#include "wave/utils/profile.hpp"
 #include "wave/utils/time.hpp"
 
 #endif  // WAVE_UTILS_UTILS_HPP
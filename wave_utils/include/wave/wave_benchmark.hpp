@@ -0,0 +1,24 @@
+/**
+ * @file
+ * Utility functions used in benchmarks
+ */
+
+#ifndef WAVE_BENCHMARK_HPP
+#define WAVE_BENCHMARK_HPP
+
+#include <fstream>
+#include <unistd.h>
+
+namespace wave {
+
+/** Returns the resident set size of this process, in bytes (Linux only) */
+inline long residentMemory() {
+    long size = 0, resident = 0;
+    std::ifstream statm{"/proc/self/statm"};
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+}  // namespace wave
+
+#endif  // WAVE_BENCHMARK_HPP
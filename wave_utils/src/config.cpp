@@ -1,36 +1,145 @@
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
 #include "wave/utils/config.hpp"
 
 
 namespace wave {
 
+namespace {
+
+/** Splits a yaml key into its elements at each '.' */
+std::vector<std::string> splitKey(const std::string &key) {
+    std::vector<std::string> path;
+    std::string element;
+    std::istringstream iss(key);
+    while (std::getline(iss, element, '.')) {
+        path.push_back(element);
+    }
+    return path;
+}
+
+/** A parsed yaml file, and the state of the file when it was parsed */
+struct CachedConfig {
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    YAML::Node root;
+};
+
+bool sameTime(const struct timespec &a, const struct timespec &b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+/** Whether the file described by `st` is the one that was parsed. Replacing
+ * the file changes its inode, and writing to it changes its status change
+ * time, which unlike the modification time cannot be set back. */
+bool isUnchanged(const CachedConfig &cached, const struct stat &st) {
+    return cached.device == st.st_dev && cached.inode == st.st_ino &&
+           cached.size == st.st_size && sameTime(cached.mtime, st.st_mtim) &&
+           sameTime(cached.ctime, st.st_ctim);
+}
+
+std::mutex config_cache_mutex;
+std::unordered_map<std::string, CachedConfig> config_cache;
+
+/** Gets the parsed yaml file at `config_file`, parsing it only if it is not
+ * cached or has changed since
+ * @throws YAML::ParserException if the file is not valid yaml
+ */
+YAML::Node loadCachedConfig(const std::string &config_file,
+                            const struct stat &st) {
+    {
+        std::lock_guard<std::mutex> lock{config_cache_mutex};
+        const auto it = config_cache.find(config_file);
+        if (it != config_cache.end() && isUnchanged(it->second, st)) {
+            return it->second.root;
+        }
+    }
+
+    // Parse without holding the lock, so other files can be loaded meanwhile
+    const YAML::Node root = YAML::LoadFile(config_file);
+
+    // Assigning a YAML::Node would overwrite the previous tree, which other
+    // parsers may still use, so rebind it with reset() instead
+    std::lock_guard<std::mutex> lock{config_cache_mutex};
+    auto &cached = config_cache[config_file];
+    cached.device = st.st_dev;
+    cached.inode = st.st_ino;
+    cached.size = st.st_size;
+    cached.mtime = st.st_mtim;
+    cached.ctime = st.st_ctim;
+    cached.root.reset(root);
+    return root;
+}
+
+}  // namespace
+
+ConfigParamBase::ConfigParamBase(std::string key, bool optional)
+    : key{std::move(key)}, optional{optional}, path{splitKey(this->key)} {}
+
 ConfigParser::ConfigParser(void) {
     this->config_loaded = false;
 }
 
+ConfigParser &ConfigParser::operator=(const ConfigParser &other) {
+    this->config_loaded = other.config_loaded;
+    // Assigning a YAML::Node would overwrite the tree shared with other
+    // parsers, so rebind it instead
+    this->root.reset(other.root);
+    this->params = other.params;
+    return *this;
+}
+
 ConfigStatus ConfigParser::getYamlNode(const std::string &key,
                                        YAML::Node &node) {
-    std::string element;
-    std::istringstream iss(key);
-    std::vector<YAML::Node> traversal;
+    return this->getYamlNode(splitKey(key), node);
+}
 
+ConfigStatus ConfigParser::getYamlNode(const std::vector<std::string> &path,
+                                       YAML::Node &node) {
+    // Return a copy, so changes to it do not reach the tree shared with other
+    // parsers through the cache
+    YAML::Node found;
+    const auto retval = this->findNode(path, found);
+    node.reset(found ? YAML::Clone(found) : found);
+    return retval;
+}
+
+ConfigStatus ConfigParser::findNode(const std::vector<std::string> &path,
+                                    YAML::Node &node) const {
     // pre-check
     if (this->config_loaded == false) {
         return ConfigStatus::FileError;
     }
 
     // recurse down config key
-    traversal.push_back(this->root);
-    while (std::getline(iss, element, '.')) {
-        traversal.push_back(traversal.back()[element]);
-    }
-    node = traversal.back();
-    // Note:
     //
-    //    yaml_node = yaml_node["some_level_deeper"];
-    //
-    // YAML::Node is mutable, by doing the above it destroys the parsed yaml
-    // tree/graph, to avoid this problem we store the visited YAML::Node into
-    // a std::vector and return the last visited YAML::Node
+    // Only const access is used, as the tree may be shared with other parsers
+    // through the cache. Non-const operator[] can modify the tree, and
+    // assigning one YAML::Node to another overwrites the node it refers to,
+    // so reset() is used to move down instead.
+    const YAML::Node &root = this->root;
+    YAML::Node current{root};
+    for (const auto &element : path) {
+        const YAML::Node &parent = current;
+        if (parent.IsScalar()) {
+            // yaml-cpp throws rather than return an undefined node
+            node.reset(YAML::Node{YAML::NodeType::Undefined});
+            return ConfigStatus::OK;
+        }
+        const YAML::Node child = parent[element];
+        if (!child) {
+            node.reset(YAML::Node{YAML::NodeType::Undefined});
+            return ConfigStatus::OK;
+        }
+        current.reset(child);
+    }
+    node.reset(current);
 
     return ConfigStatus::OK;
 }
@@ -44,7 +153,7 @@ ConfigStatus ConfigParser::checkKey(const std::string &key, bool optional) {
     }
 
     // check key
-    this->getYamlNode(key, node);
+    this->findNode(splitKey(key), node);
     if (!node && optional == false) {
         LOG_ERROR("[%s] missing in yaml file!", key.c_str());
         return ConfigStatus::KeyError;
@@ -58,13 +167,19 @@ ConfigStatus ConfigParser::checkKey(const std::string &key, bool optional) {
 ConfigStatus ConfigParser::loadParam(const ConfigParamBase &param) {
     YAML::Node node;
 
-    // Check that the key exists
-    const auto retval = this->checkKey(param.key, param.optional);
-    if (retval != ConfigStatus::OK) {
-        return retval;
+    // pre-check
+    if (this->config_loaded == false) {
+        return ConfigStatus::FileError;
     }
 
-    this->getYamlNode(param.key, node);
+    // Check that the key exists, using the key path split in advance
+    this->findNode(param.path, node);
+    if (!node && param.optional == false) {
+        LOG_ERROR("[%s] missing in yaml file!", param.key.c_str());
+        return ConfigStatus::KeyError;
+    } else if (!node && param.optional == true) {
+        return ConfigStatus::MissingOptionalKey;
+    }
 
     // Attempt to parse
     try {
@@ -79,13 +194,14 @@ ConfigStatus ConfigParser::loadParam(const ConfigParamBase &param) {
 
 ConfigStatus ConfigParser::load(const std::string &config_file) {
     // pre-check
-    if (file_exists(config_file) == false) {
+    struct stat st;
+    if (stat(config_file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
         LOG_ERROR("File not found: %s", config_file.c_str());
         return ConfigStatus::FileError;
     }
 
-    // load and parse file
-    this->root = YAML::LoadFile(config_file);
+    // load and parse file, or get it from the cache
+    this->root.reset(loadCachedConfig(config_file, st));
     this->config_loaded = true;
 
     for (const auto &param_ptr : this->params) {
@@ -98,6 +214,11 @@ ConfigStatus ConfigParser::load(const std::string &config_file) {
     return ConfigStatus::OK;
 }
 
+void ConfigParser::clearCache() {
+    std::lock_guard<std::mutex> lock{config_cache_mutex};
+    config_cache.clear();
+}
+
 }  // namespace wave
 
 
@@ -1,9 +1,197 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "wave/utils/data.hpp"
+#include "wave/utils/parallel.hpp"
 
 
 namespace wave {
 
-int csvrows(std::string file_path) {
+namespace {
+
+/** Read-only memory map of a whole file, unmapped on destruction */
+class MappedFile {
+ public:
+    explicit MappedFile(const std::string &file_path) {
+        this->fd = open(file_path.c_str(), O_RDONLY);
+        struct stat st;
+        if (this->fd < 0 || fstat(this->fd, &st) != 0) {
+            return;
+        }
+        this->size = static_cast<size_t>(st.st_size);
+        this->ok = true;
+
+        // mmap() does not accept an empty mapping
+        if (this->size > 0) {
+            // Populating the whole mapping up front is faster than faulting
+            // in each page while parsing
+            void *addr = mmap(nullptr,
+                              this->size,
+                              PROT_READ,
+                              MAP_PRIVATE | MAP_POPULATE,
+                              this->fd,
+                              0);
+            if (addr == MAP_FAILED) {
+                this->ok = false;
+                return;
+            }
+            this->data = static_cast<const char *>(addr);
+        }
+    }
+
+    ~MappedFile() {
+        if (this->data) {
+            munmap(const_cast<char *>(this->data), this->size);
+        }
+        if (this->fd >= 0) {
+            close(this->fd);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    int fd = -1;
+    bool ok = false;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+/** Pointer past the end of the line starting at p (including the newline) */
+const char *nextLine(const char *p, const char *end) {
+    const void *newline = std::memchr(p, '\n', end - p);
+    return newline ? static_cast<const char *>(newline) + 1 : end;
+}
+
+/** Number of lines in [begin, end), counting a last line without newline */
+long countLines(const char *begin, const char *end) {
+    long count = std::count(begin, end, '\n');
+    if (end > begin && end[-1] != '\n') {
+        count++;
+    }
+    return count;
+}
+
+/** Slow path of parseField(), for values the fast path does not handle */
+double parseFieldWithStrtod(const char *begin, const char *end) {
+    // strtod needs a null-terminated string, which the mapping is not
+    char buffer[128];
+    const size_t length =
+      std::min(static_cast<size_t>(end - begin), sizeof(buffer) - 1);
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    return std::atof(buffer);
+}
+
+/** Parses the number in the field starting at p and ending at `end` or the
+ * next ',' or newline, and leaves p at that delimiter.
+ *
+ * When the digits fit in 53 bits and the exponent is small, both are exact in
+ * doubles, so one multiplication or division gives the correctly rounded
+ * value. Other values fall back to atof(), which also gives 0 for invalid
+ * fields as the previous getline() and atof() parser did. */
+double parseField(const char *&p, const char *end) {
+    static const double powers_of_ten[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *begin = p;
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool fast = true;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 19) {
+            mantissa = 10 * mantissa + (*p - '0');
+            digits += (mantissa > 0);
+        } else {
+            fast = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+                digits += (mantissa > 0);
+                exponent--;
+            } else {
+                fast = false;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negative_exponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negative_exponent = (*q == '-');
+            q++;
+        }
+        int e = 0;
+        for (; q < end && *q >= '0' && *q <= '9'; q++) {
+            e = std::min(10 * e + (*q - '0'), 100000);
+        }
+        exponent += negative_exponent ? -e : e;
+        p = q;
+    }
+
+    // Anything but trailing whitespace before the delimiter needs the slow
+    // path, e.g. "nan", "inf" or an empty field
+    const char *field_end = p;
+    while (p < end && *p != ',' && *p != '\n') {
+        if (*p != ' ' && *p != '\t' && *p != '\r') {
+            fast = false;
+        }
+        p++;
+    }
+    if (field_end == begin) {
+        fast = false;
+    }
+
+    if (!fast || mantissa > (uint64_t{1} << 53) || exponent < -22 ||
+        exponent > 22) {
+        return parseFieldWithStrtod(begin, p);
+    }
+    const double value = exponent < 0 ? mantissa / powers_of_ten[-exponent]
+                                      : mantissa * powers_of_ten[exponent];
+    return negative ? -value : value;
+}
+
+/** Parses the rows in [begin, end) into `data`, starting at row `first_row` */
+void parseRows(const char *begin, const char *end, long first_row, MatX &data) {
+    const auto nb_cols = data.cols();
+    long row = first_row;
+    for (const char *p = begin; p < end; row++) {
+        const char *line_end = nextLine(p, end);
+        for (int i = 0; i < nb_cols; i++) {
+            data(row, i) = parseField(p, line_end);
+            if (p < line_end && *p == ',') {
+                p++;
+            }
+        }
+        p = line_end;
+    }
+}
+
+}  // namespace
+
+int csvrows(const std::string &file_path) {
     int nb_rows;
     std::string line;
     std::ifstream infile(file_path);
@@ -23,7 +211,7 @@ int csvrows(std::string file_path) {
     return nb_rows;
 }
 
-int csvcols(std::string file_path) {
+int csvcols(const std::string &file_path) {
     int nb_elements;
     std::string line;
     bool found_separator;
@@ -51,74 +239,99 @@ int csvcols(std::string file_path) {
     return (found_separator) ? nb_elements : 0;
 }
 
-int csv2mat(std::string file_path, bool header, MatX &data) {
-    int line_no;
-    int nb_rows;
-    int nb_cols;
-    std::string line;
-    std::ifstream infile(file_path);
-    std::vector<double> vdata;
-    std::string element;
-    double value;
-
+int csv2mat(const std::string &file_path,
+            bool header,
+            MatX &data,
+            int num_threads) {
     // load file
-    if (infile.good() != true) {
+    const MappedFile file{file_path};
+    if (!file.ok) {
         printf(E_CSV_DATA_LOAD, file_path.c_str());
         return -1;
     }
+    const char *begin = file.data;
+    const char *end = file.data + file.size;
 
-    // obtain number of rows and cols
-    nb_rows = csvrows(file_path);
-    nb_cols = csvcols(file_path);
+    // obtain number of cols from the first line
+    const char *first_line_end = nextLine(begin, end);
+    const long nb_cols =
+      (first_line_end > begin) ? std::count(begin, first_line_end, ',') + 1 : 0;
 
     // header line?
     if (header) {
-        std::getline(infile, line);
-        nb_rows -= 1;
+        begin = first_line_end;
     }
 
-    // load data
-    line_no = 0;
-    data.resize(nb_rows, nb_cols);
-    while (std::getline(infile, line)) {
-        std::istringstream ss(line);
-
-        // load data row
-        for (int i = 0; i < nb_cols; i++) {
-            std::getline(ss, element, ',');
-            value = atof(element.c_str());
-            data(line_no, i) = value;
-        }
+    // split into chunks of whole lines, one for each thread, and count the
+    // rows in each so every chunk knows the first row it parses
+    const size_t min_chunk_size = 1 << 20;
+    const int nb_chunks = static_cast<int>(std::max<size_t>(
+      1,
+      std::min<size_t>(std::max(num_threads, 1),
+                       (end - begin) / min_chunk_size)));
+    std::vector<const char *> bounds(nb_chunks + 1, end);
+    bounds[0] = begin;
+    for (int i = 1; i < nb_chunks; i++) {
+        const char *p = begin + (end - begin) * i / nb_chunks;
+        bounds[i] = (p > bounds[i - 1]) ? nextLine(p, end) : bounds[i - 1];
+    }
 
-        line_no++;
+    std::vector<long> first_rows(nb_chunks + 1, 0);
+    parallelFor(nb_chunks, nb_chunks, [&](int i) {
+        first_rows[i + 1] = countLines(bounds[i], bounds[i + 1]);
+    });
+    for (int i = 0; i < nb_chunks; i++) {
+        first_rows[i + 1] += first_rows[i];
     }
 
+    // load data
+    data.resize(first_rows.back(), nb_cols);
+    parallelFor(nb_chunks, nb_chunks, [&](int i) {
+        parseRows(bounds[i], bounds[i + 1], first_rows[i], data);
+    });
+
     return 0;
 }
 
-int mat2csv(std::string file_path, MatX data) {
-    std::ofstream outfile(file_path);
+int mat2csv(const std::string &file_path, const MatX &data) {
+    FILE *outfile = fopen(file_path.c_str(), "w");
 
     // open file
-    if (outfile.good() != true) {
+    if (outfile == nullptr) {
         printf(E_CSV_DATA_OPEN, file_path.c_str());
         return -1;
     }
 
-    // save matrix
+    // save matrix, formatting into a buffer written out in large blocks
+    std::vector<char> buffer(1 << 20);
+    const size_t max_field_size = 32;
+    size_t used = 0;
+    auto reserve = [&]() {
+        if (used + max_field_size > buffer.size()) {
+            fwrite(buffer.data(), 1, used, outfile);
+            used = 0;
+        }
+    };
     for (int i = 0; i < data.rows(); i++) {
         for (int j = 0; j < data.cols(); j++) {
-            outfile << data(i, j);
-
+            reserve();
+            // %g matches the default formatting of std::ostream
+            used += snprintf(
+              buffer.data() + used, max_field_size, "%g", data(i, j));
             if ((j + 1) != data.cols()) {
-                outfile << ",";
+                buffer[used++] = ',';
             }
         }
-        outfile << "\n";
+        reserve();
+        buffer[used++] = '\n';
     }
+    fwrite(buffer.data(), 1, used, outfile);
 
     // close file
-    outfile.close();
+    if (fclose(outfile) != 0) {
+        printf(E_CSV_DATA_OPEN, file_path.c_str());
+        return -1;
+    }
     return 0;
 }
 
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wave/utils/log.hpp"
+
+
+namespace wave {
+
+namespace {
+
+/** Single-producer, single-consumer ring buffer of messages to `out`.
+ *
+ * Each thread that logs owns one. A message is stored as a 4-byte header,
+ * holding its length, followed by the text, and may wrap around the end of
+ * the buffer. `head` and `tail` count bytes written and read in total, so
+ * the space used is their difference.
+ */
+struct LogRing {
+    static const size_t kCapacity = 1 << 16;
+    static const size_t kHeaderSize = sizeof(uint32_t);
+
+    char data[kCapacity];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+
+    /** Set when the owning thread exits; the ring is removed once empty */
+    std::atomic<bool> closed{false};
+
+    void copyIn(size_t pos, const char *src, size_t size) {
+        const size_t offset = pos % kCapacity;
+        const size_t first = std::min(size, kCapacity - offset);
+        std::memcpy(this->data + offset, src, first);
+        std::memcpy(this->data, src + first, size - first);
+    }
+
+    void copyOut(size_t pos, char *dst, size_t size) const {
+        const size_t offset = pos % kCapacity;
+        const size_t first = std::min(size, kCapacity - offset);
+        std::memcpy(dst, this->data + offset, first);
+        std::memcpy(dst + first, this->data, size - first);
+    }
+};
+
+// Longer messages are truncated, so that any message fits in a ring
+const size_t kMaxMessageSize = LogRing::kCapacity / 4;
+
+/** The background writer and the rings of all threads.
+ *
+ * It is never destroyed, so that logging from static destructors is safe;
+ * at exit the background thread is stopped and logging becomes synchronous.
+ */
+class Logger {
+ public:
+    static Logger &instance() {
+        static Logger *logger = new Logger;
+        return *logger;
+    }
+
+    /** Gets the ring of the calling thread, creating it on first use */
+    LogRing *threadRing() {
+        thread_local ThreadRing thread_ring;
+        if (!thread_ring.ring) {
+            thread_ring.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->rings.push_back(thread_ring.ring);
+            if (!this->flusher.joinable() && !this->stopped) {
+                this->flusher = std::thread{&Logger::run, this};
+                std::atexit([]() { Logger::instance().stop(); });
+            }
+        }
+        return thread_ring.ring.get();
+    }
+
+    void push(LogStream stream, const char *message, size_t size) {
+        if (!this->asynchronous.load(std::memory_order_relaxed)) {
+            this->write(stream, message, size);
+            return;
+        }
+
+        // Errors and warnings are written before returning, so they are not
+        // lost if the program then crashes. Queued messages go first, to
+        // keep the order of the output.
+        if (stream == LogStream::Err) {
+            std::lock_guard<std::mutex> drain_lock{this->drain_mutex};
+            this->drainLocked();
+            this->write(stream, message, size);
+            return;
+        }
+
+        LogRing &ring = *this->threadRing();
+        const size_t needed = LogRing::kHeaderSize + size;
+        const size_t head = ring.head.load(std::memory_order_relaxed);
+
+        // If the ring is full, wait for the writer rather than drop messages
+        while (LogRing::kCapacity -
+                 (head - ring.tail.load(std::memory_order_acquire)) <
+               needed) {
+            if (!this->asynchronous.load(std::memory_order_relaxed)) {
+                this->write(LogStream::Out, message, size);
+                return;
+            }
+            this->wake.notify_one();
+            std::this_thread::yield();
+        }
+
+        const uint32_t header = static_cast<uint32_t>(size);
+        ring.copyIn(
+          head, reinterpret_cast<const char *>(&header), sizeof(header));
+        ring.copyIn(head + LogRing::kHeaderSize, message, size);
+        ring.head.store(head + needed, std::memory_order_release);
+
+        // Wake the writer early if the ring is filling up
+        if (head + needed - ring.tail.load(std::memory_order_relaxed) >
+            LogRing::kCapacity / 2) {
+            this->wake.notify_one();
+        }
+    }
+
+    /** Writes out all messages in all rings */
+    void drain() {
+        std::lock_guard<std::mutex> drain_lock{this->drain_mutex};
+        this->drainLocked();
+    }
+
+    /** drain(), with `drain_mutex` already locked */
+    void drainLocked() {
+        std::vector<std::shared_ptr<LogRing>> current;
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            current = this->rings;
+        }
+
+        for (const auto &ring : current) {
+            // Check closed first: once it is set, no more messages will come
+            const bool closed = ring->closed.load(std::memory_order_acquire);
+            const size_t head = ring->head.load(std::memory_order_acquire);
+            size_t tail = ring->tail.load(std::memory_order_relaxed);
+
+            // The messages of a ring are written together
+            this->buffer.clear();
+            while (tail < head) {
+                uint32_t size;
+                ring->copyOut(
+                  tail, reinterpret_cast<char *>(&size), sizeof(size));
+                const size_t offset = this->buffer.size();
+                this->buffer.resize(offset + size);
+                ring->copyOut(
+                  tail + LogRing::kHeaderSize, &this->buffer[offset], size);
+                tail += LogRing::kHeaderSize + size;
+            }
+            ring->tail.store(tail, std::memory_order_release);
+            if (!this->buffer.empty()) {
+                this->write(
+                  LogStream::Out, this->buffer.data(), this->buffer.size());
+            }
+
+            if (closed) {
+                std::lock_guard<std::mutex> lock{this->mutex};
+                this->rings.erase(
+                  std::find(this->rings.begin(), this->rings.end(), ring));
+            }
+        }
+    }
+
+    void write(LogStream stream, const char *message, size_t size) {
+        std::lock_guard<std::mutex> lock{this->output_mutex};
+        FILE *file = (stream == LogStream::Err) ? this->err : this->out;
+        fwrite(message, 1, size, file);
+        fflush(file);
+    }
+
+    void setOutput(FILE *out, FILE *err) {
+        this->drain();
+        std::lock_guard<std::mutex> lock{this->output_mutex};
+        this->out = out;
+        this->err = err;
+    }
+
+    void setAsynchronous(bool asynchronous) {
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->asynchronous = asynchronous && !this->stopped;
+        }
+        this->drain();
+    }
+
+    /** Stops the background thread and writes out remaining messages */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->stopped = true;
+            this->asynchronous = false;
+        }
+        this->wake.notify_one();
+        if (this->flusher.joinable()) {
+            this->flusher.join();
+        }
+        this->drain();
+    }
+
+ private:
+    /** Marks the ring closed when its thread exits */
+    struct ThreadRing {
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing() {
+            if (this->ring) {
+                this->ring->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    Logger() = default;
+
+    void run() {
+        std::unique_lock<std::mutex> lock{this->mutex};
+        while (!this->stopped) {
+            lock.unlock();
+            this->drain();
+            lock.lock();
+            this->wake.wait_for(lock, std::chrono::milliseconds{10});
+        }
+    }
+
+    std::mutex mutex;  // guards rings and stopped
+    std::vector<std::shared_ptr<LogRing>> rings;
+    bool stopped = false;
+    std::atomic<bool> asynchronous{true};
+    std::condition_variable wake;
+    std::thread flusher;
+
+    std::mutex drain_mutex;  // only one thread may read the rings at a time
+    std::string buffer;
+
+    std::mutex output_mutex;  // guards the output files
+    FILE *out = stdout;
+    FILE *err = stderr;
+};
+
+}  // namespace
+
+void logMessage(LogStream stream, const char *format, ...) {
+    char small[512];
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    const int length = vsnprintf(small, sizeof(small), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        va_end(args_copy);
+        return;
+    }
+    auto &logger = Logger::instance();
+    if (static_cast<size_t>(length) < sizeof(small)) {
+        va_end(args_copy);
+        logger.push(stream, small, length);
+        return;
+    }
+
+    // Long message, e.g. a solver report
+    std::vector<char> large(std::min<size_t>(length + 1, kMaxMessageSize));
+    vsnprintf(large.data(), large.size(), format, args_copy);
+    va_end(args_copy);
+    if (large.size() < static_cast<size_t>(length) + 1) {
+        // Truncated; keep the line ending
+        large[large.size() - 2] = '\n';
+    }
+    logger.push(stream, large.data(), large.size() - 1);
+}
+
+void flushLog() {
+    Logger::instance().drain();
+}
+
+void setLogOutput(FILE *out, FILE *err) {
+    Logger::instance().setOutput(out, err);
+}
+
+void setLogAsynchronous(bool asynchronous) {
+    Logger::instance().setAsynchronous(asynchronous);
+}
+
+LogThrottle::LogThrottle(double period)
+    : period_ns{static_cast<int64_t>(period * 1e9)},
+      next_ns{0},
+      nb_suppressed{0} {}
+
+bool LogThrottle::check(int &suppressed) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+    int64_t next = this->next_ns.load(std::memory_order_relaxed);
+    if (now < next ||
+        !this->next_ns.compare_exchange_strong(next, now + this->period_ns)) {
+        this->nb_suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = this->nb_suppressed.exchange(0);
+    return true;
+}
+
+}  // namespace wave
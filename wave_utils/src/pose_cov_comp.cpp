@@ -35,10 +35,215 @@
  */
 
 #include "wave/utils/pose_cov_comp.hpp"
+#include "wave/utils/parallel.hpp"
 #include <Eigen/Dense>
 
 namespace wave {
 
+namespace {
+
+typedef Eigen::Matrix<double, 4, 3, Eigen::RowMajor> Matrix4x3;
+
+/** The forms of a pose used by the YPR composition Jacobians.
+ *
+ * As in the Jacobians of [1], the quaternion is computed from the angles,
+ * rather than directly from the rotation matrix. It and its Jacobian share
+ * the sines and cosines of the half angles.
+ */
+struct YPRPose {
+    explicit YPRPose(const PoseWithCovariance &p)
+        : ypr{pose_comp::rotMatrixToYPR(p.rotation_matrix)} {
+        const double cy = cos(ypr(0) / 2), sy = sin(ypr(0) / 2);
+        const double cp = cos(ypr(1) / 2), sp = sin(ypr(1) / 2);
+        const double cr = cos(ypr(2) / 2), sr = sin(ypr(2) / 2);
+        const double ccc = cr * cp * cy, ccs = cr * cp * sy,
+                     csc = cr * sp * cy, scs = sr * cp * sy,
+                     css = cr * sp * sy, scc = sr * cp * cy,
+                     ssc = sr * sp * cy, sss = sr * sp * sy;
+
+        // Equations (2.3) to (2.6), as in pose_comp::yprToQuat()
+        this->q.w() = ccc + sss;
+        this->q.x() = scc - css;
+        this->q.y() = csc + scs;
+        this->q.z() = ccs - ssc;
+
+        // Equation (2.8), as in jacobian_p6_to_p7_wrt_p()
+        // clang-format off
+        this->dq_dypr << ssc - ccs, scs - csc, css - scc,
+                         -(csc + scs), -(ssc + ccs), ccc + sss,
+                         scc - css, ccc - sss, ccs - ssc,
+                         ccc + sss, -(css + scc), -(csc + scs);
+        // clang-format on
+        this->dq_dypr /= 2.0;
+    }
+
+    Vector3 ypr;
+    Eigen::Quaterniond q;
+
+    /** Jacobian of [qr qx qy qz] wrt [yaw pitch roll] */
+    Matrix4x3 dq_dypr;
+};
+
+/** Jacobian of [yaw pitch roll] wrt a unit quaternion [qr qx qy qz].
+ *  Equation (2.10), sharing the terms of jacobian_Quat_Norm_to_Rpy_wrt_q().
+ */
+Matrix3x4 yprWrtQuat(const Eigen::Quaterniond &q) {
+    const double qr = q.w(), qx = q.x(), qy = q.y(), qz = q.z();
+    const double delta = qr * qy - qx * qz;
+    if (fabs(fabs(delta) - 0.5) < 1e-10) {
+        return jacobian_Quat_Norm_to_Rpy_wrt_q(Vector4{qr, qx, qy, qz});
+    }
+
+    // yaw = atan2(n_y, d_y), pitch = asin(2 * delta), roll = atan2(n_r, d_r)
+    const double n_y = 2 * (qr * qz + qx * qy);
+    const double d_y = 1 - 2 * (qy * qy + qz * qz);
+    const double n_r = 2 * (qr * qx + qy * qz);
+    const double d_r = 1 - 2 * (qx * qx + qy * qy);
+    const double k_y = 2 / (n_y * n_y + d_y * d_y);
+    const double k_p = 2 / sqrt(1 - 4 * delta * delta);
+    const double k_r = 2 / (n_r * n_r + d_r * d_r);
+
+    Matrix3x4 m;
+    // clang-format off
+    m << k_y * qz * d_y, k_y * qy * d_y,
+         k_y * (qx * d_y + 2 * qy * n_y), k_y * (qr * d_y + 2 * qz * n_y),
+         k_p * qy, -k_p * qz, k_p * qr, -k_p * qx,
+         k_r * qx * d_r, k_r * (qr * d_r + 2 * qx * n_r),
+         k_r * (qz * d_r + 2 * qy * n_r), k_r * qy * d_r;
+    // clang-format on
+    return m;
+}
+
+/** Jacobian of rotating the point a by a quaternion, wrt the quaternion.
+ *  Equation (3.9)
+ */
+Matrix3x4 pointWrtQuat(const Eigen::Quaterniond &q, const Vector3 &a) {
+    const double qr = q.w(), qx = q.x(), qy = q.y(), qz = q.z();
+    const double ax = a(0), ay = a(1), az = a(2);
+
+    Matrix3x4 m;
+    // clang-format off
+    m << -qz*ay+qy*az, qy*ay+qz*az, -2*qy*ax+qx*ay+qr*az, -2*qz*ax-qr*ay+qx*az,
+         qz*ax-qx*az, qy*ax-2*qx*ay-qr*az, qx*ax+qz*az, qr*ax-2*qz*ay+qy*az,
+         -qy*ax+qx*ay, qz*ax+qr*ay-2*qx*az, -qr*ax+qz*ay-2*qy*az, qx*ax+qy*ay;
+    // clang-format on
+    return 2 * m;
+}
+
+/** Matrix of q1 * q with respect to q, for the quaternion product of
+ *  Equation (5.9) */
+Matrix4x4 quatLeftProduct(const Eigen::Quaterniond &q1) {
+    const double qr = q1.w(), qx = q1.x(), qy = q1.y(), qz = q1.z();
+    Matrix4x4 m;
+    // clang-format off
+    m << qr, -qx, -qy, -qz,
+         qx, qr, -qz, qy,
+         qy, qz, qr, -qx,
+         qz, -qy, qx, qr;
+    // clang-format on
+    return m;
+}
+
+/** Matrix of q * q2 with respect to q, for the quaternion product of
+ *  Equation (5.8) */
+Matrix4x4 quatRightProduct(const Eigen::Quaterniond &q2) {
+    const double qr = q2.w(), qx = q2.x(), qy = q2.y(), qz = q2.z();
+    Matrix4x4 m;
+    // clang-format off
+    m << qr, -qx, -qy, -qz,
+         qx, qr, qz, -qy,
+         qy, -qz, qr, qx,
+         qz, qy, -qx, qr;
+    // clang-format on
+    return m;
+}
+
+/** Composes p1 and p2 with YPR covariances into r; see composePose().
+ *
+ * @return the forms of r, for composing it with the next pose in a chain
+ *
+ * This is Equations (5.2) to (5.4) with the products of the p6 to p7, p7
+ * composition and p7 to p6 Jacobians worked out by blocks. Their
+ * quaternion normalization Jacobians are left out, since the quaternions are
+ * unit and, applied to the derivative of a unit quaternion, they are the
+ * identity.
+ */
+YPRPose composeYPR(const PoseWithCovariance &p1,
+                   const YPRPose &f1,
+                   const PoseWithCovariance &p2,
+                   const YPRPose &f2,
+                   PoseWithCovariance &r) {
+    const Matrix3x3 &R1 = p1.rotation_matrix;
+    r.position = p1.position + R1 * p2.position;
+    r.rotation_matrix = R1 * p2.rotation_matrix;
+
+    // The angles of the composed pose are linearized at its own quaternion,
+    // with the sign of f1.q * f2.q, which the Jacobians below are taken at
+    const YPRPose fr{r};
+    Eigen::Quaterniond q = fr.q;
+    const Eigen::Quaterniond q12 = f1.q * f2.q;
+    if (q.coeffs().dot(q12.coeffs()) < 0) {
+        q.coeffs() = -q.coeffs();
+    }
+    const Matrix3x4 dypr_dq = yprWrtQuat(q);
+
+    // Equation (5.3) is [I G; 0 H], and Equation (5.4) is [R1 0; 0 K]
+    const Matrix3x3 G = pointWrtQuat(f1.q, p2.position) * f1.dq_dypr;
+    const Matrix3x3 H = dypr_dq * (quatRightProduct(f2.q) * f1.dq_dypr);
+    const Matrix3x3 K = dypr_dq * (quatLeftProduct(f1.q) * f2.dq_dypr);
+
+    // Equation (5.2), by 3x3 blocks [A B; C D] of the covariances
+    const Matrix6x6 &cov1 = p1.covariance, &cov2 = p2.covariance;
+    const Matrix3x3 A1 = cov1.topLeftCorner<3, 3>(),
+                    B1 = cov1.topRightCorner<3, 3>(),
+                    C1 = cov1.bottomLeftCorner<3, 3>(),
+                    D1 = cov1.bottomRightCorner<3, 3>();
+    const Matrix3x3 B1_GD1 = B1 + G * D1;
+    const Matrix3x3 A2_R1 = cov2.topLeftCorner<3, 3>() * R1.transpose();
+    const Matrix3x3 C2_R1 = cov2.bottomLeftCorner<3, 3>() * R1.transpose();
+
+    r.covariance.topLeftCorner<3, 3>() =
+      A1 + G * C1 + B1_GD1 * G.transpose() + R1 * A2_R1;
+    r.covariance.topRightCorner<3, 3>() =
+      B1_GD1 * H.transpose() +
+      R1 * cov2.topRightCorner<3, 3>() * K.transpose();
+    r.covariance.bottomLeftCorner<3, 3>() =
+      H * (C1 + D1 * G.transpose()) + K * C2_R1;
+    r.covariance.bottomRightCorner<3, 3>() =
+      H * D1 * H.transpose() +
+      K * cov2.bottomRightCorner<3, 3>() * K.transpose();
+    return fr;
+}
+
+/** Composes p1 and p2 with SE(3) covariances into r; see composePose().
+ *
+ * With left perturbations, exp(xi1^) T1 exp(xi2^) T2 is, to first order,
+ * exp((xi1 + Ad(T1) xi2)^) T1 T2, so the covariance is
+ * cov1 + Ad(T1) cov2 Ad(T1)^T.
+ */
+void composeSE3(const PoseWithCovariance &p1,
+                const PoseWithCovariance &p2,
+                PoseWithCovariance &r) {
+    const Matrix3x3 &R1 = p1.rotation_matrix;
+    const Vector3 &t1 = p1.position;
+    r.position = t1 + R1 * p2.position;
+    r.rotation_matrix = R1 * p2.rotation_matrix;
+
+    Matrix3x3 t1_skew;
+    // clang-format off
+    t1_skew << 0, -t1(2), t1(1),
+               t1(2), 0, -t1(0),
+               -t1(1), t1(0), 0;
+    // clang-format on
+    Matrix6x6 adjoint;
+    adjoint << R1, t1_skew * R1, Matrix3x3::Zero(), R1;
+    r.covariance =
+      p1.covariance + adjoint * p2.covariance * adjoint.transpose();
+}
+
+}  // namespace
+
+
 PoseWithCovariance::PoseWithCovariance() {
     this->position.setZero();
     this->rotation_matrix.setIdentity();
@@ -102,60 +307,53 @@ Eigen::Affine3d PoseWithCovariance::getTransformMatrix() const {
 }
 
 PoseWithCovariance composePose(PoseWithCovariance &p1, PoseWithCovariance &p2) {
+    return composePose(p1, p2, CovarianceConvention::YPR);
+}
+
+PoseWithCovariance composePose(const PoseWithCovariance &p1,
+                               const PoseWithCovariance &p2,
+                               CovarianceConvention convention) {
     PoseWithCovariance r;  // store all the results
+    if (convention == CovarianceConvention::SE3) {
+        composeSE3(p1, p2, r);
+    } else {
+        composeYPR(p1, YPRPose{p1}, p2, YPRPose{p2}, r);
+    }
+    return r;
+}
 
-    // Use Eigen Transform to transform poses
-    // This is the same as implementing Equation (5.5)
-    Eigen::Affine3d T_p1, T_p2, T_r;
-    T_p1 = p1.getTransformMatrix();
-    T_p2 = p2.getTransformMatrix();
-    T_r = T_p1 * T_p2;
-
-    r.position = T_r.translation();
-    r.rotation_matrix = T_r.rotation();
-
-    // compute the covariances
-    // p6 = [x y z roll pitch yaw]', transformation using YPR
-    // p7 = [x y z qr, qx, qy, qz]', transformation using Quaternion, qr is qw
-
-    // get covariances from PoseWithCovariance objects
-    Matrix6x6 cov_p1 = p1.covariance, cov_p2 = p2.covariance;
-
-    // pR7 is the composed pose in p7 form
-    // p17 is the p1 in p7 form, p27 is p2 in p7 form, p16 is p1 in p6 form,
-    // p26 is p2 in p6 form
-    Vector7 pR7, p17, p27;
-    Vector6 p16, p26;
-
-    pR7 = r.getPoseQuaternion();
-    p17 = p1.getPoseQuaternion();
-    p27 = p2.getPoseQuaternion();
-
-    p16 << p1.getPosition(), pose_comp::quatToYPR(p1.getQuaternion());
-    p26 << p2.getPosition(), pose_comp::quatToYPR(p2.getQuaternion());
-
-    // Equation (5.3)
-    Matrix6x7 jacobian_p7_to_p6 = jacobian_p7_to_p6_wrt_p(pR7);
-    Matrix7x7 jacobian_p7_p7_composition =
-      jacobian_p7_p7_Composition_wrt_p1(p17, p27);
-    Matrix7x6 jacobian_p6_to_p7 = jacobian_p6_to_p7_wrt_p(p16);
-    Matrix6x6 dfpc_dp =
-      jacobian_p7_to_p6 * jacobian_p7_p7_composition * jacobian_p6_to_p7;
-
-    // Equation (5.4)
-    jacobian_p7_p7_composition = jacobian_p7_p7_Composition_wrt_p2(p17, p27);
-    jacobian_p6_to_p7 = jacobian_p6_to_p7_wrt_p(p26);
-    Matrix6x6 dfpc_dq =
-      jacobian_p7_to_p6 * jacobian_p7_p7_composition * jacobian_p6_to_p7;
-
-    // Equation (5.2)
-    // putting everything together
-    Matrix6x6 final_cov = dfpc_dp * cov_p1 * dfpc_dp.transpose() +
-                          dfpc_dq * cov_p2 * dfpc_dq.transpose();
-
-    r.covariance = final_cov;
+void composePoseChain(const PoseWithCovarianceVector &poses,
+                      PoseWithCovarianceVector &result,
+                      CovarianceConvention convention) {
+    result.resize(poses.size());
+    if (poses.empty()) {
+        return;
+    }
 
-    return r;
+    result[0] = poses[0];
+    if (convention == CovarianceConvention::SE3) {
+        for (size_t i = 1; i < poses.size(); i++) {
+            composeSE3(result[i - 1], poses[i], result[i]);
+        }
+        return;
+    }
+
+    // Each pose is converted once, rather than in every composition using it
+    YPRPose composed{poses[0]};
+    for (size_t i = 1; i < poses.size(); i++) {
+        composed = composeYPR(
+          result[i - 1], composed, poses[i], YPRPose{poses[i]}, result[i]);
+    }
+}
+
+void composePoseChains(const std::vector<PoseWithCovarianceVector> &chains,
+                       std::vector<PoseWithCovarianceVector> &results,
+                       CovarianceConvention convention,
+                       int num_threads) {
+    results.resize(chains.size());
+    parallelFor(static_cast<int>(chains.size()), num_threads, [&](int i) {
+        composePoseChain(chains[i], results[i], convention);
+    });
 }
 
 /// the jacobian of quaternion normalization function
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "wave/utils/log.hpp"
+#include "wave/utils/profile.hpp"
+
+
+namespace wave {
+
+namespace {
+
+struct ProfileEvent {
+    const char *name;
+    int64_t start_ns;
+    int64_t end_ns;
+};
+
+/** Fixed-size block of events in a thread's buffer.
+ *
+ * Only the owning thread appends. It publishes each event by incrementing
+ * `size`, and a full block by setting `next`, so other threads can read the
+ * events published so far without locking.
+ */
+struct ProfileBlock {
+    static const size_t kCapacity = 4096;
+
+    ProfileEvent events[kCapacity];
+    std::atomic<size_t> size{0};
+    std::atomic<ProfileBlock *> next{nullptr};
+};
+
+/** The events recorded by one thread, kept after the thread exits */
+struct ThreadBuffer {
+    explicit ThreadBuffer(int thread_index)
+        : thread_index{thread_index},
+          first{new ProfileBlock},
+          last{first} {}
+
+    ~ThreadBuffer() {
+        this->clear();
+        delete this->first;
+    }
+
+    /** Discards all events; the owning thread must not be recording */
+    void clear() {
+        ProfileBlock *block = this->first->next.load();
+        while (block) {
+            ProfileBlock *next = block->next.load();
+            delete block;
+            block = next;
+        }
+        this->first->next.store(nullptr);
+        this->first->size.store(0);
+        this->last = this->first;
+    }
+
+    void record(const ProfileEvent &event) {
+        ProfileBlock *block = this->last;
+        size_t size = block->size.load(std::memory_order_relaxed);
+        if (size == ProfileBlock::kCapacity) {
+            auto next = new ProfileBlock;
+            block->next.store(next, std::memory_order_release);
+            this->last = block = next;
+            size = 0;
+        }
+        block->events[size] = event;
+        block->size.store(size + 1, std::memory_order_release);
+    }
+
+    /** Appends the events published so far to `events` */
+    void copyEvents(std::vector<ProfileEvent> &events) const {
+        for (const ProfileBlock *block = this->first; block;
+             block = block->next.load(std::memory_order_acquire)) {
+            const size_t size = block->size.load(std::memory_order_acquire);
+            events.insert(
+              events.end(), block->events, block->events + size);
+        }
+    }
+
+    const int thread_index;
+    ProfileBlock *const first;
+    ProfileBlock *last;  // only used by the owning thread
+};
+
+class ProfileRegistry {
+ public:
+    static ProfileRegistry &instance() {
+        // Never destroyed, so zones in static destructors are safe to record
+        static ProfileRegistry *registry = new ProfileRegistry;
+        return *registry;
+    }
+
+    /** Gets the buffer of the calling thread, creating it on first use */
+    ThreadBuffer &threadBuffer() {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            const int index = static_cast<int>(this->buffers.size());
+            this->buffers.emplace_back(new ThreadBuffer{index});
+            buffer = this->buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    /** Calls f(buffer) for the buffer of each thread */
+    template <typename F>
+    void forEachBuffer(const F &f) {
+        std::lock_guard<std::mutex> lock{this->mutex};
+        for (const auto &buffer : this->buffers) {
+            f(*buffer);
+        }
+    }
+
+ private:
+    ProfileRegistry() = default;
+
+    std::mutex mutex;  // guards the list of buffers, not their contents
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+/** Event durations in nanoseconds, by zone name */
+std::map<std::string, std::vector<int64_t>> durationsByZone() {
+    std::map<std::string, std::vector<int64_t>> durations;
+    std::vector<ProfileEvent> events;
+    ProfileRegistry::instance().forEachBuffer(
+      [&](const ThreadBuffer &buffer) { buffer.copyEvents(events); });
+    for (const auto &event : events) {
+        durations[event.name].push_back(event.end_ns - event.start_ns);
+    }
+    return durations;
+}
+
+/** Nearest-rank percentile `q` of sorted `values` */
+int64_t percentile(const std::vector<int64_t> &values, double q) {
+    const auto rank = static_cast<size_t>(std::ceil(q * values.size()));
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+/** Writes `text` as a JSON string, with quotes */
+void writeJsonString(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+}  // namespace
+
+void recordProfileEvent(const char *name, int64_t start_ns, int64_t end_ns) {
+    ProfileRegistry::instance().threadBuffer().record(
+      ProfileEvent{name, start_ns, end_ns});
+}
+
+int64_t profileClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::vector<ProfileStats> profileStats() {
+    std::vector<ProfileStats> stats;
+    for (auto &zone : durationsByZone()) {
+        auto &durations = zone.second;
+        std::sort(durations.begin(), durations.end());
+
+        int64_t total = 0;
+        for (const auto duration : durations) {
+            total += duration;
+        }
+        ProfileStats zone_stats;
+        zone_stats.name = zone.first;
+        zone_stats.count = durations.size();
+        zone_stats.total = total * 1e-9;
+        zone_stats.mean = zone_stats.total / durations.size();
+        zone_stats.p50 = percentile(durations, 0.5) * 1e-9;
+        zone_stats.p99 = percentile(durations, 0.99) * 1e-9;
+        zone_stats.max = durations.back() * 1e-9;
+        stats.push_back(zone_stats);
+    }
+
+    std::sort(stats.begin(),
+              stats.end(),
+              [](const ProfileStats &a, const ProfileStats &b) {
+                  return a.total > b.total;
+              });
+    return stats;
+}
+
+std::string profileReport() {
+    std::string report;
+    char line[256];
+    snprintf(line,
+             sizeof(line),
+             "%-40s %8s %12s %10s %10s %10s %10s\n",
+             "zone",
+             "count",
+             "total [ms]",
+             "mean [ms]",
+             "p50 [ms]",
+             "p99 [ms]",
+             "max [ms]");
+    report += line;
+    for (const auto &zone : profileStats()) {
+        snprintf(line,
+                 sizeof(line),
+                 "%-40s %8zu %12.3f %10.3f %10.3f %10.3f %10.3f\n",
+                 zone.name.c_str(),
+                 zone.count,
+                 zone.total * 1e3,
+                 zone.mean * 1e3,
+                 zone.p50 * 1e3,
+                 zone.p99 * 1e3,
+                 zone.max * 1e3);
+        report += line;
+    }
+    return report;
+}
+
+int writeProfileTrace(const std::string &file_path) {
+    FILE *file = fopen(file_path.c_str(), "w");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open [%s] for writing", file_path.c_str());
+        return -1;
+    }
+
+    // Complete ("X") events, with times in microseconds as the format expects
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first = true;
+    std::vector<ProfileEvent> events;
+    ProfileRegistry::instance().forEachBuffer([&](const ThreadBuffer &buffer) {
+        events.clear();
+        buffer.copyEvents(events);
+        for (const auto &event : events) {
+            fprintf(file, first ? "\n{\"name\":" : ",\n{\"name\":");
+            writeJsonString(file, event.name);
+            fprintf(file,
+                    ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer.thread_index,
+                    event.start_ns * 1e-3,
+                    (event.end_ns - event.start_ns) * 1e-3);
+            first = false;
+        }
+    });
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0) {
+        LOG_ERROR("Failed to write [%s]", file_path.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+void resetProfile() {
+    ProfileRegistry::instance().forEachBuffer(
+      [](ThreadBuffer &buffer) { buffer.clear(); });
+}
+
+}  // namespace wave
@@ -0,0 +1,74 @@
+/** @file
+ * Time to load a batch of param objects from the same config file.
+ *
+ * Each param object binds every key of the test config, the way params structs
+ * such as the matchers' build a `ConfigParser`. The argument is the number of
+ * objects in the batch. Clearing the cache before each object gives the cost
+ * of parsing the file every time, as `ConfigParser` did before the cache.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/config.hpp"
+
+namespace wave {
+
+const auto TEST_CONFIG = "tests/data/config.yaml";
+
+/** Params covering all the supported types */
+struct TestParams {
+    bool b;
+    int i;
+    double d;
+    std::string s;
+    std::vector<double> d_array;
+    Vec3 vec3;
+    VecX vecx;
+    Mat3 mat3;
+    MatX matx;
+    int nested;
+
+    ConfigStatus load(const std::string &config_file) {
+        ConfigParser parser;
+        parser.addParam("bool", &this->b);
+        parser.addParam("int", &this->i);
+        parser.addParam("double", &this->d);
+        parser.addParam("string", &this->s);
+        parser.addParam("double_array", &this->d_array);
+        parser.addParam("vector3", &this->vec3);
+        parser.addParam("vector", &this->vecx);
+        parser.addParam("matrix3", &this->mat3);
+        parser.addParam("matrix", &this->matx);
+        parser.addParam("level3.a.b.c", &this->nested);
+        return parser.load(config_file);
+    }
+};
+
+void BM_LoadParamsUncached(benchmark::State &state) {
+    std::vector<TestParams> params(state.range(0));
+    for (auto _ : state) {
+        for (auto &p : params) {
+            ConfigParser::clearCache();
+            p.load(TEST_CONFIG);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * params.size());
+}
+
+void BM_LoadParamsCached(benchmark::State &state) {
+    std::vector<TestParams> params(state.range(0));
+    for (auto _ : state) {
+        ConfigParser::clearCache();
+        for (auto &p : params) {
+            p.load(TEST_CONFIG);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * params.size());
+}
+
+BENCHMARK(BM_LoadParamsUncached)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadParamsCached)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
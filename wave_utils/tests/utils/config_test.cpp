@@ -1,3 +1,6 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include "wave/wave_test.hpp"
 #include "wave/utils/data.hpp"
 #include "wave/utils/config.hpp"
@@ -83,8 +86,7 @@ TEST(Utils_config_ConfigParser, loadPrimitive) {
     wave::ConfigParser parser;
 
     // setup
-    parser.root = YAML::LoadFile(TEST_CONFIG);
-    parser.config_loaded = true;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(TEST_CONFIG));
 
     // INTEGER
     wave::ConfigParam<int> int_param{"int", &i, false};
@@ -116,8 +118,7 @@ TEST(Utils_config_ConfigParser, loadArray) {
     wave::ConfigParser parser;
 
     // setup
-    parser.root = YAML::LoadFile(TEST_CONFIG);
-    parser.config_loaded = true;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(TEST_CONFIG));
 
     // BOOL ARRAY
     wave::ConfigParam<std::vector<bool>> b_param{"bool_array", &b_array};
@@ -167,8 +168,7 @@ TEST(Utils_config_ConfigParser, loadVector) {
     wave::ConfigStatus res;
 
     // setup
-    parser.root = YAML::LoadFile(TEST_CONFIG);
-    parser.config_loaded = true;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(TEST_CONFIG));
 
     // VECTOR 2
     wave::ConfigParam<wave::Vec2> vec2_param{"vector2", &vec2};
@@ -216,8 +216,7 @@ TEST(Utils_config_ConfigParser, loadMatrix) {
     wave::ConfigParser parser;
 
     // setup
-    parser.root = YAML::LoadFile(TEST_CONFIG);
-    parser.config_loaded = true;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(TEST_CONFIG));
 
     // MATRIX 2
     wave::ConfigParam<wave::Mat2> mat2_param{"matrix2", &mat2};
@@ -333,3 +332,132 @@ TEST(Utils_config_ConfigParser, load) {
     std::cout << "matrix: \n" << matx << std::endl;
     std::cout << std::endl;
 }
+
+TEST(Utils_config_ConfigParser, loadMissingKeys) {
+    int i;
+    wave::ConfigParser parser;
+    parser.load(TEST_CONFIG);
+
+    // Missing keys below a present key, and below a scalar
+    wave::ConfigParam<int> missing_param{"level3.a.x.c", &i};
+    wave::ConfigParam<int> below_scalar_param{"int.a", &i};
+    wave::ConfigParam<int> optional_param{"level3.a.x", &i, true};
+    EXPECT_EQ(wave::ConfigStatus::KeyError, parser.loadParam(missing_param));
+    EXPECT_EQ(wave::ConfigStatus::KeyError,
+              parser.loadParam(below_scalar_param));
+    EXPECT_EQ(wave::ConfigStatus::MissingOptionalKey,
+              parser.loadParam(optional_param));
+
+    // Looking up missing keys must not change the parsed tree
+    YAML::Node node;
+    parser.getYamlNode("level3.a.b.c", node);
+    ASSERT_EQ(3, node.as<int>());
+    parser.getYamlNode("level3.a", node);
+    ASSERT_EQ(1u, node.size());
+}
+
+TEST(Utils_config_ConfigParser, loadCached) {
+    const auto config_file = "/tmp/wave_config_test.yaml";
+    std::ofstream{config_file} << "a: 1\nb:\n  c: 2\n";
+    wave::ConfigParser::clearCache();
+
+    // Parsers loading the same file bind their params from one parsed tree
+    int a1, a2, c;
+    wave::ConfigParser parser1, parser2;
+    parser1.addParam("a", &a1);
+    parser2.addParam("a", &a2);
+    parser2.addParam("b.c", &c);
+    ASSERT_EQ(wave::ConfigStatus::OK, parser1.load(config_file));
+    ASSERT_EQ(wave::ConfigStatus::OK, parser2.load(config_file));
+    EXPECT_EQ(1, a1);
+    EXPECT_EQ(1, a2);
+    EXPECT_EQ(2, c);
+
+    // A changed file is parsed again
+    std::ofstream{config_file} << "a: 10\nb:\n  c: 20\n  d: 30\n";
+    ASSERT_EQ(wave::ConfigStatus::OK, parser2.load(config_file));
+    EXPECT_EQ(10, a2);
+    EXPECT_EQ(20, c);
+
+    // Loading another file into a parser leaves the first tree unchanged
+    wave::ConfigParser parser3;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser3.load(config_file));
+    ASSERT_EQ(wave::ConfigStatus::OK, parser3.load(TEST_CONFIG));
+    YAML::Node node;
+    parser2.getYamlNode("b.c", node);
+    EXPECT_EQ(20, node.as<int>());
+
+    // Assigning a parser leaves the tree it had loaded unchanged for other
+    // parsers
+    wave::ConfigParser parser4, parser5;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser4.load(TEST_CONFIG));
+    parser4 = parser2;
+    parser4.getYamlNode("b.c", node);
+    EXPECT_EQ(20, node.as<int>());
+    ASSERT_EQ(wave::ConfigStatus::OK, parser5.load(TEST_CONFIG));
+    parser5.getYamlNode("level3.a.b.c", node);
+    EXPECT_EQ(3, node.as<int>());
+
+    remove(config_file);
+}
+
+TEST(Utils_config_ConfigParser, getYamlNodeCopy) {
+    const auto config_file = "/tmp/wave_config_test.yaml";
+    std::ofstream{config_file} << "a: 1\nb:\n  c: 2\n";
+    wave::ConfigParser::clearCache();
+
+    wave::ConfigParser parser1, parser2;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser1.load(config_file));
+    ASSERT_EQ(wave::ConfigStatus::OK, parser2.load(config_file));
+
+    // Changing a node from one parser does not affect the other, nor later
+    // loads of the same file
+    YAML::Node node, other;
+    parser1.getYamlNode("b", node);
+    node["c"] = 3;
+    node["d"] = 4;
+    parser1.getYamlNode("a", node);
+    node = 5;
+    parser1.getYamlNode("a", other);
+    EXPECT_EQ(1, other.as<int>());
+
+    int a, c;
+    wave::ConfigParser parser3;
+    parser3.addParam("a", &a);
+    parser3.addParam("b.c", &c);
+    ASSERT_EQ(wave::ConfigStatus::OK, parser3.load(config_file));
+    EXPECT_EQ(1, a);
+    EXPECT_EQ(2, c);
+    parser2.getYamlNode("b.c", node);
+    EXPECT_EQ(2, node.as<int>());
+    EXPECT_EQ(wave::ConfigStatus::KeyError, parser2.checkKey("b.d", false));
+
+    remove(config_file);
+}
+
+TEST(Utils_config_ConfigParser, loadCachedReplaced) {
+    const auto config_file = "/tmp/wave_config_test.yaml";
+    const auto new_file = "/tmp/wave_config_test_new.yaml";
+    std::ofstream{config_file} << "a: 1\n";
+    wave::ConfigParser::clearCache();
+
+    int a;
+    wave::ConfigParser parser;
+    parser.addParam("a", &a);
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(config_file));
+    EXPECT_EQ(1, a);
+
+    // Replace the file by one of the same size and modification time, as
+    // copying with preserved timestamps would
+    struct stat st;
+    ASSERT_EQ(0, stat(config_file, &st));
+    std::ofstream{new_file} << "a: 2\n";
+    const struct timespec times[2] = {st.st_atim, st.st_mtim};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, new_file, times, 0));
+    ASSERT_EQ(0, rename(new_file, config_file));
+
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(config_file));
+    EXPECT_EQ(2, a);
+
+    remove(config_file);
+}
@@ -0,0 +1,152 @@
+/** @file
+ * Throughput of loading and saving large csv files.
+ *
+ * A csv file of random values, like a long IMU or ground truth log, is
+ * written once for each size. The first argument is its size in MB; the
+ * loader also takes a number of threads. The previous getline() and atof()
+ * loader and ostream writer are kept here as the baseline.
+ */
+
+#include <cstdio>
+#include <map>
+#include <sstream>
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/data.hpp"
+
+namespace wave {
+
+const int kCols = 10;
+
+/** The previous loader, which read the file three times */
+int csv2matGetline(std::string file_path, bool header, MatX &data) {
+    std::ifstream infile(file_path);
+    if (infile.good() != true) {
+        return -1;
+    }
+    int nb_rows = csvrows(file_path);
+    int nb_cols = csvcols(file_path);
+
+    std::string line, element;
+    if (header) {
+        std::getline(infile, line);
+        nb_rows -= 1;
+    }
+    int line_no = 0;
+    data.resize(nb_rows, nb_cols);
+    while (std::getline(infile, line)) {
+        std::istringstream ss(line);
+        for (int i = 0; i < nb_cols; i++) {
+            std::getline(ss, element, ',');
+            data(line_no, i) = atof(element.c_str());
+        }
+        line_no++;
+    }
+    return 0;
+}
+
+/** The previous writer, streaming each value */
+int mat2csvOstream(std::string file_path, MatX data) {
+    std::ofstream outfile(file_path);
+    if (outfile.good() != true) {
+        return -1;
+    }
+    for (int i = 0; i < data.rows(); i++) {
+        for (int j = 0; j < data.cols(); j++) {
+            outfile << data(i, j);
+            if ((j + 1) != data.cols()) {
+                outfile << ",";
+            }
+        }
+        outfile << "\n";
+    }
+    return 0;
+}
+
+/** Random data of about `size_mb` MB when saved */
+MatX randomData(int size_mb) {
+    // "-0.123456," is about 10 bytes
+    const int rows = size_mb * 1000000 / (10 * kCols);
+    return MatX::Random(rows, kCols);
+}
+
+/** Path to a csv file of the given size, written on first use */
+std::string csvFile(int size_mb) {
+    static std::map<int, std::string> files;
+    auto it = files.find(size_mb);
+    if (it == files.end()) {
+        const auto path =
+          "/tmp/wave_data_benchmark_" + std::to_string(size_mb) + ".csv";
+        mat2csv(path, randomData(size_mb));
+        it = files.emplace(size_mb, path).first;
+    }
+    return it->second;
+}
+
+/** Size of the file at `path` in bytes */
+int64_t fileSize(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    return file.tellg();
+}
+
+void BM_Csv2MatGetline(benchmark::State &state) {
+    const auto path = csvFile(state.range(0));
+    MatX data;
+    for (auto _ : state) {
+        csv2matGetline(path, false, data);
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(state.iterations() * fileSize(path));
+}
+
+void BM_Csv2Mat(benchmark::State &state) {
+    const auto path = csvFile(state.range(0));
+    MatX data;
+    for (auto _ : state) {
+        csv2mat(path, false, data, state.range(1));
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetBytesProcessed(state.iterations() * fileSize(path));
+}
+
+void BM_Mat2CsvOstream(benchmark::State &state) {
+    const MatX data = randomData(state.range(0));
+    const std::string path = "/tmp/wave_data_benchmark_out.csv";
+    for (auto _ : state) {
+        mat2csvOstream(path, data);
+    }
+    state.SetBytesProcessed(state.iterations() * fileSize(path));
+    std::remove(path.c_str());
+}
+
+void BM_Mat2Csv(benchmark::State &state) {
+    const MatX data = randomData(state.range(0));
+    const std::string path = "/tmp/wave_data_benchmark_out.csv";
+    for (auto _ : state) {
+        mat2csv(path, data);
+    }
+    state.SetBytesProcessed(state.iterations() * fileSize(path));
+    std::remove(path.c_str());
+}
+
+BENCHMARK(BM_Csv2MatGetline)
+  ->Arg(500)
+  ->Iterations(1)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Csv2Mat)
+  ->Args({500, 1})
+  ->Args({500, 4})
+  ->Args({500, 8})
+  ->Iterations(3)
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Mat2CsvOstream)
+  ->Arg(500)
+  ->Iterations(1)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Mat2Csv)->Arg(500)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
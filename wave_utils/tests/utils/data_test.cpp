@@ -46,4 +46,73 @@ TEST(Utils_data, mat2csv) {
     }
 }
 
+TEST(Utils_data, csv2matThreads) {
+    // Big enough to be split into several chunks
+    MatX x = MatX::Random(100000, 7);
+    mat2csv(TEST_OUTPUT, x);
+
+    MatX y, z;
+    ASSERT_EQ(0, csv2mat(TEST_OUTPUT, false, y, 1));
+    ASSERT_EQ(0, csv2mat(TEST_OUTPUT, false, z, 4));
+    ASSERT_EQ(x.rows(), y.rows());
+    ASSERT_EQ(x.cols(), y.cols());
+    ASSERT_TRUE(y.isApprox(x, 1e-5));
+    ASSERT_EQ(y, z);
+}
+
+TEST(Utils_data, csv2matFormats) {
+    std::ofstream outfile(TEST_OUTPUT);
+    outfile << "a,b,c\r\n"
+            << "1, -2.5 ,3e2\r\n"
+            << "+.5,1.25E-3,-0\n"
+            << "123456789012345678901,0.1e-30,nan\n"
+            << "7,,x\n"
+            << "8";
+    outfile.close();
+
+    MatX data;
+    ASSERT_EQ(0, csv2mat(TEST_OUTPUT, true, data));
+    ASSERT_EQ(5, data.rows());
+    ASSERT_EQ(3, data.cols());
+    EXPECT_EQ(1.0, data(0, 0));
+    EXPECT_EQ(-2.5, data(0, 1));
+    EXPECT_EQ(300.0, data(0, 2));
+    EXPECT_EQ(0.5, data(1, 0));
+    EXPECT_EQ(1.25e-3, data(1, 1));
+    EXPECT_EQ(0.0, data(1, 2));
+    EXPECT_EQ(123456789012345678901.0, data(2, 0));
+    EXPECT_EQ(0.1e-30, data(2, 1));
+    EXPECT_TRUE(std::isnan(data(2, 2)));
+    EXPECT_EQ(7.0, data(3, 0));
+    EXPECT_EQ(0.0, data(3, 1));
+    EXPECT_EQ(0.0, data(3, 2));
+    EXPECT_EQ(8.0, data(4, 0));
+    EXPECT_EQ(0.0, data(4, 1));
+
+    // Every value parses to the closest double
+    MatX x = MatX::Random(1000, 3) * 1e3;
+    outfile.open(TEST_OUTPUT);
+    outfile.precision(15);
+    outfile << x.format(Eigen::IOFormat{15, Eigen::DontAlignCols, ","});
+    outfile.close();
+    ASSERT_EQ(0, csv2mat(TEST_OUTPUT, false, data));
+    for (int i = 0; i < x.rows(); i++) {
+        for (int j = 0; j < x.cols(); j++) {
+            std::ostringstream ss;
+            ss.precision(15);
+            ss << x(i, j);
+            EXPECT_EQ(std::strtod(ss.str().c_str(), nullptr), data(i, j));
+        }
+    }
+}
+
+TEST(Utils_data, csv2matEmptyOrMissing) {
+    std::ofstream{TEST_OUTPUT}.close();
+    MatX data;
+    ASSERT_EQ(0, csv2mat(TEST_OUTPUT, true, data));
+    ASSERT_EQ(0, data.rows());
+
+    ASSERT_EQ(-1, csv2mat("/tmp/wave_no_such_file.csv", false, data));
+}
+
 }  // namespace wave
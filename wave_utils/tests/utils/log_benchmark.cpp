@@ -0,0 +1,88 @@
+/** @file
+ * Cost of a log call to the thread making it.
+ *
+ * Output goes to /dev/null, so these measure formatting and queuing rather
+ * than the terminal, which would only make the synchronous cases slower. The
+ * previous macro, an fprintf() straight to the stream, is kept here as the
+ * baseline.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/log.hpp"
+
+#define LOG_INFO_FPRINTF(M, ...) \
+    fprintf(devNull(), "[INFO] " M "\n", ##__VA_ARGS__)
+
+namespace wave {
+
+/** /dev/null, line buffered like `stdout` on a terminal */
+FILE *devNull() {
+    static FILE *file = []() {
+        FILE *file = fopen("/dev/null", "w");
+        setvbuf(file, nullptr, _IOLBF, BUFSIZ);
+        return file;
+    }();
+    return file;
+}
+
+void BM_LogFprintf(benchmark::State &state) {
+    int i = 0;
+    for (auto _ : state) {
+        LOG_INFO_FPRINTF("Iteration %d of %s at %f", i++, "benchmark", 1.5);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LogSynchronous(benchmark::State &state) {
+    setLogAsynchronous(false);
+    int i = 0;
+    for (auto _ : state) {
+        LOG_INFO("Iteration %d of %s at %f", i++, "benchmark", 1.5);
+    }
+    setLogAsynchronous(true);
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LogAsynchronous(benchmark::State &state) {
+    int i = 0;
+    for (auto _ : state) {
+        LOG_INFO("Iteration %d of %s at %f", i++, "benchmark", 1.5);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LogThrottled(benchmark::State &state) {
+    int i = 0;
+    for (auto _ : state) {
+        LOG_INFO_THROTTLE(1.0, "Iteration %d of %s at %f", i++, "bm", 1.5);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LogDisabled(benchmark::State &state) {
+    int i = 0;
+    for (auto _ : state) {
+        LOG_DEBUG("Iteration %d of %s at %f", i++, "benchmark", 1.5);
+        benchmark::DoNotOptimize(i);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LogFprintf);
+BENCHMARK(BM_LogFprintf)->Threads(4)->UseRealTime();
+BENCHMARK(BM_LogSynchronous);
+BENCHMARK(BM_LogAsynchronous);
+BENCHMARK(BM_LogAsynchronous)->Threads(4)->UseRealTime();
+BENCHMARK(BM_LogThrottled);
+BENCHMARK(BM_LogDisabled);
+
+}  // namespace wave
+
+int main(int argc, char **argv) {
+    wave::setLogOutput(wave::devNull(), wave::devNull());
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    wave::flushLog();
+    return 0;
+}
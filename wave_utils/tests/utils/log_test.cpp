@@ -0,0 +1,185 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wave/wave_test.hpp"
+#include "wave/utils/log.hpp"
+
+namespace wave {
+
+/** Redirects the log to temporary files for the duration of a test */
+class LogTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        this->out = tmpfile();
+        this->err = tmpfile();
+        setLogOutput(this->out, this->err);
+    }
+
+    void TearDown() override {
+        setLogOutput(stdout, stderr);
+        setLogAsynchronous(true);
+        fclose(this->out);
+        fclose(this->err);
+    }
+
+    /** Everything written to `file` so far */
+    std::string contents(FILE *file) {
+        flushLog();
+        std::string text;
+        rewind(file);
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, n);
+        }
+        return text;
+    }
+
+    FILE *out;
+    FILE *err;
+};
+
+TEST_F(LogTest, streams) {
+    const auto line = std::to_string(__LINE__ + 2);
+    LOG_INFO("info %d", 1);
+    LOG_ERROR("error %s", "two");
+
+    EXPECT_EQ("[INFO] info 1\n", this->contents(this->out));
+    EXPECT_EQ("[ERROR] [log_test.cpp:" + line + "] error two\n",
+              this->contents(this->err));
+    LOG_WARN("warning");
+    EXPECT_NE(std::string::npos,
+              this->contents(this->err).find("[WARN] [log_test.cpp:"));
+}
+
+TEST_F(LogTest, order) {
+    std::string expected;
+    for (int i = 0; i < 10000; i++) {
+        LOG_INFO("%d", i);
+        expected += "[INFO] " + std::to_string(i) + "\n";
+    }
+    EXPECT_EQ(expected, this->contents(this->out));
+}
+
+TEST_F(LogTest, synchronous) {
+    setLogAsynchronous(false);
+    LOG_INFO("now");
+
+    // Written without flushLog()
+    rewind(this->out);
+    char buffer[32] = {};
+    fread(buffer, 1, sizeof(buffer) - 1, this->out);
+    EXPECT_STREQ("[INFO] now\n", buffer);
+}
+
+/** Everything written to `file` so far, without flushing the log */
+std::string written(FILE *file) {
+    std::string text;
+    rewind(file);
+    char buffer[256];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, n);
+    }
+    return text;
+}
+
+TEST_F(LogTest, errorsSynchronous) {
+    LOG_INFO("before");
+    LOG_ERROR("error");
+
+    // Written without flushLog(), after the messages queued before
+    EXPECT_NE(std::string::npos, written(this->err).find("error\n"));
+    EXPECT_EQ("[INFO] before\n", written(this->out));
+    LOG_WARN("warning");
+    EXPECT_NE(std::string::npos, written(this->err).find("warning\n"));
+}
+
+TEST_F(LogTest, threads) {
+    const int nb_threads = 4;
+    const int nb_messages = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nb_threads; t++) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < nb_messages; i++) {
+                LOG_INFO("%d %d", t, i);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // Every message is whole, and each thread's messages are in order
+    const auto text = this->contents(this->out);
+    std::vector<int> next(nb_threads, 0);
+    size_t begin = 0;
+    while (begin < text.size()) {
+        const size_t end = text.find('\n', begin);
+        ASSERT_NE(std::string::npos, end);
+        int t, i;
+        ASSERT_EQ(2, sscanf(text.c_str() + begin, "[INFO] %d %d", &t, &i));
+        ASSERT_EQ(next[t], i);
+        next[t]++;
+        begin = end + 1;
+    }
+    for (int t = 0; t < nb_threads; t++) {
+        EXPECT_EQ(nb_messages, next[t]);
+    }
+}
+
+TEST_F(LogTest, longMessage) {
+    const std::string report(2000, 'x');
+    LOG_INFO("%s", report.c_str());
+    EXPECT_EQ("[INFO] " + report + "\n", this->contents(this->out));
+
+    // Messages too long for the buffer are truncated, keeping the newline
+    const std::string huge(100000, 'y');
+    LOG_INFO("%s", huge.c_str());
+    LOG_INFO("after");
+    const auto text = this->contents(this->out);
+    const size_t after = text.find("[INFO] after\n");
+    ASSERT_NE(std::string::npos, after);
+    EXPECT_EQ('\n', text[after - 1]);
+    EXPECT_GT(after, 10000u);
+}
+
+TEST_F(LogTest, throttle) {
+    for (int i = 0; i < 100; i++) {
+        LOG_INFO_THROTTLE(100.0, "repeated %d", i);
+    }
+    EXPECT_EQ("[INFO] repeated 0\n", this->contents(this->out));
+
+    // The next message after the period reports the suppressed ones
+    for (int i = 0; i < 3; i++) {
+        LOG_INFO_THROTTLE(0.05, "periodic");
+        if (i == 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        }
+    }
+    const auto text = this->contents(this->out);
+    EXPECT_NE(std::string::npos,
+              text.find("[INFO] periodic\n"
+                        "[INFO] periodic (1 similar messages suppressed)\n"));
+}
+
+TEST(LogThrottle, check) {
+    LogThrottle throttle{100.0};
+    int suppressed = -1;
+    EXPECT_TRUE(throttle.check(suppressed));
+    EXPECT_EQ(0, suppressed);
+    EXPECT_FALSE(throttle.check(suppressed));
+    EXPECT_FALSE(throttle.check(suppressed));
+}
+
+TEST_F(LogTest, debugDisabled) {
+    // LOG_DEBUG is compiled out at the default level, with its arguments
+    int evaluated = 0;
+    LOG_DEBUG("%d", ++evaluated);
+    EXPECT_EQ(0, evaluated);
+    EXPECT_EQ("", this->contents(this->out));
+}
+
+}  // namespace wave
@@ -0,0 +1,57 @@
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "wave/wave_test.hpp"
+#include "wave/utils/parallel.hpp"
+
+namespace wave {
+
+TEST(ParallelFor, callsEachItemOnce) {
+    for (int num_threads : {1, 3, 8}) {
+        std::vector<std::atomic<int>> calls(1000);
+        for (auto &count : calls) {
+            count = 0;
+        }
+        parallelFor(static_cast<int>(calls.size()), num_threads, [&](int i) {
+            calls[i]++;
+        });
+        for (const auto &count : calls) {
+            EXPECT_EQ(1, count);
+        }
+    }
+}
+
+TEST(ParallelFor, threads) {
+    // Each item waits for the others, so all must run at once
+    const int n = 4;
+    std::atomic<int> started{0};
+    std::vector<std::thread::id> ids(n);
+    parallelFor(n, n, [&](int i) {
+        ids[i] = std::this_thread::get_id();
+        started++;
+        while (started < n) {
+            std::this_thread::yield();
+        }
+    });
+    EXPECT_EQ(static_cast<size_t>(n),
+              std::set<std::thread::id>(ids.begin(), ids.end()).size());
+
+    // A single thread runs every item on the calling thread, in order
+    const auto caller = std::this_thread::get_id();
+    std::vector<int> order;
+    parallelFor(5, 1, [&](int i) {
+        EXPECT_EQ(caller, std::this_thread::get_id());
+        order.push_back(i);
+    });
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), order);
+
+    // No items, or no threads requested
+    parallelFor(0, 4, [&](int) { FAIL(); });
+    int calls = 0;
+    parallelFor(3, 0, [&](int) { calls++; });
+    EXPECT_EQ(3, calls);
+}
+
+}  // namespace wave
@@ -0,0 +1,129 @@
+/** @file
+ * Compositions per second when chaining odometry with covariance.
+ *
+ * The argument is the length of the chain. The previous composePose(), which
+ * converted both poses to p6 and p7 forms and multiplied the full 6x7, 7x7
+ * and 7x6 Jacobians for every composition, is kept here as the baseline.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "wave/utils/pose_cov_comp.hpp"
+
+namespace wave {
+
+/** The previous composePose() */
+PoseWithCovariance composePoseJacobians(PoseWithCovariance &p1,
+                                        PoseWithCovariance &p2) {
+    PoseWithCovariance r;
+    Eigen::Affine3d T_r = p1.getTransformMatrix() * p2.getTransformMatrix();
+    r.position = T_r.translation();
+    r.rotation_matrix = T_r.rotation();
+
+    Vector7 pR7 = r.getPoseQuaternion();
+    Vector7 p17 = p1.getPoseQuaternion();
+    Vector7 p27 = p2.getPoseQuaternion();
+    Vector6 p16, p26;
+    p16 << p1.getPosition(), pose_comp::quatToYPR(p1.getQuaternion());
+    p26 << p2.getPosition(), pose_comp::quatToYPR(p2.getQuaternion());
+
+    Matrix6x7 jacobian_p7_to_p6 = jacobian_p7_to_p6_wrt_p(pR7);
+    Matrix6x6 dfpc_dp = jacobian_p7_to_p6 *
+                        jacobian_p7_p7_Composition_wrt_p1(p17, p27) *
+                        jacobian_p6_to_p7_wrt_p(p16);
+    Matrix6x6 dfpc_dq = jacobian_p7_to_p6 *
+                        jacobian_p7_p7_Composition_wrt_p2(p17, p27) *
+                        jacobian_p6_to_p7_wrt_p(p26);
+    r.covariance = dfpc_dp * p1.covariance * dfpc_dp.transpose() +
+                   dfpc_dq * p2.covariance * dfpc_dq.transpose();
+    return r;
+}
+
+/** Odometry increments of about 1 m and 0.05 rad, with small covariance */
+PoseWithCovarianceVector odometry(int length) {
+    srand(1);
+    PoseWithCovarianceVector poses;
+    for (int i = 0; i < length; i++) {
+        Vector6 p = 0.05 * Vector6::Random();
+        p(0) += 1;
+        Matrix6x6 cov = 1e-3 * Matrix6x6::Identity();
+        poses.emplace_back(p, cov);
+    }
+    return poses;
+}
+
+void BM_ComposePoseLoopJacobians(benchmark::State &state) {
+    auto poses = odometry(state.range(0));
+    PoseWithCovarianceVector result(poses.size());
+    for (auto _ : state) {
+        result[0] = poses[0];
+        for (size_t i = 1; i < poses.size(); i++) {
+            result[i] = composePoseJacobians(result[i - 1], poses[i]);
+        }
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (poses.size() - 1));
+}
+
+void BM_ComposePoseLoop(benchmark::State &state) {
+    auto poses = odometry(state.range(0));
+    PoseWithCovarianceVector result(poses.size());
+    for (auto _ : state) {
+        result[0] = poses[0];
+        for (size_t i = 1; i < poses.size(); i++) {
+            result[i] = composePose(result[i - 1], poses[i]);
+        }
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (poses.size() - 1));
+}
+
+void BM_ComposePoseChain(benchmark::State &state) {
+    const auto poses = odometry(state.range(0));
+    PoseWithCovarianceVector result;
+    for (auto _ : state) {
+        composePoseChain(poses, result, CovarianceConvention::YPR);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (poses.size() - 1));
+}
+
+void BM_ComposePoseChainSE3(benchmark::State &state) {
+    const auto poses = odometry(state.range(0));
+    PoseWithCovarianceVector result;
+    for (auto _ : state) {
+        composePoseChain(poses, result, CovarianceConvention::SE3);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (poses.size() - 1));
+}
+
+/** 16 chains of the given length, with the given number of threads */
+void BM_ComposePoseChains(benchmark::State &state) {
+    const std::vector<PoseWithCovarianceVector> chains(
+      16, odometry(state.range(0)));
+    std::vector<PoseWithCovarianceVector> results;
+    for (auto _ : state) {
+        composePoseChains(
+          chains, results, CovarianceConvention::YPR, state.range(1));
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.SetItemsProcessed(state.iterations() * chains.size() *
+                            (state.range(0) - 1));
+}
+
+BENCHMARK(BM_ComposePoseLoopJacobians)
+  ->Arg(100000)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ComposePoseLoop)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ComposePoseChain)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ComposePoseChainSE3)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ComposePoseChains)
+  ->Args({10000, 1})
+  ->Args({10000, 4})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+
+}  // namespace wave
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef WAVE_PROFILING
+#define WAVE_PROFILING
+#endif
+#include "wave/wave_test.hpp"
+#include "wave/utils/profile.hpp"
+
+namespace wave {
+
+const auto TEST_TRACE = "/tmp/wave_profile_test.json";
+
+class ProfileTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        resetProfile();
+    }
+};
+
+TEST_F(ProfileTest, stats) {
+    // Durations of 1 to 100 ms
+    for (int i = 1; i <= 100; i++) {
+        recordProfileEvent("zone", 0, i * 1000000);
+    }
+    recordProfileEvent("other", 0, 5);
+
+    const auto stats = profileStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ("zone", stats[0].name);
+    EXPECT_EQ(100u, stats[0].count);
+    EXPECT_NEAR(5.05, stats[0].total, 1e-9);
+    EXPECT_NEAR(0.0505, stats[0].mean, 1e-9);
+    EXPECT_NEAR(0.050, stats[0].p50, 1e-9);
+    EXPECT_NEAR(0.099, stats[0].p99, 1e-9);
+    EXPECT_NEAR(0.100, stats[0].max, 1e-9);
+    EXPECT_EQ("other", stats[1].name);
+    EXPECT_EQ(1u, stats[1].count);
+
+    const auto report = profileReport();
+    EXPECT_NE(std::string::npos, report.find("zone"));
+    EXPECT_NE(std::string::npos, report.find("other"));
+}
+
+TEST_F(ProfileTest, scope) {
+    for (int i = 0; i < 3; i++) {
+        WAVE_PROFILE_SCOPE("outer");
+        {
+            WAVE_PROFILE_SCOPE("inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds{2});
+        }
+    }
+
+    const auto stats = profileStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ("outer", stats[0].name);
+    EXPECT_EQ("inner", stats[1].name);
+    EXPECT_EQ(3u, stats[0].count);
+    EXPECT_EQ(3u, stats[1].count);
+    EXPECT_GE(stats[1].p50, 0.002);
+    EXPECT_GE(stats[0].total, stats[1].total);
+}
+
+TEST_F(ProfileTest, threads) {
+    // Enough events to fill several blocks in each thread
+    const int nb_threads = 4;
+    const int nb_events = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nb_threads; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < nb_events; i++) {
+                WAVE_PROFILE_SCOPE("thread");
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    const auto stats = profileStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(static_cast<size_t>(nb_threads * nb_events), stats[0].count);
+
+    resetProfile();
+    EXPECT_TRUE(profileStats().empty());
+}
+
+TEST_F(ProfileTest, writeTrace) {
+    recordProfileEvent("a \"quoted\" zone", 1000, 3500);
+    recordProfileEvent("b", 2000, 3000);
+    ASSERT_EQ(0, writeProfileTrace(TEST_TRACE));
+
+    std::ifstream file{TEST_TRACE};
+    std::stringstream text;
+    text << file.rdbuf();
+    EXPECT_NE(std::string::npos,
+              text.str().find("{\"name\":\"a \\\"quoted\\\" zone\","
+                              "\"ph\":\"X\",\"pid\":0,\"tid\":"));
+    EXPECT_NE(std::string::npos,
+              text.str().find("\"ts\":1.000,\"dur\":2.500}"));
+    EXPECT_NE(std::string::npos,
+              text.str().find("\"ts\":2.000,\"dur\":1.000}\n]}"));
+    std::remove(TEST_TRACE);
+
+    EXPECT_EQ(-1, writeProfileTrace("/nonexistent/trace.json"));
+}
+
+}  // namespace wave
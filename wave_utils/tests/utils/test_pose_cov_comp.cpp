@@ -526,4 +526,128 @@ TEST(PoseCovComp, covariance_test_D) {
     Matrix6x6 covar(r1.covariance);
     EXPECT_TRUE(covar.isApprox(m_exp, 1e-6));
 }
-}  // namespace wave
\ No newline at end of file
+
+/// Random pose with a random covariance of size about `scale`
+PoseWithCovariance randomPose(double scale) {
+    Vector3 position = Vector3::Random();
+    Vector3 ypr = M_PI * Vector3::Random();
+    ypr(1) /= 2;
+    Matrix3x3 rotation = pose_comp::yprToRotMatrix(ypr);
+    Matrix6x6 cov = Matrix6x6::Random();
+    cov = scale * cov * cov.transpose();
+    return PoseWithCovariance(position, rotation, cov);
+}
+
+/// Composed pose in [x y z yaw pitch roll], given both poses in that form
+Vector6 composeP6(const Vector6 &p1, const Vector6 &p2) {
+    Matrix3x3 r1 = pose_comp::yprToRotMatrix(p1.tail<3>());
+    Matrix3x3 r2 = pose_comp::yprToRotMatrix(p2.tail<3>());
+    Vector6 r;
+    r << p1.head<3>() + r1 * p2.head<3>(), pose_comp::rotMatrixToYPR(r1 * r2);
+    return r;
+}
+
+/// Check the covariance against Jacobians by central differences, whatever
+/// the signs of the quaternions of the poses
+TEST(PoseCovComp, covariance_finite_differences) {
+    srand(1);
+    for (int i = 0; i < 100; i++) {
+        PoseWithCovariance pc1 = randomPose(1e-2), pc2 = randomPose(1e-2);
+        PoseWithCovariance r = composePose(pc1, pc2);
+
+        Vector6 p1, p2;
+        p1 << pc1.position, pc1.getYPR();
+        p2 << pc2.position, pc2.getYPR();
+        Matrix6x6 j1, j2;
+        const double h = 1e-6;
+        for (int k = 0; k < 6; k++) {
+            Vector6 d = Vector6::Zero();
+            d(k) = h;
+            j1.col(k) = (composeP6(p1 + d, p2) - composeP6(p1 - d, p2)) / 2 / h;
+            j2.col(k) = (composeP6(p1, p2 + d) - composeP6(p1, p2 - d)) / 2 / h;
+        }
+        Matrix6x6 expected = j1 * pc1.covariance * j1.transpose() +
+                             j2 * pc2.covariance * j2.transpose();
+        EXPECT_TRUE(r.covariance.isApprox(expected, 1e-6));
+    }
+}
+
+/// The SE(3) covariance maps a left perturbation xi2 of the second pose to
+/// the left perturbation Ad(T1) xi2 of the composed pose
+TEST(PoseCovComp, covariance_se3) {
+    srand(2);
+    PoseWithCovariance pc1 = randomPose(0), pc2 = randomPose(0);
+    Eigen::Matrix4d t1 = pc1.getTransformMatrix().matrix();
+
+    for (int k = 0; k < 6; k++) {
+        Vector6 xi = Vector6::Zero();
+        xi(k) = 1;
+        pc2.covariance = xi * xi.transpose();
+        PoseWithCovariance r =
+          composePose(pc1, pc2, CovarianceConvention::SE3);
+
+        // T1 xi^ T1^-1 is the perturbation of the composed pose
+        Eigen::Matrix4d xi_hat = Eigen::Matrix4d::Zero();
+        xi_hat.block<3, 3>(0, 0) << 0, -xi(5), xi(4), xi(5), 0, -xi(3),
+          -xi(4), xi(3), 0;
+        xi_hat.block<3, 1>(0, 3) = xi.head<3>();
+        Eigen::Matrix4d m = t1 * xi_hat * t1.inverse();
+        Vector6 expected_xi;
+        expected_xi << m.block<3, 1>(0, 3), m(2, 1), m(0, 2), m(1, 0);
+
+        Matrix6x6 expected = expected_xi * expected_xi.transpose();
+        EXPECT_TRUE(r.covariance.isApprox(expected, 1e-12));
+    }
+}
+
+TEST(PoseCovComp, compose_pose_chain) {
+    srand(3);
+    PoseWithCovarianceVector poses;
+    for (int i = 0; i < 50; i++) {
+        poses.push_back(randomPose(1e-4));
+    }
+
+    for (auto convention :
+         {CovarianceConvention::YPR, CovarianceConvention::SE3}) {
+        PoseWithCovarianceVector result;
+        composePoseChain(poses, result, convention);
+        ASSERT_EQ(poses.size(), result.size());
+
+        PoseWithCovariance expected = poses[0];
+        for (size_t i = 0; i < poses.size(); i++) {
+            if (i > 0) {
+                expected = composePose(expected, poses[i], convention);
+            }
+            EXPECT_TRUE(result[i].position.isApprox(expected.position));
+            EXPECT_TRUE(
+              result[i].rotation_matrix.isApprox(expected.rotation_matrix));
+            EXPECT_TRUE(result[i].covariance.isApprox(expected.covariance));
+        }
+    }
+
+    PoseWithCovarianceVector result;
+    composePoseChain(PoseWithCovarianceVector{}, result);
+    EXPECT_TRUE(result.empty());
+}
+
+TEST(PoseCovComp, compose_pose_chains) {
+    srand(4);
+    std::vector<PoseWithCovarianceVector> chains(7);
+    for (size_t c = 0; c < chains.size(); c++) {
+        for (size_t i = 0; i < 10 + c; i++) {
+            chains[c].push_back(randomPose(1e-4));
+        }
+    }
+
+    std::vector<PoseWithCovarianceVector> results;
+    composePoseChains(chains, results, CovarianceConvention::YPR, 3);
+    ASSERT_EQ(chains.size(), results.size());
+    for (size_t c = 0; c < chains.size(); c++) {
+        PoseWithCovarianceVector expected;
+        composePoseChain(chains[c], expected);
+        ASSERT_EQ(expected.size(), results[c].size());
+        EXPECT_TRUE(
+          results[c].back().covariance.isApprox(expected.back().covariance));
+    }
+}
+}  // namespace wave
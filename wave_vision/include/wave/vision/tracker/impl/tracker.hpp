@@ -150,6 +150,8 @@ template <typename TDetector, typename TDescriptor, typename TMatcher>
 void Tracker<TDetector, TDescriptor, TMatcher>::addImage(
   const cv::Mat &image,
   const std::chrono::steady_clock::time_point &current_time) {
+    WAVE_PROFILE_SCOPE("Tracker::addImage");
+
     // Register the time this image
     this->timestampImage(current_time);
 
@@ -203,8 +203,7 @@ TEST(VisionYamlConfig, loadCvMatParam) {
     cv::Mat cvmat;
 
     // setup
-    parser.root = YAML::LoadFile(TEST_CONFIG_FILE);
-    parser.config_loaded = true;
+    ASSERT_EQ(wave::ConfigStatus::OK, parser.load(TEST_CONFIG_FILE));
 
     // CV MATRIX
     wave::ConfigParam<cv::Mat> cvmat_param{"test_matrix", &cvmat};